@@ -0,0 +1,333 @@
+/**
+ * @file balancectrl.hpp
+ * @brief Balancing controller of a battery
+ *
+ * Takes the cell voltage measurements and returns the switch states
+ * as a bitmask, bit i for cell i. The controller is header only,
+ * does not allocate, throw, lock or print, and its run time does not
+ * depend on the measured values, so the same code can run on the BMS
+ * microcontroller and in the simulator.
+ *
+ * @author Subir Biswas
+ * @date 19/10/2026
+ * @see setbatt.cpp
+ */
+
+#ifndef  BALANCECTRL_CLASS
+#define  BALANCECTRL_CLASS
+
+#include <stdint.h>	// uint32_t
+#include "balancepolicy.hpp"
+
+#define CTRLMAXCELLS	32	///<Maximum number of cells, one bit each in the switch mask
+#define CTRLHISTBINS	8	///<Number of bins of the toggle rate histogram
+
+/**
+ * @brief The balancing controller
+ *
+ * Connects the best cell and every cell whose score is within the
+ * band of it. The policy gives the scores, by default the cell voltage,
+ * so the band is the tolerance band in Volts. The output voltage is
+ * the lowest connected cell voltage. Two passes over the cells without branches
+ * on the measurements, then the toggle counting visits the changed
+ * switches and, at the end of a window, every switch. So the work is
+ * bounded by the number of cells, the worst case being every switch
+ * toggling at the end of a window.
+ *
+ * Chatter near the band edge is suppressed by hysteresis and dwell:
+ * a disconnected cell joins within BandOn of the best cell, a
+ * connected cell stays till it falls BandOff below it, and a switch
+ * keeps its state for at least MinOn / MinOff decisions. The best
+ * cell is always connected. With BandOff equal to BandOn and no dwell
+ * the decision is the plain tolerance band.
+ *
+ * Every switch change is counted. The toggles of each switch are also
+ * counted per window of decisions and the windows are binned into a
+ * histogram by toggle count: bin 0 holds windows without toggles,
+ * bin b holds windows with 2^(b-1) to 2^b - 1 toggles, the last bin
+ * holds the rest.
+ *
+ * @param T numeric type of the measurements
+ * @param Policy the balancing policy. @see balancepolicy.hpp
+ */
+template<typename T, typename Policy = cVoltagePolicy<T> >
+class cBalanceController
+{
+	public:
+		cBalanceController() noexcept
+		{
+			BandOn = Rule.defaultBand();	//5 mV for the voltage policy
+			BandOff = BandOn;
+			MinOn = 0;
+			MinOff = 0;
+			Window = 100;
+			reset();
+		}
+
+		/**
+		 * @brief Clears the switch states and the toggle metrics
+		 *
+		 * @param void
+		 * @return void
+		 */
+		void reset(void) noexcept
+		{
+			Output = T(0);
+			Mask = 0;
+			Decisions = 0;
+			WindowTicks = 0;
+			for(int i=0; i<CTRLMAXCELLS; i++)
+			{
+				Held[i] = 0xFFFFFFFF;
+				Toggles[i] = 0;
+				WindowToggles[i] = 0;
+				for(int b=0; b<CTRLHISTBINS; b++)
+					Histogram[i][b] = 0;
+			}
+		}
+
+		/**
+		 * @brief Sets the width of the balancing band without hysteresis
+		 *
+		 * @param tolerance band in units of the score, Volts for the voltage policy
+		 * @return void
+		 */
+		void setTolerance(T tolerance) noexcept
+		{
+			BandOn = tolerance;
+			BandOff = tolerance;
+		}
+
+		/**
+		 * @brief Sets the hysteresis bands
+		 *
+		 * @param on	a disconnected cell joins within this band
+		 * @param off	a connected cell leaves beyond this band
+		 * @return bool false if off is narrower than on
+		 */
+		bool setHysteresis(T on, T off) noexcept
+		{
+			if(off < on)
+				return false;
+			BandOn = on;
+			BandOff = off;
+			return true;
+		}
+
+		/**
+		 * @brief Sets the minimum dwell times
+		 *
+		 * @param on	decisions a switch stays on after it was turned on
+		 * @param off	decisions a switch stays off after it was turned off
+		 * @return void
+		 */
+		void setDwell(uint32_t on, uint32_t off) noexcept
+		{
+			MinOn = on;
+			MinOff = off;
+		}
+
+		/**
+		 * @brief Sets the length of the toggle rate window
+		 *
+		 * @param decisions number of decisions in a window, at least 1
+		 * @return void
+		 */
+		void setWindow(uint32_t decisions) noexcept
+		{
+			Window = (decisions > 0) ? decisions : 1;
+		}
+
+		/**
+		 * @brief Takes the balancing decision from cell voltages only
+		 *
+		 * For policies that only score on the voltage.
+		 * @param volts	measured cell voltages in Volts
+		 * @param n	number of cells, at most CTRLMAXCELLS
+		 * @return uint32_t switch mask, 0 if n is out of range
+		 */
+		uint32_t decide(const T* volts, int n) noexcept
+		{
+			sPolicyInput<T> in;
+			in.Count = n;
+			in.Voltage = volts;
+			in.Soc = (const T*)0;
+			in.Resistance = (const T*)0;
+			in.Gradient = (const T*)0;
+			in.Load = T(0);
+			return decide(in);
+		}
+
+		/**
+		 * @brief Takes the balancing decision
+		 *
+		 * @param input	measurements and cell parameters
+		 * @return uint32_t switch mask, 0 if the cell count is out of range
+		 */
+		uint32_t decide(const sPolicyInput<T>& input) noexcept
+		{
+			int n = input.Count;
+			if(n <= 0 || n > CTRLMAXCELLS)
+			{
+				Mask = 0;
+				Output = T(0);
+				return 0;
+			}
+			const T* volts = input.Voltage;
+			T scores[CTRLMAXCELLS];
+			int i, top = 0;
+			Rule.prepare(input);
+			for(i=0; i<n; i++)
+				scores[i] = Rule.score(input, i);
+			T best = scores[0];
+			for(i=1; i<n; i++)
+			{
+				top = (best < scores[i]) ? i : top;
+				best = (best < scores[i]) ? scores[i] : best;
+			}
+			uint32_t previous = Mask;
+			uint32_t was, want, keep, in;
+			T band;
+			T lowest = volts[top];
+			Mask = 0;
+			for(i=0; i<n; i++)
+			{
+				was = (previous >> i) & 1;
+				band = was ? BandOff : BandOn;
+				want = ((best - scores[i]) <= band) ? 1 : 0;
+				keep = (Held[i] < (was ? MinOn : MinOff)) ? 1 : 0;
+				in = keep ? was : want;
+				in = (i == top) ? 1 : in;
+				Mask |= in << i;
+				lowest = (in && volts[i] < lowest) ? volts[i] : lowest;
+			}
+			Output = lowest;
+			count(previous ^ Mask, n);
+			return Mask;
+		}
+
+		/**
+		 * @brief Returns the policy to set its parameters
+		 *
+		 * @param void
+		 * @return Policy& the policy
+		 */
+		Policy& getPolicy(void) noexcept
+		{
+			return Rule;
+		}
+
+		/**
+		 * @brief Returns the output voltage of the last decision
+		 *
+		 * @param void
+		 * @return T lowest connected cell voltage in Volts
+		 */
+		T getOutputVoltage(void) const noexcept
+		{
+			return Output;
+		}
+
+		/**
+		 * @brief Returns the switch mask of the last decision
+		 *
+		 * @param void
+		 * @return uint32_t switch mask
+		 */
+		uint32_t getMask(void) const noexcept
+		{
+			return Mask;
+		}
+
+		/**
+		 * @brief Returns the number of decisions since reset
+		 *
+		 * @param void
+		 * @return uint32_t decisions
+		 */
+		uint32_t getDecisions(void) const noexcept
+		{
+			return Decisions;
+		}
+
+		/**
+		 * @brief Returns how often a switch changed state since reset
+		 *
+		 * @param cell index of the switch
+		 * @return uint32_t toggles, 0 if cell is out of range
+		 */
+		uint32_t getToggles(int cell) const noexcept
+		{
+			if(cell < 0 || cell >= CTRLMAXCELLS)
+				return 0;
+			return Toggles[cell];
+		}
+
+		/**
+		 * @brief Returns a bin of the toggle rate histogram of a switch
+		 *
+		 * @param cell	index of the switch
+		 * @param bin	index of the bin
+		 * @return uint32_t number of windows in the bin, 0 if out of range
+		 */
+		uint32_t getHistogram(int cell, int bin) const noexcept
+		{
+			if(cell < 0 || cell >= CTRLMAXCELLS || bin < 0 || bin >= CTRLHISTBINS)
+				return 0;
+			return Histogram[cell][bin];
+		}
+
+	private:
+		Policy Rule;				///<Scores the cells
+		T BandOn;				///<A disconnected cell joins within this band, in units of the score
+		T BandOff;				///<A connected cell leaves beyond this band, in units of the score
+		uint32_t MinOn;				///<Minimum on time of a switch in decisions
+		uint32_t MinOff;			///<Minimum off time of a switch in decisions
+		uint32_t Window;			///<Length of a toggle rate window in decisions
+		T Output;				///<Output voltage of the last decision in Volts
+		uint32_t Mask;				///<Switch mask of the last decision
+		uint32_t Decisions;			///<Decisions since reset
+		uint32_t WindowTicks;			///<Decisions in the current window
+		uint32_t Held[CTRLMAXCELLS];		///<Decisions since each switch last changed, saturating
+		uint32_t Toggles[CTRLMAXCELLS];		///<Changes of each switch since reset
+		uint32_t WindowToggles[CTRLMAXCELLS];	///<Changes of each switch in the current window
+		uint32_t Histogram[CTRLMAXCELLS][CTRLHISTBINS];	///<Windows of each switch binned by toggle count
+
+		/**
+		 * @brief Updates the dwell counters and the toggle metrics
+		 *
+		 * Only the changed switches are visited for the counters.
+		 * @param changed	mask of the switches that changed
+		 * @param n		number of cells
+		 * @return void
+		 */
+		void count(uint32_t changed, int n) noexcept
+		{
+			int i, bin;
+			for(i=0; i<n; i++)
+			{
+				Held[i] += (Held[i] != 0xFFFFFFFF) ? 1 : 0;
+				Held[i] = ((changed >> i) & 1) ? 0 : Held[i];
+			}
+			while(changed)
+			{
+				i = __builtin_ctz(changed);
+				changed &= changed - 1;
+				Toggles[i]++;
+				WindowToggles[i]++;
+			}
+			Decisions++;
+			if(++WindowTicks < Window)
+				return;
+			WindowTicks = 0;
+			for(i=0; i<n; i++)
+			{
+				bin = WindowToggles[i] ? 32 - __builtin_clz(WindowToggles[i]) : 0;
+				bin = (bin < CTRLHISTBINS) ? bin : CTRLHISTBINS - 1;
+				Histogram[i][bin]++;
+				WindowToggles[i] = 0;
+			}
+		}
+};
+
+#endif //BALANCECTRL_CLASS
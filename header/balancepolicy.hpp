@@ -0,0 +1,130 @@
+/**
+ * @file balancepolicy.hpp
+ * @brief Balancing policies of the balancing controller
+ *
+ * A policy ranks the cells by a score, the controller connects the
+ * best cell and every cell whose score is within the band of it.
+ * Policies are plain classes given to the controller as a template
+ * parameter, so there is no virtual call per cell and step. A policy
+ * provides:
+ *	- defaultBand()	 the band in the units of its score
+ *	- prepare(in)	 work done once per decision
+ *	- score(in, i)	 the score of cell i, higher is better
+ *	- name()	 a short name for reports
+ *
+ * @author Subir Biswas
+ * @date 19/10/2026
+ * @see balancectrl.hpp
+ */
+
+#ifndef  BALANCEPOLICY_CLASS
+#define  BALANCEPOLICY_CLASS
+
+/**
+ * @brief Measurements and cell parameters a policy decides on
+ *
+ * Only Voltage is measured by every battery, the other arrays
+ * can be NULL for policies that do not use them.
+ */
+template<typename T>
+struct sPolicyInput
+{
+	int Count;		///<Number of cells
+	const T* Voltage;	///<Cell voltages in Volts
+	const T* Soc;		///<State of charge of the cells in %
+	const T* Resistance;	///<Series resistance of the cells in Ohms
+	const T* Gradient;	///<Gradient of the discharge curves in Volt per AmS
+	T Load;			///<Load in Ohms
+};
+
+/**
+ * @brief Connects the cells with the highest voltage
+ *
+ * The original rule of the simulator, band in Volts.
+ */
+template<typename T>
+class cVoltagePolicy
+{
+	public:
+		T defaultBand(void) const noexcept { return T(0.005); }
+		void prepare(const sPolicyInput<T>& in) noexcept { (void)in; }
+		T score(const sPolicyInput<T>& in, int i) const noexcept { return in.Voltage[i]; }
+		static const char* name(void) { return "voltage"; }
+};
+
+/**
+ * @brief Connects the cells with the highest state of charge
+ *
+ * Band in percentage points of state of charge.
+ */
+template<typename T>
+class cSocPolicy
+{
+	public:
+		T defaultBand(void) const noexcept { return T(0.5); }
+		void prepare(const sPolicyInput<T>& in) noexcept { (void)in; }
+		T score(const sPolicyInput<T>& in, int i) const noexcept { return in.Soc[i]; }
+		static const char* name(void) { return "soc"; }
+};
+
+/**
+ * @brief Connects the cells with the highest voltage under load
+ *
+ * The score is the cell voltage minus its drop over the series
+ * resistance at an even share of the load current, so cells with a
+ * high resistance are connected later. Band in Volts.
+ */
+template<typename T>
+class cResistancePolicy
+{
+	public:
+		T defaultBand(void) const noexcept { return T(0.005); }
+		void prepare(const sPolicyInput<T>& in) noexcept
+		{
+			T highest = in.Voltage[0];
+			for(int i=1; i<in.Count; i++)
+				highest = (highest < in.Voltage[i]) ? in.Voltage[i] : highest;
+			Share = highest / in.Load / T(in.Count);
+		}
+		T score(const sPolicyInput<T>& in, int i) const noexcept { return in.Voltage[i] - in.Resistance[i]*Share; }
+		static const char* name(void) { return "resistance"; }
+	private:
+		T Share;	///<Even share of the load current in Ampere
+};
+
+/**
+ * @brief Connects the cells that will have the highest voltage
+ *
+ * Predicts the voltage of every cell after a horizon, assuming all
+ * cells are connected and share the load current in the ratio of
+ * their conductance. Band in Volts.
+ */
+template<typename T>
+class cPredictivePolicy
+{
+	public:
+		cPredictivePolicy() noexcept { Horizon = T(60000); }
+		void setHorizon(T horizon) noexcept { Horizon = horizon; }
+		T defaultBand(void) const noexcept { return T(0.005); }
+		void prepare(const sPolicyInput<T>& in) noexcept
+		{
+			T highest = in.Voltage[0];
+			T conductance = T(0);
+			for(int i=0; i<in.Count; i++)
+			{
+				highest = (highest < in.Voltage[i]) ? in.Voltage[i] : highest;
+				conductance += T(1) / in.Resistance[i];
+			}
+			Current = highest / in.Load / conductance;
+		}
+		T score(const sPolicyInput<T>& in, int i) const noexcept
+		{
+			return in.Voltage[i] - in.Gradient[i] * (Current / in.Resistance[i]) * Horizon;
+		}
+		static const char* name(void) { return "predictive"; }
+	private:
+		T Horizon;	///<Prediction horizon in mS
+		T Current;	///<Load current over the total conductance
+};
+
+#endif //BALANCEPOLICY_CLASS
@@ -0,0 +1,80 @@
+/**
+ * @file cellbatch.hpp
+ * @brief Defines a batch of cells updated together
+ *
+ * Holds the state of many cells as arrays, one array per quantity,
+ * so the cell update of cSingleBatt can be done for 4, 8 or 16 cells
+ * at once with AVX2 or AVX-512. The kernel is chosen at startup
+ * by CPU detection and can be overridden.
+ *
+ * @author Subir Biswas
+ * @date 19/10/2026
+ * @see cellbatch.cpp
+ */
+
+#ifndef  CELLBATCH_CLASS
+#define  CELLBATCH_CLASS
+
+#include "singlebatt.hpp"
+
+#define KERNEL_PORTABLE	0	///<Plain C++ kernel, one cell at a time
+#define KERNEL_AVX2	1	///<AVX2 kernel, 4 cells at a time
+#define KERNEL_AVX512	2	///<AVX-512 kernel, 16 cells at a time
+
+#define BATCHALIGN	16	///<Arrays are padded to a multiple of this many cells
+
+/**
+ * @brief Maximum relative difference of a vector kernel from the scalar reference
+ *
+ * The kernels do the operations of cSingleBatt::update in the same
+ * order, so with -ffp-contract=off (see Makefile) they are bit-identical
+ * to it. If the compiler fuses multiply-add the difference stays
+ * below this tolerance.
+ */
+#define BATCHTOLERANCE	1e-12
+
+/**
+ * @brief defines a batch of cells
+ *
+ * The cell parameters are copied from cSingleBatt objects.
+ * The update needs no lock and no owner check.
+ *
+ * @see cSingleBatt
+ **/
+class cCellBatch
+{
+	public:
+		cCellBatch(int cells);
+		~cCellBatch();
+		bool setCell(int index, cSingleBatt* cell);
+		bool setCurrent(int index, bool connected, double scurrent);
+		void update(double runtime);
+		void updateReference(double runtime);
+		double verify(double runtime);
+		int getCount(void);
+		double getCurrentVoltage(int index);
+		double getRemainingCapacityPercentage(int index);
+		double getSourceCurrent(int index);
+		bool setKernel(int kernel);
+		int getKernel(void);
+		const char* getKernelName(void);
+		static int detectKernel(void);
+
+	private:
+		int Count;			///<Number of cells in the batch
+		int Padded;			///<Number of cells rounded up to BATCHALIGN
+		int Kernel;			///<Kernel used by update. @see setKernel
+		double* Capacity;		///<Capacity of each cell in AmS
+		double* Gradient;		///<Slope of the discharge curve of each cell
+		double* ConstantK;		///<Constant factor of the discharge curve of each cell
+		double* DischargedCapacity;	///<Discharged capacity of each cell in AmS
+		double* RemainigCapacity;	///<Remaining capacity of each cell in %
+		double* CurrentVoltage;		///<Voltage of each cell in Volts
+		double* SourceCurrent;		///<Current sourced by each cell in Ampere
+		double* Demand;			///<Current to be sourced at the next update in Ampere
+		double* Connected;		///<1 if the cell is connected at the next update, else 0
+		cCellBatch(const cCellBatch&);
+		cCellBatch& operator=(const cCellBatch&);
+};
+
+#endif //CELLBATCH_CLASS
@@ -0,0 +1,121 @@
+/**
+ * @file cellfit.hpp
+ * @brief Defines the fit of cell parameters to recorded discharges
+ *
+ * A discharge log is read line by line and reduced to at most
+ * MAXSAMPLES intervals while it is read, so a log of any length
+ * takes the same memory. The fit runs the cell kernels over the
+ * intervals with the measured current and minimises the root mean
+ * square difference of the simulated and the measured voltage with
+ * Nelder-Mead simplexes from many starts. Every start of every cell
+ * is one job, the threads take the jobs from a shared counter.
+ *
+ * @author Subir Biswas
+ * @date 19/10/2026
+ * @see cellfit.cpp
+ * @see cellkernel.hpp
+ */
+
+#ifndef  CELLFIT_CLASS
+#define  CELLFIT_CLASS
+
+#include <vector>	// std::vector
+#include <string>	// std::string
+
+#define MAXSAMPLES	8192	///<Intervals kept of a log, neighbours are merged beyond it
+#define FITPARAMS	3	///<Fitted parameters: initial voltage, series resistance and capacity
+#define FITINITV	0	///<Index of the initial voltage in Volts
+#define FITSRES		1	///<Index of the series resistance in Ohms
+#define FITCAP		2	///<Index of the capacity in mAH
+#define FITITERATIONS	600	///<Largest number of simplex iterations of a start
+
+/**
+ * @brief Interval of a discharge log
+ */
+struct sLogSample
+{
+	double Duration;	///<Length of the interval in mS
+	double Charge;		///<Charge sourced in the interval in AmS
+	double Current;		///<Current at the end of the interval in Ampere
+	double Voltage;		///<Terminal voltage at the end of the interval in Volts
+};
+
+/**
+ * @brief A recorded discharge of one cell
+ *
+ * The log is a text file with one measurement per line,
+ * time in mS, current in Ampere and terminal voltage in Volts,
+ * separated by commas or blanks. Lines starting with # are skipped.
+ * The current is positive while the cell discharges.
+ */
+class cDischargeLog
+{
+	public:
+		cDischargeLog();
+		bool load(const char* path, double interval);
+		const std::string& getPath(void) const;
+		int getCount(void) const;
+		long getLines(void) const;
+		double getInterval(void) const;
+		double getMaxVoltage(void) const;
+		double getMaxCurrent(void) const;
+		double getCharge(void) const;
+		const sLogSample& getSample(int index) const;
+	private:
+		std::string Path;			///<File the log was read from
+		std::vector<sLogSample> Samples;	///<Intervals of the log
+		long Lines;				///<Measurements read
+		double Interval;			///<Length of an interval in mS
+		double MaxVoltage;			///<Highest measured voltage in Volts
+		double MaxCurrent;			///<Highest measured current in Ampere
+		double TotalCharge;			///<Charge sourced over the log in AmS
+		void merge(void);
+};
+
+/**
+ * @brief Fitted parameters of one cell
+ */
+struct sFitResult
+{
+	double Parameter[FITPARAMS];	///<Best parameters found
+	double Error;			///<Root mean square voltage error of the best parameters in Volts
+	int Evaluations;		///<Simulations of the log over all the starts
+	int Converged;			///<Starts that converged within FITITERATIONS
+};
+
+/**
+ * @brief The multi-start fit of a cell population
+ *
+ * A cell is simulated with the cell kernels of cPackModel: the measured
+ * charge of every interval is sourced from the cell and the terminal
+ * voltage is the cell voltage less the drop over the series resistance.
+ * Shift and drop cancel in the gradient of the linear discharge curve,
+ * so they are not fitted.
+ *
+ * The starts are spread over bounds taken from the log: the initial
+ * voltage between the highest measured voltage and half as much again,
+ * the series resistance up to what drops the highest voltage at the
+ * highest current and the capacity from the discharged charge to a
+ * hundred times as much, a log till cut off may discharge only a few
+ * % of the capacity.
+ */
+class cCellFit
+{
+	public:
+		cCellFit();
+		bool setStarts(int starts);
+		bool addLog(const cDischargeLog* log);
+		bool run(int threads);
+		int getCount(void);
+		const sFitResult& getResult(int cell);
+		static double error(const cDischargeLog& log, const double* parameter);
+	private:
+		int Starts;					///<Starts of each cell
+		std::vector<const cDischargeLog*> Logs;		///<Logs to fit
+		std::vector<sFitResult> Results;		///<Best result of each cell
+		std::vector<sFitResult> Runs;			///<Result of each start of each cell
+		void runJob(int job);
+		void fit(const cDischargeLog& log, int start, sFitResult& result);
+};
+
+#endif //CELLFIT_CLASS
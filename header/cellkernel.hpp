@@ -0,0 +1,410 @@
+/**
+ * @file cellkernel.hpp
+ * @brief Cell and pack kernels templated on the numeric type
+ *
+ * The cell update, the balancing decision and the current sharing
+ * are written once for any numeric type. They are instantiated with
+ * double (the reference used by cSingleBatt and cBattery), float, and
+ * Q-format fixed point which mirrors the BMS firmware arithmetic.
+ *
+ * @author Subir Biswas
+ * @date 19/10/2026
+ * @see numericcheck.hpp
+ */
+
+#ifndef  CELLKERNEL_CLASS
+#define  CELLKERNEL_CLASS
+
+#include <stdint.h>	// int64_t
+#include <math.h>	// llround
+#include "balancectrl.hpp"
+
+#define MAXCELLS	16	///<Maximum number of parallel cells a battery (module) can hold
+
+/**
+ * @brief Q-format fixed point number
+ *
+ * Stored in 64 bits with FRAC fractional bits, e.g. cFixed<32> is Q31.32.
+ * Products and quotients are computed in 128 bits and truncated
+ * by an arithmetic shift, the way the firmware does it.
+ * Conversion from double rounds to the nearest step.
+ */
+template<int FRAC>
+class cFixed
+{
+	public:
+		cFixed() { Raw = 0; }
+		cFixed(double value) { Raw = (int64_t)llround(value * (double)((int64_t)1 << FRAC)); }
+		static cFixed fromRaw(int64_t raw) { cFixed f; f.Raw = raw; return f; }
+		double toDouble(void) const { return (double)Raw / (double)((int64_t)1 << FRAC); }
+		int64_t getRaw(void) const { return Raw; }
+
+		cFixed operator+(cFixed b) const { return fromRaw(Raw + b.Raw); }
+		cFixed operator-(cFixed b) const { return fromRaw(Raw - b.Raw); }
+		cFixed operator-() const { return fromRaw(-Raw); }
+		cFixed operator*(cFixed b) const { return fromRaw((int64_t)(((__int128)Raw * b.Raw) >> FRAC)); }
+		cFixed operator/(cFixed b) const
+		{
+			if(b.Raw == 0)
+				return fromRaw(0);
+			return fromRaw((int64_t)(((__int128)Raw << FRAC) / b.Raw));
+		}
+		cFixed& operator+=(cFixed b) { Raw += b.Raw; return *this; }
+		cFixed& operator-=(cFixed b) { Raw -= b.Raw; return *this; }
+		bool operator<(cFixed b) const { return Raw < b.Raw; }
+		bool operator<=(cFixed b) const { return Raw <= b.Raw; }
+		bool operator>(cFixed b) const { return Raw > b.Raw; }
+		bool operator>=(cFixed b) const { return Raw >= b.Raw; }
+		bool operator==(cFixed b) const { return Raw == b.Raw; }
+		bool operator!=(cFixed b) const { return Raw != b.Raw; }
+	private:
+		int64_t Raw;	///<Value multiplied by 2^FRAC
+};
+
+/**
+ * @brief Converts a kernel number to double
+ */
+inline double toDouble(double value) { return value; }
+inline double toDouble(float value) { return value; }
+template<int FRAC>
+inline double toDouble(cFixed<FRAC> value) { return value.toDouble(); }
+
+/**
+ * @brief Gradient of the discharge curve
+ *
+ * Same equation cSingleBatt::initialise uses, y=mx+c.
+ * @param initv	initial voltage in Volts
+ * @param cap	capacity in AmS
+ * @param shift	first gradient change in %
+ * @param drop	voltage drop at shift in %
+ * @return T gradient in Volt per AmS
+ */
+template<typename T>
+inline T cellGradient(T initv, T cap, T shift, T drop)
+{
+	return ((initv * shift) - (initv * drop)) / ((cap * shift) - (cap * drop));
+}
+
+/**
+ * @brief Updates a connected cell for one interval
+ *
+ * The three stage linear approximation of cSingleBatt::update.
+ * @param dis		discharged capacity in AmS, updated
+ * @param rem		remaining capacity in %, updated
+ * @param volt		cell voltage in Volts, updated
+ * @param cap		capacity in AmS
+ * @param grad		gradient of the discharge curve
+ * @param k		constant factor of the discharge curve
+ * @param scurrent	current sourced in Ampere
+ * @param runtime	For how long it was connected in milisec
+ * @return void
+ */
+template<typename T>
+inline void cellUpdate(T& dis, T& rem, T& volt, T cap, T grad, T k, T scurrent, T runtime)
+{
+	dis += (scurrent * runtime);
+	rem = ((cap - dis) / cap) * T(100);
+	volt = volt - grad*scurrent*runtime + k;
+}
+
+/**
+ * @brief Sum of voltage over series resistance of the connected cells
+ *
+ * @param n	number of cells
+ * @param volts	cell voltages in Volts
+ * @param sres	series resistances in Ohms
+ * @param sw	switch states
+ * @return T ratio used to share the output current
+ */
+template<typename T>
+inline T cellRatio(int n, const T* volts, const T* sres, const bool* sw)
+{
+	T ratio = T(0);
+	for(int i=0;i<n;i++)
+	{
+		if(sw[i])
+			ratio += volts[i]/sres[i];
+	}
+	return ratio;
+}
+
+/**
+ * @brief Current sourced by a connected cell
+ *
+ * @param iout	output current in Ampere
+ * @param volt	cell voltage in Volts
+ * @param ratio	@see cellRatio
+ * @param sres	series resistance of the cell in Ohms
+ * @return T source current in Ampere
+ */
+template<typename T>
+inline T cellShare(T iout, T volt, T ratio, T sres)
+{
+	return (iout*volt)/(ratio * sres);
+}
+
+/**
+ * @brief Headless model of a battery in any numeric type
+ *
+ * Does what cBattery::step does with the state held in T,
+ * without locks and threads. The balancing policy is a template
+ * parameter, the policies see the true state of charge.
+ */
+template<typename T, typename Policy = cVoltagePolicy<T> >
+class cPackModel
+{
+	public:
+		cPackModel()
+		{
+			Count = 0;
+			CutOffVoltage = T(8);
+			reset();
+		}
+
+		/**
+		 * @brief Adds a cell to the model
+		 *
+		 * The parameters are numbers of the model, so a dual number
+		 * model can be given parameters with seeded derivatives.
+		 * @param initv	initial voltage in Volts
+		 * @param sres	series resistance in Ohms
+		 * @param cap	capacity in AmS
+		 * @param shift	first gradient change in %
+		 * @param drop	voltage drop at shift in %
+		 * @return true successfully added, false the model is full
+		 */
+		bool addCell(T initv, T sres, T cap, T shift, T drop)
+		{
+			if(Count >= MAXCELLS)
+				return false;
+			InitialVoltage[Count] = initv;
+			SeriesResistance[Count] = sres;
+			Capacity[Count] = cap;
+			Gradient[Count] = cellGradient<T>(initv, cap, shift, drop);
+			Count++;
+			reset();
+			return true;
+		}
+
+		/**
+		 * @brief Loads the initial state of all the cells
+		 */
+		void reset(void)
+		{
+			for(int i=0;i<Count;i++)
+			{
+				CurrentVoltage[i] = InitialVoltage[i];
+				DischargedCapacity[i] = T(0);
+				RemainigCapacity[i] = T(100);
+				SourceCurrent[i] = T(0);
+				Switch[i] = false;
+			}
+			Vout = T(0);
+			Iout = T(0);
+			ElapsedTime = 0;
+			Controller.reset();
+		}
+
+		/**
+		 * @brief Runs one step with a load
+		 *
+		 * @param load		Load in Ohms
+		 * @param resolution	The interval of the step in miliseconds
+		 * @return true the battery is still above the cut off voltage
+		 */
+		bool step(T load, T resolution)
+		{
+			if(Count == 0)
+				return false;
+			sPolicyInput<T> input;
+			input.Count = Count;
+			input.Voltage = CurrentVoltage;
+			input.Soc = RemainigCapacity;
+			input.Resistance = SeriesResistance;
+			input.Gradient = Gradient;
+			input.Load = load;
+			uint32_t mask = Controller.decide(input);
+			return stepMask(mask, load, resolution);
+		}
+
+		/**
+		 * @brief Runs one step with the switches given
+		 *
+		 * Bypasses the controller, used by controllers that
+		 * decide outside of the model.
+		 * @param mask		switch mask, bit i for cell i
+		 * @param load		Load in Ohms
+		 * @param resolution	The interval of the step in miliseconds
+		 * @return true the battery is still above the cut off voltage
+		 */
+		bool stepMask(uint32_t mask, T load, T resolution)
+		{
+			if(Count == 0 || mask == 0)
+				return false;
+			bool first = true;
+			for(int i=0;i<Count;i++)
+			{
+				Switch[i] = (mask >> i) & 1;
+				if(Switch[i] && (first || CurrentVoltage[i] < Vout))
+				{
+					Vout = CurrentVoltage[i];
+					first = false;
+				}
+			}
+			if(first)
+				return false;
+			T ratio = cellRatio<T>(Count, CurrentVoltage, SeriesResistance, Switch);
+			Iout = Vout / load;
+			for(int i=0;i<Count;i++)
+			{
+				if(!Switch[i])
+				{
+					SourceCurrent[i] = T(0);
+					continue;
+				}
+				SourceCurrent[i] = cellShare<T>(Iout, CurrentVoltage[i], ratio, SeriesResistance[i]);
+				cellUpdate<T>(DischargedCapacity[i], RemainigCapacity[i], CurrentVoltage[i],
+					Capacity[i], Gradient[i], T(0), SourceCurrent[i], resolution);
+			}
+			ElapsedTime += toDouble(resolution);
+			return !(Vout < CutOffVoltage);
+		}
+
+		/**
+		 * @brief Charges the cells for one interval
+		 *
+		 * Every cell that is not full is charged with the same
+		 * constant current, a cell stops once it is full.
+		 * @param current	charge current of each cell in Ampere
+		 * @param resolution	The interval of the step in miliseconds
+		 * @return true a cell is still not full
+		 */
+		bool charge(T current, T resolution)
+		{
+			bool charging = false;
+			Vout = T(0);
+			Iout = T(0);
+			for(int i=0;i<Count;i++)
+			{
+				Switch[i] = false;
+				SourceCurrent[i] = T(0);
+				if(!(T(0) < DischargedCapacity[i]))
+					continue;
+				T runtime = DischargedCapacity[i] / current;
+				runtime = (resolution < runtime) ? resolution : runtime;
+				SourceCurrent[i] = -current;
+				cellUpdate<T>(DischargedCapacity[i], RemainigCapacity[i], CurrentVoltage[i],
+					Capacity[i], Gradient[i], T(0), SourceCurrent[i], runtime);
+				charging = charging || (T(0) < DischargedCapacity[i]);
+			}
+			ElapsedTime += toDouble(resolution);
+			return charging;
+		}
+
+		/**
+		 * @brief Charges every cell till it is full in one go
+		 *
+		 * The discharge curve is linear in the discharged capacity,
+		 * so a constant current charge is one update of each cell for
+		 * the time it takes to put the discharged capacity back.
+		 * @param current	charge current of each cell in Ampere
+		 * @return double time till the last cell is full in mS
+		 */
+		double chargeFull(T current)
+		{
+			double longest = 0;
+			Vout = T(0);
+			Iout = T(0);
+			for(int i=0;i<Count;i++)
+			{
+				Switch[i] = false;
+				SourceCurrent[i] = T(0);
+				if(!(T(0) < DischargedCapacity[i]))
+					continue;
+				T runtime = DischargedCapacity[i] / current;
+				cellUpdate<T>(DischargedCapacity[i], RemainigCapacity[i], CurrentVoltage[i],
+					Capacity[i], Gradient[i], T(0), -current, runtime);
+				DischargedCapacity[i] = T(0);
+				RemainigCapacity[i] = T(100);
+				longest = (toDouble(runtime) > longest) ? toDouble(runtime) : longest;
+			}
+			ElapsedTime += longest;
+			return longest;
+		}
+
+		/**
+		 * @brief Leaves the cells without current
+		 *
+		 * The model has no relaxation, only the time passes.
+		 * @param time rest time in mS
+		 */
+		void rest(double time)
+		{
+			for(int i=0;i<Count;i++)
+			{
+				Switch[i] = false;
+				SourceCurrent[i] = T(0);
+			}
+			Vout = T(0);
+			Iout = T(0);
+			ElapsedTime += time;
+		}
+
+		/**
+		 * @brief Changes the capacity and series resistance of a cell
+		 *
+		 * Used to age a cell between cycles. The gradient of the
+		 * discharge curve is inversely proportional to the capacity,
+		 * so it is scaled by the change.
+		 * @param cell	index of the cell
+		 * @param cap	capacity in AmS
+		 * @param sres	series resistance in Ohms
+		 * @return true successfully changed, false out of range
+		 */
+		bool setCell(int cell, T cap, T sres)
+		{
+			if(cell < 0 || cell >= Count || !(T(0) < cap) || !(T(0) < sres))
+				return false;
+			Gradient[cell] = Gradient[cell] * Capacity[cell] / cap;
+			Capacity[cell] = cap;
+			SeriesResistance[cell] = sres;
+			RemainigCapacity[cell] = ((cap - DischargedCapacity[cell]) / cap) * T(100);
+			return true;
+		}
+
+		int getCount(void) { return Count; }
+		T getVout(void) { return Vout; }
+		T getIout(void) { return Iout; }
+		T getCurrentVoltage(int cell) { return CurrentVoltage[cell]; }
+		T getSourceCurrent(int cell) { return SourceCurrent[cell]; }
+		T getRemainingCapacityPercentage(int cell) { return RemainigCapacity[cell]; }
+		T getDischargedCapacity(int cell) { return DischargedCapacity[cell]; }
+		T getSeriesResistance(int cell) { return SeriesResistance[cell]; }
+		T getCapacity(int cell) { return Capacity[cell]; }
+		T getGradient(int cell) { return Gradient[cell]; }
+		T getCutOffVoltage(void) { return CutOffVoltage; }
+		bool getSwitchStatus(int cell) { return Switch[cell]; }
+		double getElapsedTime(void) { return ElapsedTime; }
+		void setTolerance(T tolerance) { Controller.setTolerance(tolerance); }
+		cBalanceController<T, Policy>& getController(void) { return Controller; }
+		void setCutOffVoltage(T cutoff) { CutOffVoltage = cutoff; }
+
+	private:
+		int Count;				///<Number of cells
+		cBalanceController<T, Policy> Controller;	///<Takes the balancing decision
+		T CutOffVoltage;			///<Cut off voltage in Volts
+		T Vout;					///<Output voltage in Volts
+		T Iout;					///<Output current in Ampere
+		double ElapsedTime;			///<Simulated time in mS
+		T InitialVoltage[MAXCELLS];		///<Initial voltage of each cell in Volts
+		T SeriesResistance[MAXCELLS];		///<Series resistance of each cell in Ohms
+		T Capacity[MAXCELLS];			///<Capacity of each cell in AmS
+		T Gradient[MAXCELLS];			///<Gradient of each discharge curve
+		T CurrentVoltage[MAXCELLS];		///<Voltage of each cell in Volts
+		T DischargedCapacity[MAXCELLS];		///<Discharged capacity of each cell in AmS
+		T RemainigCapacity[MAXCELLS];		///<Remaining capacity of each cell in %
+		T SourceCurrent[MAXCELLS];		///<Current sourced by each cell in Ampere
+		bool Switch[MAXCELLS];			///<Switch of each cell
+};
+
+#endif //CELLKERNEL_CLASS
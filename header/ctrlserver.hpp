@@ -0,0 +1,110 @@
+/**
+ * @file ctrlserver.hpp
+ * @brief Defines the control and telemetry server
+ *
+ * Accepts the commands of the command line over a local Unix domain
+ * socket from many clients. A request is one line, the reply is the
+ * text the command line would print followed by a line holding a
+ * single '.'. A client ends its connection with 'exit'.
+ *
+ * One thread serves every connection with epoll. Queries answered from
+ * the published snapshot are replied by that thread directly, other
+ * commands are run one at a time by a command thread, so a slow command
+ * never blocks the other clients. The replies to a client keep the
+ * order of its requests.
+ *
+ * @author Subir Biswas
+ * @date 19/10/2026
+ * @see ctrlserver.cpp
+ */
+
+#ifndef  CTRLSERVER_CLASS
+#define  CTRLSERVER_CLASS
+
+#include <string>		// std::string
+#include <deque>		// std::deque
+#include <map>			// std::map
+#include <thread>		// std::thread
+#include <mutex>		// std::mutex
+#include <condition_variable>	// std::condition_variable
+#include <atomic>		// std::atomic
+#include <stdint.h>		// uint32_t
+
+#define SERVERMAXEVENTS	64		///<Events taken from epoll at once
+#define SERVERMAXLINE	256		///<A longer request line closes the connection
+#define SERVERMAXOUT	(1 << 20)	///<A client with more unsent reply bytes is dropped
+
+/**
+ * @brief Runs a request line
+ *
+ * @param line	the request without the line end
+ * @param reply	the reply text is appended to it
+ * @param query	true: only answer the request if it can be answered from a
+ *		snapshot without locking, false: always answer it
+ * @return bool true if the request was answered
+ */
+typedef bool (*tCommandHandler)(const char* line, std::string& reply, bool query);
+
+/**
+ * @brief The control server
+ */
+class cControlServer
+{
+	public:
+		cControlServer(tCommandHandler handler);
+		~cControlServer();
+		bool start(const char* path);
+		bool stop(void);
+		bool IsRunning(void);
+		unsigned long getRequestCount(void);
+		int getClientCount(void);
+	private:
+		/**
+		 * @brief A connected client
+		 */
+		struct sClient
+		{
+			int Fd;			///<Socket of the client
+			std::string In;		///<Received bytes not yet a full line
+			std::string Out;	///<Reply bytes not yet sent
+			int Pending;		///<Requests queued to the command thread
+			bool Closing;		///<Close once the replies are sent
+			uint32_t Events;	///<Events the client is registered for with epoll
+		};
+		/**
+		 * @brief A request or reply passed to or from the command thread
+		 */
+		struct sJob
+		{
+			unsigned long Client;	///<Id of the client
+			std::string Text;	///<Request line or reply text
+		};
+		tCommandHandler Handler;		///<Runs the requests
+		std::string Path;			///<Path of the socket
+		int Listener;				///<Listening socket
+		int Poller;				///<epoll instance
+		int Wakeup;				///<eventfd signalled for replies and stop
+		std::map<unsigned long, sClient> Clients;	///<Connected clients by id, used by the epoll thread only
+		unsigned long LastId;			///<Last client id given, 0 and 1 are the listener and the eventfd
+		std::atomic<unsigned long> Requests;	///<Requests answered since start
+		std::atomic<int> ClientCount;		///<Number of connected clients
+		std::deque<sJob> Commands;		///<Requests waiting for the command thread
+		std::deque<sJob> Replies;		///<Replies waiting for the epoll thread
+		std::mutex mtx;				///<Protects the queues and Quit
+		std::condition_variable CommandReady;	///<Signalled when a request is queued
+		bool Quit;				///<Signals the threads to end
+		std::thread* Poll;			///<The epoll thread
+		std::thread* Command;			///<The command thread
+		void runPoll(void);
+		void runCommand(void);
+		void accept(void);
+		void receive(unsigned long id);
+		void request(unsigned long id, const std::string& line);
+		void send(unsigned long id);
+		void deliver(void);
+		void close(unsigned long id);
+		cControlServer(const cControlServer&);
+		cControlServer& operator=(const cControlServer&);
+};
+
+#endif //CTRLSERVER_CLASS
@@ -0,0 +1,84 @@
+/**
+ * @file cycler.hpp
+ * @brief Defines the charge and aging cycler
+ *
+ * Cycles headless battery models through discharge, rest, charge and
+ * rest, and ages every cell between two cycles: the capacity fades and
+ * the series resistance grows with the depth of discharge of the
+ * cycle. With fast forward a cycle costs a few thousand steps instead
+ * of hundreds of thousands, so thousands of cycles of many packs run
+ * in minutes.
+ *
+ * @author Subir Biswas
+ * @date 19/10/2026
+ * @see cycler.cpp
+ */
+
+#ifndef  CYCLER_CLASS
+#define  CYCLER_CLASS
+
+#include "scenario.hpp"
+#include <vector>	// std::vector
+
+#define MAXCYCLES	100000	///<Maximum number of cycles of a run
+#define ENDOFLIFE	80	///<A pack reaches its end of life when its runtime falls below this % of the first cycle
+
+/**
+ * @brief Result of cycling one pack
+ */
+struct sCycleResult
+{
+	int Cycles;			///<Cycles run
+	int EndOfLife;			///<First cycle below ENDOFLIFE % of the first runtime, 0 if not reached
+	double FirstRunTime;		///<Runtime till cut off of the first cycle in mS
+	double LastRunTime;		///<Runtime till cut off of the last cycle in mS
+	double Capacity;		///<Mean capacity left of the cells in % of the new cells
+	double Resistance;		///<Mean series resistance of the cells in % of the new cells
+	double SimulatedTime;		///<Simulated time of all the cycles in mS
+	std::vector<double> RunTime;	///<Runtime till cut off of every cycle in mS
+};
+
+/**
+ * @brief The charge and aging cycler
+ *
+ * A cycle is a discharge till cut off with the load and the balancing
+ * of the scenario, a rest, a constant current charge of every cell till
+ * it is full and another rest. After the cycle each cell is aged by its
+ * depth of discharge, the discharged share of its capacity:
+ *	capacity *= 1 - fade * depth
+ *	resistance *= 1 + growth * depth
+ *
+ * Fine steps discharge and charge at the resolution of the scenario.
+ * Fast forward charges in one update, which is exact for the linear
+ * discharge curve, and discharges in steps as long as possible while
+ * no cell voltage changes by more than half the balancing band in a
+ * step, so the switching of the balancing is still resolved.
+ *
+ * Every pack is one job, the threads take the jobs from a shared counter.
+ */
+class cCycler
+{
+	public:
+		cCycler();
+		bool setAging(double fade, double growth);
+		bool setCharge(double current);
+		bool setRest(double time);
+		void setFastForward(bool fast);
+		bool addPack(const cScenario& scenario);
+		int getPackCount(void);
+		bool run(int cycles, int threads);
+		bool runPack(const cScenario& scenario, int cycles, sCycleResult& result);
+		const sCycleResult& getResult(int pack);
+	private:
+		double Fade;				///<Capacity lost per full depth cycle, fraction of the capacity
+		double Growth;				///<Series resistance gained per full depth cycle, fraction of the resistance
+		double ChargeCurrent;			///<Charge current of each cell in Ampere
+		double RestTime;			///<Rest after the discharge and after the charge in mS
+		bool FastForward;			///<Denotes the fast forward path
+		int Cycles;				///<Cycles of the last run
+		std::vector<cScenario> Packs;		///<Packs to cycle
+		std::vector<sCycleResult> Results;	///<Result of each pack of the last run
+		void runJob(int job);
+};
+
+#endif //CYCLER_CLASS
@@ -0,0 +1,111 @@
+/**
+ * @file dualnumber.hpp
+ * @brief Forward mode dual numbers for the cell kernels
+ *
+ * A dual number carries a value and its derivatives with respect to
+ * N parameters. Instantiating cPackModel with it gives the result of a
+ * run together with the derivatives of the result with respect to
+ * every cell parameter that was seeded, in one run.
+ *
+ * Comparisons look at the value only, so the balancing decisions are
+ * those of the double model and the derivatives follow the path of
+ * the run. A decision that would flip for a slightly different
+ * parameter is not differentiated.
+ *
+ * @author Subir Biswas
+ * @date 19/10/2026
+ * @see sensitivity.cpp
+ */
+
+#ifndef  DUALNUMBER_CLASS
+#define  DUALNUMBER_CLASS
+
+/**
+ * @brief Dual number with N derivatives
+ */
+template<int N>
+class cDual
+{
+	public:
+		cDual() { Value = 0; clear(); }
+		cDual(double value) { Value = value; clear(); }
+
+		/**
+		 * @brief Returns a parameter, its own derivative is 1
+		 *
+		 * @param value	value of the parameter
+		 * @param index	index of the parameter, 0 to N-1
+		 */
+		static cDual variable(double value, int index)
+		{
+			cDual d(value);
+			if(index >= 0 && index < N)
+				d.Derivative[index] = 1;
+			return d;
+		}
+
+		double getValue(void) const { return Value; }
+		double getDerivative(int index) const { return (index >= 0 && index < N) ? Derivative[index] : 0; }
+
+		cDual operator+(const cDual& b) const
+		{
+			cDual r(Value + b.Value);
+			for(int i=0; i<N; i++)
+				r.Derivative[i] = Derivative[i] + b.Derivative[i];
+			return r;
+		}
+		cDual operator-(const cDual& b) const
+		{
+			cDual r(Value - b.Value);
+			for(int i=0; i<N; i++)
+				r.Derivative[i] = Derivative[i] - b.Derivative[i];
+			return r;
+		}
+		cDual operator-() const
+		{
+			cDual r(-Value);
+			for(int i=0; i<N; i++)
+				r.Derivative[i] = -Derivative[i];
+			return r;
+		}
+		cDual operator*(const cDual& b) const
+		{
+			cDual r(Value * b.Value);
+			for(int i=0; i<N; i++)
+				r.Derivative[i] = Derivative[i] * b.Value + Value * b.Derivative[i];
+			return r;
+		}
+		cDual operator/(const cDual& b) const
+		{
+			cDual r(Value / b.Value);
+			for(int i=0; i<N; i++)
+				r.Derivative[i] = (Derivative[i] - r.Value * b.Derivative[i]) / b.Value;
+			return r;
+		}
+		cDual& operator+=(const cDual& b) { *this = *this + b; return *this; }
+		cDual& operator-=(const cDual& b) { *this = *this - b; return *this; }
+		bool operator<(const cDual& b) const { return Value < b.Value; }
+		bool operator<=(const cDual& b) const { return Value <= b.Value; }
+		bool operator>(const cDual& b) const { return Value > b.Value; }
+		bool operator>=(const cDual& b) const { return Value >= b.Value; }
+		bool operator==(const cDual& b) const { return Value == b.Value; }
+		bool operator!=(const cDual& b) const { return Value != b.Value; }
+
+	private:
+		double Value;		///<Value of the number
+		double Derivative[N];	///<Derivative with respect to each parameter
+
+		void clear(void)
+		{
+			for(int i=0; i<N; i++)
+				Derivative[i] = 0;
+		}
+};
+
+/**
+ * @brief Converts a dual number to double, the derivatives are dropped
+ */
+template<int N>
+inline double toDouble(const cDual<N>& value) { return value.getValue(); }
+
+#endif //DUALNUMBER_CLASS
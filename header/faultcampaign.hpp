@@ -0,0 +1,91 @@
+/**
+ * @file faultcampaign.hpp
+ * @brief Defines the randomized fault campaign
+ *
+ * Runs many discharges of a scenario through cBattery, each with a
+ * random plan of faults, on all cores, and summarises per fault type
+ * how the balancing reacted: runs that went on below the cut off
+ * voltage, cells that sourced more current than they do in the fault
+ * free run and runs that never stopped.
+ *
+ * @author Subir Biswas
+ * @date 19/10/2026
+ * @see faultcampaign.cpp
+ * @see faultplan.hpp
+ */
+
+#ifndef  FAULTCAMPAIGN_CLASS
+#define  FAULTCAMPAIGN_CLASS
+
+#include "setbatt.hpp"
+#include "scenario.hpp"
+#include <vector>	// std::vector
+
+#define FAULTSPERRUN	2	///<Most faults of a run of a campaign
+#define OVERCURRENT	1.2	///<A cell current above this times the highest of the same cell in the fault free run is an over current
+#define RUNLIMIT	3	///<A run is stopped after this times the steps of the fault free run
+
+/**
+ * @brief Reaction of the battery in one run
+ */
+struct sFaultOutcome
+{
+	int Faults;				///<Number of faults
+	sFault Fault[FAULTSPERRUN];		///<The faults
+	double RunTime;				///<Simulated time till the battery stopped in mS
+	double BelowCutOff;			///<Time the output ran below the cut off voltage before the stop in mS
+	double PeakCurrent[MAXCELLS];		///<Highest current of each cell in Ampere
+	double LowestVoltage;			///<Lowest voltage of a connected cell in Volts
+	unsigned long Steps;			///<Steps run
+	unsigned long BelowSteps;		///<Steps that started below the cut off voltage
+	bool Exhausted;				///<The run reached the step limit
+};
+
+/**
+ * @brief Reaction of the battery to one fault type
+ */
+struct sFaultSummary
+{
+	int Runs;			///<Runs with a fault of the type
+	int MissedCutOff;		///<Runs that went on below the cut off voltage
+	int OverCurrent;		///<Runs with a cell current above its limit
+	int Exhausted;			///<Runs stopped at the step limit
+	double RunTimeChange;		///<Mean change of the runtime from the fault free run in %
+	double WorstBelow;		///<Longest time below the cut off voltage in mS
+};
+
+/**
+ * @brief The randomized fault campaign
+ *
+ * A run has one or FAULTSPERRUN faults of random types on random cells,
+ * starting at random times within the fault free runtime. A resistance
+ * step multiplies the resistance by 2 to 6, a sensor offset is 0.1 V to
+ * 1 V either way. The plans come from a linear congruential generator
+ * seeded with the run index, so a campaign is repeatable.
+ *
+ * Every run is one job, the threads take the jobs from a shared counter.
+ */
+class cFaultCampaign
+{
+	public:
+		cFaultCampaign();
+		bool setScenario(const cScenario& scenario);
+		bool run(int runs, unsigned int seed, int threads);
+		int getRuns(void);
+		const sFaultOutcome& getReference(void);
+		const sFaultOutcome& getOutcome(int run);
+		double getCurrentLimit(int cell);
+		double getStepCost(bool plan);
+		sFaultSummary getSummary(int type);
+		static bool runOnce(const cScenario& scenario, cFaultPlan* plan, unsigned long limit, sFaultOutcome& outcome);
+	private:
+		cScenario Scenario;			///<Scenario of every run
+		sFaultOutcome Reference;		///<The fault free run
+		double StepCost[2];			///<Time of a fault free step without and with an empty plan in nS
+		unsigned int Seed;			///<Seed of the campaign
+		std::vector<sFaultOutcome> Outcomes;	///<Outcome of each run of the last campaign
+		void runJob(int job);
+		void plan(int run, cFaultPlan& faults, sFaultOutcome& outcome);
+};
+
+#endif //FAULTCAMPAIGN_CLASS
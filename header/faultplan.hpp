@@ -0,0 +1,194 @@
+/**
+ * @file faultplan.hpp
+ * @brief Faults scheduled for a run of a battery
+ *
+ * A plan holds faults with the simulated time they start at. The
+ * battery that runs with a plan applies every fault that is due at
+ * the start of a step and asks the plan for the cell voltages its
+ * controller sees and for the switches that really close. A battery
+ * without a plan only tests a null pointer per step.
+ *
+ * @author Subir Biswas
+ * @date 19/10/2026
+ * @see setbatt.cpp
+ * @see faultcampaign.hpp
+ */
+
+#ifndef  FAULTPLAN_CLASS
+#define  FAULTPLAN_CLASS
+
+#include "cellkernel.hpp"
+#include <stdint.h>	// uint32_t
+
+#define MAXFAULTS	16	///<Maximum number of faults of a plan
+#define FAULTOPEN	1	///<The cell goes open circuit, it sources no current whatever its switch
+#define FAULTSRES	2	///<The series resistance steps to Value times the resistance
+#define FAULTSTUCKON	3	///<The switch of the cell sticks closed
+#define FAULTSTUCKOFF	4	///<The switch of the cell sticks open
+#define FAULTOFFSET	5	///<The voltage sensor of the cell reads Value Volts too high
+#define FAULTSENSOR	6	///<The voltage sensor of the cell sticks at its reading
+#define FAULTTYPES	6	///<Number of fault types
+
+/**
+ * @brief A fault of one cell
+ */
+struct sFault
+{
+	int Type;		///<FAULTOPEN to FAULTSENSOR
+	int Cell;		///<Index of the cell
+	double Time;		///<Simulated time the fault starts at in mS
+	double Value;		///<Factor of FAULTSRES, offset of FAULTOFFSET in Volts
+};
+
+/**
+ * @brief Returns the name of a fault type
+ *
+ * @param type FAULTOPEN to FAULTSENSOR
+ * @return const char* the name
+ */
+inline const char* faultName(int type)
+{
+	static const char* names[FAULTTYPES+1] = {"none", "open", "resistance", "stuck on", "stuck off", "offset", "sensor stuck"};
+	return (type > 0 && type <= FAULTTYPES) ? names[type] : names[0];
+}
+
+/**
+ * @brief The faults of a run
+ *
+ * The battery owns the plan while it runs, the plan is not locked.
+ * Faults stay active till the plan is rewound.
+ */
+class cFaultPlan
+{
+	public:
+		cFaultPlan()
+		{
+			Count = 0;
+			rewind();
+		}
+
+		/**
+		 * @brief Adds a fault, the faults are kept in the order of their time
+		 *
+		 * @param fault the fault
+		 * @return true successfully added
+		 * @return false the plan is full, or the type, cell or time is invalid
+		 */
+		bool add(const sFault& fault)
+		{
+			if(Count >= MAXFAULTS || fault.Type < FAULTOPEN || fault.Type > FAULTTYPES
+				|| fault.Cell < 0 || fault.Cell >= MAXCELLS || fault.Time < 0)
+				return false;
+			int i = Count++;
+			while(i > 0 && Faults[i-1].Time > fault.Time)
+			{
+				Faults[i] = Faults[i-1];
+				i--;
+			}
+			Faults[i] = fault;
+			return true;
+		}
+
+		/**
+		 * @brief Removes every fault
+		 */
+		void clear(void)
+		{
+			Count = 0;
+			rewind();
+		}
+
+		/**
+		 * @brief Deactivates every fault, the plan starts again
+		 */
+		void rewind(void)
+		{
+			Next = 0;
+			Open = 0;
+			StuckOn = 0;
+			StuckOff = 0;
+			Frozen = 0;
+			Freezing = 0;
+			for(int i=0; i<MAXCELLS; i++)
+			{
+				Offset[i] = 0;
+				Reading[i] = 0;
+			}
+		}
+
+		/**
+		 * @brief Activates the next fault that is due
+		 *
+		 * A resistance step is only returned, the battery applies it
+		 * to the cell.
+		 * @param time	simulated time in mS
+		 * @param fault	the fault is copied here
+		 * @return bool false if no fault is due
+		 */
+		bool next(double time, sFault& fault)
+		{
+			if(Next >= Count || Faults[Next].Time > time)
+				return false;
+			fault = Faults[Next++];
+			uint32_t bit = (uint32_t)1 << fault.Cell;
+			switch(fault.Type)
+			{
+				case FAULTOPEN:		Open |= bit;		break;
+				case FAULTSTUCKON:	StuckOn |= bit;		break;
+				case FAULTSTUCKOFF:	StuckOff |= bit;	break;
+				case FAULTOFFSET:	Offset[fault.Cell] += fault.Value;	break;
+				case FAULTSENSOR:	Freezing |= bit & ~Frozen;	break;
+				default:		break;
+			}
+			return true;
+		}
+
+		/**
+		 * @brief Turns the cell voltages into the voltages the sensors read
+		 *
+		 * @param volts	cell voltages in Volts, replaced by the readings
+		 * @param n	number of cells
+		 */
+		void sense(double* volts, int n)
+		{
+			for(int i=0; i<n; i++)
+			{
+				uint32_t bit = (uint32_t)1 << i;
+				if(Freezing & bit)
+				{
+					Reading[i] = volts[i] + Offset[i];
+					Frozen |= bit;
+					Freezing &= ~bit;
+				}
+				volts[i] = (Frozen & bit) ? Reading[i] : volts[i] + Offset[i];
+			}
+		}
+
+		/**
+		 * @brief Turns the switches commanded into the switches that conduct
+		 *
+		 * @param mask switches commanded, bit i for cell i
+		 * @return uint32_t switches that conduct
+		 */
+		uint32_t actuate(uint32_t mask)
+		{
+			return ((mask | StuckOn) & ~StuckOff) & ~Open;
+		}
+
+		int getCount(void) const { return Count; }
+		const sFault& getFault(int index) const { return Faults[index]; }
+
+	private:
+		sFault Faults[MAXFAULTS];	///<Faults in the order of their time
+		int Count;			///<Number of faults
+		int Next;			///<Index of the next fault to activate
+		uint32_t Open;			///<Cells that are open circuit
+		uint32_t StuckOn;		///<Switches stuck closed
+		uint32_t StuckOff;		///<Switches stuck open
+		uint32_t Frozen;		///<Sensors stuck at Reading
+		uint32_t Freezing;		///<Sensors that stick at their next reading
+		double Offset[MAXCELLS];	///<Offset of each sensor in Volts
+		double Reading[MAXCELLS];	///<Reading of each stuck sensor in Volts
+};
+
+#endif //FAULTPLAN_CLASS
@@ -0,0 +1,171 @@
+/**
+ * @file fleet.hpp
+ * @brief Defines the fleet of packs read from a scenario file
+ *
+ * A scenario file describes packs without a recompile: their cells,
+ * topology, load profile and run settings. It is text, one statement
+ * per line, '#' starts a comment:
+ *
+ *	pack <name>			starts a pack, the statements below belong to it
+ *	load <Ohm>			load at the start of the run
+ *	profile <time s> <Ohm>		the load changes at the time, in increasing time
+ *	resolution <ms>			interval of a step
+ *	speed <factor>			speed of the real time simulator
+ *	cutoff <V>			cut off voltage
+ *	topology <series> <strings>	modules in series and strings in parallel, only 1 1
+ *	cell <V> <Ohm> <mAh> [<shift %> <drop %>]	a cell of the module
+ *	repeat <n>			n more copies of the pack above
+ *
+ * Every pack runs as one module: the simulator, getScenario and the
+ * sweep take the cells of a module, so a topology other than 1 1 is
+ * rejected rather than run as one module.
+ *
+ * The same fleet can be saved in a binary form that is mapped into
+ * memory as it is: a sFleetHeader followed by the arrays of packs,
+ * cells and profile points, so loading a fleet of any size only
+ * checks the arrays.
+ *
+ * @author Subir Biswas
+ * @date 19/10/2026
+ * @see fleet.cpp
+ * @see tools/fleetc.cpp
+ */
+
+#ifndef  FLEET_CLASS
+#define  FLEET_CLASS
+
+#include "scenario.hpp"
+#include "setbatt.hpp"
+#include <vector>	// std::vector
+#include <atomic>	// std::atomic
+#include <stdint.h>	// uint32_t
+
+#define FLEETMAGIC	0x544C4642	///<"BFLT"
+#define FLEETVERSION	1		///<Version of the binary form
+#define FLEETNAME	24		///<Bytes of the name of a pack, with the terminating 0
+#define FLEETSPEED	100000		///<Default speed of the real time simulator
+
+/**
+ * @brief Head of the binary form
+ */
+struct sFleetHeader
+{
+	uint32_t Magic;		///<FLEETMAGIC
+	uint32_t Version;	///<FLEETVERSION
+	uint32_t Packs;		///<Number of packs
+	uint32_t Cells;		///<Number of cells of all packs
+	uint32_t Points;	///<Number of profile points of all packs
+	uint32_t Reserved[3];	///<0, keeps the arrays aligned
+};
+
+/**
+ * @brief A pack of the fleet
+ */
+struct sFleetPack
+{
+	char Name[FLEETNAME];	///<Name of the pack
+	uint32_t FirstCell;	///<Index of the first cell of the pack in the cells
+	uint32_t Cells;		///<Cells of a module
+	uint32_t FirstPoint;	///<Index of the first profile point of the pack
+	uint32_t Points;	///<Profile points
+	uint32_t Series;	///<Modules in series, 1
+	uint32_t Strings;	///<Strings in parallel, 1
+	double Load;		///<Load at the start in Ohms
+	double Resolution;	///<Interval of a step in mS
+	double CutOffVoltage;	///<Cut off voltage in Volts
+	double Speed;		///<Speed of the real time simulator
+};
+
+/**
+ * @brief A cell of a module of a pack
+ */
+struct sFleetCell
+{
+	double InitialVoltage;		///<Initial voltage in Volts
+	double SeriesResistance;	///<Series resistance in Ohms
+	double Capacity;		///<Capacity in mAH
+	double Shift;			///<First gradient change in %
+	double Drop;			///<Voltage drop at shift in %
+};
+
+/**
+ * @brief A point of a load profile, the load from Time on
+ */
+struct sFleetPoint
+{
+	double Time;		///<Simulated time in mS
+	double Load;		///<Load in Ohms
+};
+
+/**
+ * @brief The packs of a scenario file
+ *
+ * The packs are read only once loaded, so threads may share a fleet.
+ */
+class cFleet
+{
+	public:
+		cFleet();
+		~cFleet();
+		bool load(const char* path);
+		bool parse(const char* text, size_t size);
+		bool save(const char* path);
+		void clear(void);
+		bool isMapped(void);
+		int getPackCount(void);
+		int getCellCount(void);
+		const sFleetPack* getPack(int pack);
+		const sFleetCell* getCells(int pack);
+		const sFleetPoint* getProfile(int pack);
+		int find(const char* name);
+		bool getScenario(int pack, cScenario& scenario);
+		int getLine(void);
+		const char* getError(void);
+	private:
+		std::vector<sFleetPack> PackList;	///<Packs read from text
+		std::vector<sFleetCell> CellList;	///<Cells read from text
+		std::vector<sFleetPoint> PointList;	///<Profile points read from text
+		const sFleetPack* Packs;		///<The packs, read or mapped
+		const sFleetCell* Cells;		///<The cells, read or mapped
+		const sFleetPoint* Points;		///<The profile points, read or mapped
+		uint32_t PackCount;			///<Number of packs
+		uint32_t CellCount;			///<Number of cells
+		uint32_t PointCount;			///<Number of profile points
+		void* Map;				///<Mapping of the binary form, null if read from text
+		size_t MapSize;				///<Size of the mapping in bytes
+		int Line;				///<Line of the last parse error
+		const char* Error;			///<The last error, empty if none
+		bool fail(int line, const char* error);
+		bool check(const sFleetPack& pack, int line);
+		bool map(int fd, size_t size);
+		cFleet(const cFleet&);
+		cFleet& operator=(const cFleet&);
+};
+
+/**
+ * @brief Plays the load profile of a pack into a running battery
+ *
+ * Registered as a step sink. When the simulated time reaches the next
+ * point, the load is applied to the battery as a live change from the
+ * stepping thread and holds from the next step on. A run starting
+ * again from time 0 plays the profile again.
+ *
+ * @see cBattery::apply
+ */
+class cProfilePlayer
+{
+	public:
+		cProfilePlayer();
+		void setProfile(cBattery* battery, const sFleetPoint* points, int count);
+		int getRejected(void);
+		static void sink(void* player, const sSnapshot& snapshot);
+	private:
+		cBattery* Battery;		///<The battery the loads are applied to
+		const sFleetPoint* Points;	///<The profile
+		int Count;			///<Number of points
+		int Next;			///<Index of the next point
+		double Last;			///<Time of the last step in mS
+		std::atomic<int> Rejected;	///<Loads the battery rejected, read by other threads
+};
+
+#endif //FLEET_CLASS
@@ -22,17 +22,39 @@
 #define GETSCURR	05 //<get source current
 #define GETRCAP		06 //<get remaining battery capacity
 #define GETSWTCH	10 //<get switch status
+#define GETTOGGL	14 //<get switch toggle counts and rate histograms
+#define GETCHNG		17 //<get live changes and the step they were applied at
+#define GETSUBST	18 //<get physics substeps per controller step
+#define GETHIST		23 //<get the size of the history
+#define GETPREV		24 //<get the plotting preview of the run <lttb>
+#define GETFLEET	25 //<get the packs of the scenario file
 
 #define SETSRES		101 //<set series resistance <v1> <v2> <V3>
 #define SETLOAD		102 //<set load resistance <v1>
 #define SETINTV		100 //<set initial voltage <v1> <v2> <v3>
+#define SETHYST		112 //<set hysteresis bands <on> <off>
+#define SETDWELL	113 //<set minimum switch dwell <on steps> <off steps>
+#define SETSUBST	118 //<set physics substeps per controller step <n>
 
 #define SIMSTART	208 //<simulation start
 #define SIMSTOP		209 //<simulation stop
+#define SIMVALID	211 //<compare numeric backends over a full discharge
+#define SIMTOURN	215 //<rank the balancing policies over a scenario set
+#define SIMMPC		216 //<discharge with the predictive controller <budget us>
+#define SIMCYCL		219 //<charge and aging cycles <cycles> <packs> <fine>
+#define SIMSOC		220 //<evaluate the state of charge estimator <cells> <voltage noise mV> <current noise mA>
+#define SIMSENS		221 //<runtime sensitivity to every cell parameter <step %> <balanced>
+#define SIMFAULT	222 //<randomized fault campaign <runs> <seed> <resolution ms>
+#define SIMSCHED	227 //<run many packs on the cooperative scheduler <packs> <seconds> <threads>
+#define SIMPACK		226 //<step a series parallel pack on 1 upto n threads <series> <parallel> <threads>
 
 #define HELP		300 //<help
 #define EXIT		400 //<exit
 
+#define WATCH		500 //<watch <key> <interval ms>, WATCH + the number of a get key
+#define UNWATCH		600 //<unwatch [key], UNWATCH alone stops every watch
+#define INVALIDCMD	700 //<first function number of an unknown command
+
 
 #endif //FUNCTIONDEF_H
 
@@ -0,0 +1,142 @@
+/**
+ * @file goldtrace.hpp
+ * @brief Defines the golden trace recorder and comparer
+ *
+ * A golden trace is the output voltage, the voltage and current of
+ * every cell and the switches of every step of a discharge, run
+ * headless through cBattery and cSingleBatt. It is recorded once from
+ * a trusted build and later runs of the same case are compared to it
+ * step by step while they run: the golden file is read one record
+ * ahead of the battery, so neither trace is held in memory and a
+ * comparison stops at the first divergent step.
+ *
+ * Values compare equal within an absolute tolerance per channel plus a
+ * relative tolerance. The switch timelines are equal when every switch
+ * toggles as often, in the same order, each toggle within a slack of
+ * steps of its golden toggle. While a toggle is unmatched the values
+ * are not compared, the currents of a shifted toggle differ by design.
+ *
+ * File layout: a sGoldHeader, then a record per step of doubles: time
+ * in mS, Vout, then the voltage and current of each cell, then the
+ * switch mask, bit i for cell i, as an integer held in a double.
+ *
+ * @author Subir Biswas
+ * @date 19/10/2026
+ * @see goldtrace.cpp
+ * @see tools/goldtrace.cpp
+ */
+
+#ifndef  GOLDTRACE_CLASS
+#define  GOLDTRACE_CLASS
+
+#include "scenario.hpp"
+#include "snapshot.hpp"
+#include <stdio.h>	// FILE
+#include <stdint.h>	// uint32_t
+
+#define GOLDMAGIC	0x43525447	///<"GTRC"
+#define GOLDVERSION	1		///<Version of the file layout
+#define GOLDBUFFER	(1 << 20)	///<Bytes of the file buffer
+
+/**
+ * @brief A case of the corpus, a scenario and the balancing settings
+ */
+struct sGoldCase
+{
+	char Name[32];			///<Name of the case, also the name of its golden file
+	cScenario Scenario;		///<Cells, load and resolution
+	double HysteresisOn;		///<On band in Volts
+	double HysteresisOff;		///<Off band in Volts
+	int DwellOn;			///<Steps a switch stays on
+	int DwellOff;			///<Steps a switch stays off
+	int Substeps;			///<Physics substeps per controller step
+};
+
+/**
+ * @brief Head of a golden file, the case it was recorded from
+ */
+struct sGoldHeader
+{
+	uint32_t Magic;				///<GOLDMAGIC
+	uint32_t Version;			///<GOLDVERSION
+	int32_t Count;				///<Number of cells
+	int32_t Substeps;			///<Physics substeps per controller step
+	int32_t DwellOn;			///<Steps a switch stays on
+	int32_t DwellOff;			///<Steps a switch stays off
+	double HysteresisOn;			///<On band in Volts
+	double HysteresisOff;			///<Off band in Volts
+	double Load;				///<Load in Ohms
+	double Resolution;			///<Interval of a step in mS
+	double CutOffVoltage;			///<Cut off voltage in Volts
+	double InitialVoltage[MAXCELLS];	///<Initial voltage of each cell in Volts
+	double SeriesResistance[MAXCELLS];	///<Series resistance of each cell in Ohms
+	double Capacity[MAXCELLS];		///<Capacity of each cell in mAH
+	uint64_t Steps;				///<Records in the file
+};
+
+/**
+ * @brief Tolerances of a comparison
+ */
+struct sGoldTolerance
+{
+	double Voltage;		///<Absolute tolerance of the voltages in Volts
+	double Current;		///<Absolute tolerance of the currents in Ampere
+	double Relative;	///<Relative tolerance of every value
+	int Slack;		///<Steps a toggle may lie from its golden toggle
+};
+
+/**
+ * @brief Outcome of recording or comparing a case
+ */
+struct sGoldResult
+{
+	bool Passed;			///<Recorded, or equal to the golden trace
+	unsigned long Steps;		///<Steps run
+	unsigned long GoldenSteps;	///<Steps in the golden trace
+	unsigned long Step;		///<First divergent step, counted from 1
+	double Time;			///<Golden time of the divergent step in mS
+	char Channel[16];		///<Divergent channel: time, vout, v<cell>, i<cell>, switch<cell> or length
+	double Golden;			///<Golden value of the channel
+	double Actual;			///<Value of the channel in the run
+	char Error[64];			///<Why the case could not run, empty if it ran
+};
+
+/**
+ * @brief Records or compares the golden trace of a case
+ *
+ * One object runs one case at a time, cases can run on parallel threads
+ * with one object each.
+ */
+class cGoldenTrace
+{
+	public:
+		cGoldenTrace();
+		~cGoldenTrace();
+		bool record(const sGoldCase& run, const char* path, sGoldResult& result);
+		bool compare(const sGoldCase& run, const char* path, const sGoldTolerance& tolerance, sGoldResult& result);
+		static void sink(void* trace, const sSnapshot& snapshot);
+	private:
+		FILE* File;			///<The golden file
+		char* Buffer;			///<Buffer of the golden file
+		bool Recording;			///<Writing the golden file, else reading it
+		int Count;			///<Number of cells
+		int Width;			///<Doubles per record
+		double Interval;		///<Interval of a step in mS
+		sGoldTolerance Tolerance;	///<Tolerances of the comparison
+		sGoldResult* Result;		///<Result of the running case
+		double Record[2 + 2*MAXCELLS + 1];	///<Record of the step
+		double Golden[2 + 2*MAXCELLS + 1];	///<Golden record of the step
+		uint32_t LastMask[2];		///<Golden and actual switches of the step before
+		int Pending[MAXCELLS];		///<Unmatched toggles of each switch, positive golden, negative actual
+		unsigned long PendingStep[MAXCELLS];	///<Step of the oldest unmatched toggle of each switch
+		bool play(const sGoldCase& run, sGoldResult& result);
+		void step(const sSnapshot& snapshot);
+		bool differ(const char* name, int cell, double golden, double actual, double tolerance);
+		bool toggles(unsigned long step);
+		void diverge(unsigned long step, const char* channel, double golden, double actual);
+		void header(const sGoldCase& run, sGoldHeader& head);
+		cGoldenTrace(const cGoldenTrace&);
+		cGoldenTrace& operator=(const cGoldenTrace&);
+};
+
+#endif //GOLDTRACE_CLASS
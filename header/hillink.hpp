@@ -0,0 +1,399 @@
+/**
+ * @file hillink.hpp
+ * @brief Shared memory link between a cell emulator and a balancing controller
+ *
+ * The hardware-in-the-loop stand-in runs the cell physics in one
+ * process (hilemu) and the balancing decision in another (hilctrl),
+ * the way the BMS microcontroller is separated from the cells. The
+ * emulator sends a measurement frame every tick, the controller answers
+ * each with a command frame holding the switch mask. The frames travel
+ * through two single producer single consumer rings in one POSIX
+ * shared memory object, created by the emulator.
+ *
+ * Layout, all numbers in the native byte order of the host:
+ *	offset 0	sHilHeader, 64 bytes
+ *	offset 64	sHilRing of the measurements, 128 bytes
+ *	offset 192	sHilRing of the commands, 128 bytes
+ *	offset 320	Slots measurement frames, sHilMeasure
+ *	then		Slots command frames, sHilCommand
+ *
+ * A producer copies frame n into slot n % Slots and then stores Head
+ * n+1 with release order; the consumer reads Head with acquire order,
+ * copies the frame and stores Tail n+1. Head and Tail are on their own
+ * cache lines. A full ring refuses the frame. Time stamps are
+ * CLOCK_MONOTONIC nano seconds, which both processes share.
+ *
+ * This header does not depend on the rest of the simulator.
+ *
+ * @author Subir Biswas
+ * @date 19/10/2026
+ * @see tools/hilemu.cpp
+ * @see tools/hilctrl.cpp
+ */
+
+#ifndef  HILLINK_CLASS
+#define  HILLINK_CLASS
+
+#include <stdint.h>	// uint64_t
+#include <string.h>	// memcpy
+#include <time.h>	// clock_gettime
+#include <fcntl.h>	// O_RDWR
+#include <unistd.h>	// close
+#include <sys/mman.h>	// shm_open, mmap
+#include <sys/stat.h>	// fstat
+#include <ostream>	// std::ostream
+#include <iomanip>	// std::setw
+
+#define HILMAGIC	0x4C484242	///<"BBHL" in the first four bytes on little endian hosts
+#define HILVERSION	1		///<Version of the layout
+#define HILMAXCELLS	16		///<Cells a measurement frame holds
+#define HILSLOTS	256		///<Default number of frames in each ring, a power of two
+#define HILBINS		24		///<Bins of a latency histogram
+
+/**
+ * @brief Returns the monotonic clock in nano seconds
+ */
+inline uint64_t hilNow(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+/**
+ * @brief Header of the link, 64 bytes
+ */
+struct sHilHeader
+{
+	uint32_t Magic;		///<HILMAGIC once the link is initialised
+	uint32_t Version;	///<HILVERSION
+	uint32_t Slots;		///<Frames in each ring, a power of two
+	uint32_t MaxCells;	///<Cells a measurement frame holds
+	uint32_t Closed;	///<1 once the emulator has finished
+	uint32_t Reserved[11];	///<Zero
+};
+
+/**
+ * @brief Indices of a ring, each on its own cache line, 128 bytes
+ */
+struct sHilRing
+{
+	uint64_t Head;		///<Frames written by the producer
+	uint64_t PadHead[7];	///<Zero
+	uint64_t Tail;		///<Frames taken by the consumer
+	uint64_t PadTail[7];	///<Zero
+};
+
+/**
+ * @brief Measurement of the cells, emulator to controller, 176 bytes
+ */
+struct sHilMeasure
+{
+	uint64_t Sequence;		///<Tick of the emulator
+	uint64_t SentTime;		///<Time the frame was sent in nS
+	double ElapsedTime;		///<Simulated time in mS
+	double Vout;			///<Output voltage in Volts
+	double Iout;			///<Output current in Ampere
+	uint32_t Count;			///<Number of cells
+	uint32_t Reserved;		///<Zero
+	double Voltage[HILMAXCELLS];	///<Voltage of each cell in Volts
+};
+
+/**
+ * @brief Switch command, controller to emulator, 32 bytes
+ */
+struct sHilCommand
+{
+	uint64_t Sequence;	///<Sequence of the measurement it answers
+	uint64_t SentTime;	///<SentTime of the measurement it answers
+	uint64_t DecideTime;	///<Time the controller took to decide in nS
+	uint32_t Mask;		///<Switch states, bit i for cell i
+	uint32_t Reserved;	///<Zero
+};
+
+static_assert(sizeof(sHilHeader) == 64, "hil header layout");
+static_assert(sizeof(sHilRing) == 128, "hil ring layout");
+static_assert(sizeof(sHilMeasure) == 176, "hil measurement layout");
+static_assert(sizeof(sHilCommand) == 32, "hil command layout");
+
+/**
+ * @brief One end of the link
+ *
+ * The emulator creates the link, the controller opens it. Each end
+ * produces into one ring and consumes from the other.
+ */
+class cHilLink
+{
+	public:
+		cHilLink()
+		{
+			Name[0] = '\0';
+			Header = (sHilHeader*)0;
+			Size = 0;
+			Owner = false;
+		}
+		~cHilLink() { close(); }
+
+		/**
+		 * @brief Creates the link, the emulator end
+		 *
+		 * An existing object of the same name is replaced.
+		 * @param name	name of the shared memory object, starting with '/'
+		 * @param slots	frames in each ring, a power of two
+		 * @return bool false if already open, invalid input or a system call failed
+		 */
+		bool create(const char* name, uint32_t slots = HILSLOTS)
+		{
+			if(Header != (sHilHeader*)0 || name[0] != '/' || strlen(name) >= sizeof(Name) || slots == 0 || (slots & (slots - 1)))
+				return false;
+			shm_unlink(name);
+			int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+			if(fd < 0)
+				return false;
+			size_t size = bytes(slots);
+			if(ftruncate(fd, size) < 0 || !map(fd, size))
+			{
+				::close(fd);
+				shm_unlink(name);
+				return false;
+			}
+			::close(fd);
+			strcpy(Name, name);
+			Owner = true;
+			Header->Version = HILVERSION;
+			Header->Slots = slots;
+			Header->MaxCells = HILMAXCELLS;
+			Header->Closed = 0;
+			layout();
+			//the controller checks the magic last
+			__atomic_store_n(&Header->Magic, HILMAGIC, __ATOMIC_RELEASE);
+			return true;
+		}
+
+		/**
+		 * @brief Opens a link created by the emulator, the controller end
+		 *
+		 * @param name name of the shared memory object
+		 * @return bool false if it does not exist or is not a link of this version
+		 */
+		bool open(const char* name)
+		{
+			struct stat info;
+			if(Header != (sHilHeader*)0)
+				return false;
+			int fd = shm_open(name, O_RDWR, 0);
+			if(fd < 0)
+				return false;
+			if(fstat(fd, &info) < 0 || (size_t)info.st_size < sizeof(sHilHeader) || !map(fd, info.st_size))
+			{
+				::close(fd);
+				return false;
+			}
+			::close(fd);
+			if(__atomic_load_n(&Header->Magic, __ATOMIC_ACQUIRE) != HILMAGIC || Header->Version != HILVERSION
+				|| Header->MaxCells != HILMAXCELLS || Size < bytes(Header->Slots))
+			{
+				close();
+				return false;
+			}
+			layout();
+			Owner = false;
+			return true;
+		}
+
+		/**
+		 * @brief Unmaps the link, the emulator end also marks it finished and removes it
+		 */
+		void close(void)
+		{
+			if(Header == (sHilHeader*)0)
+				return;
+			if(Owner)
+			{
+				__atomic_store_n(&Header->Closed, 1, __ATOMIC_RELEASE);
+				shm_unlink(Name);
+			}
+			munmap((void*)Header, Size);
+			Header = (sHilHeader*)0;
+			Owner = false;
+		}
+
+		/**
+		 * @brief Returns true once the emulator has finished
+		 */
+		bool isClosed(void) const
+		{
+			return (Header == (sHilHeader*)0) || __atomic_load_n(&Header->Closed, __ATOMIC_ACQUIRE);
+		}
+
+		bool sendMeasure(const sHilMeasure& frame) { return push(MeasureRing, Measures, frame); }
+		bool receiveMeasure(sHilMeasure& frame) { return pop(MeasureRing, Measures, frame); }
+		bool sendCommand(const sHilCommand& frame) { return push(CommandRing, Commands, frame); }
+		bool receiveCommand(sHilCommand& frame) { return pop(CommandRing, Commands, frame); }
+
+	private:
+		char Name[64];			///<Name of the shared memory object
+		sHilHeader* Header;		///<Mapped header
+		sHilRing* MeasureRing;		///<Indices of the measurement ring
+		sHilRing* CommandRing;		///<Indices of the command ring
+		sHilMeasure* Measures;		///<Measurement frames
+		sHilCommand* Commands;		///<Command frames
+		size_t Size;			///<Size of the mapping in bytes
+		bool Owner;			///<Denotes the emulator end
+		cHilLink(const cHilLink&);
+		cHilLink& operator=(const cHilLink&);
+
+		static size_t bytes(uint32_t slots)
+		{
+			return sizeof(sHilHeader) + 2*sizeof(sHilRing) + (size_t)slots * (sizeof(sHilMeasure) + sizeof(sHilCommand));
+		}
+
+		bool map(int fd, size_t size)
+		{
+			void* mapped = mmap((void*)0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+			if(mapped == MAP_FAILED)
+				return false;
+			Size = size;
+			Header = (sHilHeader*)mapped;
+			return true;
+		}
+
+		void layout(void)
+		{
+			MeasureRing = (sHilRing*)(Header + 1);
+			CommandRing = MeasureRing + 1;
+			Measures = (sHilMeasure*)(CommandRing + 1);
+			Commands = (sHilCommand*)(Measures + Header->Slots);
+		}
+
+		template<typename F>
+		bool push(sHilRing* ring, F* frames, const F& frame)
+		{
+			uint32_t slots = Header->Slots;
+			uint64_t head = __atomic_load_n(&ring->Head, __ATOMIC_RELAXED);
+			if(head - __atomic_load_n(&ring->Tail, __ATOMIC_ACQUIRE) >= slots)
+				return false;
+			memcpy((void*)&frames[head & (slots - 1)], &frame, sizeof(F));
+			__atomic_store_n(&ring->Head, head + 1, __ATOMIC_RELEASE);
+			return true;
+		}
+
+		template<typename F>
+		bool pop(sHilRing* ring, F* frames, F& frame)
+		{
+			uint32_t slots = Header->Slots;
+			uint64_t tail = __atomic_load_n(&ring->Tail, __ATOMIC_RELAXED);
+			if(tail == __atomic_load_n(&ring->Head, __ATOMIC_ACQUIRE))
+				return false;
+			memcpy(&frame, (const void*)&frames[tail & (slots - 1)], sizeof(F));
+			__atomic_store_n(&ring->Tail, tail + 1, __ATOMIC_RELEASE);
+			return true;
+		}
+};
+
+/**
+ * @brief Histogram of latencies
+ *
+ * Bin 0 holds latencies below 1 uS, bin b latencies of 2^(b-1) to
+ * 2^b - 1 uS, the last bin the rest. The percentiles are the upper
+ * edge of the bin they fall in.
+ */
+class cLatencyHistogram
+{
+	public:
+		cLatencyHistogram() { reset(); }
+
+		void reset(void)
+		{
+			Count = 0;
+			Sum = 0;
+			Max = 0;
+			Min = 0;
+			for(int b=0; b<HILBINS; b++)
+				Bins[b] = 0;
+		}
+
+		/**
+		 * @brief Adds a latency
+		 *
+		 * @param ns latency in nS
+		 */
+		void add(uint64_t ns)
+		{
+			uint64_t us = ns / 1000;
+			int bin = us ? 64 - __builtin_clzll(us) : 0;
+			bin = (bin < HILBINS) ? bin : HILBINS - 1;
+			Bins[bin]++;
+			Min = (Count == 0 || ns < Min) ? ns : Min;
+			Max = (ns > Max) ? ns : Max;
+			Sum += ns;
+			Count++;
+		}
+
+		/**
+		 * @brief Returns a percentile in uS, the upper edge of its bin
+		 *
+		 * @param p percentile, 0 to 100
+		 */
+		double percentile(double p) const
+		{
+			if(Count == 0)
+				return 0;
+			uint64_t rank = (uint64_t)(p / 100 * (double)Count);
+			uint64_t seen = 0;
+			for(int b=0; b<HILBINS; b++)
+			{
+				seen += Bins[b];
+				if(seen > rank)
+					return (b < HILBINS - 1) ? (double)((uint64_t)1 << b) : Max / 1000.0;
+			}
+			return Max / 1000.0;
+		}
+
+		/**
+		 * @brief Prints the summary and the bins that are not empty
+		 *
+		 * @param title	name of the latency
+		 * @param out	stream to print to
+		 */
+		void print(const char* title, std::ostream& out) const
+		{
+			out <<title <<": " <<Count <<" samples";
+			if(Count == 0)
+			{
+				out <<"\n";
+				return;
+			}
+			out <<std::fixed <<std::setprecision(1) <<", min " <<getMin() <<" us, mean " <<getMean()
+				<<" us, p99 " <<percentile(99) <<" us, max " <<getMax() <<" us\n";
+			for(int b=0; b<HILBINS; b++)
+			{
+				if(Bins[b] == 0)
+					continue;
+				if(b == 0)
+					out <<std::setw(20) <<"< 1";
+				else if(b == 1)
+					out <<std::setw(20) <<1;
+				else if(b == HILBINS - 1)
+					out <<std::setw(19) <<((uint64_t)1 << (b - 1)) <<"+";
+				else
+					out <<std::setw(10) <<((uint64_t)1 << (b - 1)) <<" - " <<std::setw(7) <<((uint64_t)1 << b) - 1;
+				out <<" us " <<std::setw(10) <<Bins[b] <<"\n";
+			}
+		}
+
+		uint64_t getCount(void) const { return Count; }
+		double getMean(void) const { return Count ? (double)Sum / (double)Count / 1000 : 0; }
+		double getMin(void) const { return Min / 1000.0; }
+		double getMax(void) const { return Max / 1000.0; }
+		uint64_t getBin(int bin) const { return (bin >= 0 && bin < HILBINS) ? Bins[bin] : 0; }
+
+	private:
+		uint64_t Count;		///<Latencies added
+		uint64_t Sum;		///<Sum of the latencies in nS
+		uint64_t Min;		///<Lowest latency in nS
+		uint64_t Max;		///<Highest latency in nS
+		uint64_t Bins[HILBINS];	///<Latencies by bin
+};
+
+#endif //HILLINK_CLASS
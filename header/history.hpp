@@ -0,0 +1,121 @@
+/**
+ * @file history.hpp
+ * @brief Defines the compressed history of a run
+ *
+ * Keeps the voltage, source current and remaining capacity of every
+ * cell and the switches, sampled at a fixed simulated interval, for
+ * the whole run. The samples are quantised to integers and stored per
+ * column as the delta of the delta of consecutive samples, zigzag and
+ * varint coded, in blocks of HISTBLOCK samples. A slowly changing
+ * column takes one byte per sample. The blocks are indexed by their
+ * first time, so a query finds its block with a binary search and
+ * decodes only that block. Only the newest blocks stay in memory, the
+ * older ones are appended to a spill file and read back for a query.
+ *
+ * @author Subir Biswas
+ * @date 19/10/2026
+ * @see history.cpp
+ */
+
+#ifndef  HISTORY_CLASS
+#define  HISTORY_CLASS
+
+#include "snapshot.hpp"
+#include <vector>	// std::vector
+#include <mutex>	// std::mutex
+#include <stdint.h>	// int64_t
+
+#define HISTBLOCK	512	///<Samples of a block
+#define HISTRESIDENT	8	///<Sealed blocks kept in memory, older blocks are spilled
+#define HISTINTERVAL	1000	///<Default simulated time between two samples in mS
+#define HISTVOLTAGE	0	///<Column of the cell voltage, quantum 0.1 mV
+#define HISTCURRENT	1	///<Column of the source current, quantum 1 uA
+#define HISTREMAIN	2	///<Column of the remaining capacity, quantum 0.001 %
+#define HISTKINDS	3	///<Columns of a cell
+#define HISTCOLUMNS	(2 + HISTKINDS * MAXCELLS)	///<Time, the switches and the columns of every cell
+
+/**
+ * @brief Summary of a column over a time range
+ */
+struct sHistoryRange
+{
+	long Samples;		///<Samples in the range
+	double Min;		///<Lowest value
+	double Max;		///<Highest value
+	double Mean;		///<Mean value
+};
+
+/**
+ * @brief Size of the history
+ */
+struct sHistoryStats
+{
+	long Samples;		///<Samples stored
+	int Blocks;		///<Sealed blocks
+	int Spilled;		///<Sealed blocks in the spill file
+	size_t Resident;	///<Bytes of samples in memory
+	size_t Encoded;		///<Bytes of all the samples encoded
+	double Hours;		///<Simulated hours stored
+	int Cells;		///<Cells stored
+};
+
+/**
+ * @brief The history of a run
+ *
+ * Registered as a step sink of a battery. A step whose simulated time
+ * lies before the last sample starts a new history. Queries may come
+ * from any thread, a lock keeps them apart from the stepping thread.
+ *
+ * @see cBattery::addSink
+ */
+class cHistoryStore
+{
+	public:
+		cHistoryStore();
+		~cHistoryStore();
+		bool open(const char* path, double interval);
+		bool close(void);
+		bool isOpen(void);
+		void record(const sSnapshot& snapshot);
+		bool at(int kind, double time, double* values, bool* switches);
+		bool range(int kind, int cell, double from, double to, sHistoryRange& summary);
+		sHistoryStats getStats(void);
+		int getCells(void);
+		static void sink(void* store, const sSnapshot& snapshot);
+	private:
+		/**
+		 * @brief A block of samples
+		 *
+		 * Column c takes the bytes from Start[c] to Start[c+1] of the block.
+		 */
+		struct sBlock
+		{
+			double First;			///<Time of the first sample in mS
+			double Last;			///<Time of the last sample in mS
+			int Count;			///<Samples
+			long Offset;			///<Position in the spill file, -1 while in memory
+			uint32_t Start[HISTCOLUMNS+1];	///<Start of each column in the bytes
+			std::vector<uint8_t> Data;	///<The bytes while in memory
+		};
+		int Fd;					///<Spill file
+		double Interval;			///<Simulated time between two samples in mS
+		double NextTime;			///<Time of the next sample in mS
+		int Cells;				///<Cells of the run
+		int Columns;				///<Columns of the run
+		long Spilled;				///<Bytes in the spill file
+		std::vector<sBlock> Blocks;		///<Sealed blocks in the order of their time
+		sBlock Open;				///<Block being filled
+		std::vector<uint8_t> Stream[HISTCOLUMNS];	///<Bytes of each column of the open block
+		int64_t Previous[HISTCOLUMNS];		///<Last sample of each column of the open block
+		int64_t Delta[HISTCOLUMNS];		///<Last delta of each column of the open block
+		std::mutex Lock;			///<Keeps queries apart from record
+		void clear(void);
+		void seal(void);
+		int find(double time);
+		bool bytes(int block, std::vector<uint8_t>& data, uint32_t* start);
+		static void decode(const uint8_t* data, uint32_t size, std::vector<int64_t>& values);
+		cHistoryStore(const cHistoryStore&);
+		cHistoryStore& operator=(const cHistoryStore&);
+};
+
+#endif //HISTORY_CLASS
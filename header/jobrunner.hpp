@@ -0,0 +1,50 @@
+/**
+ * @file jobrunner.hpp
+ * @brief Runs independent jobs on several threads
+ *
+ * The threads take the next job from a shared counter until none is
+ * left, so a slow job does not hold up the others. The calling thread
+ * is one of them.
+ *
+ * @author Subir Biswas
+ * @date 19/10/2026
+ * @see faultcampaign.cpp cellfit.cpp cycler.cpp tournament.cpp
+ */
+
+#ifndef  JOBRUNNER_CLASS
+#define  JOBRUNNER_CLASS
+
+#include <atomic>	// std::atomic
+#include <thread>	// std::thread
+#include <vector>	// std::vector
+
+/**
+ * @brief Runs the jobs 0 to jobs - 1 and returns when all are done
+ *
+ * The job is called from several threads at once, every call must
+ * write only the results of its own index.
+ * @param F	type of the job, callable as job(int index)
+ * @param jobs	number of jobs
+ * @param threads	number of threads to use, at least 1
+ * @param job	the job
+ * @return void
+ */
+template<typename F>
+void runJobs(int jobs, int threads, F job)
+{
+	std::atomic<int> next(0);
+	auto worker = [&]()
+	{
+		int index;
+		while((index = next.fetch_add(1)) < jobs)
+			job(index);
+	};
+	std::vector<std::thread> workers;
+	for(int t=1; t<threads && t<jobs; t++)
+		workers.push_back(std::thread(worker));
+	worker();
+	for(size_t t=0; t<workers.size(); t++)
+		workers[t].join();
+}
+
+#endif
@@ -0,0 +1,105 @@
+/**
+ * @file mpcctrl.hpp
+ * @brief Defines the model predictive balancing controller
+ *
+ * At every decision the controller rolls the pack state forward
+ * over a short horizon once for each candidate switch set and
+ * picks the set that keeps the battery above the cut off voltage
+ * the longest. The rollouts run in parallel and the decision is
+ * cut short when its time budget is spent.
+ *
+ * @author Subir Biswas
+ * @date 19/10/2026
+ * @see mpcctrl.cpp
+ */
+
+#ifndef  MPCCTRL_CLASS
+#define  MPCCTRL_CLASS
+
+#include "scenario.hpp"
+#include <thread>		// std::thread
+#include <mutex>		// std::mutex
+#include <condition_variable>	// std::condition_variable
+#include <chrono>		// std::chrono
+#include <atomic>		// std::atomic
+#include <vector>		// std::vector
+
+#define MPCSTEPS	50	///<Steps of a rollout over the horizon
+#define MPCENUMCELLS	6	///<Up to this many cells every switch set is a candidate
+#define MPCMAXCAND	32	///<Maximum number of candidates of a decision
+#define MPCPERIOD	100	///<Decision period in mS, 10 Hz
+#define MPCBUDGET	10000	///<Default budget of a decision in micro seconds, a tenth of the period, the rest is for sensing and actuating
+
+/**
+ * @brief Decision time statistics of the controller
+ */
+struct sMpcStats
+{
+	unsigned long Decisions;	///<Decisions since the statistics were reset
+	double MeanTime;		///<Mean decision time in micro seconds
+	double P99Time;			///<99th percentile of the decision time in micro seconds
+	double MaxTime;			///<Longest decision time in micro seconds
+	unsigned long Overruns;		///<Decisions that took longer than the budget
+	unsigned long Skipped;		///<Candidates not evaluated because the budget was spent
+};
+
+/**
+ * @brief The model predictive balancing controller
+ *
+ * A candidate is a switch set that holds the highest cell, so the
+ * output is never taken from a lower cell alone. With upto MPCENUMCELLS
+ * cells every such set is a candidate, with more cells the candidates are
+ * the highest k cells for every k. The first candidate is the tolerance
+ * band rule and is always evaluated, the others only while the budget
+ * lasts. The cell coefficients are set once and shared by all rollouts.
+ */
+class cMpcController
+{
+	public:
+		cMpcController(int threads);
+		~cMpcController();
+		bool setCells(int n, const double* sres, const double* cap, const double* grad);
+		bool setHorizon(double horizon);
+		bool setBudget(double budget);
+		double getBudget(void);
+		void setCutOffVoltage(double cutoff);
+		uint32_t decide(const double* volts, const double* discharged, double load);
+		double simulate(const cScenario& scenario, double period);
+		sMpcStats getStats(void);
+		void resetStats(void);
+	private:
+		int Count;				///<Number of cells
+		double SeriesRes[MAXCELLS];		///<Series resistance of each cell in Ohms
+		double Capacity[MAXCELLS];		///<Capacity of each cell in AmS
+		double Gradient[MAXCELLS];		///<Gradient of each discharge curve
+		double Horizon;				///<Rollout horizon in mS
+		double Budget;				///<Time budget of a decision in micro seconds
+		double CutOffVoltage;			///<Cut off voltage in Volts
+		double Tolerance;			///<Band of the first candidate in Volts
+		double Voltage[MAXCELLS];		///<Cell voltages of the current decision
+		double Discharged[MAXCELLS];		///<Discharged capacities of the current decision
+		double Load;				///<Load of the current decision in Ohms
+		int Candidates;				///<Number of candidates of the current decision
+		uint32_t Mask[MPCMAXCAND];		///<Switch set of each candidate
+		double Value[MPCMAXCAND];		///<Predicted time to cut off of each candidate, negative if skipped
+		std::atomic<int> NextCandidate;		///<Next candidate to evaluate
+		std::atomic<int> SkippedNow;		///<Candidates skipped in the current decision
+		std::chrono::steady_clock::time_point Deadline;	///<End of the budget of the current decision
+		std::vector<double> Times;		///<Decision times since reset in micro seconds
+		unsigned long Overruns;			///<Decisions over budget since reset
+		unsigned long Skipped;			///<Candidates skipped since reset
+		std::vector<std::thread*> Workers;	///<Threads evaluating candidates besides the caller
+		std::mutex mtx;				///<Protects the fields below
+		std::condition_variable Start;		///<Signalled when a decision starts
+		std::condition_variable Finished;	///<Signalled when a worker is done with a decision
+		unsigned int Generation;		///<Counts the decisions, wakes the workers
+		int Busy;				///<Workers still evaluating the current decision
+		bool Quit;				///<Signals the workers to end
+		double rollout(uint32_t mask) const;
+		void evaluate(void);
+		void runWorker(void);
+		cMpcController(const cMpcController&);
+		cMpcController& operator=(const cMpcController&);
+};
+
+#endif //MPCCTRL_CLASS
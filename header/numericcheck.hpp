@@ -0,0 +1,57 @@
+/**
+ * @file numericcheck.hpp
+ * @brief Compares the numeric backends of the simulation kernels
+ *
+ * Runs a full discharge of the same cells with the kernels
+ * instantiated in double, float and fixed point, and reports
+ * how far each backend diverges from the double reference.
+ *
+ * @author Subir Biswas
+ * @date 19/10/2026
+ * @see numericcheck.cpp
+ * @see cellkernel.hpp
+ */
+
+#ifndef  NUMERICCHECK_CLASS
+#define  NUMERICCHECK_CLASS
+
+#include "singlebatt.hpp"
+#include "cellkernel.hpp"
+#include "scenario.hpp"
+
+#define BACKENDS	4	///<Number of numeric backends compared
+
+/**
+ * @brief Result of one numeric backend
+ */
+struct sBackendResult
+{
+	const char* Name;		///<Name of the numeric type
+	double RunTime;			///<Simulated time till cut off in mS
+	double MaxVoltageError;		///<Largest cell voltage difference from double in Volts
+	double MaxCapacityError;	///<Largest remaining capacity difference from double in %
+	long SwitchMismatches;		///<Steps where a switch state differed from double
+};
+
+/**
+ * @brief The numeric backend validation
+ *
+ * The cells are copied when they are added, the check
+ * does not touch the cells or a running battery.
+ */
+class cNumericCheck
+{
+	public:
+		cNumericCheck();
+		bool addCell(cSingleBatt* cell);
+		bool run(double load, double resolution);
+		int getBackendCount(void);
+		sBackendResult getResult(int backend);
+	private:
+		cScenario Scenario;			///<Cells the backends are run with
+		sBackendResult Result[BACKENDS];	///<Results of the last run
+		template<typename T>
+		void compare(int backend, const char* name, double load, double resolution);
+};
+
+#endif //NUMERICCHECK_CLASS
@@ -0,0 +1,93 @@
+/**
+ * @file packtopology.hpp
+ * @brief Defines a series-parallel battery pack.
+ *
+ * A pack is built as module -> string -> pack. A module is a
+ * battery of parallel cells with a balancing switch per cell,
+ * a string is a number of modules connected in series and the
+ * pack is a number of strings connected in parallel.
+ * The modules are stepped in parallel by a set of worker threads.
+ *
+ * @author Subir Biswas
+ * @date 19/10/2026
+ * @see packtopology.cpp
+ */
+
+#ifndef  PACKTOPOLOGY_CLASS
+#define  PACKTOPOLOGY_CLASS
+
+#include "singlebatt.hpp"
+#include "setbatt.hpp"
+#include <atomic>		// std::atomic
+
+#define BARRIERSPINS	4000	///<Spins of a waiting thread before it yields between polls
+#define PACKSTEPS	2000	///<Steps of the pack timing of the sim pack command
+
+/**
+ * @brief A reusable sense reversing thread barrier
+ *
+ * Blocks the calling threads until all the participants have reached
+ * the barrier. A tick of the pack is microseconds of work, too short to
+ * sleep on a condition variable, so the waiting threads spin on the
+ * generation and only yield once they spun for long. With more threads
+ * than cores a spinning thread would hold the core of the thread it
+ * waits for, then they yield at once.
+ */
+class cBarrier
+{
+	public:
+		cBarrier(int participants);
+		void wait(void);
+	private:
+		int Participants;			///<Number of threads to wait for
+		int Spins;				///<Spins before yielding
+		std::atomic<int> Waiting;		///<Number of threads already waiting
+		std::atomic<unsigned long> Generation;	///<Incremented every time the barrier opens
+};
+
+/**
+ * @brief defines a series-parallel battery pack
+ *
+ * Holds the cells and the modules of a SxP pack, for example 14S4P.
+ * Balancing decision is made per module, the string current is
+ * shared between the parallel strings and flows through every module
+ * of a string.
+ *
+ * @see cBattery
+ **/
+class cPack
+{
+	public:
+		cPack();
+		~cPack();
+		bool build(int series, int parallel, int strings);
+		cSingleBatt* getCell(int string, int module, int cell);
+		cBattery* getModule(int string, int module);
+		bool setThreads(int threads);
+		double simulate(double load, double resolution, long maxSteps);
+		int getSeriesCount(void);
+		int getParallelCount(void);
+		int getStringCount(void);
+		double getVout(void);
+		double getIout(void);
+		double getElapsedTime(void);
+		double getCutOffVoltage(void);
+
+	private:
+		int Series;			///<Number of modules in a string
+		int Parallel;			///<Number of cells in a module
+		int Strings;			///<Number of parallel strings
+		int Threads;			///<Number of threads stepping the modules
+		cSingleBatt* Cells;		///<All the cells of the pack, module by module
+		cBattery* Modules;		///<All the modules of the pack, string by string
+		double* StringCurrent;		///<Current through each string in Ampere
+		double Vout;			///<Output voltage of the pack in Volts
+		double Iout;			///<Output current of the pack in Ampere
+		double ElapsedTime;		///<Simulated time in mS
+		bool Exhausted;			///<Set when the pack went below the cut off voltage
+		void release(void);
+		void share(double load);
+		void worker(int first, int last, double resolution, long maxSteps, cBarrier* barrier, double load, bool leader);
+};
+
+#endif //PACKTOPOLOGY_CLASS
@@ -23,6 +23,7 @@ class cprocessIP
 	public:	
 		cprocessIP();
 		char getInput(void);
+		char parseInput(const char* line);
 		char ValidateInput(const char** , const char** );
 		int getFunctionNumber(void);
 		char* getLastCommand(void);
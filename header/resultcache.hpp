@@ -0,0 +1,67 @@
+/**
+ * @file resultcache.hpp
+ * @brief Defines the on disk cache of run results
+ *
+ * A headless run is fully given by its scenario, its balancing policy
+ * and the version of the simulator, so its results can be kept and
+ * reused by later runs, also of other processes and of colleagues
+ * sharing the directory. The key of a run is a canonical text of all
+ * of these, the doubles written as exact hexadecimal floats, and the
+ * entry is the file named by the hash of the key. An entry holds the
+ * key too, so a hash collision is a miss and not a wrong result.
+ *
+ * Entries are written to a temporary file in the directory, synced and
+ * renamed into place, which is atomic, so a reader sees a whole entry
+ * or none and writers of the same entry need no lock: their entries are
+ * equal. An entry ends with a checksum of all its bytes, so an entry
+ * torn or zero filled by a power loss is a miss.
+ *
+ * @author Subir Biswas
+ * @date 19/10/2026
+ * @see resultcache.cpp
+ */
+
+#ifndef  RESULTCACHE_CLASS
+#define  RESULTCACHE_CLASS
+
+#include "scenario.hpp"
+#include <string>	// std::string
+#include <vector>	// std::vector
+#include <atomic>	// std::atomic
+#include <stdint.h>	// uint64_t
+
+#define CACHEVERSION	1		///<Version of the results, increase it when a change of the simulator changes results
+#define CACHEMAGIC	0x32435242	///<"BRC2", entries with a checksum
+#define CACHEVALUES	16		///<Most summary values of an entry
+
+/**
+ * @brief Content addressed cache of run results in a directory
+ *
+ * The counters are atomic, one cache can be shared by threads.
+ */
+class cResultCache
+{
+	public:
+		cResultCache();
+		bool open(const char* dir);
+		bool isOpen(void);
+		const char* getDir(void);
+		static std::string key(const cScenario& scenario, const char* policy);
+		bool load(const std::string& key, double* values, int count, std::vector<uint8_t>* trace);
+		bool save(const std::string& key, const double* values, int count, const std::vector<uint8_t>* trace);
+		unsigned long getHits(void);
+		unsigned long getMisses(void);
+		void resetCounts(void);
+	private:
+		std::string Dir;			///<Directory of the entries, empty if closed
+		std::atomic<unsigned long> Hits;	///<Loads that found their entry
+		std::atomic<unsigned long> Misses;	///<Loads that did not
+		std::atomic<unsigned long> Written;	///<Entries written, names the temporary files
+		std::string path(const std::string& key);
+		static uint64_t hash(const std::string& key);
+		static uint64_t mix(uint64_t value, const void* data, size_t size);
+		cResultCache(const cResultCache&);
+		cResultCache& operator=(const cResultCache&);
+};
+
+#endif //RESULTCACHE_CLASS
@@ -0,0 +1,74 @@
+/**
+ * @file scenario.hpp
+ * @brief Defines a simulation scenario
+ *
+ * A scenario holds everything needed to repeat a headless
+ * simulation: the cell parameters, the load, the resolution
+ * and the cut off voltage.
+ *
+ * @author Subir Biswas
+ * @date 19/10/2026
+ * @see scenario.cpp
+ */
+
+#ifndef  SCENARIO_CLASS
+#define  SCENARIO_CLASS
+
+#include "singlebatt.hpp"
+#include "cellkernel.hpp"
+
+#define MAXSTEPS	100000000L	///<A scenario that does not reach cut off is stopped after this many steps
+
+/**
+ * @brief defines a scenario
+ *
+ * The cells are copied, the scenario does not refer to
+ * cSingleBatt objects after they are added.
+ */
+class cScenario
+{
+	public:
+		cScenario();
+		bool addCell(cSingleBatt* cell);
+		bool addCell(double initv, double sres, double cap, double shift, double drop);
+		bool setCell(int cell, double initv, double sres);
+		bool setLoad(double load);
+		bool setResolution(double resolution);
+		bool setCutOffVoltage(double cutoff);
+		int getCount(void) const;
+		double getInitialVoltage(int cell) const;
+		double getSeriesResistance(int cell) const;
+		double getCapacity(int cell) const;
+		double getShift(int cell) const;
+		double getDrop(int cell) const;
+		double getLoad(void) const;
+		double getResolution(void) const;
+		double getCutOffVoltage(void) const;
+
+		/**
+		 * @brief Loads the scenario into a headless model
+		 *
+		 * @param model an empty model
+		 * @return void
+		 */
+		template<typename T, typename Policy>
+		void build(cPackModel<T, Policy>& model) const
+		{
+			for(int i=0; i<Count; i++)
+				model.addCell(InitialVoltage[i], SeriesResistance[i], Capacity[i]*3600, Shift[i], Drop[i]);
+			model.setCutOffVoltage(T(CutOffVoltage));
+		}
+
+	private:
+		int Count;				///<Number of cells
+		double InitialVoltage[MAXCELLS];	///<Initial voltage of each cell in Volts
+		double SeriesResistance[MAXCELLS];	///<Series resistance of each cell in Ohms
+		double Capacity[MAXCELLS];		///<Capacity of each cell in mAH
+		double Shift[MAXCELLS];			///<Shift of each discharge curve in %
+		double Drop[MAXCELLS];			///<Drop of each discharge curve in %
+		double Load;				///<Load in Ohms
+		double Resolution;			///<Interval of a step in mS
+		double CutOffVoltage;			///<Cut off voltage in Volts
+};
+
+#endif //SCENARIO_CLASS
@@ -0,0 +1,93 @@
+/**
+ * @file scheduler.hpp
+ * @brief Defines a cooperative scheduler for battery simulations
+ *
+ * Runs many batteries in real time pace on a few threads. Every
+ * battery is a small resumable task instead of an OS thread: each
+ * resume runs the steps that are due and parks the task on a timer
+ * wheel till its next step is due.
+ *
+ * @author Subir Biswas
+ * @date 19/10/2026
+ * @see scheduler.cpp
+ */
+
+#ifndef  SCHEDULER_CLASS
+#define  SCHEDULER_CLASS
+
+#include "setbatt.hpp"
+#include <thread>		// std::thread
+#include <mutex>		// std::mutex
+#include <condition_variable>	// std::condition_variable
+#include <chrono>		// std::chrono
+#include <atomic>		// std::atomic
+#include <deque>		// std::deque
+#include <map>			// std::map
+#include <vector>		// std::vector
+
+#define WHEELSLOTS	256	///<Number of slots in the timer wheel
+#define WHEELTICK	1000	///<Duration of a timer wheel slot in micro seconds
+#define MAXBATCH	1000	///<Maximum number of steps a task runs in one resume
+#define SCHEDSPEED	100	///<Speed of the packs of the sim scheduler command, 1 s steps every 10 ms
+
+/**
+ * @brief A resumable battery run loop
+ *
+ * Holds the state that the runner thread keeps on its stack.
+ * resume() continues the run loop upto the next wait.
+ */
+class cPackTask
+{
+	public:
+		cPackTask(int id, cBattery* battery, double load, double resolution, double speed);
+		bool resume(long long now);
+		int Id;				///<Task identifier returned by spawn
+		double Due;			///<Time of the next step in micro seconds
+		long long DueTick;		///<Wheel tick at which the task is due
+		std::atomic<bool> Cancelled;	///<Set to stop the task at its next resume
+		bool Finished;			///<Set when the run loop has ended
+		bool Resuming;			///<Set while a worker is resuming the task
+		cPackTask* Next;		///<Next task in the same wheel slot
+	private:
+		cBattery* Battery;		///<Battery being simulated
+		double Load;			///<Load connected to the battery in Ohms
+		double Resolution;		///<Simulated time of a step in miliseconds
+		double Interval;		///<Real time between two steps in micro seconds
+		bool Started;			///<Denotes the battery is attached
+};
+
+/**
+ * @brief The cooperative scheduler
+ *
+ * A wheel thread advances the timer wheel and hands the due tasks
+ * to a few worker threads, which resume them.
+ */
+class cScheduler
+{
+	public:
+		cScheduler(int threads);
+		~cScheduler();
+		int spawn(cBattery* battery, double load, double resolution, double speed);
+		bool cancel(int task);
+		bool isActive(int task);
+		int getActiveCount(void);
+	private:
+		cPackTask* Slot[WHEELSLOTS];	///<Timer wheel, each slot is a list of tasks
+		long long Tick;			///<Index of the current wheel tick
+		std::chrono::steady_clock::time_point Epoch;	///<Start time of the wheel
+		std::deque<cPackTask*> Ready;	///<Tasks that are due and wait for a worker
+		std::map<int, cPackTask*> Tasks;	///<All active tasks by id
+		int LastId;			///<Last task id given
+		bool Quit;			///<Signals the threads to end
+		std::mutex mtx;			///<Protects the wheel, the ready queue and the tasks
+		std::condition_variable Wakeup;	///<Signalled when a task is ready
+		std::condition_variable Done;	///<Signalled when a task is finished
+		std::thread* Wheel;		///<The thread advancing the timer wheel
+		std::vector<std::thread*> Workers;	///<The threads resuming the tasks
+		long long now(void);
+		void park(cPackTask* task);
+		void runWheel(void);
+		void runWorker(void);
+};
+
+#endif //SCHEDULER_CLASS
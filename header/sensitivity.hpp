@@ -0,0 +1,83 @@
+/**
+ * @file sensitivity.hpp
+ * @brief Defines the runtime sensitivity analysis
+ *
+ * Runs one discharge of the pack model in dual numbers, which gives
+ * the runtime till cut off together with its derivative with respect
+ * to every parameter of every cell. Central finite differences of the
+ * double model are computed beside it as a check, they cost two runs
+ * per parameter.
+ *
+ * @author Subir Biswas
+ * @date 19/10/2026
+ * @see sensitivity.cpp
+ * @see dualnumber.hpp
+ */
+
+#ifndef  SENSITIVITY_CLASS
+#define  SENSITIVITY_CLASS
+
+#include "scenario.hpp"
+#include "dualnumber.hpp"
+
+#define SENSPARAMS	5	///<Parameters of a cell: initial voltage, series resistance, capacity, shift and drop
+#define SENSINITV	0	///<Index of the initial voltage in Volts
+#define SENSSRES	1	///<Index of the series resistance in Ohms
+#define SENSCAP		2	///<Index of the capacity in mAH
+#define SENSSHIFT	3	///<Index of the shift in %
+#define SENSDROP	4	///<Index of the drop in %
+
+/**
+ * @brief Runtime and its sensitivities
+ *
+ * The derivatives are in mS of runtime per unit of the parameter.
+ */
+struct sSensitivityResult
+{
+	int Cells;					///<Cells of the scenario
+	double RunTime;					///<Runtime till the output crosses the cut off voltage in mS
+	double Derivative[MAXCELLS][SENSPARAMS];	///<Derivatives from the dual number run
+	double Difference[MAXCELLS][SENSPARAMS];	///<Derivatives from central finite differences
+	bool Valid[MAXCELLS][SENSPARAMS];		///<Denotes that no switch decision of the dual number run depends on the parameter
+	long Toggles;					///<Switch events of the dual number run
+	double DualTime;				///<Wall time of the dual number run in S
+	double PlainTime;				///<Wall time of one double run in S
+	double DifferenceTime;				///<Wall time of all the finite difference runs in S
+};
+
+/**
+ * @brief The runtime sensitivity analysis
+ *
+ * The runtime is taken where the output voltage crosses the cut off
+ * voltage, interpolated within the last step. The step count itself
+ * does not change with a small change of a parameter, the crossing
+ * does, so the runtime is differentiable.
+ *
+ * The derivatives follow the path of the run. With all cells
+ * connected there is no switching decision and they are exact. With
+ * balancing the switching of the policy is held as it was, while a
+ * changed parameter would move it, so only the finite differences give
+ * the sensitivity of the balanced pack.
+ *
+ * Every parameter of every cell is one derivative of the dual number,
+ * the number type is chosen by the cell count: 4, 8 or MAXCELLS cells.
+ */
+class cSensitivity
+{
+	public:
+		cSensitivity();
+		bool setStep(double step);
+		void setBalanced(bool balanced);
+		bool run(const cScenario& scenario);
+		const sSensitivityResult& getResult(void);
+	private:
+		double Step;			///<Relative step of the finite differences
+		bool Balanced;			///<Denotes that the balancing policy switches the cells
+		uint32_t Mask;			///<Switches of the cells of the last run, 0 when balanced
+		sSensitivityResult Result;	///<Result of the last run
+		template<int N>
+		void runDual(const cScenario& scenario);
+		void runDifferences(const cScenario& scenario);
+};
+
+#endif //SENSITIVITY_CLASS
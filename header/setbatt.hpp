@@ -16,9 +16,41 @@
 #define  BATTERYSET_CLASS
 
 #include "singlebatt.hpp"
+#include "cellkernel.hpp"
+#include "balancectrl.hpp"
+#include "snapshot.hpp"
+#include "spscqueue.hpp"
+#include "faultplan.hpp"
 #include <thread>	// std::thread
 #include <mutex>	// std::mutex
 
+#define MAXSINKS	4	///<Maximum number of step sinks of a battery
+#define MAXSUBSTEPS	1000	///<Maximum number of physics substeps per controller step
+#define LIVEQUEUE	64	///<Live changes that can wait for the next step
+#define LIVELOAD	1	///<Live change of the load, Value[0] in Ohms
+#define LIVESRES	2	///<Live change of the series resistances, Value[i] in Ohms for cell i, 0 keeps it
+
+/**
+ * @brief A change of a running battery
+ *
+ * Applied as a whole at the start of a step.
+ */
+struct sLiveChange
+{
+	int Type;			///<LIVELOAD or LIVESRES
+	int Count;			///<Number of values
+	double Value[MAXCELLS];		///<New values
+	unsigned long Step;		///<Step the change was applied at, set by the battery
+};
+
+/**
+ * @brief Receives the state of a battery after every step
+ *
+ * Called by the thread stepping the battery, so it must be short.
+ * @param context	the context given to addSink
+ * @param snapshot	state of the battery after the step
+ */
+typedef void (*tStepSink)(void* context, const sSnapshot& snapshot);
 
 /**
  * @brief defines a battery
@@ -45,15 +77,59 @@ class cBattery
 		bool IsRunning(void);
 		double getLoadResistance(void);
 		double getCutOffVoltage(void);
+		int getCellCount(void);
+		bool attach(void);
+		bool detach(void);
+		bool balance(void);
+		bool balance(uint32_t mask);
+		bool discharge(double current, double resolution);
+		bool step(double load, double resolution);
+		double getResistance(void);
+		bool setHysteresis(double on, double off);
+		bool setDwell(int on, int off);
+		bool setSubsteps(int substeps);
+		int getSubsteps(void);
+		unsigned int getToggleCount(int cell);
+		unsigned int getToggleHistogram(int cell, int bin);
+		unsigned int getDecisionCount(void);
+		bool publish(double load);
+		sSnapshot getSnapshot(void);
+		bool addSink(tStepSink sink, void* context);
+		bool removeSink(tStepSink sink, void* context);
+		bool post(const sLiveChange& change);
+		bool apply(const sLiveChange& change);
+		bool getApplied(sLiveChange& change);
+		bool setFaults(cFaultPlan* plan);
 
 	private:
-		cSingleBatt *Cell[3];		///<Holds the cells that are added. @see addCell
-		bool Switch[3];			///<A switch for each cell
+		cSingleBatt *Cell[MAXCELLS];	///<Holds the cells that are added. @see addCell
+		bool Switch[MAXCELLS];		///<A switch for each cell
+		double SeriesRes[MAXCELLS];	///<Series resistance of each cell, cached while attached. @see attach
+		double Ratio;			///<Sum of V/R of the connected cells, used to share the output current
+		bool Attached;			///<Denotes the cells are locked to this battery for stepping
 		double Vout;			///<Output voltage of the battery in Volts.
 		double Iout;			///<Output current of the battery in Ampere.
 		double ElapsedTime;		///<Time for which the battery is running in mS.
 		double CutOffVoltage;		///<Battery will be disconnected when Output voltage drops below this. expressed in Volts.
 		double tollarance;
+		int Substeps;			///<Physics substeps per controller step. @see setSubsteps
+		cBalanceController<double> Controller;	///<Takes the balancing decision. @see balance
+		cSnapshotBuffer Published;	///<Latest published state. @see publish
+		tStepSink Sink[MAXSINKS];	///<Step sinks. @see addSink
+		void* SinkContext[MAXSINKS];	///<Context of each step sink
+		int SinkCount;			///<Number of step sinks
+		cSpscQueue<sLiveChange, LIVEQUEUE> Changes;	///<Live changes waiting for the next step. @see post
+		cSpscQueue<sLiveChange, LIVEQUEUE> Applied;	///<Live changes applied, with their step. @see getApplied
+		double LiveLoad;		///<Load set by a live change in Ohms, 0 for the load of the run
+		unsigned long Steps;		///<Steps since the battery was attached
+		cFaultPlan* Faults;		///<Faults of the runs, null for none. @see setFaults
+		double Sensed;			///<Output voltage the controller sees in Volts, differs from Vout under faults
+		static bool validChange(const sLiveChange& change);
+		void applyChange(sLiveChange& change);
+		void applyChanges(void);
+		void applyFaults(void);
+		double hold(double load, double resolution, int substeps);
+		void capture(double load, sSnapshot& snapshot);
 		std::thread* Runner;		///<Pointer to the runner thread
 		std::mutex SimState;		///<Used to signal thread terminaton event
 		void runBattery(double load,double resolution,double speed);
@@ -12,6 +12,7 @@
 #define  SIMULATION_CLASS
 
 #include "setbatt.hpp"
+#include "scheduler.hpp"
 
 /**
  * @brief The simulator class
@@ -32,12 +33,17 @@ class cSimulation
 		bool connect(double);
 		bool setLoad(double load);
 		double getLoad(void);
+		double getResolution(void);
+		bool useScheduler(cScheduler*);
+		bool IsRunning(void);
 	private:
 		double Load;		///<Load to connect with the battery
 		cBattery* BatPack;  	///<Pointer to the Battery to be simulated
 		double Speed;		///<simulation speed. used to reduce the delay by this factor
 		double Resolution;  	///resolution of the simulation. It determines how often battery will be sampled
 		bool BatteryConnected;	///<denotes weather a battery is connected or not
+		cScheduler* Scheduler;	///<Scheduler running the battery as a task, NULL for a runner thread
+		int TaskId;		///<Scheduler task of the running battery
 };
 
 #endif //SIMULATION_CLASS
@@ -34,6 +34,7 @@ class cSingleBatt
 		cSingleBatt();
 		bool setInitialVoltage(double initv);
 		bool setSeriesResistance(double sres);
+		bool setSeriesResistance(cBattery* owner, double sres);
 		bool setCapacity(double cap);
 		bool lock(cBattery* owner);
 		bool unlock(cBattery* owner);
@@ -45,6 +46,8 @@ class cSingleBatt
 		double getRemainingCapacityPercentage(void);
 		bool loadDefaults(cBattery* owner);		
 		double getCurrentVoltage(void);
+		double getShift(void);
+		double getDrop(void);
 	private:
 		bool Locked;				///<Denotes the cell is connected to a battery and the parameters are locked
 		cBattery* AttachedTo;		///<Denotes which battery it is connected to
@@ -0,0 +1,109 @@
+/**
+ * @file snapshot.hpp
+ * @brief Published snapshots of the battery state
+ *
+ * The battery publishes a copy of its state after every step. Readers
+ * such as the control server take the latest copy without locking the
+ * battery: the buffer is a sequence lock, a reader retries when a
+ * writer was copying at the same time, a writer never waits for readers.
+ *
+ * @author Subir Biswas
+ * @date 19/10/2026
+ * @see setbatt.cpp
+ */
+
+#ifndef  SNAPSHOT_CLASS
+#define  SNAPSHOT_CLASS
+
+#include <atomic>	// std::atomic
+#include <mutex>	// std::mutex
+#include <string.h>	// memcpy
+#include "cellkernel.hpp"
+
+/**
+ * @brief State of a battery at one moment
+ */
+struct sSnapshot
+{
+	unsigned long Version;				///<Number of the snapshot, counts the publishes
+	unsigned long Steps;				///<Steps since the battery was attached
+	double ElapsedTime;				///<Simulated time in mS
+	double Vout;					///<Output voltage in Volts
+	double Iout;					///<Output current in Ampere
+	double Load;					///<Load in Ohms
+	double CutOffVoltage;				///<Cut off voltage in Volts
+	unsigned int Decisions;				///<Balancing decisions since the battery was attached
+	int Substeps;					///<Physics substeps per controller step
+	int Count;					///<Number of cells
+	double InitialVoltage[MAXCELLS];		///<Initial voltage of each cell in Volts
+	double SeriesResistance[MAXCELLS];		///<Series resistance of each cell in Ohms
+	double Capacity[MAXCELLS];			///<Capacity of each cell in mAH
+	double CurrentVoltage[MAXCELLS];		///<Voltage of each cell in Volts
+	double SourceCurrent[MAXCELLS];			///<Current sourced by each cell in Ampere
+	double RemainingCapacity[MAXCELLS];		///<Remaining capacity of each cell in %
+	bool Switch[MAXCELLS];				///<Switch of each cell
+	unsigned int Toggles[MAXCELLS];			///<Switch changes of each cell
+	unsigned int Histogram[MAXCELLS][CTRLHISTBINS];	///<Toggle rate histogram of each switch
+};
+
+/**
+ * @brief Sequence locked buffer holding the latest snapshot
+ *
+ * Writers are serialized by a mutex, readers never lock.
+ */
+class cSnapshotBuffer
+{
+	public:
+		cSnapshotBuffer()
+		{
+			Sequence = 0;
+			memset(&Data, 0, sizeof(Data));
+		}
+
+		/**
+		 * @brief Publishes a snapshot
+		 *
+		 * @param snapshot the new state, its Version is set
+		 * @return void
+		 */
+		void publish(const sSnapshot& snapshot)
+		{
+			std::lock_guard<std::mutex> lock(Writer);
+			unsigned long seq = Sequence.load(std::memory_order_relaxed);
+			Sequence.store(seq + 1, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+			memcpy(&Data, &snapshot, sizeof(Data));
+			Data.Version = seq/2 + 1;
+			Sequence.store(seq + 2, std::memory_order_release);
+		}
+
+		/**
+		 * @brief Returns the latest snapshot
+		 *
+		 * @param void
+		 * @return sSnapshot copy of the latest snapshot, Version 0 if none was published
+		 */
+		sSnapshot read(void) const
+		{
+			sSnapshot copy;
+			unsigned long before, after;
+			do
+			{
+				before = Sequence.load(std::memory_order_acquire);
+				memcpy(&copy, &Data, sizeof(copy));
+				std::atomic_thread_fence(std::memory_order_acquire);
+				after = Sequence.load(std::memory_order_relaxed);
+			}
+			while((before & 1) || before != after);
+			return copy;
+		}
+
+	private:
+		std::atomic<unsigned long> Sequence;	///<Odd while a writer is copying
+		sSnapshot Data;				///<The latest snapshot
+		std::mutex Writer;			///<Serializes the writers
+		cSnapshotBuffer(const cSnapshotBuffer&);
+		cSnapshotBuffer& operator=(const cSnapshotBuffer&);
+};
+
+#endif //SNAPSHOT_CLASS
@@ -0,0 +1,103 @@
+/**
+ * @file socestimator.hpp
+ * @brief Defines the state of charge estimator
+ *
+ * Estimates the state of charge of many cells from the measured cell
+ * voltage and current only, the way the BMS has to, instead of taking
+ * it from the model. Every cell runs Coulomb counting and an extended
+ * Kalman filter. The state of all the cells is held as arrays, one
+ * array per quantity, so the filters of 4, 8 or 16 cells are updated
+ * at once with AVX2 or AVX-512, like cCellBatch.
+ *
+ * @author Subir Biswas
+ * @date 19/10/2026
+ * @see socestimator.cpp
+ * @see cellbatch.hpp
+ */
+
+#ifndef  SOCESTIMATOR_CLASS
+#define  SOCESTIMATOR_CLASS
+
+#include "cellbatch.hpp"
+#include "scenario.hpp"
+
+#define SOCOFFSET	0.1	///<Initial error of the estimator of the sim soc command, as a fraction of the charge
+
+/**
+ * @brief Noise of the simulated sensors
+ */
+struct sSensorNoise
+{
+	double Voltage;		///<Standard deviation of the voltage measurement in Volts
+	double Current;		///<Standard deviation of the current measurement in Ampere
+	double Bias;		///<Offset of the current measurement in Ampere
+};
+
+/**
+ * @brief Accuracy and cost of the estimator
+ */
+struct sSocAccuracy
+{
+	int Cells;		///<Cells estimated
+	double Offset;		///<Initial error of both estimates, as a fraction of the charge
+	long Updates;		///<Updates of every cell
+	double FilterRms;	///<Root mean square error of the Kalman filter in %
+	double FilterMax;	///<Largest error of the Kalman filter after it settled in %
+	double CountRms;	///<Root mean square error of Coulomb counting in %
+	double CountMax;	///<Largest error of Coulomb counting in %
+	double Cost[3];		///<Time of an update per cell in nS with each kernel, 0 if not supported
+};
+
+/**
+ * @brief defines the state of charge estimator of a batch of cells
+ *
+ * A cell is described by the model the BMS knows of it: the capacity
+ * and the open circuit voltage curve, V = Full - Slope * (1 - soc).
+ * Each update takes one voltage and current measurement per cell:
+ *	- Coulomb counting and the filter prediction subtract the charge
+ *	  sourced since the last update
+ *	- the filter corrects its state by the difference between the
+ *	  measured voltage and the voltage the curve predicts, weighted by
+ *	  the Kalman gain from the slope of the curve at the estimate
+ *
+ * The state of charge is a fraction, 1 is full.
+ *
+ * @see cCellBatch
+ **/
+class cSocEstimator
+{
+	public:
+		cSocEstimator(int cells);
+		~cSocEstimator();
+		bool setCell(int index, double full, double slope, double capacity, double soc);
+		bool setNoise(const sSensorNoise& noise, double interval);
+		bool setMeasurement(int index, double voltage, double current);
+		void update(double runtime);
+		int getCount(void);
+		double getFilterSoc(int index);
+		double getCountedSoc(int index);
+		double getVariance(int index);
+		bool setKernel(int kernel);
+		int getKernel(void);
+
+	private:
+		int Count;		///<Number of cells
+		int Padded;		///<Number of cells rounded up to BATCHALIGN
+		int Kernel;		///<Kernel used by update. @see cCellBatch::setKernel
+		double ProcessNoise;	///<Variance of the charge counted in an update times the squared capacity
+		double MeasureNoise;	///<Variance of the voltage measurement
+		double* Full;		///<Open circuit voltage of each full cell in Volts
+		double* Slope;		///<Voltage of each cell over its state of charge in Volts
+		double* Capacity;	///<Capacity of each cell in AmS
+		double* Soc;		///<State of charge estimated by the filter
+		double* Variance;	///<Variance of the filter estimate
+		double* Counted;	///<State of charge by Coulomb counting
+		double* Voltage;	///<Measured voltage of each cell in Volts
+		double* Current;	///<Measured current of each cell in Ampere
+		cSocEstimator(const cSocEstimator&);
+		cSocEstimator& operator=(const cSocEstimator&);
+};
+
+bool evaluateSoc(const cScenario& scenario, int cells, const sSensorNoise& noise, double offset, sSocAccuracy& accuracy);
+
+#endif //SOCESTIMATOR_CLASS
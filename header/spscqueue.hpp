@@ -0,0 +1,92 @@
+/**
+ * @file spscqueue.hpp
+ * @brief Lock free single producer single consumer queue
+ *
+ * A ring of SIZE entries with a head index written only by the
+ * consumer and a tail index written only by the producer. Neither
+ * side locks or waits: push fails when the ring is full and pop
+ * fails when it is empty.
+ *
+ * @author Subir Biswas
+ * @date 19/10/2026
+ * @see setbatt.cpp
+ */
+
+#ifndef  SPSCQUEUE_CLASS
+#define  SPSCQUEUE_CLASS
+
+#include <atomic>	// std::atomic
+#include <stddef.h>	// size_t
+
+/**
+ * @brief The queue
+ *
+ * Several producer threads are allowed if they are serialized by
+ * a lock of their own, the same holds for consumers.
+ *
+ * @param T	type of an entry, copied in and out
+ * @param SIZE	number of entries, a power of two
+ */
+template<typename T, size_t SIZE>
+class cSpscQueue
+{
+	static_assert(SIZE > 1 && (SIZE & (SIZE - 1)) == 0, "queue size must be a power of two");
+	public:
+		cSpscQueue()
+		{
+			Head = 0;
+			Tail = 0;
+		}
+
+		/**
+		 * @brief Adds an entry, producer side
+		 *
+		 * @param entry the entry
+		 * @return bool false if the queue is full
+		 */
+		bool push(const T& entry)
+		{
+			size_t tail = Tail.load(std::memory_order_relaxed);
+			if(tail - Head.load(std::memory_order_acquire) == SIZE)
+				return false;
+			Ring[tail & (SIZE - 1)] = entry;
+			Tail.store(tail + 1, std::memory_order_release);
+			return true;
+		}
+
+		/**
+		 * @brief Takes the oldest entry, consumer side
+		 *
+		 * @param entry the entry is copied here
+		 * @return bool false if the queue is empty
+		 */
+		bool pop(T& entry)
+		{
+			size_t head = Head.load(std::memory_order_relaxed);
+			if(head == Tail.load(std::memory_order_acquire))
+				return false;
+			entry = Ring[head & (SIZE - 1)];
+			Head.store(head + 1, std::memory_order_release);
+			return true;
+		}
+
+		/**
+		 * @brief Returns true if the queue is empty, consumer side
+		 *
+		 * Two loads and no store, cheap enough for every step.
+		 */
+		bool empty(void) const
+		{
+			return Head.load(std::memory_order_relaxed) == Tail.load(std::memory_order_acquire);
+		}
+
+	private:
+		T Ring[SIZE];			///<The entries
+		std::atomic<size_t> Head;	///<Entries taken, written by the consumer
+		char Pad[64];			///<Keeps Head and Tail on different cache lines
+		std::atomic<size_t> Tail;	///<Entries added, written by the producer
+		cSpscQueue(const cSpscQueue&);
+		cSpscQueue& operator=(const cSpscQueue&);
+};
+
+#endif //SPSCQUEUE_CLASS
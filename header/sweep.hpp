@@ -0,0 +1,123 @@
+/**
+ * @file sweep.hpp
+ * @brief Defines the sharded sweep of a fleet over the balancing policies
+ *
+ * A sweep runs every balancing policy on every pack of a fleet, too
+ * many runs for one process to be trusted with. The packs are cut into
+ * shards of consecutive packs and the coordinator forks worker processes
+ * that run a shard each, headless through cTournament. A worker writes
+ * the results of its shard to a file of its own in the sweep directory,
+ * through a temporary file that is synced and renamed into place.
+ *
+ * Progress is kept in an append only journal in the same directory,
+ * written by the coordinator alone: the sweep it belongs to, and each
+ * shard started, done or failed. A record is only done once the file of
+ * its shard is in place, and every record carries a checksum, so a
+ * journal torn by a crash is cut back to its last whole record and the
+ * sweep resumes with the shards that are not done. At the end the shard
+ * files are merged into one CSV and the policies are ranked.
+ *
+ * Nothing but the directory is shared, so coordinators on several
+ * machines can later split the shards of one sweep on shared storage.
+ *
+ * @author Subir Biswas
+ * @date 19/10/2026
+ * @see sweep.cpp
+ * @see tools/sweep.cpp
+ */
+
+#ifndef  SWEEP_CLASS
+#define  SWEEP_CLASS
+
+#include "fleet.hpp"
+#include "tournament.hpp"
+#include "resultcache.hpp"
+#include <vector>	// std::vector
+#include <string>	// std::string
+#include <ostream>	// std::ostream
+#include <stdint.h>	// uint32_t, uint64_t
+
+#define SWEEPMAGIC	0x50575342	///<"BSWP", magic of journal records and shard files
+#define SWEEPVERSION	1		///<Version of the journal and shard files
+#define SWEEPSHARD	64		///<Default packs of a shard
+#define SWEEPRETRIES	3		///<Attempts of a shard before the sweep gives up on it
+
+#define SWEEPBEGIN	1	///<Journal record of the sweep, Shard shards, Value packs, Extra packs of a shard, Stamp identity of the fleet
+#define SWEEPSTART	2	///<Journal record of a shard given to the worker of process Value
+#define SWEEPDONE	3	///<Journal record of a shard whose file is in place
+#define SWEEPFAIL	4	///<Journal record of a shard whose worker ended with status Value
+
+/**
+ * @brief A record of the journal
+ */
+struct sJournalRecord
+{
+	uint32_t Magic;		///<SWEEPMAGIC
+	uint32_t Type;		///<SWEEPBEGIN, SWEEPSTART, SWEEPDONE or SWEEPFAIL
+	uint32_t Shard;		///<The shard
+	uint32_t Value;		///<Depends on the type
+	uint64_t Stamp;		///<Depends on the type
+	uint32_t Extra;		///<Depends on the type
+	uint32_t Check;		///<FNV-1a hash of the bytes before it
+};
+
+/**
+ * @brief Head of a shard file, followed by runtime and imbalance of every policy of every pack
+ */
+struct sShardHeader
+{
+	uint32_t Magic;		///<SWEEPMAGIC
+	uint32_t Version;	///<SWEEPVERSION
+	uint32_t Shard;		///<The shard
+	uint32_t FirstPack;	///<Index of the first pack of the shard
+	uint32_t Packs;		///<Packs of the shard
+	uint32_t Policies;	///<Policies run on every pack
+	uint64_t Stamp;		///<Identity of the fleet
+};
+
+/**
+ * @brief Coordinator of a sharded sweep
+ */
+class cSweep
+{
+	public:
+		cSweep();
+		~cSweep();
+		bool open(const char* dir, cFleet* fleet, int packs);
+		void setCache(cResultCache* cache);
+		bool run(int workers, std::ostream& out);
+		bool merge(void);
+		int getShardCount(void);
+		int getDoneCount(void);
+		int getResumedCount(void);
+		int getTornCount(void);
+		const char* getResultPath(void);
+		sPolicyResult getResult(int rank);
+		const char* getError(void);
+	private:
+		std::string Dir;		///<Directory of the journal and the shard files
+		cFleet* Fleet;			///<The packs
+		cResultCache* Cache;		///<Cache of the runs of the workers, null for none
+		int Journal;			///<Descriptor of the journal, -1 if closed
+		int ShardPacks;			///<Packs of a shard
+		int Shards;			///<Number of shards
+		uint64_t Stamp;			///<Identity of the fleet
+		std::vector<bool> Done;		///<Shards done
+		int Resumed;			///<Shards done before this coordinator started
+		int Torn;			///<Bytes cut from the end of the journal
+		std::string Results;		///<The merged CSV
+		sPolicyResult Result[POLICIES];	///<Ranking of the merged results, best first
+		const char* Error;		///<The last error, empty if none
+		bool fail(const char* error);
+		bool append(uint32_t type, uint32_t shard, uint32_t value, bool sync);
+		bool replay(void);
+		bool runShard(int shard);
+		bool loadShard(int shard, std::vector<double>& values);
+		std::string shardPath(int shard);
+		static uint64_t identity(cFleet* fleet);
+		static uint32_t check(const sJournalRecord& record);
+		cSweep(const cSweep&);
+		cSweep& operator=(const cSweep&);
+};
+
+#endif //SWEEP_CLASS
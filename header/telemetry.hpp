@@ -0,0 +1,214 @@
+/**
+ * @file telemetry.hpp
+ * @brief Layout and reader of the shared memory telemetry ring
+ *
+ * The simulator started with -m <name> writes one record per battery
+ * step into the POSIX shared memory object <name>. Monitors map it
+ * read only and follow the writer; the writer never makes a system
+ * call per step and never waits for a reader.
+ *
+ * Layout, all numbers in the native byte order of the host:
+ *	offset 0	sTelemetryHeader, 64 bytes
+ *	offset 64	Slots records of RecordSize bytes, sTelemetryRecord
+ *
+ * Step s is written to slot s % Slots. Head is the number of steps
+ * written. The Sequence of a record is odd while the writer copies
+ * it and 2*s+2 once step s is complete. A reader copies the record and
+ * accepts it if Sequence was 2*s+2 before and after the copy, else the
+ * writer has overtaken the reader and the step is lost. Reads of Head
+ * and Sequence are acquire loads, so a reader in another language only
+ * needs 64 bit atomic loads.
+ *
+ * This header does not depend on the rest of the simulator, monitors
+ * include it alone.
+ *
+ * @author Subir Biswas
+ * @date 19/10/2026
+ * @see telemwriter.cpp
+ * @see tools/telemtail.cpp
+ */
+
+#ifndef  TELEMETRY_CLASS
+#define  TELEMETRY_CLASS
+
+#include <stdint.h>	// uint64_t
+#include <string.h>	// memcpy
+#include <fcntl.h>	// O_RDONLY
+#include <unistd.h>	// close
+#include <sys/mman.h>	// shm_open, mmap
+#include <sys/stat.h>	// fstat
+
+#define TELEMAGIC	0x52544242	///<"BBTR" in the first four bytes on little endian hosts
+#define TELEVERSION	1		///<Version of the layout
+#define TELEMAXCELLS	16		///<Cells a record holds
+#define TELESLOTS	4096		///<Default number of records in the ring, a power of two
+
+/**
+ * @brief Header of the ring, 64 bytes
+ */
+struct sTelemetryHeader
+{
+	uint32_t Magic;		///<TELEMAGIC once the ring is initialised
+	uint32_t Version;	///<TELEVERSION
+	uint32_t Slots;		///<Number of records, a power of two
+	uint32_t RecordSize;	///<Size of a record in bytes
+	uint32_t MaxCells;	///<Cells a record holds
+	uint32_t Closed;	///<1 once the writer has finished
+	uint64_t Head;		///<Number of steps written
+	uint64_t Reserved[4];	///<Zero
+};
+
+/**
+ * @brief State of the battery after one step, 448 bytes
+ */
+struct sTelemetryRecord
+{
+	uint64_t Sequence;			///<Odd while written, 2*Step+2 when complete
+	uint64_t Step;				///<Index of the step since the ring was created
+	double ElapsedTime;			///<Simulated time in mS
+	double Vout;				///<Output voltage in Volts
+	double Iout;				///<Output current in Ampere
+	double Load;				///<Load in Ohms
+	uint32_t Count;				///<Number of cells
+	uint32_t Switches;			///<Switch states, bit i for cell i
+	double Voltage[TELEMAXCELLS];		///<Voltage of each cell in Volts
+	double Current[TELEMAXCELLS];		///<Current sourced by each cell in Ampere
+	double Remaining[TELEMAXCELLS];		///<Remaining capacity of each cell in %
+	uint64_t Reserved;			///<Zero
+};
+
+static_assert(sizeof(sTelemetryHeader) == 64, "telemetry header layout");
+static_assert(sizeof(sTelemetryRecord) == 448, "telemetry record layout");
+
+/**
+ * @brief Reads the records of a telemetry ring
+ *
+ * Starts at the newest record and follows the writer.
+ */
+class cTelemetryReader
+{
+	public:
+		cTelemetryReader()
+		{
+			Header = (const sTelemetryHeader*)0;
+			Records = (const sTelemetryRecord*)0;
+			Size = 0;
+			Next = 0;
+			Lost = 0;
+		}
+		~cTelemetryReader() { close(); }
+
+		/**
+		 * @brief Maps a ring
+		 *
+		 * @param name		name of the shared memory object, e.g. /battbalancesim
+		 * @param oldest	true to start at the oldest record still in the ring
+		 * @return bool false if it does not exist or is not a ring of this version
+		 */
+		bool open(const char* name, bool oldest = false)
+		{
+			struct stat info;
+			close();
+			int fd = shm_open(name, O_RDONLY, 0);
+			if(fd < 0)
+				return false;
+			if(fstat(fd, &info) < 0 || (size_t)info.st_size < sizeof(sTelemetryHeader))
+			{
+				::close(fd);
+				return false;
+			}
+			Size = info.st_size;
+			void* map = mmap((void*)0, Size, PROT_READ, MAP_SHARED, fd, 0);
+			::close(fd);
+			if(map == MAP_FAILED)
+				return false;
+			Header = (const sTelemetryHeader*)map;
+			if(__atomic_load_n(&Header->Magic, __ATOMIC_ACQUIRE) != TELEMAGIC || Header->Version != TELEVERSION
+				|| Header->RecordSize != sizeof(sTelemetryRecord) || Header->MaxCells != TELEMAXCELLS
+				|| Size < sizeof(sTelemetryHeader) + (size_t)Header->Slots * sizeof(sTelemetryRecord))
+			{
+				close();
+				return false;
+			}
+			Records = (const sTelemetryRecord*)(Header + 1);
+			Next = __atomic_load_n(&Header->Head, __ATOMIC_ACQUIRE);
+			if(oldest)
+				Next = (Next > Header->Slots) ? Next - Header->Slots : 0;
+			Lost = 0;
+			return true;
+		}
+
+		/**
+		 * @brief Unmaps the ring
+		 */
+		void close(void)
+		{
+			if(Header != (const sTelemetryHeader*)0)
+				munmap((void*)Header, Size);
+			Header = (const sTelemetryHeader*)0;
+			Records = (const sTelemetryRecord*)0;
+		}
+
+		/**
+		 * @brief Takes the next record
+		 *
+		 * Records the writer overwrote before they were read are skipped
+		 * and counted as lost.
+		 * @param record the record is copied here
+		 * @return bool false if there is no new record
+		 */
+		bool next(sTelemetryRecord& record)
+		{
+			if(Header == (const sTelemetryHeader*)0)
+				return false;
+			uint64_t slots = Header->Slots;
+			while(true)
+			{
+				uint64_t head = __atomic_load_n(&Header->Head, __ATOMIC_ACQUIRE);
+				if(Next >= head)
+					return false;
+				if(head - Next > slots)
+				{
+					Lost += head - slots - Next;
+					Next = head - slots;
+				}
+				const sTelemetryRecord* slot = &Records[Next & (slots - 1)];
+				uint64_t expect = 2*Next + 2;
+				uint64_t before = __atomic_load_n(&slot->Sequence, __ATOMIC_ACQUIRE);
+				memcpy(&record, (const void*)slot, sizeof(record));
+				__atomic_thread_fence(__ATOMIC_ACQUIRE);
+				uint64_t after = __atomic_load_n(&slot->Sequence, __ATOMIC_RELAXED);
+				Next++;
+				if(before == expect && after == expect)
+					return true;
+				Lost++;
+			}
+		}
+
+		/**
+		 * @brief Returns true once the writer has finished and every record is read
+		 */
+		bool isClosed(void) const
+		{
+			if(Header == (const sTelemetryHeader*)0)
+				return true;
+			return __atomic_load_n(&Header->Closed, __ATOMIC_ACQUIRE)
+				&& Next >= __atomic_load_n(&Header->Head, __ATOMIC_ACQUIRE);
+		}
+
+		/**
+		 * @brief Returns the number of records lost since open
+		 */
+		uint64_t getLost(void) const { return Lost; }
+
+	private:
+		const sTelemetryHeader* Header;		///<Mapped header
+		const sTelemetryRecord* Records;	///<Mapped records
+		size_t Size;				///<Size of the mapping in bytes
+		uint64_t Next;				///<Step to read next
+		uint64_t Lost;				///<Steps lost since open
+		cTelemetryReader(const cTelemetryReader&);
+		cTelemetryReader& operator=(const cTelemetryReader&);
+};
+
+#endif //TELEMETRY_CLASS
@@ -0,0 +1,46 @@
+/**
+ * @file telemwriter.hpp
+ * @brief Defines the writer of the shared memory telemetry ring
+ *
+ * @author Subir Biswas
+ * @date 19/10/2026
+ * @see telemwriter.cpp
+ * @see telemetry.hpp
+ */
+
+#ifndef  TELEMWRITER_CLASS
+#define  TELEMWRITER_CLASS
+
+#include "telemetry.hpp"
+#include "snapshot.hpp"
+
+/**
+ * @brief Writes battery steps into a telemetry ring
+ *
+ * Registered as a step sink of a battery. There is one writer per ring,
+ * write() is called by the thread that steps the battery.
+ *
+ * @see cBattery::addSink
+ */
+class cTelemetryWriter
+{
+	public:
+		cTelemetryWriter();
+		~cTelemetryWriter();
+		bool open(const char* name, unsigned int slots);
+		bool close(void);
+		bool isOpen(void);
+		void write(const sSnapshot& snapshot);
+		uint64_t getWritten(void);
+		static void sink(void* writer, const sSnapshot& snapshot);
+	private:
+		char Name[256];			///<Name of the shared memory object
+		sTelemetryHeader* Header;	///<Mapped header
+		sTelemetryRecord* Records;	///<Mapped records
+		size_t Size;			///<Size of the mapping in bytes
+		uint64_t Head;			///<Steps written
+		cTelemetryWriter(const cTelemetryWriter&);
+		cTelemetryWriter& operator=(const cTelemetryWriter&);
+};
+
+#endif //TELEMWRITER_CLASS
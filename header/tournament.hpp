@@ -0,0 +1,66 @@
+/**
+ * @file tournament.hpp
+ * @brief Defines the balancing policy tournament
+ *
+ * Runs every balancing policy against the same set of scenarios
+ * on several threads and ranks the policies by the runtime till
+ * cut off and by the imbalance left in the cells at cut off.
+ *
+ * @author Subir Biswas
+ * @date 19/10/2026
+ * @see tournament.cpp
+ * @see balancepolicy.hpp
+ */
+
+#ifndef  TOURNAMENT_CLASS
+#define  TOURNAMENT_CLASS
+
+#include "scenario.hpp"
+#include "resultcache.hpp"
+#include <vector>	// std::vector
+
+#define POLICIES	4	///<Number of balancing policies in the tournament
+
+/**
+ * @brief Result of one balancing policy
+ */
+struct sPolicyResult
+{
+	const char* Name;		///<Name of the policy
+	double MeanRunTime;		///<Mean simulated time till cut off in mS
+	double MeanImbalance;		///<Mean spread of remaining capacity at cut off in %
+	double WorstImbalance;		///<Largest spread of remaining capacity at cut off in %
+	int Wins;			///<Scenarios in which the policy ran the longest
+};
+
+/**
+ * @brief The balancing policy tournament
+ *
+ * Every policy and scenario pair is one job, the threads take
+ * the jobs from a shared counter. With a cache a job that was run
+ * before, by any process, is loaded instead of run.
+ */
+class cTournament
+{
+	public:
+		cTournament();
+		bool addScenario(const cScenario& scenario);
+		int getScenarioCount(void);
+		bool run(int threads);
+		void setCache(cResultCache* cache);
+		int getPolicyCount(void);
+		sPolicyResult getResult(int rank);
+		const char* getPolicyName(int policy);
+		bool getRun(int scenario, int policy, double& runtime, double& imbalance);
+		static void rank(const double* runtimes, const double* imbalances, int scenarios, sPolicyResult* result);
+	private:
+		std::vector<cScenario> Scenarios;	///<Scenarios every policy is run against
+		std::vector<double> RunTime;		///<Run time of each job in mS
+		std::vector<double> Imbalance;		///<Imbalance of each job in %
+		sPolicyResult Result[POLICIES];		///<Results of the last run, best first
+		cResultCache* Cache;			///<Cache of the jobs, null for none
+		void runJob(int job);
+		void rank(void);
+};
+
+#endif //TOURNAMENT_CLASS
@@ -0,0 +1,138 @@
+/**
+ * @file tracepreview.hpp
+ * @brief Defines the plotting preview of a run
+ *
+ * Keeps the lowest and highest value with their time in each of at
+ * most PREVBUCKETS buckets of steps, per channel: the output voltage
+ * and the voltage and current of every cell. When the buckets are
+ * full, neighbouring buckets are merged and a bucket covers twice the
+ * steps, so a preview of a run of any length takes the same memory and
+ * every step costs a compare per channel. The preview keeps every peak
+ * and dip of the run. Its points are the minima and maxima in time
+ * order, or those reduced to one point per bucket with largest
+ * triangle three buckets (LTTB).
+ *
+ * The full trace is written by a thread of its own. A step copies its
+ * values into a queue and the writer formats them and writes them in
+ * blocks, so the stepping thread does no file I/O.
+ *
+ * @author Subir Biswas
+ * @date 19/10/2026
+ * @see tracepreview.cpp
+ */
+
+#ifndef  TRACEPREVIEW_CLASS
+#define  TRACEPREVIEW_CLASS
+
+#include "snapshot.hpp"
+#include "spscqueue.hpp"
+#include <vector>	// std::vector
+#include <string>	// std::string
+#include <ostream>	// std::ostream
+#include <mutex>	// std::mutex
+#include <thread>	// std::thread
+#include <atomic>	// std::atomic
+#include <stdio.h>	// FILE
+
+#define PREVBUCKETS	1024	///<Buckets of a preview, even
+#define PREVCHANNELS	(1 + 2 * MAXCELLS)	///<The output voltage and the voltage and current of every cell
+#define TRACELINES	4096	///<Steps queued for the trace writer, a power of two
+#define TRACEBUFFER	65536	///<Bytes the trace writer formats before a write
+#define TRACELINE	1024	///<Longest line of the trace in bytes
+#define TRACEPOLL	1	///<mS the trace writer sleeps when the queue is empty
+
+/**
+ * @brief A point of a preview
+ */
+struct sPreviewPoint
+{
+	double Time;		///<Simulated time in mS
+	double Value;		///<Value in Volts or Ampere
+};
+
+/**
+ * @brief Size of a preview
+ */
+struct sPreviewStats
+{
+	unsigned long Samples;	///<Steps recorded
+	int Buckets;		///<Buckets in use
+	unsigned long Width;	///<Steps per bucket
+	int Channels;		///<Channels recorded
+	size_t Bytes;		///<Memory of the buckets
+};
+
+/**
+ * @brief The plotting preview of a run, and optionally its full trace
+ *
+ * Registered as a step sink of a battery. A step whose simulated time
+ * lies before the last step starts a new run, the preview and the full
+ * trace start again. Queries may come from any thread, a lock keeps
+ * them apart from the stepping thread. When the trace writer falls
+ * TRACELINES steps behind, the stepping thread waits for it rather
+ * than lose steps.
+ *
+ * @see cBattery::addSink
+ */
+class cTracePreview
+{
+	public:
+		cTracePreview();
+		~cTracePreview();
+		bool open(const char* path);
+		bool close(void);
+		const char* getPath(void);
+		void record(const sSnapshot& snapshot);
+		int getChannels(void);
+		std::string getName(int channel);
+		bool getPoints(int channel, bool lttb, std::vector<sPreviewPoint>& points);
+		bool write(std::ostream& out, bool lttb);
+		sPreviewStats getStats(void);
+		static void sink(void* preview, const sSnapshot& snapshot);
+	private:
+		/**
+		 * @brief Extremes of a channel in a bucket
+		 */
+		struct sBucket
+		{
+			double MinTime;		///<Time of the lowest value in mS
+			double Min;		///<Lowest value
+			double MaxTime;		///<Time of the highest value in mS
+			double Max;		///<Highest value
+		};
+		/**
+		 * @brief A step queued for the trace writer
+		 */
+		struct sTraceLine
+		{
+			double Time;			///<Simulated time in mS
+			double Value[PREVCHANNELS];	///<Value of every channel
+			unsigned long Switches;		///<Bit i for the switch of cell i
+			int Channels;			///<Channels of the step, 0 to empty the trace
+		};
+		std::vector<sBucket> Buckets;	///<Buckets of every channel, channel by channel
+		int Channels;			///<Channels of the run
+		int Used;			///<Buckets in use
+		unsigned long Width;		///<Steps per bucket
+		unsigned long Fill;		///<Steps in the last bucket
+		unsigned long Samples;		///<Steps recorded
+		double Last;			///<Time of the last step in mS
+		FILE* Trace;			///<Full trace, null if not written
+		std::string Path;		///<Path of the full trace
+		std::mutex Lock;		///<Keeps queries apart from record
+		cSpscQueue<sTraceLine, TRACELINES>* Lines;	///<Steps for the trace writer, producers hold Lock
+		std::thread* Writer;		///<Writes the full trace, null if not written
+		std::atomic<bool> Stop;		///<Tells the writer to finish the queue and end
+		unsigned long Queued;		///<Lines queued, under Lock
+		std::atomic<unsigned long> Written;	///<Lines written and flushed to the file
+		void clear(int cells);
+		void queue(const sTraceLine& line);
+		void runWriter(void);
+		void merge(void);
+		void extremes(int channel, std::vector<sPreviewPoint>& points);
+		static void reduce(const std::vector<sPreviewPoint>& points, int count, std::vector<sPreviewPoint>& reduced);
+		cTracePreview(const cTracePreview&);
+		cTracePreview& operator=(const cTracePreview&);
+};
+
+#endif //TRACEPREVIEW_CLASS
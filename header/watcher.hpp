@@ -0,0 +1,80 @@
+/**
+ * @file watcher.hpp
+ * @brief Defines the watches of the command line
+ *
+ * A watch prints the value of a get key at a fixed interval. All the
+ * watches are served by one output thread, which reads the published
+ * snapshot once per tick for every watch that is due, so neither the
+ * prompt nor the simulation waits for the terminal.
+ *
+ * @author Subir Biswas
+ * @date 19/10/2026
+ * @see watcher.cpp
+ */
+
+#ifndef  WATCHER_CLASS
+#define  WATCHER_CLASS
+
+#include "setbatt.hpp"
+#include <ostream>		// std::ostream
+#include <vector>		// std::vector
+#include <thread>		// std::thread
+#include <mutex>		// std::mutex
+#include <condition_variable>	// std::condition_variable
+#include <chrono>		// std::chrono
+
+#define WATCHMININTERVAL	10	///<Shortest interval of a watch in mS
+#define WATCHSLACK		5	///<Watches due within this many mS print at the same tick
+
+/**
+ * @brief Prints the value of a key from a snapshot
+ *
+ * @param key		the key
+ * @param snapshot	the published state of the battery
+ * @param out		stream to print to
+ * @return bool false if the key can not be printed
+ */
+typedef bool (*tWatchFormat)(int key, const sSnapshot& snapshot, std::ostream& out);
+
+/**
+ * @brief The watches and their output thread
+ *
+ * A watch prints only when a new snapshot was published since it
+ * last printed, the steps in between are coalesced.
+ */
+class cWatcher
+{
+	public:
+		cWatcher(cBattery* battery, tWatchFormat format, std::ostream& out);
+		~cWatcher();
+		bool watch(int key, double interval);
+		bool unwatch(int key);
+		int unwatchAll(void);
+		int getCount(void);
+		unsigned long getReadCount(void);
+	private:
+		/**
+		 * @brief A watch
+		 */
+		struct sWatch
+		{
+			int Key;					///<The key printed
+			std::chrono::microseconds Interval;		///<Interval of the watch
+			std::chrono::steady_clock::time_point Due;	///<Time of the next print
+			unsigned long Version;				///<Snapshot version last printed
+		};
+		cBattery* Battery;		///<Battery whose snapshots are read
+		tWatchFormat Format;		///<Prints a key
+		std::ostream& Out;		///<Stream the watches print to
+		std::vector<sWatch> Watches;	///<Active watches
+		unsigned long Reads;		///<Snapshot reads of the output thread
+		bool Quit;			///<Signals the output thread to end
+		std::mutex mtx;			///<Protects the watches
+		std::condition_variable Changed;	///<Signalled when the watches change
+		std::thread* Output;		///<The output thread
+		void runOutput(void);
+		cWatcher(const cWatcher&);
+		cWatcher& operator=(const cWatcher&);
+};
+
+#endif //WATCHER_CLASS
@@ -0,0 +1,427 @@
+/**
+ * @file cellbatch.cpp
+ * @brief Implementation of the batch of cells
+ *
+ * Every kernel does exactly what cSingleBatt::update does for a
+ * cell, in the same order of operations. A disconnected cell only
+ * gets its source current cleared. The vector kernels compute every
+ * lane and blend the connected ones into the state.
+ *
+ * @author Subir Biswas
+ * @date 19/10/2026
+ * @see cellbatch.hpp
+ */
+
+#include "../header/cellbatch.hpp"
+#include "../header/cellkernel.hpp"
+#include <stdlib.h>	// posix_memalign
+#include <string.h>	// memcpy
+#include <math.h>	// fabs
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BATCHX86
+#endif
+
+/**
+ * @brief Signature of a batch update kernel
+ */
+typedef void (*tBatchKernel)(int n, const double* cap, const double* grad, const double* k,
+	double* dis, double* rem, double* volt, double* src, const double* dem, const double* con, double runtime);
+
+/**
+ * @brief Portable kernel, the scalar reference
+ *
+ * @param n		number of cells
+ * @param cap		capacities in AmS
+ * @param grad		gradients of the discharge curves
+ * @param k		constant factors of the discharge curves
+ * @param dis		discharged capacities in AmS
+ * @param rem		remaining capacities in %
+ * @param volt		cell voltages in Volts
+ * @param src		source currents in Ampere
+ * @param dem		currents to be sourced in Ampere
+ * @param con		1 for connected cells, 0 for disconnected ones
+ * @param runtime	For how long the cells are connected in milisec
+ * @return void
+ */
+static void updatePortable(int n, const double* cap, const double* grad, const double* k,
+	double* dis, double* rem, double* volt, double* src, const double* dem, const double* con, double runtime)
+{
+	for(int i=0; i<n; i++)
+	{
+		if(con[i] == 0)
+		{
+			src[i] = 0;
+			continue;
+		}
+		src[i] = dem[i];
+		cellUpdate<double>(dis[i], rem[i], volt[i], cap[i], grad[i], k[i], src[i], runtime);
+	}
+}
+
+#ifdef BATCHX86
+/**
+ * @brief AVX2 kernel, 4 cells at a time
+ *
+ * @see updatePortable
+ */
+__attribute__((target("avx2")))
+static void updateAvx2(int n, const double* cap, const double* grad, const double* k,
+	double* dis, double* rem, double* volt, double* src, const double* dem, const double* con, double runtime)
+{
+	const __m256d zero = _mm256_setzero_pd();
+	const __m256d hundred = _mm256_set1_pd(100);
+	const __m256d t = _mm256_set1_pd(runtime);
+	__m256d m, i, d, nd, r, v, nv;
+	for(int c=0; c<n; c+=4)
+	{
+		m = _mm256_cmp_pd(_mm256_load_pd(con+c), zero, _CMP_NEQ_OQ);
+		i = _mm256_and_pd(_mm256_load_pd(dem+c), m);
+		d = _mm256_load_pd(dis+c);
+		v = _mm256_load_pd(volt+c);
+		nd = _mm256_add_pd(d, _mm256_mul_pd(i, t));
+		r = _mm256_mul_pd(_mm256_div_pd(_mm256_sub_pd(_mm256_load_pd(cap+c), nd), _mm256_load_pd(cap+c)), hundred);
+		nv = _mm256_add_pd(_mm256_sub_pd(v, _mm256_mul_pd(_mm256_mul_pd(_mm256_load_pd(grad+c), i), t)), _mm256_load_pd(k+c));
+		_mm256_store_pd(src+c, i);
+		_mm256_store_pd(dis+c, _mm256_blendv_pd(d, nd, m));
+		_mm256_store_pd(rem+c, _mm256_blendv_pd(_mm256_load_pd(rem+c), r, m));
+		_mm256_store_pd(volt+c, _mm256_blendv_pd(v, nv, m));
+	}
+}
+
+/**
+ * @brief AVX-512 update of 8 cells
+ *
+ * @see updatePortable
+ */
+__attribute__((target("avx512f")))
+static inline void updateAvx512Lanes(int c, const double* cap, const double* grad, const double* k,
+	double* dis, double* rem, double* volt, double* src, const double* dem, const double* con, __m512d t)
+{
+	__mmask8 m = _mm512_cmp_pd_mask(_mm512_load_pd(con+c), _mm512_setzero_pd(), _CMP_NEQ_OQ);
+	__m512d i = _mm512_maskz_mov_pd(m, _mm512_load_pd(dem+c));
+	__m512d d = _mm512_load_pd(dis+c);
+	__m512d v = _mm512_load_pd(volt+c);
+	__m512d nd = _mm512_add_pd(d, _mm512_mul_pd(i, t));
+	__m512d r = _mm512_mul_pd(_mm512_div_pd(_mm512_sub_pd(_mm512_load_pd(cap+c), nd), _mm512_load_pd(cap+c)), _mm512_set1_pd(100));
+	__m512d nv = _mm512_add_pd(_mm512_sub_pd(v, _mm512_mul_pd(_mm512_mul_pd(_mm512_load_pd(grad+c), i), t)), _mm512_load_pd(k+c));
+	_mm512_store_pd(src+c, i);
+	_mm512_store_pd(dis+c, _mm512_mask_blend_pd(m, d, nd));
+	_mm512_store_pd(rem+c, _mm512_mask_blend_pd(m, _mm512_load_pd(rem+c), r));
+	_mm512_store_pd(volt+c, _mm512_mask_blend_pd(m, v, nv));
+}
+
+/**
+ * @brief AVX-512 kernel, 16 cells at a time
+ *
+ * Two 8 lane vectors per iteration.
+ * @see updatePortable
+ */
+__attribute__((target("avx512f")))
+static void updateAvx512(int n, const double* cap, const double* grad, const double* k,
+	double* dis, double* rem, double* volt, double* src, const double* dem, const double* con, double runtime)
+{
+	const __m512d t = _mm512_set1_pd(runtime);
+	for(int c=0; c<n; c+=16)
+	{
+		updateAvx512Lanes(c, cap, grad, k, dis, rem, volt, src, dem, con, t);
+		updateAvx512Lanes(c+8, cap, grad, k, dis, rem, volt, src, dem, con, t);
+	}
+}
+#endif
+
+static const tBatchKernel Kernels[] = {updatePortable,
+#ifdef BATCHX86
+	updateAvx2, updateAvx512
+#endif
+};
+static const char* KernelNames[] = {"portable", "avx2", "avx512"};
+static const int DetectedKernel = cCellBatch::detectKernel();	///<Kernel chosen at startup
+
+/**
+ * @brief Allocates a cache line aligned array of doubles
+ *
+ * @param n number of elements
+ * @return double* zero filled array
+ */
+static double* allocArray(int n)
+{
+	void* p = (void*)0;
+	if(posix_memalign(&p, 64, n*sizeof(double)) != 0)
+		return (double*)0;
+	memset(p, 0, n*sizeof(double));
+	return (double*)p;
+}
+
+/**
+ * @brief Constructor of a cell batch
+ *
+ * Creates a batch of cells with empty state. The padding
+ * cells are never connected.
+ * @param cells number of cells
+ * @return void
+ */
+cCellBatch::cCellBatch(int cells)
+{
+	if(cells < 0)
+		cells = 0;
+	Count = cells;
+	Padded = ((cells + BATCHALIGN - 1) / BATCHALIGN) * BATCHALIGN;
+	Kernel = DetectedKernel;
+	Capacity = allocArray(Padded);
+	Gradient = allocArray(Padded);
+	ConstantK = allocArray(Padded);
+	DischargedCapacity = allocArray(Padded);
+	RemainigCapacity = allocArray(Padded);
+	CurrentVoltage = allocArray(Padded);
+	SourceCurrent = allocArray(Padded);
+	Demand = allocArray(Padded);
+	Connected = allocArray(Padded);
+	for(int i=0; i<Padded; i++)
+		Capacity[i] = 1;
+}
+
+/**
+ * @brief Destructor of the cell batch
+ *
+ * @param void
+ * @return void
+ */
+cCellBatch::~cCellBatch()
+{
+	free(Capacity);
+	free(Gradient);
+	free(ConstantK);
+	free(DischargedCapacity);
+	free(RemainigCapacity);
+	free(CurrentVoltage);
+	free(SourceCurrent);
+	free(Demand);
+	free(Connected);
+}
+
+/**
+ * @brief Loads a cell into the batch
+ *
+ * Copies the parameters of the cell and initialises the state
+ * the way cSingleBatt does when it is locked to a battery.
+ *
+ * @param index	position of the cell in the batch
+ * @param cell	cell to copy
+ * @return true successfully loaded
+ * @return false index is out of range
+ */
+bool cCellBatch::setCell(int index, cSingleBatt* cell)
+{
+	if(index < 0 || index >= Count)
+		return false;
+	double initv = cell->getInitialVoltage();
+	double cap = cell->getCapacity() * 3600;
+	double shift = cell->getShift();
+	double drop = cell->getDrop();
+	Capacity[index] = cap;
+	Gradient[index] = cellGradient<double>(initv, cap, shift, drop);
+	ConstantK[index] = 0;
+	DischargedCapacity[index] = 0;
+	RemainigCapacity[index] = 100;
+	CurrentVoltage[index] = initv;
+	SourceCurrent[index] = 0;
+	Demand[index] = 0;
+	Connected[index] = 0;
+	return true;
+}
+
+/**
+ * @brief Sets the current a cell sources at the next update
+ *
+ * @param index		position of the cell in the batch
+ * @param connected	Weather or not the cell is connected
+ * @param scurrent	current to source in Ampere
+ * @return true successfully set
+ * @return false index is out of range
+ */
+bool cCellBatch::setCurrent(int index, bool connected, double scurrent)
+{
+	if(index < 0 || index >= Count)
+		return false;
+	Demand[index] = scurrent;
+	Connected[index] = connected ? 1 : 0;
+	return true;
+}
+
+/**
+ * @brief Updates all the cells with the selected kernel
+ *
+ * @param runtime For how long the cells are connected in milisec
+ * @return void
+ */
+void cCellBatch::update(double runtime)
+{
+	if(0 == runtime)
+		return;
+	Kernels[Kernel](Padded, Capacity, Gradient, ConstantK, DischargedCapacity, RemainigCapacity,
+		CurrentVoltage, SourceCurrent, Demand, Connected, runtime);
+}
+
+/**
+ * @brief Updates all the cells with the scalar reference kernel
+ *
+ * @param runtime For how long the cells are connected in milisec
+ * @return void
+ */
+void cCellBatch::updateReference(double runtime)
+{
+	if(0 == runtime)
+		return;
+	updatePortable(Padded, Capacity, Gradient, ConstantK, DischargedCapacity, RemainigCapacity,
+		CurrentVoltage, SourceCurrent, Demand, Connected, runtime);
+}
+
+/**
+ * @brief Updates the cells and checks the kernel against the reference
+ *
+ * Runs the scalar reference on a copy of the state, then the
+ * selected kernel on the batch itself.
+ *
+ * @param runtime For how long the cells are connected in milisec
+ * @return double largest relative difference found, compare with BATCHTOLERANCE
+ */
+double cCellBatch::verify(double runtime)
+{
+	cCellBatch ref(Count);
+	int bytes = Padded * sizeof(double);
+	memcpy(ref.Capacity, Capacity, bytes);
+	memcpy(ref.Gradient, Gradient, bytes);
+	memcpy(ref.ConstantK, ConstantK, bytes);
+	memcpy(ref.DischargedCapacity, DischargedCapacity, bytes);
+	memcpy(ref.RemainigCapacity, RemainigCapacity, bytes);
+	memcpy(ref.CurrentVoltage, CurrentVoltage, bytes);
+	memcpy(ref.SourceCurrent, SourceCurrent, bytes);
+	memcpy(ref.Demand, Demand, bytes);
+	memcpy(ref.Connected, Connected, bytes);
+	ref.updateReference(runtime);
+	update(runtime);
+
+	const double* mine[] = {DischargedCapacity, RemainigCapacity, CurrentVoltage, SourceCurrent};
+	const double* theirs[] = {ref.DischargedCapacity, ref.RemainigCapacity, ref.CurrentVoltage, ref.SourceCurrent};
+	double worst = 0;
+	double diff, scale;
+	for(int a=0; a<4; a++)
+	{
+		for(int i=0; i<Count; i++)
+		{
+			diff = fabs(mine[a][i] - theirs[a][i]);
+			scale = fabs(theirs[a][i]);
+			if(scale > 1)
+				diff /= scale;
+			if(diff > worst)
+				worst = diff;
+		}
+	}
+	return worst;
+}
+
+/**
+ * @brief Returns the number of cells in the batch
+ *
+ * @param void
+ * @return int number of cells
+ */
+int cCellBatch::getCount(void)
+{
+	return Count;
+}
+
+/**
+ * @brief Returns the voltage of a cell
+ *
+ * @param index position of the cell in the batch
+ * @return double voltage in Volts, 0 if index is out of range
+ */
+double cCellBatch::getCurrentVoltage(int index)
+{
+	if(index < 0 || index >= Count)
+		return 0;
+	return CurrentVoltage[index];
+}
+
+/**
+ * @brief Returns the remaining capacity of a cell
+ *
+ * @param index position of the cell in the batch
+ * @return double remaining capacity as percentage, 0 if index is out of range
+ */
+double cCellBatch::getRemainingCapacityPercentage(int index)
+{
+	if(index < 0 || index >= Count)
+		return 0;
+	return RemainigCapacity[index];
+}
+
+/**
+ * @brief Returns the current sourced by a cell at the last update
+ *
+ * @param index position of the cell in the batch
+ * @return double current in Ampere, 0 if index is out of range
+ */
+double cCellBatch::getSourceCurrent(int index)
+{
+	if(index < 0 || index >= Count)
+		return 0;
+	return SourceCurrent[index];
+}
+
+/**
+ * @brief Overrides the kernel chosen at startup
+ *
+ * @param kernel one of KERNEL_PORTABLE, KERNEL_AVX2, KERNEL_AVX512
+ * @return true successfully selected
+ * @return false the CPU does not support the kernel
+ */
+bool cCellBatch::setKernel(int kernel)
+{
+	if(kernel < KERNEL_PORTABLE || kernel > DetectedKernel)
+		return false;
+	Kernel = kernel;
+	return true;
+}
+
+/**
+ * @brief Returns the selected kernel
+ *
+ * @param void
+ * @return int one of KERNEL_PORTABLE, KERNEL_AVX2, KERNEL_AVX512
+ */
+int cCellBatch::getKernel(void)
+{
+	return Kernel;
+}
+
+/**
+ * @brief Returns the name of the selected kernel
+ *
+ * @param void
+ * @return const char* name of the kernel
+ */
+const char* cCellBatch::getKernelName(void)
+{
+	return KernelNames[Kernel];
+}
+
+/**
+ * @brief Detects the best kernel the CPU supports
+ *
+ * @param void
+ * @return int one of KERNEL_PORTABLE, KERNEL_AVX2, KERNEL_AVX512
+ */
+int cCellBatch::detectKernel(void)
+{
+#ifdef BATCHX86
+	__builtin_cpu_init();
+	if(__builtin_cpu_supports("avx512f"))
+		return KERNEL_AVX512;
+	if(__builtin_cpu_supports("avx2"))
+		return KERNEL_AVX2;
+#endif
+	return KERNEL_PORTABLE;
+}
@@ -0,0 +1,501 @@
+/**
+ * @file cellfit.cpp
+ * @brief Implementation of the fit of cell parameters to recorded discharges
+ *
+ * @author Subir Biswas
+ * @date 19/10/2026
+ * @see cellfit.hpp
+ */
+
+#include "../header/cellfit.hpp"
+#include "../header/cellkernel.hpp"
+#include "../header/jobrunner.hpp"
+#include <fstream>	// std::ifstream
+#include <stdlib.h>	// strtod
+#include <math.h>	// sqrt, HUGE_VAL
+
+/**
+ * @brief Constructor of a discharge log
+ *
+ * @param void
+ * @return void
+ */
+cDischargeLog::cDischargeLog()
+{
+	Lines = 0;
+	Interval = 0;
+	MaxVoltage = 0;
+	MaxCurrent = 0;
+	TotalCharge = 0;
+}
+
+/**
+ * @brief Reads a log
+ *
+ * The measurements are added to the open interval till it is at least
+ * interval long. When MAXSAMPLES intervals are kept, neighbouring
+ * intervals are merged and the interval is doubled. The charge of two
+ * measurements is their mean current times the time between them.
+ * Measurements that do not come later than the one before are skipped.
+ * @param path		the log file
+ * @param interval	shortest interval in mS
+ * @return true successfully read
+ * @return false the file can not be read, has less than two measurements or interval is not positive
+ */
+bool cDischargeLog::load(const char* path, double interval)
+{
+	std::ifstream in(path);
+	if(!in || interval <= 0)
+		return false;
+	Path = path;
+	Samples.clear();
+	Lines = 0;
+	Interval = interval;
+	MaxVoltage = 0;
+	MaxCurrent = 0;
+	TotalCharge = 0;
+
+	std::string line;
+	sLogSample open = {0, 0, 0, 0};
+	double value[3], time = 0, current = 0, charge;
+	char* cursor;
+	char* end;
+	int i;
+	while(std::getline(in, line))
+	{
+		if(line.empty() || line[0] == '#')
+			continue;
+		cursor = (char*)line.c_str();
+		for(i=0; i<3; i++)
+		{
+			while(*cursor == ',' || *cursor == ' ' || *cursor == '\t')
+				cursor++;
+			value[i] = strtod(cursor, &end);
+			if(end == cursor)
+				break;
+			cursor = end;
+		}
+		if(i < 3 || (Lines > 0 && value[0] <= time))
+			continue;
+		if(Lines > 0)
+		{
+			charge = (current + value[1]) / 2 * (value[0] - time);
+			open.Duration += value[0] - time;
+			open.Charge += charge;
+			TotalCharge += charge;
+		}
+		time = value[0];
+		current = value[1];
+		open.Current = value[1];
+		open.Voltage = value[2];
+		MaxVoltage = (value[2] > MaxVoltage) ? value[2] : MaxVoltage;
+		MaxCurrent = (value[1] > MaxCurrent) ? value[1] : MaxCurrent;
+		Lines++;
+		if(open.Duration >= Interval)
+		{
+			Samples.push_back(open);
+			open.Duration = 0;
+			open.Charge = 0;
+			if((int)Samples.size() >= MAXSAMPLES)
+				merge();
+		}
+	}
+	if(open.Duration > 0)
+		Samples.push_back(open);
+	return Lines >= 2 && !Samples.empty();
+}
+
+/**
+ * @brief Merges every two neighbouring intervals and doubles the interval
+ *
+ * @param void
+ * @return void
+ */
+void cDischargeLog::merge(void)
+{
+	size_t kept = 0;
+	for(size_t i=0; i<Samples.size(); i+=2, kept++)
+	{
+		sLogSample merged = Samples[i];
+		if(i+1 < Samples.size())
+		{
+			merged.Duration += Samples[i+1].Duration;
+			merged.Charge += Samples[i+1].Charge;
+			merged.Current = Samples[i+1].Current;
+			merged.Voltage = Samples[i+1].Voltage;
+		}
+		Samples[kept] = merged;
+	}
+	Samples.resize(kept);
+	Interval *= 2;
+}
+
+/**
+ * @brief Returns the file the log was read from
+ *
+ * @param void
+ * @return const std::string& the path
+ */
+const std::string& cDischargeLog::getPath(void) const
+{
+	return Path;
+}
+
+/**
+ * @brief Returns the number of intervals
+ *
+ * @param void
+ * @return int number of intervals
+ */
+int cDischargeLog::getCount(void) const
+{
+	return (int)Samples.size();
+}
+
+/**
+ * @brief Returns the number of measurements read
+ *
+ * @param void
+ * @return long number of measurements
+ */
+long cDischargeLog::getLines(void) const
+{
+	return Lines;
+}
+
+/**
+ * @brief Returns the length of an interval
+ *
+ * @param void
+ * @return double interval in mS
+ */
+double cDischargeLog::getInterval(void) const
+{
+	return Interval;
+}
+
+/**
+ * @brief Returns the highest measured voltage
+ *
+ * @param void
+ * @return double voltage in Volts
+ */
+double cDischargeLog::getMaxVoltage(void) const
+{
+	return MaxVoltage;
+}
+
+/**
+ * @brief Returns the highest measured current
+ *
+ * @param void
+ * @return double current in Ampere
+ */
+double cDischargeLog::getMaxCurrent(void) const
+{
+	return MaxCurrent;
+}
+
+/**
+ * @brief Returns the charge sourced over the log
+ *
+ * @param void
+ * @return double charge in AmS
+ */
+double cDischargeLog::getCharge(void) const
+{
+	return TotalCharge;
+}
+
+/**
+ * @brief Returns an interval
+ *
+ * @param index index of the interval, 0 to getCount()-1
+ * @return const sLogSample& the interval
+ */
+const sLogSample& cDischargeLog::getSample(int index) const
+{
+	return Samples[index];
+}
+
+/**
+ * @brief Constructor of the fit
+ *
+ * Default 16 starts per cell.
+ * @param void
+ * @return void
+ */
+cCellFit::cCellFit()
+{
+	Starts = 16;
+}
+
+/**
+ * @brief Sets the starts of each cell
+ *
+ * @param starts number of starts, at least 1
+ * @return true successfully set
+ * @return false out of range
+ */
+bool cCellFit::setStarts(int starts)
+{
+	if(starts < 1)
+		return false;
+	Starts = starts;
+	return true;
+}
+
+/**
+ * @brief Adds a cell
+ *
+ * The log is not copied, it has to live till the fit has run.
+ * @param log the loaded log of the cell
+ * @return true successfully added
+ * @return false the log is empty
+ */
+bool cCellFit::addLog(const cDischargeLog* log)
+{
+	if(log == (const cDischargeLog*)0 || log->getCount() == 0)
+		return false;
+	Logs.push_back(log);
+	return true;
+}
+
+/**
+ * @brief Returns the number of cells
+ *
+ * @param void
+ * @return int number of cells
+ */
+int cCellFit::getCount(void)
+{
+	return (int)Logs.size();
+}
+
+/**
+ * @brief Simulates a log and returns the voltage error
+ *
+ * The cell starts full and sources the mean current of every interval
+ * for the length of the interval.
+ * @param log		the log
+ * @param parameter	initial voltage, series resistance and capacity in mAH
+ * @return double root mean square voltage error in Volts, HUGE_VAL if a parameter is invalid
+ */
+double cCellFit::error(const cDischargeLog& log, const double* parameter)
+{
+	double initv = parameter[FITINITV];
+	double sres = parameter[FITSRES];
+	double cap = parameter[FITCAP] * 3600;
+	if(initv <= 0 || sres < 0 || cap <= 0 || log.getCount() == 0)
+		return HUGE_VAL;
+	//shift and drop cancel, the defaults of cSingleBatt
+	double grad = cellGradient<double>(initv, cap, 95, 10);
+	double dis = 0, rem = 100, volt = initv;
+	double current, diff, sum = 0;
+	for(int i=0; i<log.getCount(); i++)
+	{
+		const sLogSample& sample = log.getSample(i);
+		current = sample.Charge / sample.Duration;
+		cellUpdate<double>(dis, rem, volt, cap, grad, 0, current, sample.Duration);
+		diff = volt - sample.Current * sres - sample.Voltage;
+		sum += diff * diff;
+	}
+	return sqrt(sum / log.getCount());
+}
+
+/**
+ * @brief Runs one start of a cell
+ *
+ * A Nelder-Mead simplex over the bounds scaled to the unit cube, the
+ * vertices are clamped into it. The start point is drawn from the
+ * start index, so a run is repeatable.
+ * @param log		the log of the cell
+ * @param start		index of the start
+ * @param result	result of the start
+ * @return void
+ */
+void cCellFit::fit(const cDischargeLog& log, int start, sFitResult& result)
+{
+	double low[FITPARAMS], span[FITPARAMS];
+	double simplex[FITPARAMS+1][FITPARAMS], value[FITPARAMS+1];
+	double centre[FITPARAMS], trial[FITPARAMS], expanded[FITPARAMS], parameter[FITPARAMS];
+	double charge = log.getCharge() / 3600;
+	unsigned int seed = 2654435761U * (unsigned int)(start + 1);
+	int i, j, best, worst, next;
+
+	low[FITINITV] = log.getMaxVoltage();
+	span[FITINITV] = log.getMaxVoltage() / 2;
+	low[FITSRES] = 0;
+	span[FITSRES] = (log.getMaxCurrent() > 0) ? log.getMaxVoltage() / log.getMaxCurrent() : 1;
+	low[FITCAP] = (charge > 0) ? charge : 1;
+	span[FITCAP] = low[FITCAP] * 99;
+
+	//evaluates a point of the unit cube
+	struct sCost
+	{
+		const cDischargeLog& Log;
+		const double* Low;
+		const double* Span;
+		int Evaluations;
+		double operator()(double* point, double* parameter)
+		{
+			for(int k=0; k<FITPARAMS; k++)
+			{
+				point[k] = (point[k] < 0) ? 0 : ((point[k] > 1) ? 1 : point[k]);
+				parameter[k] = Low[k] + Span[k] * point[k];
+			}
+			Evaluations++;
+			return cCellFit::error(Log, parameter);
+		}
+	} cost = {log, low, span, 0};
+
+	for(j=0; j<FITPARAMS; j++)
+	{
+		seed = seed * 1103515245U + 12345U;
+		simplex[0][j] = (double)((seed >> 8) & 0xFFFF) / 0xFFFF;
+	}
+	for(i=1; i<=FITPARAMS; i++)
+	{
+		for(j=0; j<FITPARAMS; j++)
+			simplex[i][j] = simplex[0][j];
+		simplex[i][i-1] += (simplex[0][i-1] < 0.9) ? 0.1 : -0.1;
+	}
+	for(i=0; i<=FITPARAMS; i++)
+		value[i] = cost(simplex[i], parameter);
+
+	bool converged = false;
+	for(int iteration=0; iteration<FITITERATIONS; iteration++)
+	{
+		best = 0;
+		worst = 0;
+		for(i=1; i<=FITPARAMS; i++)
+		{
+			best = (value[i] < value[best]) ? i : best;
+			worst = (value[i] > value[worst]) ? i : worst;
+		}
+		next = best;
+		for(i=0; i<=FITPARAMS; i++)
+			next = (i != worst && value[i] > value[next]) ? i : next;
+		if(value[worst] - value[best] <= 1e-9 * (value[best] + 1e-9))
+		{
+			converged = true;
+			break;
+		}
+		for(j=0; j<FITPARAMS; j++)
+		{
+			centre[j] = 0;
+			for(i=0; i<=FITPARAMS; i++)
+				centre[j] += (i != worst) ? simplex[i][j] / FITPARAMS : 0;
+			trial[j] = 2 * centre[j] - simplex[worst][j];
+		}
+		double reflected = cost(trial, parameter);
+		if(reflected < value[best])
+		{
+			for(j=0; j<FITPARAMS; j++)
+				expanded[j] = 3 * centre[j] - 2 * simplex[worst][j];
+			double grown = cost(expanded, parameter);
+			double* accepted = (grown < reflected) ? expanded : trial;
+			for(j=0; j<FITPARAMS; j++)
+				simplex[worst][j] = accepted[j];
+			value[worst] = (grown < reflected) ? grown : reflected;
+			continue;
+		}
+		if(reflected < value[next])
+		{
+			for(j=0; j<FITPARAMS; j++)
+				simplex[worst][j] = trial[j];
+			value[worst] = reflected;
+			continue;
+		}
+		for(j=0; j<FITPARAMS; j++)
+			trial[j] = (centre[j] + simplex[worst][j]) / 2;
+		double contracted = cost(trial, parameter);
+		if(contracted < value[worst])
+		{
+			for(j=0; j<FITPARAMS; j++)
+				simplex[worst][j] = trial[j];
+			value[worst] = contracted;
+			continue;
+		}
+		//shrink towards the best vertex
+		for(i=0; i<=FITPARAMS; i++)
+		{
+			if(i == best)
+				continue;
+			for(j=0; j<FITPARAMS; j++)
+				simplex[i][j] = (simplex[i][j] + simplex[best][j]) / 2;
+			value[i] = cost(simplex[i], parameter);
+		}
+	}
+	best = 0;
+	for(i=1; i<=FITPARAMS; i++)
+		best = (value[i] < value[best]) ? i : best;
+	cost(simplex[best], result.Parameter);
+	result.Error = value[best];
+	result.Evaluations = cost.Evaluations;
+	result.Converged = converged ? 1 : 0;
+}
+
+/**
+ * @brief Runs a job, start job % Starts of cell job / Starts
+ *
+ * Every job writes its own result, so jobs run on several threads
+ * need no lock.
+ * @param job the job
+ * @return void
+ */
+void cCellFit::runJob(int job)
+{
+	fit(*Logs[job / Starts], job % Starts, Runs[job]);
+}
+
+/**
+ * @brief Fits every cell
+ *
+ * @param threads number of threads to run the starts on
+ * @return true successfully ran
+ * @return false no cell is added or threads is less than 1
+ */
+bool cCellFit::run(int threads)
+{
+	if(Logs.empty() || threads < 1)
+		return false;
+	int cells = (int)Logs.size();
+	int jobs = cells * Starts;
+	Runs.assign(jobs, sFitResult());
+	runJobs(jobs, threads, [this](int job) { runJob(job); });
+	Results.assign(cells, sFitResult());
+	for(int c=0; c<cells; c++)
+	{
+		sFitResult& result = Results[c];
+		result = Runs[c * Starts];
+		result.Evaluations = 0;
+		result.Converged = 0;
+		for(int s=0; s<Starts; s++)
+		{
+			const sFitResult& run = Runs[c * Starts + s];
+			if(run.Error < result.Error)
+			{
+				for(int p=0; p<FITPARAMS; p++)
+					result.Parameter[p] = run.Parameter[p];
+				result.Error = run.Error;
+			}
+			result.Evaluations += run.Evaluations;
+			result.Converged += run.Converged;
+		}
+	}
+	return true;
+}
+
+/**
+ * @brief Returns the result of a cell of the last run
+ *
+ * @param cell index of the cell in the order they were added
+ * @return const sFitResult& the result
+ */
+const sFitResult& cCellFit::getResult(int cell)
+{
+	if(cell < 0 || cell >= (int)Results.size())
+		cell = 0;
+	return Results[cell];
+}
@@ -0,0 +1,467 @@
+/**
+ * @file ctrlserver.cpp
+ * @brief Implementation of the control and telemetry server
+ *
+ * The epoll thread owns the sockets and the client buffers. The
+ * command thread only sees request lines and client ids, and passes
+ * the replies back through a queue and an eventfd.
+ *
+ * @author Subir Biswas
+ * @date 19/10/2026
+ * @see ctrlserver.hpp
+ */
+
+#include "../header/ctrlserver.hpp"
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+
+#define LISTENERID	0	///<epoll id of the listening socket
+#define WAKEUPID	1	///<epoll id of the eventfd
+
+/**
+ * @brief Constructor of the server
+ *
+ * @param handler runs the requests
+ * @return void
+ */
+cControlServer::cControlServer(tCommandHandler handler)
+{
+	Handler = handler;
+	Listener = -1;
+	Poller = -1;
+	Wakeup = -1;
+	LastId = WAKEUPID;
+	Requests = 0;
+	ClientCount = 0;
+	Quit = false;
+	Poll = (std::thread*)0;
+	Command = (std::thread*)0;
+}
+
+/**
+ * @brief Destructor of the server, stops it if running
+ *
+ * @param void
+ * @return void
+ */
+cControlServer::~cControlServer()
+{
+	stop();
+}
+
+/**
+ * @brief Starts serving on a socket path
+ *
+ * An existing file at the path is removed.
+ * @param path path of the Unix domain socket
+ * @return true successfully started
+ * @return false already running, path too long or a socket call failed
+ */
+bool cControlServer::start(const char* path)
+{
+	struct sockaddr_un address;
+	struct epoll_event event;
+	if(IsRunning() || Handler == (tCommandHandler)0)
+		return false;
+	if(strlen(path) >= sizeof(address.sun_path))
+		return false;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	strcpy(address.sun_path, path);
+	unlink(path);
+
+	Listener = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	Poller = epoll_create1(EPOLL_CLOEXEC);
+	Wakeup = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if(Listener < 0 || Poller < 0 || Wakeup < 0
+		|| bind(Listener, (struct sockaddr*)&address, sizeof(address)) < 0
+		|| listen(Listener, SOMAXCONN) < 0)
+	{
+		if(Listener >= 0) ::close(Listener);
+		if(Poller >= 0) ::close(Poller);
+		if(Wakeup >= 0) ::close(Wakeup);
+		Listener = Poller = Wakeup = -1;
+		return false;
+	}
+	event.events = EPOLLIN;
+	event.data.u64 = LISTENERID;
+	epoll_ctl(Poller, EPOLL_CTL_ADD, Listener, &event);
+	event.data.u64 = WAKEUPID;
+	epoll_ctl(Poller, EPOLL_CTL_ADD, Wakeup, &event);
+
+	Path = path;
+	Quit = false;
+	Requests = 0;
+	Poll = new std::thread(&cControlServer::runPoll, this);
+	Command = new std::thread(&cControlServer::runCommand, this);
+	return true;
+}
+
+/**
+ * @brief Stops the server and closes every connection
+ *
+ * Waits for a command that is running to finish.
+ * @param void
+ * @return true successfully stopped
+ * @return false the server was not running
+ */
+bool cControlServer::stop(void)
+{
+	if(!IsRunning())
+		return false;
+	uint64_t one = 1;
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		Quit = true;
+	}
+	CommandReady.notify_one();
+	if(write(Wakeup, &one, sizeof(one)) < 0)
+		return false;
+	Poll->join();
+	Command->join();
+	delete Poll;
+	delete Command;
+	Poll = Command = (std::thread*)0;
+	while(!Clients.empty())
+		close(Clients.begin()->first);
+	Commands.clear();
+	Replies.clear();
+	::close(Listener);
+	::close(Poller);
+	::close(Wakeup);
+	Listener = Poller = Wakeup = -1;
+	unlink(Path.c_str());
+	return true;
+}
+
+/**
+ * @brief Returns true if the server is running
+ *
+ * @param void
+ * @return bool true if running
+ */
+bool cControlServer::IsRunning(void)
+{
+	return (Poll != (std::thread*)0);
+}
+
+/**
+ * @brief Returns the number of requests answered since start
+ *
+ * @param void
+ * @return unsigned long number of requests
+ */
+unsigned long cControlServer::getRequestCount(void)
+{
+	return Requests;
+}
+
+/**
+ * @brief Returns the number of connected clients
+ *
+ * @param void
+ * @return int number of clients
+ */
+int cControlServer::getClientCount(void)
+{
+	return ClientCount;
+}
+
+/**
+ * @brief The epoll thread
+ *
+ * @param void
+ * @return void
+ */
+void cControlServer::runPoll(void)
+{
+	struct epoll_event events[SERVERMAXEVENTS];
+	int ready, i;
+	while(true)
+	{
+		ready = epoll_wait(Poller, events, SERVERMAXEVENTS, -1);
+		if(ready < 0 && errno != EINTR)
+			return;
+		for(i=0; i<ready; i++)
+		{
+			unsigned long id = events[i].data.u64;
+			if(id == LISTENERID)
+				accept();
+			else if(id == WAKEUPID)
+			{
+				uint64_t count;
+				if(read(Wakeup, &count, sizeof(count)) < 0 && errno != EAGAIN)
+					return;
+				{
+					std::lock_guard<std::mutex> lock(mtx);
+					if(Quit)
+						return;
+				}
+				deliver();
+			}
+			else
+			{
+				if(events[i].events & EPOLLOUT)
+					send(id);
+				if(events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+					receive(id);
+			}
+		}
+	}
+}
+
+/**
+ * @brief The command thread, runs the queued requests one at a time
+ *
+ * @param void
+ * @return void
+ */
+void cControlServer::runCommand(void)
+{
+	uint64_t one = 1;
+	sJob job;
+	while(true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mtx);
+			CommandReady.wait(lock, [&]{ return Quit || !Commands.empty(); });
+			if(Quit)
+				return;
+			job = Commands.front();
+			Commands.pop_front();
+		}
+		std::string reply;
+		Handler(job.Text.c_str(), reply, false);
+		reply += ".\n";
+		{
+			std::lock_guard<std::mutex> lock(mtx);
+			job.Text.swap(reply);
+			Replies.push_back(job);
+		}
+		if(write(Wakeup, &one, sizeof(one)) < 0)
+			return;
+	}
+}
+
+/**
+ * @brief Accepts the waiting connections
+ *
+ * @param void
+ * @return void
+ */
+void cControlServer::accept(void)
+{
+	struct epoll_event event;
+	int fd;
+	while((fd = accept4(Listener, (struct sockaddr*)0, (socklen_t*)0, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0)
+	{
+		unsigned long id = ++LastId;
+		sClient& client = Clients[id];
+		client.Fd = fd;
+		client.Pending = 0;
+		client.Closing = false;
+		client.Events = EPOLLIN;
+		event.events = EPOLLIN;
+		event.data.u64 = id;
+		epoll_ctl(Poller, EPOLL_CTL_ADD, fd, &event);
+		ClientCount++;
+	}
+}
+
+/**
+ * @brief Reads from a client and handles the complete lines
+ *
+ * @param id id of the client
+ * @return void
+ */
+void cControlServer::receive(unsigned long id)
+{
+	std::map<unsigned long, sClient>::iterator it = Clients.find(id);
+	if(it == Clients.end())
+		return;
+	//a closing client is not read, so this is a hang up or an error
+	if(it->second.Closing)
+	{
+		close(id);
+		return;
+	}
+	char buffer[4096];
+	ssize_t len;
+	size_t start, end;
+	bool ended = false;
+	while(true)
+	{
+		len = read(it->second.Fd, buffer, sizeof(buffer));
+		if(len < 0 && errno != EAGAIN && errno != EINTR)
+		{
+			close(id);
+			return;
+		}
+		if(len < 0 && errno == EINTR)
+			continue;
+		if(len == 0)
+			ended = true;
+		if(len <= 0)
+			break;
+		it->second.In.append(buffer, len);
+	}
+	std::string& in = it->second.In;
+	start = 0;
+	while(!it->second.Closing && (end = in.find('\n', start)) != std::string::npos)
+	{
+		std::string line = in.substr(start, end - start);
+		if(!line.empty() && line[line.size()-1] == '\r')
+			line.erase(line.size()-1);
+		start = end + 1;
+		request(id, line);
+	}
+	in.erase(0, start);
+	if(in.size() > SERVERMAXLINE)
+	{
+		close(id);
+		return;
+	}
+	//a client that shut down its side still gets the replies
+	if(ended)
+		it->second.Closing = true;
+	send(id);
+}
+
+/**
+ * @brief Handles one request line of a client
+ *
+ * A query is answered at once unless earlier requests of the client
+ * are still queued, everything else is queued to the command thread.
+ * @param id	id of the client
+ * @param line	the request
+ * @return void
+ */
+void cControlServer::request(unsigned long id, const std::string& line)
+{
+	sClient& client = Clients[id];
+	if(line.empty())
+		return;
+	if(line == "exit" || line == "quit")
+	{
+		client.Closing = true;
+		return;
+	}
+	if(client.Pending == 0 && Handler(line.c_str(), client.Out, true))
+	{
+		client.Out += ".\n";
+		Requests++;
+		return;
+	}
+	sJob job;
+	job.Client = id;
+	job.Text = line;
+	client.Pending++;
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		Commands.push_back(job);
+	}
+	CommandReady.notify_one();
+}
+
+/**
+ * @brief Sends the pending reply bytes of a client
+ *
+ * Waits for EPOLLOUT when the socket is full, drops a client
+ * that does not read its replies. A closing client is not read
+ * any more and is closed once its replies are sent.
+ * @param id id of the client
+ * @return void
+ */
+void cControlServer::send(unsigned long id)
+{
+	std::map<unsigned long, sClient>::iterator it = Clients.find(id);
+	if(it == Clients.end())
+		return;
+	sClient& client = it->second;
+	struct epoll_event event;
+	ssize_t len;
+	while(!client.Out.empty())
+	{
+		len = ::send(client.Fd, client.Out.data(), client.Out.size(), MSG_NOSIGNAL);
+		if(len < 0 && errno == EINTR)
+			continue;
+		if(len < 0 && errno != EAGAIN)
+		{
+			close(id);
+			return;
+		}
+		if(len < 0)
+			break;
+		client.Out.erase(0, len);
+	}
+	if(client.Out.size() > SERVERMAXOUT)
+	{
+		close(id);
+		return;
+	}
+	if(client.Out.empty() && client.Closing && client.Pending == 0)
+	{
+		close(id);
+		return;
+	}
+	uint32_t events = (client.Closing ? 0 : EPOLLIN) | (client.Out.empty() ? 0 : EPOLLOUT);
+	if(events != client.Events)
+	{
+		client.Events = events;
+		event.events = events;
+		event.data.u64 = id;
+		epoll_ctl(Poller, EPOLL_CTL_MOD, client.Fd, &event);
+	}
+}
+
+/**
+ * @brief Hands the replies of the command thread to their clients
+ *
+ * Replies of clients that have disconnected are dropped.
+ * @param void
+ * @return void
+ */
+void cControlServer::deliver(void)
+{
+	std::deque<sJob> replies;
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		replies.swap(Replies);
+	}
+	while(!replies.empty())
+	{
+		sJob& job = replies.front();
+		std::map<unsigned long, sClient>::iterator it = Clients.find(job.Client);
+		if(it != Clients.end())
+		{
+			it->second.Out += job.Text;
+			it->second.Pending--;
+			Requests++;
+			send(job.Client);
+		}
+		replies.pop_front();
+	}
+}
+
+/**
+ * @brief Closes the connection of a client
+ *
+ * @param id id of the client
+ * @return void
+ */
+void cControlServer::close(unsigned long id)
+{
+	std::map<unsigned long, sClient>::iterator it = Clients.find(id);
+	if(it == Clients.end())
+		return;
+	epoll_ctl(Poller, EPOLL_CTL_DEL, it->second.Fd, (struct epoll_event*)0);
+	::close(it->second.Fd);
+	Clients.erase(it);
+	ClientCount--;
+}
@@ -0,0 +1,253 @@
+/**
+ * @file cycler.cpp
+ * @brief Implementation of the charge and aging cycler
+ *
+ * @author Subir Biswas
+ * @date 19/10/2026
+ * @see cycler.hpp
+ */
+
+#include "../header/cycler.hpp"
+#include "../header/jobrunner.hpp"
+
+/**
+ * @brief Discharges a model till cut off
+ *
+ * With fast forward the next step is as long as the fastest falling
+ * cell takes to fall by maxdv at the present currents, never further
+ * than the cut off voltage and never shorter than the resolution.
+ *
+ * @param model		the model, charged
+ * @param load		Load in Ohms
+ * @param resolution	The interval of a fine step in miliseconds
+ * @param maxdv		largest voltage change of a cell in a step in Volts, 0 for fine steps
+ * @return double runtime till cut off in mS
+ */
+static double discharge(cPackModel<double>& model, double load, double resolution, double maxdv)
+{
+	double start = model.getElapsedTime();
+	double interval = resolution;
+	double rate, dv;
+	long steps = 0;
+	int i, n = model.getCount();
+	while(model.step(load, interval) && ++steps < MAXSTEPS)
+	{
+		if(maxdv <= 0)
+			continue;
+		rate = 0;
+		for(i=0; i<n; i++)
+		{
+			dv = model.getGradient(i) * model.getSourceCurrent(i);
+			rate = (dv > rate) ? dv : rate;
+		}
+		dv = model.getVout() - model.getCutOffVoltage();
+		dv = (dv < maxdv) ? dv : maxdv;
+		interval = (rate > 0) ? dv / rate : resolution;
+		interval = (interval > resolution) ? interval : resolution;
+	}
+	return model.getElapsedTime() - start;
+}
+
+/**
+ * @brief Constructor of the cycler
+ *
+ * Defaults: 20 % capacity fade and 50 % resistance growth after 3000
+ * full depth cycles, 0.4 A charge, 30 minutes rest, fast forward.
+ * @param void
+ * @return void
+ */
+cCycler::cCycler()
+{
+	Fade = 0.2 / 3000;
+	Growth = 0.5 / 3000;
+	ChargeCurrent = 0.4;
+	RestTime = 30 * 60000;
+	FastForward = true;
+	Cycles = 0;
+}
+
+/**
+ * @brief Sets the aging per full depth cycle
+ *
+ * @param fade	capacity lost, fraction of the capacity, 0 to below 1
+ * @param growth	series resistance gained, fraction of the resistance, at least 0
+ * @return true successfully set
+ * @return false out of range
+ */
+bool cCycler::setAging(double fade, double growth)
+{
+	if(fade < 0 || fade >= 1 || growth < 0)
+		return false;
+	Fade = fade;
+	Growth = growth;
+	return true;
+}
+
+/**
+ * @brief Sets the charge current of each cell
+ *
+ * @param current charge current in Ampere
+ * @return true successfully set
+ * @return false not positive
+ */
+bool cCycler::setCharge(double current)
+{
+	if(current <= 0)
+		return false;
+	ChargeCurrent = current;
+	return true;
+}
+
+/**
+ * @brief Sets the rest after the discharge and after the charge
+ *
+ * @param time rest time in mS
+ * @return true successfully set
+ * @return false negative
+ */
+bool cCycler::setRest(double time)
+{
+	if(time < 0)
+		return false;
+	RestTime = time;
+	return true;
+}
+
+/**
+ * @brief Chooses fast forward or fine steps
+ *
+ * @param fast true for fast forward
+ * @return void
+ */
+void cCycler::setFastForward(bool fast)
+{
+	FastForward = fast;
+}
+
+/**
+ * @brief Adds a pack
+ *
+ * @param scenario the new pack, it is copied
+ * @return true successfully added
+ * @return false the scenario has no cells
+ */
+bool cCycler::addPack(const cScenario& scenario)
+{
+	if(scenario.getCount() == 0)
+		return false;
+	Packs.push_back(scenario);
+	return true;
+}
+
+/**
+ * @brief Returns the number of packs
+ *
+ * @param void
+ * @return int number of packs
+ */
+int cCycler::getPackCount(void)
+{
+	return (int)Packs.size();
+}
+
+/**
+ * @brief Cycles one pack
+ *
+ * @param scenario	the new pack
+ * @param cycles	number of cycles, 1 to MAXCYCLES
+ * @param result	the result of the pack
+ * @return true successfully cycled
+ * @return false the scenario has no cells or cycles is out of range
+ */
+bool cCycler::runPack(const cScenario& scenario, int cycles, sCycleResult& result)
+{
+	if(scenario.getCount() == 0 || cycles < 1 || cycles > MAXCYCLES)
+		return false;
+	cPackModel<double> model;
+	scenario.build(model);
+	int i, cycle, n = model.getCount();
+	double depth[MAXCELLS];
+	double runtime;
+	//half the balancing band of the voltage policy
+	double maxdv = FastForward ? cVoltagePolicy<double>().defaultBand() / 2 : 0;
+
+	result.Cycles = 0;
+	result.EndOfLife = 0;
+	result.RunTime.clear();
+	result.RunTime.reserve(cycles);
+	for(cycle=1; cycle<=cycles; cycle++)
+	{
+		runtime = discharge(model, scenario.getLoad(), scenario.getResolution(), maxdv);
+		result.RunTime.push_back(runtime);
+		if(result.EndOfLife == 0 && runtime < result.RunTime[0] * ENDOFLIFE / 100)
+			result.EndOfLife = cycle;
+		model.rest(RestTime);
+		for(i=0; i<n; i++)
+			depth[i] = model.getDischargedCapacity(i) / model.getCapacity(i);
+		if(FastForward)
+			model.chargeFull(ChargeCurrent);
+		else
+			while(model.charge(ChargeCurrent, scenario.getResolution()));
+		//aged once full, the discharge curve starts again at the initial voltage
+		for(i=0; i<n; i++)
+			model.setCell(i, model.getCapacity(i) * (1 - Fade * depth[i]), model.getSeriesResistance(i) * (1 + Growth * depth[i]));
+		model.rest(RestTime);
+		result.Cycles++;
+	}
+	result.FirstRunTime = result.RunTime.front();
+	result.LastRunTime = result.RunTime.back();
+	result.Capacity = 0;
+	result.Resistance = 0;
+	for(i=0; i<n; i++)
+	{
+		result.Capacity += model.getCapacity(i) / (scenario.getCapacity(i) * 3600) * 100 / n;
+		result.Resistance += model.getSeriesResistance(i) / scenario.getSeriesResistance(i) * 100 / n;
+	}
+	result.SimulatedTime = model.getElapsedTime();
+	return true;
+}
+
+/**
+ * @brief Runs a job, the cycles of a pack
+ *
+ * Every job writes its own result, so jobs run on several threads
+ * need no lock.
+ * @param job the pack
+ * @return void
+ */
+void cCycler::runJob(int job)
+{
+	runPack(Packs[job], Cycles, Results[job]);
+}
+
+/**
+ * @brief Cycles every pack
+ *
+ * @param cycles	number of cycles of each pack, 1 to MAXCYCLES
+ * @param threads	number of threads to run the packs on
+ * @return true successfully ran
+ * @return false no pack is added or an argument is out of range
+ */
+bool cCycler::run(int cycles, int threads)
+{
+	if(Packs.empty() || threads < 1 || cycles < 1 || cycles > MAXCYCLES)
+		return false;
+	int packs = (int)Packs.size();
+	Cycles = cycles;
+	Results.assign(packs, sCycleResult());
+	runJobs(packs, threads, [this](int job) { runJob(job); });
+	return true;
+}
+
+/**
+ * @brief Returns the result of a pack of the last run
+ *
+ * @param pack index of the pack in the order they were added
+ * @return const sCycleResult& the result
+ */
+const sCycleResult& cCycler::getResult(int pack)
+{
+	if(pack < 0 || pack >= (int)Results.size())
+		pack = 0;
+	return Results[pack];
+}
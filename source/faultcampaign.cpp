@@ -0,0 +1,298 @@
+/**
+ * @file faultcampaign.cpp
+ * @brief Implementation of the randomized fault campaign
+ *
+ * @author Subir Biswas
+ * @date 19/10/2026
+ * @see faultcampaign.hpp
+ */
+
+#include "../header/faultcampaign.hpp"
+#include "../header/jobrunner.hpp"
+#include <chrono>	// std::chrono::steady_clock
+
+/**
+ * @brief Step sink that watches a run
+ *
+ * @param context	the outcome of the run
+ * @param snapshot	state of the battery after the step
+ * @return void
+ */
+static void monitor(void* context, const sSnapshot& snapshot)
+{
+	sFaultOutcome* outcome = (sFaultOutcome*)context;
+	if(snapshot.Vout < snapshot.CutOffVoltage)
+		outcome->BelowSteps++;
+	for(int i=0; i<snapshot.Count; i++)
+	{
+		if(snapshot.SourceCurrent[i] > outcome->PeakCurrent[i])
+			outcome->PeakCurrent[i] = snapshot.SourceCurrent[i];
+		if(snapshot.Switch[i] && snapshot.CurrentVoltage[i] < outcome->LowestVoltage)
+			outcome->LowestVoltage = snapshot.CurrentVoltage[i];
+	}
+}
+
+/**
+ * @brief Draws the next number of a linear congruential generator
+ *
+ * @param seed state of the generator, updated
+ * @return double number from 0 to below 1
+ */
+static double draw(unsigned int& seed)
+{
+	seed = seed * 1103515245U + 12345U;
+	return (double)((seed >> 8) & 0xFFFF) / 0x10000;
+}
+
+/**
+ * @brief Constructor of the campaign
+ *
+ * @param void
+ * @return void
+ */
+cFaultCampaign::cFaultCampaign()
+{
+	Reference = sFaultOutcome();
+	StepCost[0] = 0;
+	StepCost[1] = 0;
+	Seed = 1;
+}
+
+/**
+ * @brief Sets the scenario of the runs
+ *
+ * The battery stops at its own cut off voltage.
+ * @param scenario the cells, the load and the resolution
+ * @return true successfully set
+ * @return false the scenario has no cells
+ */
+bool cFaultCampaign::setScenario(const cScenario& scenario)
+{
+	if(scenario.getCount() == 0)
+		return false;
+	Scenario = scenario;
+	return true;
+}
+
+/**
+ * @brief Runs a discharge of a scenario through cBattery
+ *
+ * The cells and the battery are local, so runs can go on in parallel.
+ * The step loop is the one of cBattery::runBattery without the sleep.
+ * @param scenario	the cells, the load and the resolution
+ * @param plan		the faults, null for a fault free run
+ * @param limit		largest number of steps
+ * @param outcome	the outcome, the faults are kept
+ * @return true successfully ran
+ * @return false the battery could not be attached
+ */
+bool cFaultCampaign::runOnce(const cScenario& scenario, cFaultPlan* plan, unsigned long limit, sFaultOutcome& outcome)
+{
+	cSingleBatt cells[MAXCELLS];
+	cBattery battery;
+	int i, n = scenario.getCount();
+	for(i=0; i<n; i++)
+	{
+		cells[i].setInitialVoltage(scenario.getInitialVoltage(i));
+		cells[i].setSeriesResistance(scenario.getSeriesResistance(i));
+		cells[i].setCapacity(scenario.getCapacity(i));
+		battery.addCell(&cells[i]);
+	}
+	outcome.RunTime = 0;
+	outcome.BelowCutOff = 0;
+	for(i=0; i<MAXCELLS; i++)
+		outcome.PeakCurrent[i] = 0;
+	outcome.LowestVoltage = scenario.getInitialVoltage(0);
+	for(i=1; i<n; i++)
+		outcome.LowestVoltage = (scenario.getInitialVoltage(i) > outcome.LowestVoltage) ? scenario.getInitialVoltage(i) : outcome.LowestVoltage;
+	outcome.Steps = 0;
+	outcome.BelowSteps = 0;
+	outcome.Exhausted = false;
+	battery.setFaults(plan);
+	battery.addSink(monitor, &outcome);
+	if(!battery.attach())
+		return false;
+	while(battery.step(scenario.getLoad(), scenario.getResolution()))
+	{
+		if(++outcome.Steps >= limit)
+		{
+			outcome.Exhausted = true;
+			break;
+		}
+	}
+	outcome.RunTime = battery.getElapsedTime();
+	//the last step of a run starts below the cut off, the ones before it should not
+	if(outcome.BelowSteps > 1)
+		outcome.BelowCutOff = (outcome.BelowSteps - 1) * scenario.getResolution();
+	battery.detach();
+	return true;
+}
+
+/**
+ * @brief Draws the faults of a run
+ *
+ * @param run		index of the run
+ * @param faults	the plan, cleared first
+ * @param outcome	the faults are recorded here
+ * @return void
+ */
+void cFaultCampaign::plan(int run, cFaultPlan& faults, sFaultOutcome& outcome)
+{
+	unsigned int seed = Seed * 2654435761U + (unsigned int)run;
+	faults.clear();
+	draw(seed);
+	outcome.Faults = 1 + (int)(draw(seed) * FAULTSPERRUN);
+	for(int f=0; f<outcome.Faults; f++)
+	{
+		sFault& fault = outcome.Fault[f];
+		fault.Type = FAULTOPEN + (int)(draw(seed) * FAULTTYPES);
+		fault.Cell = (int)(draw(seed) * Scenario.getCount());
+		fault.Time = draw(seed) * Reference.RunTime;
+		fault.Value = 0;
+		if(fault.Type == FAULTSRES)
+			fault.Value = 2 + 4 * draw(seed);
+		else if(fault.Type == FAULTOFFSET)
+			fault.Value = (draw(seed) < 0.5 ? -1 : 1) * (0.1 + 0.9 * draw(seed));
+		faults.add(fault);
+	}
+}
+
+/**
+ * @brief Runs a job of the campaign
+ *
+ * Every job writes its own outcome, so jobs run on several threads
+ * need no lock.
+ * @param job the run
+ * @return void
+ */
+void cFaultCampaign::runJob(int job)
+{
+	cFaultPlan faults;
+	plan(job, faults, Outcomes[job]);
+	runOnce(Scenario, &faults, Reference.Steps * RUNLIMIT + 1, Outcomes[job]);
+}
+
+/**
+ * @brief Runs a campaign
+ *
+ * The fault free run is made first, twice: without a plan and with an
+ * empty plan, which gives the cost of a step with and without the
+ * fault checks.
+ * @param runs		number of runs with faults
+ * @param seed		seed of the random plans
+ * @param threads	number of threads to run on
+ * @return true successfully ran
+ * @return false no scenario is set or an argument is out of range
+ */
+bool cFaultCampaign::run(int runs, unsigned int seed, int threads)
+{
+	if(Scenario.getCount() == 0 || runs < 1 || threads < 1)
+		return false;
+	Seed = seed;
+	cFaultPlan empty;
+	sFaultOutcome planned;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	if(!runOnce(Scenario, (cFaultPlan*)0, MAXSTEPS, Reference))
+		return false;
+	std::chrono::steady_clock::time_point middle = std::chrono::steady_clock::now();
+	runOnce(Scenario, &empty, MAXSTEPS, planned);
+	std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+	Reference.Faults = 0;
+	StepCost[0] = std::chrono::duration<double, std::nano>(middle - start).count() / (Reference.Steps + 1);
+	StepCost[1] = std::chrono::duration<double, std::nano>(end - middle).count() / (planned.Steps + 1);
+
+	Outcomes.assign(runs, sFaultOutcome());
+	runJobs(runs, threads, [this](int job) { runJob(job); });
+	return true;
+}
+
+/**
+ * @brief Returns the number of runs of the last campaign
+ *
+ * @param void
+ * @return int number of runs
+ */
+int cFaultCampaign::getRuns(void)
+{
+	return (int)Outcomes.size();
+}
+
+/**
+ * @brief Returns the fault free run of the last campaign
+ *
+ * @param void
+ * @return const sFaultOutcome& the outcome
+ */
+const sFaultOutcome& cFaultCampaign::getReference(void)
+{
+	return Reference;
+}
+
+/**
+ * @brief Returns a run of the last campaign
+ *
+ * @param run index of the run
+ * @return const sFaultOutcome& the outcome
+ */
+const sFaultOutcome& cFaultCampaign::getOutcome(int run)
+{
+	if(run < 0 || run >= (int)Outcomes.size())
+		return Reference;
+	return Outcomes[run];
+}
+
+/**
+ * @brief Returns the current of a cell above which a run has an over current
+ *
+ * @param cell index of the cell
+ * @return double current in Ampere
+ */
+double cFaultCampaign::getCurrentLimit(int cell)
+{
+	if(cell < 0 || cell >= MAXCELLS)
+		return 0;
+	return Reference.PeakCurrent[cell] * OVERCURRENT;
+}
+
+/**
+ * @brief Returns the time of a fault free step
+ *
+ * @param plan true for the step with an empty plan
+ * @return double time in nS
+ */
+double cFaultCampaign::getStepCost(bool plan)
+{
+	return StepCost[plan ? 1 : 0];
+}
+
+/**
+ * @brief Summarises the runs with a fault type
+ *
+ * A run with faults of two types counts for both.
+ * @param type FAULTOPEN to FAULTSENSOR
+ * @return sFaultSummary the summary, all 0 if no run has the type
+ */
+sFaultSummary cFaultCampaign::getSummary(int type)
+{
+	sFaultSummary summary = sFaultSummary();
+	for(size_t r=0; r<Outcomes.size(); r++)
+	{
+		const sFaultOutcome& outcome = Outcomes[r];
+		bool found = false, over = false;
+		for(int f=0; f<outcome.Faults; f++)
+			found = found || outcome.Fault[f].Type == type;
+		if(!found)
+			continue;
+		for(int i=0; i<Scenario.getCount(); i++)
+			over = over || outcome.PeakCurrent[i] > getCurrentLimit(i);
+		summary.Runs++;
+		summary.MissedCutOff += (outcome.BelowCutOff > 0) ? 1 : 0;
+		summary.OverCurrent += over ? 1 : 0;
+		summary.Exhausted += outcome.Exhausted ? 1 : 0;
+		summary.RunTimeChange += (outcome.RunTime / Reference.RunTime - 1) * 100;
+		summary.WorstBelow = (outcome.BelowCutOff > summary.WorstBelow) ? outcome.BelowCutOff : summary.WorstBelow;
+	}
+	if(summary.Runs > 0)
+		summary.RunTimeChange /= summary.Runs;
+	return summary;
+}
@@ -0,0 +1,616 @@
+/**
+ * @file fleet.cpp
+ * @brief Implementation of the fleet of packs read from a scenario file
+ *
+ * @author Subir Biswas
+ * @date 19/10/2026
+ * @see fleet.hpp
+ */
+
+#include "../header/fleet.hpp"
+#include <stdio.h>	// FILE
+#include <stdlib.h>	// strtod
+#include <math.h>	// isfinite
+#include <string.h>	// strncmp, memcpy
+#include <fcntl.h>	// open
+#include <unistd.h>	// read, close
+#include <sys/mman.h>	// mmap
+#include <sys/stat.h>	// fstat
+
+/**
+ * @brief Skips blanks
+ *
+ * @param p position in the text, moved past the blanks
+ * @return void
+ */
+static void blanks(const char*& p)
+{
+	while(*p == ' ' || *p == '\t')
+		p++;
+}
+
+/**
+ * @brief Reads a number
+ *
+ * @param p	position in the text, moved past the number
+ * @param value	the number
+ * @return bool false if no finite number is there
+ */
+static bool number(const char*& p, double& value)
+{
+	char* end;
+	blanks(p);
+	value = strtod(p, &end);
+	if(end == p || !isfinite(value))
+		return false;
+	p = end;
+	return true;
+}
+
+/**
+ * @brief Checks a cell
+ *
+ * @param cell the cell
+ * @return bool true if its values are finite, resistance and capacity positive and shift not drop
+ */
+static bool validCell(const sFleetCell& cell)
+{
+	return isfinite(cell.InitialVoltage) && isfinite(cell.SeriesResistance) && isfinite(cell.Capacity)
+		&& isfinite(cell.Shift) && isfinite(cell.Drop) && cell.SeriesResistance > 0 && cell.Capacity > 0
+		&& cell.Shift != cell.Drop;
+}
+
+/**
+ * @brief Checks a profile point
+ *
+ * @param point the point
+ * @return bool true if its time is finite and not negative and its load finite and positive
+ */
+static bool validPoint(const sFleetPoint& point)
+{
+	return isfinite(point.Time) && isfinite(point.Load) && point.Time >= 0 && point.Load > 0;
+}
+
+/**
+ * @brief Tells if the rest of a line is blank or a comment
+ *
+ * @param p position in the text
+ * @return bool true if nothing else is on the line
+ */
+static bool ended(const char* p)
+{
+	blanks(p);
+	return *p == '#' || *p == '\n' || *p == '\r' || *p == 0;
+}
+
+/**
+ * @brief Constructor of an empty fleet
+ *
+ * @param void
+ * @return void
+ */
+cFleet::cFleet()
+{
+	Map = (void*)0;
+	MapSize = 0;
+	clear();
+}
+
+/**
+ * @brief Destructor of the fleet, unmaps the binary form
+ *
+ * @param void
+ * @return void
+ */
+cFleet::~cFleet()
+{
+	clear();
+}
+
+/**
+ * @brief Removes every pack
+ *
+ * @param void
+ * @return void
+ */
+void cFleet::clear(void)
+{
+	if(Map != (void*)0)
+		munmap(Map, MapSize);
+	Map = (void*)0;
+	MapSize = 0;
+	PackList.clear();
+	CellList.clear();
+	PointList.clear();
+	Packs = (const sFleetPack*)0;
+	Cells = (const sFleetCell*)0;
+	Points = (const sFleetPoint*)0;
+	PackCount = 0;
+	CellCount = 0;
+	PointCount = 0;
+	Line = 0;
+	Error = "";
+}
+
+/**
+ * @brief Records an error
+ *
+ * @param line	line of the error, 0 if not a parse error
+ * @param error	the error
+ * @return bool false
+ */
+bool cFleet::fail(int line, const char* error)
+{
+	Line = line;
+	Error = error;
+	return false;
+}
+
+/**
+ * @brief Loads a scenario file, text or binary
+ *
+ * The binary form is recognised by its magic number and mapped, the
+ * text is read at once and parsed.
+ * @param path the file
+ * @return true successfully loaded
+ * @return false the file can not be read or is invalid, see getError and getLine
+ */
+bool cFleet::load(const char* path)
+{
+	clear();
+	int fd = open(path, O_RDONLY);
+	struct stat info;
+	uint32_t magic = 0;
+	if(fd < 0 || fstat(fd, &info) != 0)
+	{
+		if(fd >= 0)
+			close(fd);
+		return fail(0, "can not open the file");
+	}
+	size_t size = info.st_size;
+	if(size >= sizeof(sFleetHeader) && pread(fd, &magic, sizeof(magic), 0) == sizeof(magic) && magic == FLEETMAGIC)
+	{
+		bool mapped = map(fd, size);
+		close(fd);
+		return mapped;
+	}
+	std::vector<char> text(size + 1);
+	size_t got = 0;
+	ssize_t n = 1;
+	while(got < size && (n = read(fd, &text[got], size - got)) > 0)
+		got += n;
+	close(fd);
+	if(got != size)
+		return fail(0, "can not read the file");
+	text[size] = 0;
+	return parse(&text[0], size);
+}
+
+/**
+ * @brief Checks the settings of a finished pack
+ *
+ * @param pack	the pack
+ * @param line	line the pack ends at
+ * @return bool false if the pack is invalid, the error is recorded
+ */
+bool cFleet::check(const sFleetPack& pack, int line)
+{
+	if(pack.Cells == 0)
+		return fail(line, "a pack needs a cell");
+	if(!isfinite(pack.Load) || !isfinite(pack.Resolution) || !isfinite(pack.Speed) || !isfinite(pack.CutOffVoltage)
+		|| pack.Load <= 0 || pack.Resolution <= 0 || pack.Speed < 1)
+		return fail(line, "invalid load, resolution, speed or cut off");
+	if(pack.Series != 1 || pack.Strings != 1)
+		return fail(line, "only topology 1 1 is run, a pack is one module");
+	return true;
+}
+
+/**
+ * @brief Parses the text of a scenario file
+ *
+ * @param text	the text, a 0 must follow it
+ * @param size	length of the text
+ * @return true successfully parsed
+ * @return false the text is invalid, see getError and getLine
+ */
+bool cFleet::parse(const char* text, size_t size)
+{
+	clear();
+	const char* p = text;
+	const char* end = text + size;
+	sFleetPack pack = sFleetPack();
+	bool open = false;
+	double value[5];
+	int line = 0;
+	while(p < end)
+	{
+		line++;
+		blanks(p);
+		const char* word = p;
+		while(*p >= 'a' && *p <= 'z')
+			p++;
+		size_t length = p - word;
+		bool valid = true;
+		if(length == 0)
+			valid = ended(p);
+		else if(length == 4 && !strncmp(word, "pack", 4))
+		{
+			if(open && !check(pack, line))
+				return false;
+			if(open)
+				PackList.push_back(pack);
+			blanks(p);
+			const char* name = p;
+			while(*p > ' ' && *p != '#')
+				p++;
+			if(p == name || p - name >= FLEETNAME)
+				return fail(line, "a pack needs a name shorter than 24 characters");
+			pack = sFleetPack();
+			memcpy(pack.Name, name, p - name);
+			pack.FirstCell = CellList.size();
+			pack.FirstPoint = PointList.size();
+			pack.Series = 1;
+			pack.Strings = 1;
+			pack.Load = 10;
+			pack.Resolution = 10;
+			pack.CutOffVoltage = 8;
+			pack.Speed = FLEETSPEED;
+			open = true;
+		}
+		else if(!open)
+			return fail(line, "pack expected");
+		else if(length == 4 && !strncmp(word, "load", 4))
+			valid = number(p, pack.Load);
+		else if(length == 10 && !strncmp(word, "resolution", 10))
+			valid = number(p, pack.Resolution);
+		else if(length == 5 && !strncmp(word, "speed", 5))
+			valid = number(p, pack.Speed);
+		else if(length == 6 && !strncmp(word, "cutoff", 6))
+			valid = number(p, pack.CutOffVoltage);
+		else if(length == 8 && !strncmp(word, "topology", 8))
+		{
+			//the simulator, getScenario and the sweep run one module, so a
+			//pack of several modules would silently run as one
+			valid = number(p, value[0]) && number(p, value[1]);
+			if(valid && (value[0] != 1 || value[1] != 1))
+				return fail(line, "only topology 1 1 is run, a pack is one module");
+		}
+		else if(length == 4 && !strncmp(word, "cell", 4))
+		{
+			sFleetCell cell;
+			valid = number(p, cell.InitialVoltage) && number(p, cell.SeriesResistance) && number(p, cell.Capacity);
+			cell.Shift = 95;
+			cell.Drop = 10;
+			if(valid && !ended(p))
+				valid = number(p, cell.Shift) && number(p, cell.Drop);
+			if(!valid || !validCell(cell))
+				return fail(line, "cell needs <V> <Ohm> <mAh> [<shift %> <drop %>], resistance and capacity positive");
+			if(pack.Cells == MAXCELLS)
+				return fail(line, "too many cells in a module");
+			CellList.push_back(cell);
+			pack.Cells++;
+		}
+		else if(length == 7 && !strncmp(word, "profile", 7))
+		{
+			sFleetPoint point;
+			valid = number(p, point.Time) && number(p, point.Load);
+			point.Time *= 1000;
+			valid = valid && validPoint(point);
+			if(valid && pack.Points > 0 && point.Time <= PointList.back().Time)
+				return fail(line, "profile times must increase");
+			PointList.push_back(point);
+			pack.Points++;
+		}
+		else if(length == 6 && !strncmp(word, "repeat", 6))
+		{
+			//the copies share the cells and the profile of the pack
+			valid = number(p, value[0]) && value[0] >= 0 && value[0] <= 10000000;
+			if(valid && !check(pack, line))
+				return false;
+			for(long k=0; valid && k<(long)value[0]; k++)
+				PackList.push_back(pack);
+		}
+		else
+			return fail(line, "unknown statement");
+		if(!valid || !ended(p))
+			return fail(line, "invalid value");
+		while(p < end && *p != '\n')
+			p++;
+		p++;
+	}
+	if(open)
+	{
+		if(!check(pack, line))
+			return false;
+		PackList.push_back(pack);
+	}
+	Packs = PackList.empty() ? (const sFleetPack*)0 : &PackList[0];
+	Cells = CellList.empty() ? (const sFleetCell*)0 : &CellList[0];
+	Points = PointList.empty() ? (const sFleetPoint*)0 : &PointList[0];
+	PackCount = PackList.size();
+	CellCount = CellList.size();
+	PointCount = PointList.size();
+	return true;
+}
+
+/**
+ * @brief Maps the binary form and checks it
+ *
+ * Every cell and profile point is checked once, and every pack to lie
+ * within the arrays with its settings valid and its profile times
+ * increasing, so the packs can be used without further checks.
+ * @param fd	the open file
+ * @param size	size of the file in bytes
+ * @return bool false if the file can not be mapped or is invalid
+ */
+bool cFleet::map(int fd, size_t size)
+{
+	Map = mmap((void*)0, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if(Map == MAP_FAILED)
+	{
+		Map = (void*)0;
+		return fail(0, "can not map the file");
+	}
+	MapSize = size;
+	const sFleetHeader* head = (const sFleetHeader*)Map;
+	size_t expected = sizeof(sFleetHeader) + (size_t)head->Packs * sizeof(sFleetPack)
+		+ (size_t)head->Cells * sizeof(sFleetCell) + (size_t)head->Points * sizeof(sFleetPoint);
+	if(head->Version != FLEETVERSION || expected != size)
+	{
+		clear();
+		return fail(0, "invalid binary fleet");
+	}
+	Packs = (const sFleetPack*)(head + 1);
+	Cells = (const sFleetCell*)(Packs + head->Packs);
+	Points = (const sFleetPoint*)(Cells + head->Cells);
+	bool valid = true;
+	for(uint32_t i=0; valid && i<head->Cells; i++)
+		valid = validCell(Cells[i]);
+	for(uint32_t i=0; valid && i<head->Points; i++)
+		valid = validPoint(Points[i]);
+	for(uint32_t k=0; valid && k<head->Packs; k++)
+	{
+		const sFleetPack& pack = Packs[k];
+		valid = pack.Cells >= 1 && pack.Cells <= MAXCELLS && pack.Cells <= head->Cells
+			&& pack.FirstCell <= head->Cells - pack.Cells
+			&& pack.Points <= head->Points && pack.FirstPoint <= head->Points - pack.Points
+			&& pack.Name[FLEETNAME-1] == 0 && check(pack, 0);
+		for(uint32_t i=1; valid && i<pack.Points; i++)
+			valid = Points[pack.FirstPoint + i].Time > Points[pack.FirstPoint + i - 1].Time;
+	}
+	if(!valid)
+	{
+		clear();
+		return fail(0, "invalid binary fleet");
+	}
+	PackCount = head->Packs;
+	CellCount = head->Cells;
+	PointCount = head->Points;
+	return true;
+}
+
+/**
+ * @brief Saves the fleet in the binary form
+ *
+ * @param path the file, it is replaced
+ * @return true successfully saved
+ * @return false the file can not be written
+ */
+bool cFleet::save(const char* path)
+{
+	sFleetHeader head = sFleetHeader();
+	head.Magic = FLEETMAGIC;
+	head.Version = FLEETVERSION;
+	head.Packs = PackCount;
+	head.Cells = CellCount;
+	head.Points = PointCount;
+	FILE* file = fopen(path, "wb");
+	if(file == (FILE*)0)
+		return fail(0, "can not write the file");
+	bool written = fwrite(&head, sizeof(head), 1, file) == 1
+		&& fwrite(Packs, sizeof(sFleetPack), PackCount, file) == PackCount
+		&& fwrite(Cells, sizeof(sFleetCell), CellCount, file) == CellCount
+		&& fwrite(Points, sizeof(sFleetPoint), PointCount, file) == PointCount;
+	written = (fclose(file) == 0) && written;
+	return written || fail(0, "can not write the file");
+}
+
+/**
+ * @brief Tells if the fleet is mapped from the binary form
+ *
+ * @param void
+ * @return bool true if mapped
+ */
+bool cFleet::isMapped(void)
+{
+	return Map != (void*)0;
+}
+
+/**
+ * @brief Returns the number of packs
+ *
+ * @param void
+ * @return int number of packs
+ */
+int cFleet::getPackCount(void)
+{
+	return (int)PackCount;
+}
+
+/**
+ * @brief Returns the number of distinct cells, repeated packs share theirs
+ *
+ * @param void
+ * @return int number of cells
+ */
+int cFleet::getCellCount(void)
+{
+	return (int)CellCount;
+}
+
+/**
+ * @brief Returns a pack
+ *
+ * @param pack index of the pack
+ * @return const sFleetPack* the pack, null if out of range
+ */
+const sFleetPack* cFleet::getPack(int pack)
+{
+	if(pack < 0 || pack >= (int)PackCount)
+		return (const sFleetPack*)0;
+	return &Packs[pack];
+}
+
+/**
+ * @brief Returns the cells of a module of a pack
+ *
+ * @param pack index of the pack
+ * @return const sFleetCell* the first of getPack(pack)->Cells cells, null if out of range
+ */
+const sFleetCell* cFleet::getCells(int pack)
+{
+	if(pack < 0 || pack >= (int)PackCount)
+		return (const sFleetCell*)0;
+	return &Cells[Packs[pack].FirstCell];
+}
+
+/**
+ * @brief Returns the load profile of a pack
+ *
+ * @param pack index of the pack
+ * @return const sFleetPoint* the first of getPack(pack)->Points points, null if out of range or without profile
+ */
+const sFleetPoint* cFleet::getProfile(int pack)
+{
+	if(pack < 0 || pack >= (int)PackCount || Packs[pack].Points == 0)
+		return (const sFleetPoint*)0;
+	return &Points[Packs[pack].FirstPoint];
+}
+
+/**
+ * @brief Finds a pack by name
+ *
+ * @param name the name
+ * @return int index of the first pack with the name, -1 if none
+ */
+int cFleet::find(const char* name)
+{
+	for(uint32_t k=0; k<PackCount; k++)
+	{
+		if(!strncmp(Packs[k].Name, name, FLEETNAME))
+			return (int)k;
+	}
+	return -1;
+}
+
+/**
+ * @brief Returns the scenario of a module of a pack
+ *
+ * The scenario has the cells of one module, the start load, the
+ * resolution and the cut off voltage.
+ * @param pack		index of the pack
+ * @param scenario	an empty scenario
+ * @return true successfully built
+ * @return false index out of range or the scenario is not empty
+ */
+bool cFleet::getScenario(int pack, cScenario& scenario)
+{
+	const sFleetPack* settings = getPack(pack);
+	if(settings == (const sFleetPack*)0 || scenario.getCount() != 0)
+		return false;
+	const sFleetCell* cell = getCells(pack);
+	for(uint32_t i=0; i<settings->Cells; i++)
+		scenario.addCell(cell[i].InitialVoltage, cell[i].SeriesResistance, cell[i].Capacity, cell[i].Shift, cell[i].Drop);
+	return scenario.setLoad(settings->Load) && scenario.setResolution(settings->Resolution)
+		&& scenario.setCutOffVoltage(settings->CutOffVoltage);
+}
+
+/**
+ * @brief Returns the line of the last parse error
+ *
+ * @param void
+ * @return int the line, 0 if the error is not in a line
+ */
+int cFleet::getLine(void)
+{
+	return Line;
+}
+
+/**
+ * @brief Returns the last error
+ *
+ * @param void
+ * @return const char* the error, empty if none
+ */
+const char* cFleet::getError(void)
+{
+	return Error;
+}
+
+/**
+ * @brief Constructor of a player without profile
+ *
+ * @param void
+ * @return void
+ */
+cProfilePlayer::cProfilePlayer()
+{
+	Rejected = 0;
+	setProfile((cBattery*)0, (const sFleetPoint*)0, 0);
+}
+
+/**
+ * @brief Sets the profile to play
+ *
+ * @param battery	the battery the loads are applied to
+ * @param points	the profile, it must outlive the player
+ * @param count		number of points
+ * @return void
+ */
+void cProfilePlayer::setProfile(cBattery* battery, const sFleetPoint* points, int count)
+{
+	Battery = battery;
+	Points = points;
+	Count = (points != (const sFleetPoint*)0) ? count : 0;
+	Next = 0;
+	Last = 0;
+	Rejected = 0;
+}
+
+/**
+ * @brief Returns the number of loads the battery rejected
+ *
+ * @param void
+ * @return int loads not applied since the profile was set
+ */
+int cProfilePlayer::getRejected(void)
+{
+	return Rejected.load();
+}
+
+/**
+ * @brief Step sink applying the due loads of the profile
+ *
+ * Runs on the thread stepping the battery, so the loads are applied
+ * directly and not posted: the queue of live changes keeps the command
+ * thread as its only producer.
+ * @param player	the cProfilePlayer
+ * @param snapshot	state of the battery after the step
+ * @return void
+ */
+void cProfilePlayer::sink(void* player, const sSnapshot& snapshot)
+{
+	cProfilePlayer* self = (cProfilePlayer*)player;
+	if(snapshot.ElapsedTime < self->Last)
+		self->Next = 0;
+	self->Last = snapshot.ElapsedTime;
+	while(self->Next < self->Count && self->Points[self->Next].Time <= snapshot.ElapsedTime)
+	{
+		sLiveChange change;
+		change.Type = LIVELOAD;
+		change.Count = 1;
+		change.Value[0] = self->Points[self->Next++].Load;
+		if(!self->Battery->apply(change))
+			self->Rejected++;
+	}
+}
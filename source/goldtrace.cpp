@@ -0,0 +1,356 @@
+/**
+ * @file goldtrace.cpp
+ * @brief Implementation of the golden trace recorder and comparer
+ *
+ * @author Subir Biswas
+ * @date 19/10/2026
+ * @see goldtrace.hpp
+ */
+
+#include "../header/goldtrace.hpp"
+#include "../header/setbatt.hpp"
+#include <string.h>	// memset, memcmp, strncpy
+#include <stddef.h>	// offsetof
+#include <math.h>	// fabs
+
+/**
+ * @brief Constructor of the trace, no case running
+ *
+ * @param void
+ * @return void
+ */
+cGoldenTrace::cGoldenTrace()
+{
+	File = (FILE*)0;
+	Buffer = new char[GOLDBUFFER];
+	Recording = false;
+	Count = 0;
+	Width = 0;
+	Interval = 0;
+	Tolerance = sGoldTolerance();
+	Result = (sGoldResult*)0;
+}
+
+/**
+ * @brief Destructor of the trace
+ *
+ * @param void
+ * @return void
+ */
+cGoldenTrace::~cGoldenTrace()
+{
+	if(File != (FILE*)0)
+		fclose(File);
+	delete[] Buffer;
+}
+
+/**
+ * @brief Fills the head of the golden file of a case
+ *
+ * @param run	the case
+ * @param head	the head, Steps is 0
+ * @return void
+ */
+void cGoldenTrace::header(const sGoldCase& run, sGoldHeader& head)
+{
+	memset(&head, 0, sizeof(head));
+	head.Magic = GOLDMAGIC;
+	head.Version = GOLDVERSION;
+	head.Count = run.Scenario.getCount();
+	head.Substeps = run.Substeps;
+	head.DwellOn = run.DwellOn;
+	head.DwellOff = run.DwellOff;
+	head.HysteresisOn = run.HysteresisOn;
+	head.HysteresisOff = run.HysteresisOff;
+	head.Load = run.Scenario.getLoad();
+	head.Resolution = run.Scenario.getResolution();
+	head.CutOffVoltage = run.Scenario.getCutOffVoltage();
+	for(int i=0; i<head.Count; i++)
+	{
+		head.InitialVoltage[i] = run.Scenario.getInitialVoltage(i);
+		head.SeriesResistance[i] = run.Scenario.getSeriesResistance(i);
+		head.Capacity[i] = run.Scenario.getCapacity(i);
+	}
+}
+
+/**
+ * @brief Runs the discharge of a case with the trace as step sink
+ *
+ * The step loop is the one of cBattery::runBattery without the sleep.
+ * A comparison stops at the first divergence, and one step after the
+ * golden trace ended.
+ * @param run		the case
+ * @param result	the result, Passed is true unless a divergence was found
+ * @return bool false if the battery can not be set up
+ */
+bool cGoldenTrace::play(const sGoldCase& run, sGoldResult& result)
+{
+	cSingleBatt cells[MAXCELLS];
+	cBattery battery;
+	unsigned long limit = Recording ? MAXSTEPS : result.GoldenSteps + 1;
+	Count = run.Scenario.getCount();
+	Width = 3 + 2 * Count;
+	Interval = run.Scenario.getResolution();
+	Golden[0] = 0;
+	LastMask[0] = 0;
+	LastMask[1] = 0;
+	for(int i=0; i<MAXCELLS; i++)
+	{
+		Pending[i] = 0;
+		PendingStep[i] = 0;
+	}
+	for(int i=0; i<Count; i++)
+	{
+		cells[i].setInitialVoltage(run.Scenario.getInitialVoltage(i));
+		cells[i].setSeriesResistance(run.Scenario.getSeriesResistance(i));
+		cells[i].setCapacity(run.Scenario.getCapacity(i));
+		battery.addCell(&cells[i]);
+	}
+	if(!battery.setHysteresis(run.HysteresisOn, run.HysteresisOff) || !battery.setDwell(run.DwellOn, run.DwellOff)
+		|| !battery.setSubsteps(run.Substeps) || !battery.addSink(sink, this) || !battery.attach())
+	{
+		strncpy(result.Error, "invalid balancing settings", sizeof(result.Error) - 1);
+		return false;
+	}
+	Result = &result;
+	result.Passed = true;
+	while(battery.step(run.Scenario.getLoad(), run.Scenario.getResolution()) && result.Passed && result.Steps < limit)
+		;
+	battery.detach();
+	Result = (sGoldResult*)0;
+	return true;
+}
+
+/**
+ * @brief Records the golden trace of a case
+ *
+ * @param run		the case
+ * @param path		the golden file, it is replaced
+ * @param result	the result
+ * @return true successfully recorded
+ * @return false the file can not be written or the battery can not be set up, see result.Error
+ */
+bool cGoldenTrace::record(const sGoldCase& run, const char* path, sGoldResult& result)
+{
+	sGoldHeader head;
+	result = sGoldResult();
+	header(run, head);
+	File = fopen(path, "wb");
+	if(File == (FILE*)0)
+	{
+		strncpy(result.Error, "can not write the golden file", sizeof(result.Error) - 1);
+		return false;
+	}
+	setvbuf(File, Buffer, _IOFBF, GOLDBUFFER);
+	Recording = true;
+	bool played = fwrite(&head, sizeof(head), 1, File) == 1 && play(run, result);
+	head.Steps = result.Steps;
+	result.GoldenSteps = result.Steps;
+	bool written = played && fseek(File, 0, SEEK_SET) == 0 && fwrite(&head, sizeof(head), 1, File) == 1;
+	written = (fclose(File) == 0) && written;
+	File = (FILE*)0;
+	if(played && !written)
+		strncpy(result.Error, "can not write the golden file", sizeof(result.Error) - 1);
+	result.Passed = written;
+	return written;
+}
+
+/**
+ * @brief Compares a run of a case with its golden trace
+ *
+ * @param run		the case
+ * @param path		the golden file
+ * @param tolerance	tolerances of the values and slack of the toggles
+ * @param result	the result, the first divergence if it did not pass
+ * @return true the case ran, see result.Passed
+ * @return false the golden file is missing, was recorded from another case or the battery can not be set up, see result.Error
+ */
+bool cGoldenTrace::compare(const sGoldCase& run, const char* path, const sGoldTolerance& tolerance, sGoldResult& result)
+{
+	sGoldHeader head, golden;
+	result = sGoldResult();
+	header(run, head);
+	File = fopen(path, "rb");
+	if(File == (FILE*)0)
+	{
+		strncpy(result.Error, "no golden file, record it first", sizeof(result.Error) - 1);
+		return false;
+	}
+	setvbuf(File, Buffer, _IOFBF, GOLDBUFFER);
+	bool played = false;
+	if(fread(&golden, sizeof(golden), 1, File) != 1 || golden.Magic != GOLDMAGIC || golden.Version != GOLDVERSION)
+		strncpy(result.Error, "not a golden file", sizeof(result.Error) - 1);
+	else if(memcmp(&head, &golden, offsetof(sGoldHeader, Steps)) != 0)
+		strncpy(result.Error, "the case changed, record it again", sizeof(result.Error) - 1);
+	else
+	{
+		Recording = false;
+		Tolerance = tolerance;
+		result.GoldenSteps = golden.Steps;
+		played = play(run, result);
+	}
+	fclose(File);
+	File = (FILE*)0;
+	if(!played || !result.Passed)
+		return played;
+	//a toggle still unmatched at the end never happened in the other trace
+	Result = &result;
+	toggles(result.Steps + Tolerance.Slack + 1);
+	Result = (sGoldResult*)0;
+	if(result.Passed && result.Steps < result.GoldenSteps)
+		diverge(result.Steps + 1, "length", result.GoldenSteps, result.Steps);
+	return true;
+}
+
+/**
+ * @brief Step sink of the trace
+ *
+ * @param trace		the cGoldenTrace
+ * @param snapshot	state of the battery after the step
+ * @return void
+ */
+void cGoldenTrace::sink(void* trace, const sSnapshot& snapshot)
+{
+	((cGoldenTrace*)trace)->step(snapshot);
+}
+
+/**
+ * @brief Records a divergence if it is the first
+ *
+ * @param step		step of the divergence, counted from 1
+ * @param channel	name of the channel
+ * @param golden	golden value
+ * @param actual	value of the run
+ * @return void
+ */
+void cGoldenTrace::diverge(unsigned long step, const char* channel, double golden, double actual)
+{
+	if(!Result->Passed)
+		return;
+	Result->Passed = false;
+	Result->Step = step;
+	//the golden time of the step, the steps are Interval apart
+	Result->Time = Golden[0] - ((double)Result->Steps - (double)step) * Interval;
+	snprintf(Result->Channel, sizeof(Result->Channel), "%s", channel);
+	Result->Golden = golden;
+	Result->Actual = actual;
+}
+
+/**
+ * @brief Compares a value with its golden value
+ *
+ * @param name		name of the channel
+ * @param cell		index of the cell of the channel, -1 for a channel of the battery
+ * @param golden	golden value
+ * @param actual	value of the run
+ * @param tolerance	absolute tolerance, the relative tolerance is added
+ * @return bool true if they differ, the divergence is recorded
+ */
+bool cGoldenTrace::differ(const char* name, int cell, double golden, double actual, double tolerance)
+{
+	char channel[16];
+	if(fabs(actual - golden) <= tolerance + Tolerance.Relative * fabs(golden))
+		return false;
+	if(cell < 0)
+		snprintf(channel, sizeof(channel), "%s", name);
+	else
+		snprintf(channel, sizeof(channel), "%s%d", name, cell);
+	diverge(Result->Steps, channel, golden, actual);
+	return true;
+}
+
+/**
+ * @brief Checks the unmatched toggles for one older than the slack
+ *
+ * The switches have not changed since the unmatched toggle, so the
+ * states of the step before are those of the toggle.
+ * @param step the current step
+ * @return bool true if a toggle went unmatched, the divergence is recorded
+ */
+bool cGoldenTrace::toggles(unsigned long step)
+{
+	char channel[16];
+	for(int i=0; i<Count; i++)
+	{
+		if(Pending[i] == 0 || step - PendingStep[i] <= (unsigned long)Tolerance.Slack)
+			continue;
+		snprintf(channel, sizeof(channel), "switch%d", i);
+		diverge(PendingStep[i], channel, (LastMask[0] >> i) & 1, (LastMask[1] >> i) & 1);
+		return true;
+	}
+	return false;
+}
+
+/**
+ * @brief Records or compares a step
+ *
+ * @param snapshot state of the battery after the step
+ * @return void
+ */
+void cGoldenTrace::step(const sSnapshot& snapshot)
+{
+	char channel[16];
+	uint32_t mask = 0;
+	int i;
+	if(Result == (sGoldResult*)0 || !Result->Passed)
+		return;
+	unsigned long n = ++Result->Steps;
+	Record[0] = snapshot.ElapsedTime;
+	Record[1] = snapshot.Vout;
+	for(i=0; i<Count; i++)
+	{
+		Record[2 + 2*i] = snapshot.CurrentVoltage[i];
+		Record[3 + 2*i] = snapshot.SourceCurrent[i];
+		mask |= (uint32_t)snapshot.Switch[i] << i;
+	}
+	Record[Width - 1] = mask;
+	if(Recording)
+	{
+		if(fwrite(Record, sizeof(double), Width, File) != (size_t)Width)
+		{
+			strncpy(Result->Error, "can not write the golden file", sizeof(Result->Error) - 1);
+			Result->Passed = false;
+		}
+		return;
+	}
+	if(fread(Golden, sizeof(double), Width, File) != (size_t)Width)
+	{
+		diverge(n, "length", Result->GoldenSteps, n);
+		return;
+	}
+
+	//switch timelines, an unmatched toggle waits upto the slack for its match
+	uint32_t golden = (uint32_t)Golden[Width - 1];
+	if(toggles(n))
+		return;
+	bool pending = false;
+	for(i=0; i<Count; i++)
+	{
+		int g = ((golden ^ LastMask[0]) >> i) & 1;
+		int a = ((mask ^ LastMask[1]) >> i) & 1;
+		int before = Pending[i];
+		Pending[i] += g - a;
+		if(Pending[i] > 1 || Pending[i] < -1)
+		{
+			//toggled twice without a match, report the states after the first toggle
+			snprintf(channel, sizeof(channel), "switch%d", i);
+			diverge(PendingStep[i], channel, ((golden >> i) & 1) ^ g, ((mask >> i) & 1) ^ a);
+			return;
+		}
+		if(Pending[i] != 0 && (before == 0 || (before > 0 && a) || (before < 0 && g)))
+			PendingStep[i] = n;
+		pending = pending || Pending[i] != 0;
+	}
+	LastMask[0] = golden;
+	LastMask[1] = mask;
+	if(differ("time", -1, Golden[0], Record[0], 1e-6) || pending)
+		return;
+	if(differ("vout", -1, Golden[1], Record[1], Tolerance.Voltage))
+		return;
+	for(i=0; i<Count; i++)
+	{
+		if(differ("v", i, Golden[2 + 2*i], Record[2 + 2*i], Tolerance.Voltage)
+			|| differ("i", i, Golden[3 + 2*i], Record[3 + 2*i], Tolerance.Current))
+			return;
+	}
+}
@@ -0,0 +1,463 @@
+/**
+ * @file history.cpp
+ * @brief Implementation of the compressed history of a run
+ *
+ * A sample of a column is written as the zigzag varint of
+ * (value - previous) - (previous - the one before), both 0 at the
+ * start of a block, so every block decodes on its own.
+ *
+ * @author Subir Biswas
+ * @date 19/10/2026
+ * @see history.hpp
+ */
+
+#include "../header/history.hpp"
+#include <fcntl.h>	// open
+#include <unistd.h>	// pread, pwrite, close
+#include <math.h>	// llround
+
+static const double Quantum[HISTKINDS] = {10000, 1000000, 1000};	///<Steps per unit of each column of a cell
+
+/**
+ * @brief Constructor of the history, closed
+ *
+ * @param void
+ * @return void
+ */
+cHistoryStore::cHistoryStore()
+{
+	Fd = -1;
+	Interval = 0;
+	clear();
+}
+
+/**
+ * @brief Destructor of the history, closes the spill file
+ *
+ * @param void
+ * @return void
+ */
+cHistoryStore::~cHistoryStore()
+{
+	close();
+}
+
+/**
+ * @brief Starts an empty history
+ *
+ * @param path		spill file, it is truncated, null to keep every block in memory
+ * @param interval	simulated time between two samples in mS
+ * @return true successfully opened
+ * @return false already open, interval is not positive or the file can not be created
+ */
+bool cHistoryStore::open(const char* path, double interval)
+{
+	if(isOpen() || interval <= 0)
+		return false;
+	std::lock_guard<std::mutex> guard(Lock);
+	if(path != (const char*)0)
+	{
+		Fd = ::open(path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+		if(Fd < 0)
+			return false;
+	}
+	Interval = interval;
+	clear();
+	return true;
+}
+
+/**
+ * @brief Drops the history and closes the spill file
+ *
+ * @param void
+ * @return true successfully closed
+ * @return false not open
+ */
+bool cHistoryStore::close(void)
+{
+	if(!isOpen())
+		return false;
+	std::lock_guard<std::mutex> guard(Lock);
+	if(Fd >= 0)
+		::close(Fd);
+	Fd = -1;
+	Interval = 0;
+	clear();
+	return true;
+}
+
+/**
+ * @brief Tells if the history is open
+ *
+ * @param void
+ * @return bool true if open
+ */
+bool cHistoryStore::isOpen(void)
+{
+	return Interval > 0;
+}
+
+/**
+ * @brief Drops every sample, called with the lock held
+ *
+ * @param void
+ * @return void
+ */
+void cHistoryStore::clear(void)
+{
+	Blocks.clear();
+	Open.First = 0;
+	Open.Last = 0;
+	Open.Count = 0;
+	Open.Offset = -1;
+	for(int c=0; c<HISTCOLUMNS; c++)
+	{
+		Stream[c].clear();
+		Previous[c] = 0;
+		Delta[c] = 0;
+	}
+	NextTime = 0;
+	Cells = 0;
+	Columns = 0;
+	Spilled = 0;
+}
+
+/**
+ * @brief Records a step if a sample is due
+ *
+ * Called by the thread that steps the battery. The time of the next
+ * sample is only written by this thread, so a step that is not
+ * sampled takes no lock.
+ * @param snapshot state of the battery after the step
+ * @return void
+ */
+void cHistoryStore::record(const sSnapshot& snapshot)
+{
+	if(!isOpen() || (Columns > 0 && snapshot.ElapsedTime < NextTime && snapshot.ElapsedTime >= Open.Last))
+		return;
+	std::lock_guard<std::mutex> guard(Lock);
+	int64_t value[HISTCOLUMNS];
+	int c, i, k;
+	if(Columns == 0 || snapshot.ElapsedTime < Open.Last || snapshot.Count != Cells)
+	{
+		//a new run
+		clear();
+		Cells = snapshot.Count;
+		Columns = 2 + HISTKINDS * Cells;
+		NextTime = snapshot.ElapsedTime;
+	}
+	value[0] = llround(snapshot.ElapsedTime);
+	value[1] = 0;
+	for(i=0; i<Cells; i++)
+	{
+		value[1] |= (int64_t)snapshot.Switch[i] << i;
+		value[2 + i*HISTKINDS + HISTVOLTAGE] = llround(snapshot.CurrentVoltage[i] * Quantum[HISTVOLTAGE]);
+		value[2 + i*HISTKINDS + HISTCURRENT] = llround(snapshot.SourceCurrent[i] * Quantum[HISTCURRENT]);
+		value[2 + i*HISTKINDS + HISTREMAIN] = llround(snapshot.RemainingCapacity[i] * Quantum[HISTREMAIN]);
+	}
+	for(c=0; c<Columns; c++)
+	{
+		int64_t delta = value[c] - Previous[c];
+		int64_t dod = delta - Delta[c];
+		uint64_t zigzag = ((uint64_t)dod << 1) ^ (uint64_t)(dod >> 63);
+		for(k=0; k<10 && zigzag >= 0x80; k++, zigzag >>= 7)
+			Stream[c].push_back((uint8_t)(zigzag | 0x80));
+		Stream[c].push_back((uint8_t)zigzag);
+		Previous[c] = value[c];
+		Delta[c] = delta;
+	}
+	if(Open.Count == 0)
+		Open.First = snapshot.ElapsedTime;
+	Open.Last = snapshot.ElapsedTime;
+	Open.Count++;
+	NextTime += Interval;
+	if(NextTime <= snapshot.ElapsedTime)
+		NextTime = snapshot.ElapsedTime + Interval;
+	if(Open.Count == HISTBLOCK)
+		seal();
+}
+
+/**
+ * @brief Seals the open block, called with the lock held
+ *
+ * With a spill file, the block that falls out of the HISTRESIDENT
+ * newest is appended to it and its bytes are freed. A block that can
+ * not be written stays in memory.
+ * @param void
+ * @return void
+ */
+void cHistoryStore::seal(void)
+{
+	sBlock block;
+	int c;
+	block.First = Open.First;
+	block.Last = Open.Last;
+	block.Count = Open.Count;
+	block.Offset = -1;
+	block.Start[0] = 0;
+	for(c=0; c<HISTCOLUMNS; c++)
+	{
+		block.Start[c+1] = block.Start[c] + (uint32_t)Stream[c].size();
+		block.Data.insert(block.Data.end(), Stream[c].begin(), Stream[c].end());
+		Stream[c].clear();
+		Previous[c] = 0;
+		Delta[c] = 0;
+	}
+	Blocks.push_back(block);
+	Open.Count = 0;
+
+	int oldest = (int)Blocks.size() - HISTRESIDENT - 1;
+	if(Fd < 0 || oldest < 0)
+		return;
+	sBlock& spill = Blocks[oldest];
+	size_t size = spill.Data.size();
+	if(pwrite(Fd, &spill.Data[0], size, Spilled) != (ssize_t)size)
+		return;
+	spill.Offset = Spilled;
+	Spilled += size;
+	std::vector<uint8_t>().swap(spill.Data);
+}
+
+/**
+ * @brief Step sink recording into a history
+ *
+ * @param store		the cHistoryStore
+ * @param snapshot	state of the battery after the step
+ * @return void
+ */
+void cHistoryStore::sink(void* store, const sSnapshot& snapshot)
+{
+	((cHistoryStore*)store)->record(snapshot);
+}
+
+/**
+ * @brief Finds the block holding a time, called with the lock held
+ *
+ * @param time simulated time in mS
+ * @return int index of the block, the number of sealed blocks for the open block, -1 outside the history
+ */
+int cHistoryStore::find(double time)
+{
+	int sealed = (int)Blocks.size();
+	double last = (Open.Count > 0) ? Open.Last : ((sealed > 0) ? Blocks[sealed-1].Last : 0);
+	if(Columns == 0 || time > last)
+		return -1;
+	if(Open.Count > 0 && time >= Open.First)
+		return sealed;
+	int low = 0, high = sealed;
+	//first block that starts after time
+	while(low < high)
+	{
+		int middle = (low + high) / 2;
+		if(Blocks[middle].First <= time)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+	return low - 1;
+}
+
+/**
+ * @brief Copies the bytes of a block, called with the lock held
+ *
+ * A spilled block is read from the spill file, the open block is put
+ * together from its columns.
+ * @param block	index of the block, the number of sealed blocks for the open block
+ * @param data	the bytes
+ * @param start	start of each column in the bytes, HISTCOLUMNS+1 entries
+ * @return bool false if the block can not be read
+ */
+bool cHistoryStore::bytes(int block, std::vector<uint8_t>& data, uint32_t* start)
+{
+	int c;
+	if(block == (int)Blocks.size())
+	{
+		data.clear();
+		start[0] = 0;
+		for(c=0; c<HISTCOLUMNS; c++)
+		{
+			start[c+1] = start[c] + (uint32_t)Stream[c].size();
+			data.insert(data.end(), Stream[c].begin(), Stream[c].end());
+		}
+		return true;
+	}
+	const sBlock& sealed = Blocks[block];
+	for(c=0; c<=HISTCOLUMNS; c++)
+		start[c] = sealed.Start[c];
+	if(sealed.Offset < 0)
+	{
+		data = sealed.Data;
+		return true;
+	}
+	data.resize(sealed.Start[HISTCOLUMNS]);
+	return pread(Fd, &data[0], data.size(), sealed.Offset) == (ssize_t)data.size();
+}
+
+/**
+ * @brief Decodes a column of a block
+ *
+ * @param data		the bytes of the column
+ * @param size		number of bytes
+ * @param values	the samples
+ * @return void
+ */
+void cHistoryStore::decode(const uint8_t* data, uint32_t size, std::vector<int64_t>& values)
+{
+	int64_t previous = 0, delta = 0;
+	uint64_t zigzag;
+	int shift;
+	uint32_t p = 0;
+	values.clear();
+	while(p < size)
+	{
+		zigzag = 0;
+		shift = 0;
+		while(p < size && (data[p] & 0x80))
+		{
+			zigzag |= (uint64_t)(data[p++] & 0x7F) << shift;
+			shift += 7;
+		}
+		if(p < size)
+			zigzag |= (uint64_t)data[p++] << shift;
+		delta += (int64_t)(zigzag >> 1) ^ -(int64_t)(zigzag & 1);
+		previous += delta;
+		values.push_back(previous);
+	}
+}
+
+/**
+ * @brief Returns a column of every cell at a time
+ *
+ * The values are those of the last sample at or before the time.
+ * @param kind		HISTVOLTAGE, HISTCURRENT or HISTREMAIN
+ * @param time		simulated time in mS
+ * @param values	value of each cell, getCells() entries
+ * @param switches	switch of each cell, getCells() entries
+ * @return true successfully found
+ * @return false kind is invalid, the time is outside the history or the spill file can not be read
+ */
+bool cHistoryStore::at(int kind, double time, double* values, bool* switches)
+{
+	if(kind < 0 || kind >= HISTKINDS)
+		return false;
+	std::lock_guard<std::mutex> guard(Lock);
+	int block = find(time);
+	std::vector<uint8_t> data;
+	std::vector<int64_t> column;
+	uint32_t start[HISTCOLUMNS+1];
+	int i, index = 0;
+	if(block < 0 || !bytes(block, data, start))
+		return false;
+	decode(&data[0], start[1] - start[0], column);
+	while(index + 1 < (int)column.size() && column[index + 1] <= time)
+		index++;
+	decode(&data[start[1]], start[2] - start[1], column);
+	for(i=0; i<Cells; i++)
+		switches[i] = (column[index] >> i) & 1;
+	for(i=0; i<Cells; i++)
+	{
+		int c = 2 + i*HISTKINDS + kind;
+		decode(&data[start[c]], start[c+1] - start[c], column);
+		values[i] = column[index] / Quantum[kind];
+	}
+	return true;
+}
+
+/**
+ * @brief Summarises a column of a cell over a time range
+ *
+ * Decodes the blocks that overlap the range one at a time.
+ * @param kind		HISTVOLTAGE, HISTCURRENT or HISTREMAIN
+ * @param cell		index of the cell
+ * @param from		start of the range in mS
+ * @param to		end of the range in mS
+ * @param summary	the summary
+ * @return true successfully summarised
+ * @return false an argument is invalid, no sample lies in the range or the spill file can not be read
+ */
+bool cHistoryStore::range(int kind, int cell, double from, double to, sHistoryRange& summary)
+{
+	if(kind < 0 || kind >= HISTKINDS || from > to)
+		return false;
+	std::lock_guard<std::mutex> guard(Lock);
+	if(cell < 0 || cell >= Cells)
+		return false;
+	std::vector<uint8_t> data;
+	std::vector<int64_t> times, column;
+	uint32_t start[HISTCOLUMNS+1];
+	int c = 2 + cell*HISTKINDS + kind;
+	int block = find(from);
+	double sum = 0, value;
+	summary.Samples = 0;
+	summary.Min = 0;
+	summary.Max = 0;
+	summary.Mean = 0;
+	//a range that starts before the history starts at its first block
+	if(block < 0 && Columns > 0 && (Blocks.empty() ? Open.First : Blocks[0].First) <= to)
+		block = 0;
+	for(; block >= 0 && block <= (int)Blocks.size(); block++)
+	{
+		if(block == (int)Blocks.size() && Open.Count == 0)
+			break;
+		if((block < (int)Blocks.size() ? Blocks[block].First : Open.First) > to)
+			break;
+		if(!bytes(block, data, start))
+			return false;
+		decode(&data[0], start[1] - start[0], times);
+		decode(&data[start[c]], start[c+1] - start[c], column);
+		for(size_t s=0; s<times.size(); s++)
+		{
+			if(times[s] < from || times[s] > to)
+				continue;
+			value = column[s] / Quantum[kind];
+			summary.Min = (summary.Samples == 0 || value < summary.Min) ? value : summary.Min;
+			summary.Max = (summary.Samples == 0 || value > summary.Max) ? value : summary.Max;
+			sum += value;
+			summary.Samples++;
+		}
+	}
+	if(summary.Samples == 0)
+		return false;
+	summary.Mean = sum / summary.Samples;
+	return true;
+}
+
+/**
+ * @brief Returns the size of the history
+ *
+ * @param void
+ * @return sHistoryStats the size
+ */
+sHistoryStats cHistoryStore::getStats(void)
+{
+	std::lock_guard<std::mutex> guard(Lock);
+	sHistoryStats stats = sHistoryStats();
+	stats.Cells = Cells;
+	stats.Blocks = (int)Blocks.size();
+	stats.Samples = Open.Count;
+	for(size_t b=0; b<Blocks.size(); b++)
+	{
+		stats.Samples += Blocks[b].Count;
+		stats.Spilled += (Blocks[b].Offset >= 0) ? 1 : 0;
+		stats.Resident += Blocks[b].Data.size();
+	}
+	for(int c=0; c<Columns; c++)
+		stats.Resident += Stream[c].size();
+	stats.Encoded = stats.Resident + Spilled;
+	if(Columns > 0)
+		stats.Hours = ((Open.Count > 0) ? Open.Last : Blocks.back().Last) - (Blocks.empty() ? Open.First : Blocks[0].First);
+	stats.Hours /= 3600000;
+	return stats;
+}
+
+/**
+ * @brief Returns the number of cells of the history
+ *
+ * @param void
+ * @return int number of cells, 0 before the first sample
+ */
+int cHistoryStore::getCells(void)
+{
+	std::lock_guard<std::mutex> guard(Lock);
+	return Cells;
+}
@@ -0,0 +1,404 @@
+/**
+ * @file mpcctrl.cpp
+ * @brief Implementation of the model predictive balancing controller
+ *
+ * A rollout uses the cell kernels of cellkernel.hpp with a coarse
+ * step of Horizon / MPCSTEPS. The time to cut off after the horizon
+ * is estimated from the charge the cells hold above the cut off
+ * voltage and the output current at the end of the horizon.
+ *
+ * @author Subir Biswas
+ * @date 19/10/2026
+ * @see mpcctrl.hpp
+ */
+
+#include "../header/mpcctrl.hpp"
+#include <algorithm>	// std::sort
+
+/**
+ * @brief Constructor of the controller
+ *
+ * @param threads number of threads evaluating candidates, including the caller
+ * @return void
+ */
+cMpcController::cMpcController(int threads)
+{
+	Count = 0;
+	Horizon = 60000;
+	Budget = MPCBUDGET;
+	CutOffVoltage = 8;
+	Tolerance = 0.005;
+	Load = 1;
+	Candidates = 0;
+	NextCandidate = 0;
+	SkippedNow = 0;
+	Overruns = 0;
+	Skipped = 0;
+	Generation = 0;
+	Busy = 0;
+	Quit = false;
+	for(int t=1; t<threads; t++)
+		Workers.push_back(new std::thread(&cMpcController::runWorker, this));
+}
+
+/**
+ * @brief Destructor of the controller, ends the workers
+ *
+ * @param void
+ * @return void
+ */
+cMpcController::~cMpcController()
+{
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		Quit = true;
+	}
+	Start.notify_all();
+	for(size_t t=0; t<Workers.size(); t++)
+	{
+		Workers[t]->join();
+		delete Workers[t];
+	}
+}
+
+/**
+ * @brief Sets and precomputes the cell coefficients
+ *
+ * @param n	number of cells
+ * @param sres	series resistance of each cell in Ohms
+ * @param cap	capacity of each cell in AmS
+ * @param grad	gradient of each discharge curve
+ * @return true successfully set
+ * @return false n is out of range or a coefficient is invalid
+ */
+bool cMpcController::setCells(int n, const double* sres, const double* cap, const double* grad)
+{
+	if(n <= 0 || n > MAXCELLS)
+		return false;
+	for(int i=0; i<n; i++)
+	{
+		if(sres[i] <= 0 || cap[i] <= 0 || grad[i] <= 0)
+			return false;
+	}
+	for(int i=0; i<n; i++)
+	{
+		SeriesRes[i] = sres[i];
+		Capacity[i] = cap[i];
+		Gradient[i] = grad[i];
+	}
+	Count = n;
+	return true;
+}
+
+/**
+ * @brief Sets the rollout horizon
+ *
+ * @param horizon horizon in miliseconds
+ * @return true successfully set
+ * false if the input is less than or equals 0
+ */
+bool cMpcController::setHorizon(double horizon)
+{
+	if(horizon <= 0)
+		return false;
+	Horizon = horizon;
+	return true;
+}
+
+/**
+ * @brief Returns the time budget of a decision
+ *
+ * @param void
+ * @return double budget in micro seconds
+ */
+double cMpcController::getBudget(void)
+{
+	return Budget;
+}
+
+/**
+ * @brief Sets the time budget of a decision
+ *
+ * @param budget budget in micro seconds
+ * @return true successfully set
+ * false if the input is less than or equals 0
+ */
+bool cMpcController::setBudget(double budget)
+{
+	if(budget <= 0)
+		return false;
+	Budget = budget;
+	return true;
+}
+
+/**
+ * @brief Sets the cut off voltage
+ *
+ * @param cutoff voltage in Volts
+ * @return void
+ */
+void cMpcController::setCutOffVoltage(double cutoff)
+{
+	CutOffVoltage = cutoff;
+}
+
+/**
+ * @brief Predicts the time to cut off with a switch set
+ *
+ * Works on a copy of the state, the shared coefficients are only read.
+ * @param mask switch set held over the horizon
+ * @return double predicted time to cut off in mS
+ */
+double cMpcController::rollout(uint32_t mask) const
+{
+	double volt[MAXCELLS], dis[MAXCELLS], rem;
+	bool sw[MAXCELLS];
+	double dt = Horizon / MPCSTEPS;
+	double t = 0, vout, ratio, iout, charge, q;
+	int i, s;
+	for(i=0; i<Count; i++)
+	{
+		volt[i] = Voltage[i];
+		dis[i] = Discharged[i];
+		sw[i] = (mask >> i) & 1;
+	}
+	for(s=0; ; s++)
+	{
+		vout = 0;
+		for(i=0; i<Count; i++)
+		{
+			if(sw[i] && (vout == 0 || volt[i] < vout))
+				vout = volt[i];
+		}
+		if(vout < CutOffVoltage || s == MPCSTEPS)
+			break;
+		ratio = cellRatio<double>(Count, volt, SeriesRes, sw);
+		iout = vout / Load;
+		for(i=0; i<Count; i++)
+		{
+			if(sw[i])
+				cellUpdate<double>(dis[i], rem, volt[i], Capacity[i], Gradient[i], 0,
+					cellShare<double>(iout, volt[i], ratio, SeriesRes[i]), dt);
+		}
+		t += dt;
+	}
+	if(vout < CutOffVoltage)
+		return t;
+	//the charge left above cut off drains at the current output current
+	charge = 0;
+	for(i=0; i<Count; i++)
+	{
+		q = (volt[i] - CutOffVoltage) / Gradient[i];
+		q = (q < Capacity[i] - dis[i]) ? q : Capacity[i] - dis[i];
+		charge += (q > 0) ? q : 0;
+	}
+	return t + charge / (vout / Load);
+}
+
+/**
+ * @brief Evaluates candidates till none is left
+ *
+ * Runs on the caller and on every worker. Candidate 0 is always
+ * evaluated, the others are skipped once the deadline is passed.
+ * @param void
+ * @return void
+ */
+void cMpcController::evaluate(void)
+{
+	int c;
+	while((c = NextCandidate.fetch_add(1)) < Candidates)
+	{
+		if(c > 0 && std::chrono::steady_clock::now() > Deadline)
+		{
+			Value[c] = -1;
+			SkippedNow++;
+			continue;
+		}
+		Value[c] = rollout(Mask[c]);
+	}
+}
+
+/**
+ * @brief Worker thread, evaluates the candidates of every decision
+ *
+ * @param void
+ * @return void
+ */
+void cMpcController::runWorker(void)
+{
+	unsigned int seen = 0;
+	while(true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mtx);
+			Start.wait(lock, [&]{ return Quit || Generation != seen; });
+			if(Quit)
+				return;
+			seen = Generation;
+		}
+		evaluate();
+		{
+			std::lock_guard<std::mutex> lock(mtx);
+			if(--Busy == 0)
+				Finished.notify_one();
+		}
+	}
+}
+
+/**
+ * @brief Takes the balancing decision
+ *
+ * @param volts		cell voltages in Volts
+ * @param discharged	discharged capacity of each cell in AmS
+ * @param load		Load in Ohms
+ * @return uint32_t switch mask, 0 if no cells are set or load is invalid
+ */
+uint32_t cMpcController::decide(const double* volts, const double* discharged, double load)
+{
+	if(Count == 0 || load <= 0)
+		return 0;
+	std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+	Deadline = begin + std::chrono::microseconds((long long)Budget);
+	int i, k, top = 0;
+	int order[MAXCELLS];
+	for(i=0; i<Count; i++)
+	{
+		Voltage[i] = volts[i];
+		Discharged[i] = discharged[i];
+		order[i] = i;
+		top = (Voltage[top] < Voltage[i]) ? i : top;
+	}
+	Load = load;
+
+	//candidate 0 is the tolerance band rule
+	Mask[0] = 0;
+	for(i=0; i<Count; i++)
+		Mask[0] |= (Voltage[top] - Voltage[i] <= Tolerance) ? (1u << i) : 0;
+	Candidates = 1;
+	if(Count <= MPCENUMCELLS)
+	{
+		for(uint32_t m=1; m < (1u << Count); m++)
+		{
+			if(((m >> top) & 1) && m != Mask[0])
+				Mask[Candidates++] = m;
+		}
+	}
+	else
+	{
+		std::sort(order, order + Count, [&](int a, int b) { return Voltage[a] > Voltage[b]; });
+		uint32_t m = 0;
+		for(k=0; k<Count; k++)
+		{
+			m |= 1u << order[k];
+			if(m != Mask[0])
+				Mask[Candidates++] = m;
+		}
+	}
+
+	NextCandidate = 0;
+	SkippedNow = 0;
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		Busy = (int)Workers.size();
+		Generation++;
+	}
+	Start.notify_all();
+	evaluate();
+	{
+		std::unique_lock<std::mutex> lock(mtx);
+		Finished.wait(lock, [&]{ return Busy == 0; });
+	}
+
+	int best = 0;
+	for(i=1; i<Candidates; i++)
+		best = (Value[i] > Value[best]) ? i : best;
+	double elapsed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - begin).count();
+	Times.push_back(elapsed);
+	if(elapsed > Budget)
+		Overruns++;
+	Skipped += SkippedNow;
+	return Mask[best];
+}
+
+/**
+ * @brief Runs a scenario till cut off with the controller
+ *
+ * The switches are decided every period and held between the decisions.
+ * @param scenario	the scenario
+ * @param period	decision period in miliseconds
+ * @return double simulated time till cut off in mS, 0 if the cells are invalid
+ */
+double cMpcController::simulate(const cScenario& scenario, double period)
+{
+	cPackModel<double> model;
+	scenario.build(model);
+	double sres[MAXCELLS], cap[MAXCELLS], grad[MAXCELLS], volts[MAXCELLS], dis[MAXCELLS];
+	int n = model.getCount();
+	int i;
+	for(i=0; i<n; i++)
+	{
+		sres[i] = model.getSeriesResistance(i);
+		cap[i] = model.getCapacity(i);
+		grad[i] = model.getGradient(i);
+	}
+	if(!setCells(n, sres, cap, grad))
+		return 0;
+	setCutOffVoltage(scenario.getCutOffVoltage());
+	double next = 0;
+	uint32_t mask = 0;
+	long steps = 0;
+	do
+	{
+		if(model.getElapsedTime() >= next)
+		{
+			for(i=0; i<n; i++)
+			{
+				volts[i] = model.getCurrentVoltage(i);
+				dis[i] = model.getDischargedCapacity(i);
+			}
+			mask = decide(volts, dis, scenario.getLoad());
+			next += period;
+		}
+	}
+	while(model.stepMask(mask, scenario.getLoad(), scenario.getResolution()) && ++steps < MAXSTEPS);
+	return model.getElapsedTime();
+}
+
+/**
+ * @brief Returns the decision time statistics
+ *
+ * @param void
+ * @return sMpcStats the statistics since reset
+ */
+sMpcStats cMpcController::getStats(void)
+{
+	sMpcStats stats;
+	stats.Decisions = Times.size();
+	stats.MeanTime = 0;
+	stats.P99Time = 0;
+	stats.MaxTime = 0;
+	stats.Overruns = Overruns;
+	stats.Skipped = Skipped;
+	if(Times.empty())
+		return stats;
+	std::vector<double> sorted(Times);
+	std::sort(sorted.begin(), sorted.end());
+	for(size_t t=0; t<sorted.size(); t++)
+		stats.MeanTime += sorted[t] / sorted.size();
+	stats.P99Time = sorted[(sorted.size() * 99) / 100];
+	stats.MaxTime = sorted.back();
+	return stats;
+}
+
+/**
+ * @brief Clears the decision time statistics
+ *
+ * @param void
+ * @return void
+ */
+void cMpcController::resetStats(void)
+{
+	Times.clear();
+	Overruns = 0;
+	Skipped = 0;
+}
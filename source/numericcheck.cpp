@@ -0,0 +1,146 @@
+/**
+ * @file numericcheck.cpp
+ * @brief Implementation of the numeric backend validation
+ *
+ * Every backend is stepped in lock step with the double reference
+ * till both of them reach the cut off voltage.
+ *
+ * @author Subir Biswas
+ * @date 19/10/2026
+ * @see numericcheck.hpp
+ */
+
+#include "../header/numericcheck.hpp"
+#include <math.h>	// fabs
+
+/**
+ * @brief Constructor of the numeric check
+ *
+ * @param void
+ * @return void
+ */
+cNumericCheck::cNumericCheck()
+{
+	for(int b=0; b<BACKENDS; b++)
+	{
+		Result[b].Name = "";
+		Result[b].RunTime = 0;
+		Result[b].MaxVoltageError = 0;
+		Result[b].MaxCapacityError = 0;
+		Result[b].SwitchMismatches = 0;
+	}
+}
+
+/**
+ * @brief Copies the parameters of a cell
+ *
+ * @param cell the cell to add
+ * @return true successfully added
+ * @return false MAXCELLS cells are already added
+ */
+bool cNumericCheck::addCell(cSingleBatt* cell)
+{
+	return Scenario.addCell(cell);
+}
+
+/**
+ * @brief Runs one backend against the double reference
+ *
+ * @param backend	index of the result
+ * @param name		name of the numeric type
+ * @param load		Load in Ohms
+ * @param resolution	The interval of a step in miliseconds
+ * @return void
+ */
+template<typename T>
+void cNumericCheck::compare(int backend, const char* name, double load, double resolution)
+{
+	cPackModel<double> reference;
+	cPackModel<T> model;
+	sBackendResult& result = Result[backend];
+	int i;
+	double diff;
+	int count = Scenario.getCount();
+	Scenario.build(reference);
+	Scenario.build(model);
+	result.Name = name;
+	result.RunTime = 0;
+	result.MaxVoltageError = 0;
+	result.MaxCapacityError = 0;
+	result.SwitchMismatches = 0;
+
+	bool referenceRunning = true;
+	bool modelRunning = true;
+	while(referenceRunning || modelRunning)
+	{
+		if(referenceRunning)
+			referenceRunning = reference.step(load, resolution);
+		if(modelRunning)
+		{
+			modelRunning = model.step(T(load), T(resolution));
+			result.RunTime = model.getElapsedTime();
+		}
+		//a backend that never reaches cut off is stopped at twice the reference
+		if(!referenceRunning && model.getElapsedTime() > 2*reference.getElapsedTime())
+			modelRunning = false;
+		if(!referenceRunning || !modelRunning)
+			continue;
+		bool mismatch = false;
+		for(i=0; i<count; i++)
+		{
+			diff = fabs(toDouble(model.getCurrentVoltage(i)) - reference.getCurrentVoltage(i));
+			if(diff > result.MaxVoltageError)
+				result.MaxVoltageError = diff;
+			diff = fabs(toDouble(model.getRemainingCapacityPercentage(i)) - reference.getRemainingCapacityPercentage(i));
+			if(diff > result.MaxCapacityError)
+				result.MaxCapacityError = diff;
+			if(model.getSwitchStatus(i) != reference.getSwitchStatus(i))
+				mismatch = true;
+		}
+		if(mismatch)
+			result.SwitchMismatches++;
+	}
+}
+
+/**
+ * @brief Runs a full discharge with every backend
+ *
+ * @param load		Load in Ohms
+ * @param resolution	The interval of a step in miliseconds
+ * @return true successfully ran
+ * @return false no cell is added or the inputs are invalid
+ */
+bool cNumericCheck::run(double load, double resolution)
+{
+	if(Scenario.getCount() == 0 || load <= 0 || resolution <= 0)
+		return false;
+	compare<double>(0, "double", load, resolution);
+	compare<float>(1, "float", load, resolution);
+	compare< cFixed<32> >(2, "Q31.32", load, resolution);
+	compare< cFixed<24> >(3, "Q39.24", load, resolution);
+	return true;
+}
+
+/**
+ * @brief Returns the number of backends compared
+ *
+ * @param void
+ * @return int number of backends
+ */
+int cNumericCheck::getBackendCount(void)
+{
+	return BACKENDS;
+}
+
+/**
+ * @brief Returns the result of a backend
+ *
+ * @param backend index of the backend, 0 is the double reference
+ * @return sBackendResult the result of the last run
+ */
+sBackendResult cNumericCheck::getResult(int backend)
+{
+	if(backend < 0 || backend >= BACKENDS)
+		backend = 0;
+	return Result[backend];
+}
@@ -0,0 +1,385 @@
+/**
+ * @file packtopology.cpp
+ * @brief Implementation of the series-parallel battery pack
+ *
+ * Every simulation tick is done in three phases. First each worker
+ * balances its own modules, then the leader shares the load current
+ * between the strings, then each worker discharges its own modules
+ * with the current of their string. The phases are joined by a barrier.
+ *
+ * @author Subir Biswas
+ * @date 19/10/2026
+ * @see packtopology.hpp
+ */
+
+#include "../header/packtopology.hpp"
+#include <thread>	// std::thread
+#include <vector>	// std::vector
+
+/**
+ * @brief Constructor of a barrier
+ *
+ * @param participants number of threads that has to reach the barrier
+ * @return void
+ */
+cBarrier::cBarrier(int participants)
+	: Waiting(0), Generation(0)
+{
+	Participants = participants;
+	Spins = (participants <= (int)std::thread::hardware_concurrency()) ? BARRIERSPINS : 0;
+}
+
+/**
+ * @brief Waits untill all the participants reached the barrier
+ *
+ * The last arriving thread opens the barrier for everyone.
+ * The barrier can be used again right after it opens.
+ *
+ * @param void
+ * @return void
+ */
+void cBarrier::wait(void)
+{
+	unsigned long generation = Generation.load(std::memory_order_acquire);
+	if(Waiting.fetch_add(1, std::memory_order_acq_rel) + 1 == Participants)
+	{
+		//reset before the release, a thread passing the new generation may arrive again at once
+		Waiting.store(0, std::memory_order_relaxed);
+		Generation.fetch_add(1, std::memory_order_release);
+		return;
+	}
+	int spins = 0;
+	while(Generation.load(std::memory_order_acquire) == generation)
+	{
+		if(++spins > Spins)
+			std::this_thread::yield();
+	}
+}
+
+/**
+ * @brief Constructor of a pack object
+ *
+ * Creates an empty pack. Use build() to create the cells and modules.
+ * @param void
+ * @return void
+ */
+cPack::cPack()
+{
+	Series = 0;
+	Parallel = 0;
+	Strings = 0;
+	Threads = std::thread::hardware_concurrency();
+	if(Threads < 1)
+		Threads = 1;
+	Cells = (cSingleBatt*)0;
+	Modules = (cBattery*)0;
+	StringCurrent = (double*)0;
+	Vout = 0;
+	Iout = 0;
+	ElapsedTime = 0;
+	Exhausted = false;
+}
+
+/**
+ * @brief Destructor of the pack object
+ *
+ * @param void
+ * @return void
+ */
+cPack::~cPack()
+{
+	release();
+}
+
+/**
+ * @brief Frees the cells and modules of the pack
+ *
+ * @param void
+ * @return void
+ */
+void cPack::release(void)
+{
+	delete []Modules;
+	delete []Cells;
+	delete []StringCurrent;
+	Modules = (cBattery*)0;
+	Cells = (cSingleBatt*)0;
+	StringCurrent = (double*)0;
+	Series = 0;
+	Parallel = 0;
+	Strings = 0;
+}
+
+/**
+ * @brief Builds the topology of the pack
+ *
+ * Creates series x parallel x strings cells with default values
+ * and adds them to their modules.
+ *
+ * @param series	number of modules in a string
+ * @param parallel	number of cells in a module
+ * @param strings	number of strings in parallel
+ * @return true successfully built the pack
+ * @return false invalid topology
+ */
+bool cPack::build(int series, int parallel, int strings)
+{
+	if(series < 1 || strings < 1 || parallel < 1 || parallel > MAXCELLS)
+		return false;
+	release();
+	Series = series;
+	Parallel = parallel;
+	Strings = strings;
+	Cells = new cSingleBatt[series * parallel * strings];
+	Modules = new cBattery[series * strings];
+	StringCurrent = new double[strings];
+	for(int m=0; m<series*strings; m++)
+	{
+		for(int c=0; c<parallel; c++)
+			Modules[m].addCell(&Cells[m*parallel + c]);
+	}
+	return true;
+}
+
+/**
+ * @brief Returns a cell of the pack
+ *
+ * @param string	index of the string
+ * @param module	index of the module in the string
+ * @param cell		index of the cell in the module
+ * @return cSingleBatt* the cell, NULL if the index is out of range
+ */
+cSingleBatt* cPack::getCell(int string, int module, int cell)
+{
+	if(string < 0 || string >= Strings || module < 0 || module >= Series || cell < 0 || cell >= Parallel)
+		return (cSingleBatt*)0;
+	return &Cells[(string*Series + module)*Parallel + cell];
+}
+
+/**
+ * @brief Returns a module of the pack
+ *
+ * @param string	index of the string
+ * @param module	index of the module in the string
+ * @return cBattery* the module, NULL if the index is out of range
+ */
+cBattery* cPack::getModule(int string, int module)
+{
+	if(string < 0 || string >= Strings || module < 0 || module >= Series)
+		return (cBattery*)0;
+	return &Modules[string*Series + module];
+}
+
+/**
+ * @brief Sets the number of threads stepping the modules
+ *
+ * @param threads number of threads including the calling one
+ * @return true successfully set
+ * false if the input is less than 1
+ */
+bool cPack::setThreads(int threads)
+{
+	if(threads < 1)
+		return false;
+	Threads = threads;
+	return true;
+}
+
+/**
+ * @brief Shares the load current between the strings
+ *
+ * Voltage of a string is the sum of its module voltages and its
+ * resistance is the sum of the module resistances. The strings are
+ * combined like the cells of a module: the output current is shared
+ * in the ratio of voltage over resistance.
+ *
+ * @param load Load connected to the pack in Ohms
+ * @return void
+ */
+void cPack::share(double load)
+{
+	double ratio = 0;
+	double conductance = 0;
+	double volt, res;
+	for(int s=0; s<Strings; s++)
+	{
+		volt = 0;
+		res = 0;
+		for(int m=0; m<Series; m++)
+		{
+			volt += Modules[s*Series + m].getVout();
+			res += Modules[s*Series + m].getResistance();
+		}
+		StringCurrent[s] = (res > 0) ? volt/res : 0;
+		ratio += StringCurrent[s];
+		conductance += (res > 0) ? 1/res : 0;
+	}
+	Vout = (conductance > 0) ? ratio/conductance : 0;
+	Iout = Vout / load;
+	for(int s=0; s<Strings; s++)
+		StringCurrent[s] = (ratio > 0) ? Iout*StringCurrent[s]/ratio : 0;
+}
+
+/**
+ * @brief Steps a range of modules untill the pack is exhausted
+ *
+ * @param first		index of the first module of the worker
+ * @param last		index after the last module of the worker
+ * @param resolution	interval of a step in miliseconds
+ * @param maxSteps	maximum number of steps, 0 for no limit
+ * @param barrier	barrier joining the workers
+ * @param load		load connected to the pack in Ohms
+ * @param leader	true for the worker that shares the current
+ * @return void
+ */
+void cPack::worker(int first, int last, double resolution, long maxSteps, cBarrier* barrier, double load, bool leader)
+{
+	long steps = 0;
+	int m;
+	while(true)
+	{
+		for(m=first; m<last; m++)
+			Modules[m].balance();
+		barrier->wait();
+		if(leader)
+		{
+			share(load);
+			if(Vout < getCutOffVoltage() || (maxSteps > 0 && steps >= maxSteps))
+				Exhausted = true;
+			else
+				ElapsedTime += resolution;
+		}
+		barrier->wait();
+		if(Exhausted)
+			break;
+		for(m=first; m<last; m++)
+			Modules[m].discharge(StringCurrent[m/Series], resolution);
+		steps++;
+	}
+}
+
+/**
+ * @brief Runs the pack with a load untill the cut off voltage
+ *
+ * Headless simulation without any delay. The modules are divided
+ * among the worker threads, the calling thread is one of them.
+ *
+ * @param load		Load to be connected with in Ohms
+ * @param resolution	The interval of a step in miliseconds
+ * @param maxSteps	maximum number of steps, 0 for no limit
+ * @return double simulated time in miliseconds, negative if the pack can not run
+ */
+double cPack::simulate(double load, double resolution, long maxSteps)
+{
+	int modules = Series * Strings;
+	int m, t;
+	if(modules == 0 || load <= 0 || resolution <= 0)
+		return -1;
+	for(m=0; m<modules; m++)
+	{
+		if(!Modules[m].attach())
+		{
+			while(--m >= 0)
+				Modules[m].detach();
+			return -1;
+		}
+	}
+
+	int threads = (Threads < modules) ? Threads : modules;
+	cBarrier barrier(threads);
+	std::vector<std::thread> workers;
+	ElapsedTime = 0;
+	Exhausted = false;
+	for(t=1; t<threads; t++)
+		workers.push_back(std::thread(&cPack::worker, this, t*modules/threads, (t+1)*modules/threads,
+			resolution, maxSteps, &barrier, load, false));
+	worker(0, modules/threads, resolution, maxSteps, &barrier, load, true);
+	for(t=0; t<(int)workers.size(); t++)
+		workers[t].join();
+
+	for(m=0; m<modules; m++)
+		Modules[m].detach();
+	return ElapsedTime;
+}
+
+/**
+ * @brief Returns the number of modules in a string
+ *
+ * @param void
+ * @return int number of modules
+ */
+int cPack::getSeriesCount(void)
+{
+	return Series;
+}
+
+/**
+ * @brief Returns the number of cells in a module
+ *
+ * @param void
+ * @return int number of cells
+ */
+int cPack::getParallelCount(void)
+{
+	return Parallel;
+}
+
+/**
+ * @brief Returns the number of parallel strings
+ *
+ * @param void
+ * @return int number of strings
+ */
+int cPack::getStringCount(void)
+{
+	return Strings;
+}
+
+/**
+ * @brief Returns the output voltage of the pack
+ *
+ * @param void
+ * @return double voltage in Volts
+ */
+double cPack::getVout(void)
+{
+	return Vout;
+}
+
+/**
+ * @brief Returns the output current of the pack
+ *
+ * @param void
+ * @return double current in Ampere
+ */
+double cPack::getIout(void)
+{
+	return Iout;
+}
+
+/**
+ * @brief Returns the simulated time of the last run
+ *
+ * @param void
+ * @return double time in miliseconds
+ */
+double cPack::getElapsedTime(void)
+{
+	return ElapsedTime;
+}
+
+/**
+ * @brief Returns the cut off voltage of the pack
+ *
+ * A string is cut off when the sum of its module cut off
+ * voltages is reached.
+ *
+ * @param void
+ * @return double voltage in Volts
+ */
+double cPack::getCutOffVoltage(void)
+{
+	if(Modules == (cBattery*)0)
+		return 0;
+	return Series * Modules[0].getCutOffVoltage();
+}
@@ -11,6 +11,8 @@
 #include <iostream>
 #include <iomanip>
 #include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
 
 /**
  * @brief Constructor of the cparser object
@@ -34,26 +36,41 @@ cprocessIP::cprocessIP()
  */
 char cprocessIP::getInput(void)
 {
-	char* buffer = new char[100];
-	size_t len = 100;
+	char* buffer = (char*)0;
+	size_t len = 0;
 	std::cout<<"Mybatsim>> ";
 	NumberofParam = 0;
 	command[0] = '\0';
 	key[0] = '\0';
 	
-	len = getline(&buffer,&len, stdin);
-	//std::cout <<len <<"\n";
-	if(len <= 0)
+	if(getline(&buffer,&len, stdin) <= 0)
+	{
+		free(buffer);
 		return false;
-	
-	NumberofParam = sscanf(buffer,"%s%s%lf%lf%lf",command,key,&value[0],&value[1],&value[2]);
+	}
+	char result = parseInput(buffer);
+	free(buffer);
+	return result;
+}
+
+/**
+ * @brief Parses an input line
+ * 
+ * fills the command, key and values from a line, used for the
+ * terminal input and for the requests of the control server
+ * 
+ * @param const char* line the input line
+ * @return char true if the line holds at least a command
+ * and false if it is empty
+ */
+char cprocessIP::parseInput(const char* line)
+{
+	NumberofParam = 0;
+	command[0] = '\0';
+	key[0] = '\0';
+	NumberofParam = sscanf(line,"%19s%19s%lf%lf%lf",command,key,&value[0],&value[1],&value[2]);
 	if(NumberofParam < 1)
 		return false;
-	//std::cout <<NumberofParam << "\n";
-	//std::cout <<command <<" " <<key <<" " <<value[0] <<" " <<value[1] <<" " <<value[2] <<"\n";
-
-	delete []buffer;
-	
 	return true;
 }
 
@@ -0,0 +1,292 @@
+/**
+ * @file resultcache.cpp
+ * @brief Implementation of the on disk cache of run results
+ *
+ * Entry layout: CACHEMAGIC, the length of the key and the key, the
+ * number of values and the values, the length of the trace and the
+ * trace, then the FNV-1a hash of all the bytes before it, the numbers
+ * as uint32_t and uint64_t of the machine.
+ *
+ * @author Subir Biswas
+ * @date 19/10/2026
+ * @see resultcache.hpp
+ */
+
+#include "../header/resultcache.hpp"
+#include <stdio.h>	// FILE, snprintf, rename
+#include <string.h>	// memcpy
+#include <unistd.h>	// getpid, gethostname, fsync
+#include <sys/stat.h>	// mkdir
+#include <errno.h>	// errno
+
+/**
+ * @brief Constructor of the cache, closed
+ *
+ * @param void
+ * @return void
+ */
+cResultCache::cResultCache()
+	: Hits(0), Misses(0), Written(0)
+{
+}
+
+/**
+ * @brief Opens a cache directory, it is created if missing
+ *
+ * @param dir the directory
+ * @return true successfully opened
+ * @return false the directory can not be created
+ */
+bool cResultCache::open(const char* dir)
+{
+	if(dir == (const char*)0 || *dir == 0)
+		return false;
+	if(mkdir(dir, 0755) != 0 && errno != EEXIST)
+		return false;
+	struct stat info;
+	if(stat(dir, &info) != 0 || !S_ISDIR(info.st_mode))
+		return false;
+	Dir = dir;
+	return true;
+}
+
+/**
+ * @brief Tells if the cache is open
+ *
+ * @param void
+ * @return bool true if open
+ */
+bool cResultCache::isOpen(void)
+{
+	return !Dir.empty();
+}
+
+/**
+ * @brief Returns the directory of the cache
+ *
+ * @param void
+ * @return const char* the directory, empty if closed
+ */
+const char* cResultCache::getDir(void)
+{
+	return Dir.c_str();
+}
+
+/**
+ * @brief Returns the canonical key of a run
+ *
+ * Every input of the run in a fixed order, the doubles as hexadecimal
+ * floats so equal inputs give equal keys and different inputs differ.
+ * @param scenario	the cells, the load, the resolution and the cut off voltage
+ * @param policy	name of the balancing policy
+ * @return std::string the key
+ */
+std::string cResultCache::key(const cScenario& scenario, const char* policy)
+{
+	char field[64];
+	std::string text;
+	snprintf(field, sizeof(field), "version %d\npolicy %s\n", CACHEVERSION, policy);
+	text = field;
+	//+0.0 for -0.0, both run the same
+	snprintf(field, sizeof(field), "load %a\nresolution %a\ncutoff %a\ncells %d\n", scenario.getLoad() + 0.0,
+		scenario.getResolution() + 0.0, scenario.getCutOffVoltage() + 0.0, scenario.getCount());
+	text += field;
+	for(int i=0; i<scenario.getCount(); i++)
+	{
+		snprintf(field, sizeof(field), "cell %a %a", scenario.getInitialVoltage(i) + 0.0, scenario.getSeriesResistance(i) + 0.0);
+		text += field;
+		snprintf(field, sizeof(field), " %a %a %a\n", scenario.getCapacity(i) + 0.0, scenario.getShift(i) + 0.0, scenario.getDrop(i) + 0.0);
+		text += field;
+	}
+	return text;
+}
+
+/**
+ * @brief Returns the 64 bit FNV-1a hash of a key
+ *
+ * @param key the key
+ * @return uint64_t the hash
+ */
+uint64_t cResultCache::hash(const std::string& key)
+{
+	return mix(14695981039346656037ULL, key.data(), key.size());
+}
+
+/**
+ * @brief Continues a 64 bit FNV-1a hash with more bytes
+ *
+ * @param value	the hash so far, 14695981039346656037 to start
+ * @param data	the bytes
+ * @param size	number of bytes
+ * @return uint64_t the hash
+ */
+uint64_t cResultCache::mix(uint64_t value, const void* data, size_t size)
+{
+	const uint8_t* byte = (const uint8_t*)data;
+	for(size_t c=0; c<size; c++)
+	{
+		value ^= byte[c];
+		value *= 1099511628211ULL;
+	}
+	return value;
+}
+
+/**
+ * @brief Returns the path of the entry of a key
+ *
+ * @param key the key
+ * @return std::string <dir>/<hash>.res
+ */
+std::string cResultCache::path(const std::string& key)
+{
+	char name[32];
+	snprintf(name, sizeof(name), "/%016llx.res", (unsigned long long)hash(key));
+	return Dir + name;
+}
+
+/**
+ * @brief Loads the results of a run
+ *
+ * @param key		the key of the run
+ * @param values	the summary values
+ * @param count		number of summary values, as saved
+ * @param trace		the trace, null if not wanted
+ * @return true the run was found
+ * @return false the cache is closed, the run is not cached or the entry does not match
+ */
+bool cResultCache::load(const std::string& key, double* values, int count, std::vector<uint8_t>* trace)
+{
+	if(!isOpen() || count < 0 || count > CACHEVALUES)
+		return false;
+	FILE* file = fopen(path(key).c_str(), "rb");
+	std::vector<uint8_t> entry;
+	uint32_t magic = 0, length = 0, stored = 0;
+	uint64_t size = 0, check = 0;
+	size_t at = 0, head = sizeof(magic) + sizeof(length) + key.size() + sizeof(stored) + count * sizeof(double);
+	bool found = false;
+	if(file != (FILE*)0)
+	{
+		//the whole entry is read and its checksum checked, also when the trace is not wanted
+		long bytes = (fseek(file, 0, SEEK_END) == 0) ? ftell(file) : -1;
+		if(bytes >= (long)(head + sizeof(size) + sizeof(check)) && fseek(file, 0, SEEK_SET) == 0)
+		{
+			entry.resize(bytes);
+			found = fread(&entry[0], 1, bytes, file) == (size_t)bytes;
+		}
+		fclose(file);
+	}
+	if(found)
+	{
+		memcpy(&check, &entry[entry.size() - sizeof(check)], sizeof(check));
+		found = check == mix(14695981039346656037ULL, &entry[0], entry.size() - sizeof(check));
+	}
+	if(found)
+	{
+		memcpy(&magic, &entry[at], sizeof(magic));
+		at += sizeof(magic);
+		memcpy(&length, &entry[at], sizeof(length));
+		at += sizeof(length);
+		found = magic == CACHEMAGIC && length == key.size() && !key.compare(0, length, (const char*)&entry[at], length);
+		at += key.size();
+	}
+	if(found)
+	{
+		memcpy(&stored, &entry[at], sizeof(stored));
+		at += sizeof(stored);
+		if(count > 0)
+			memcpy(values, &entry[at], count * sizeof(double));
+		at += count * sizeof(double);
+		memcpy(&size, &entry[at], sizeof(size));
+		at += sizeof(size);
+		found = stored == (uint32_t)count && size == entry.size() - at - sizeof(check);
+	}
+	if(found && trace != (std::vector<uint8_t>*)0)
+		trace->assign(entry.begin() + at, entry.begin() + at + size);
+	if(found)
+		Hits++;
+	else
+		Misses++;
+	return found;
+}
+
+/**
+ * @brief Saves the results of a run
+ *
+ * @param key		the key of the run
+ * @param values	the summary values
+ * @param count		number of summary values, upto CACHEVALUES
+ * @param trace		the trace, null for none
+ * @return true successfully saved
+ * @return false the cache is closed, count is out of range or the entry can not be written
+ */
+bool cResultCache::save(const std::string& key, const double* values, int count, const std::vector<uint8_t>* trace)
+{
+	if(!isOpen() || count < 0 || count > CACHEVALUES)
+		return false;
+	char host[64] = "", name[128];
+	gethostname(host, sizeof(host) - 1);
+	snprintf(name, sizeof(name), "/.tmp.%s.%d.%lu", host, (int)getpid(), Written++);
+	std::string temporary = Dir + name;
+	FILE* file = fopen(temporary.c_str(), "wb");
+	if(file == (FILE*)0)
+		return false;
+	uint32_t magic = CACHEMAGIC, length = (uint32_t)key.size(), stored = (uint32_t)count;
+	uint64_t size = (trace != (std::vector<uint8_t>*)0) ? trace->size() : 0;
+	uint64_t check = 14695981039346656037ULL;
+	check = mix(check, &magic, sizeof(magic));
+	check = mix(check, &length, sizeof(length));
+	check = mix(check, key.data(), length);
+	check = mix(check, &stored, sizeof(stored));
+	check = mix(check, values, count * sizeof(double));
+	check = mix(check, &size, sizeof(size));
+	if(size > 0)
+		check = mix(check, &(*trace)[0], size);
+	bool written = fwrite(&magic, sizeof(magic), 1, file) == 1 && fwrite(&length, sizeof(length), 1, file) == 1
+		&& fwrite(key.data(), 1, length, file) == length && fwrite(&stored, sizeof(stored), 1, file) == 1
+		&& fwrite(values, sizeof(double), count, file) == (size_t)count && fwrite(&size, sizeof(size), 1, file) == 1
+		&& (size == 0 || fwrite(&(*trace)[0], 1, size, file) == size) && fwrite(&check, sizeof(check), 1, file) == 1
+		&& fflush(file) == 0 && fsync(fileno(file)) == 0;
+	written = fclose(file) == 0 && written;
+	//the entry is on the disk before its rename makes it visible, an entry torn
+	//or zero filled all the same fails its checksum and is a miss
+	if(!written || rename(temporary.c_str(), path(key).c_str()) != 0)
+	{
+		remove(temporary.c_str());
+		return false;
+	}
+	return true;
+}
+
+/**
+ * @brief Returns the number of loads that found their run
+ *
+ * @param void
+ * @return unsigned long hits since the last reset
+ */
+unsigned long cResultCache::getHits(void)
+{
+	return Hits;
+}
+
+/**
+ * @brief Returns the number of loads that did not find their run
+ *
+ * @param void
+ * @return unsigned long misses since the last reset
+ */
+unsigned long cResultCache::getMisses(void)
+{
+	return Misses;
+}
+
+/**
+ * @brief Clears the hit and miss counters
+ *
+ * @param void
+ * @return void
+ */
+void cResultCache::resetCounts(void)
+{
+	Hits = 0;
+	Misses = 0;
+}
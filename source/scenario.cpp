@@ -0,0 +1,222 @@
+/**
+ * @file scenario.cpp
+ * @brief Implementation of the simulation scenario
+ *
+ * @author Subir Biswas
+ * @date 19/10/2026
+ * @see scenario.hpp
+ */
+
+#include "../header/scenario.hpp"
+
+/**
+ * @brief Constructor of a scenario
+ *
+ * Creates an empty scenario with the default load,
+ * resolution and cut off voltage of the simulator.
+ * @param void
+ * @return void
+ */
+cScenario::cScenario()
+{
+	Count = 0;
+	Load = 10;
+	Resolution = 10;
+	CutOffVoltage = 8;
+}
+
+/**
+ * @brief Copies the parameters of a cell
+ *
+ * @param cell the cell to add
+ * @return true successfully added
+ * @return false MAXCELLS cells are already added
+ */
+bool cScenario::addCell(cSingleBatt* cell)
+{
+	return addCell(cell->getInitialVoltage(), cell->getSeriesResistance(), cell->getCapacity(),
+		cell->getShift(), cell->getDrop());
+}
+
+/**
+ * @brief Adds a cell from its parameters
+ *
+ * @param initv	initial voltage in Volts
+ * @param sres	series resistance in Ohms
+ * @param cap	capacity in mAH
+ * @param shift	first gradient change in %
+ * @param drop	voltage drop at shift in %
+ * @return true successfully added
+ * @return false MAXCELLS cells are already added or a parameter is invalid
+ */
+bool cScenario::addCell(double initv, double sres, double cap, double shift, double drop)
+{
+	if(Count >= MAXCELLS || sres <= 0 || cap <= 0 || shift == drop)
+		return false;
+	InitialVoltage[Count] = initv;
+	SeriesResistance[Count] = sres;
+	Capacity[Count] = cap;
+	Shift[Count] = shift;
+	Drop[Count] = drop;
+	Count++;
+	return true;
+}
+
+/**
+ * @brief Changes the voltage and resistance of a cell
+ *
+ * @param cell	index of the cell
+ * @param initv	initial voltage in Volts
+ * @param sres	series resistance in Ohms
+ * @return true successfully changed
+ * @return false index out of range or resistance is invalid
+ */
+bool cScenario::setCell(int cell, double initv, double sres)
+{
+	if(cell < 0 || cell >= Count || sres <= 0)
+		return false;
+	InitialVoltage[cell] = initv;
+	SeriesResistance[cell] = sres;
+	return true;
+}
+
+/**
+ * @brief Sets the load
+ *
+ * @param load load in Ohms
+ * @return true successfully set
+ * false if the input is less than or equals 0
+ */
+bool cScenario::setLoad(double load)
+{
+	if(load <= 0)
+		return false;
+	Load = load;
+	return true;
+}
+
+/**
+ * @brief Sets the resolution
+ *
+ * @param resolution interval of a step in milisecond
+ * @return true successfully set
+ * false if the input is less than or equals 0
+ */
+bool cScenario::setResolution(double resolution)
+{
+	if(resolution <= 0)
+		return false;
+	Resolution = resolution;
+	return true;
+}
+
+/**
+ * @brief Sets the cut off voltage
+ *
+ * @param cutoff voltage in Volts
+ * @return true successfully set
+ */
+bool cScenario::setCutOffVoltage(double cutoff)
+{
+	CutOffVoltage = cutoff;
+	return true;
+}
+
+/**
+ * @brief Returns the number of cells
+ *
+ * @param void
+ * @return int number of cells
+ */
+int cScenario::getCount(void) const
+{
+	return Count;
+}
+
+/**
+ * @brief Returns the initial voltage of a cell
+ *
+ * @param cell index of the cell
+ * @return double voltage in Volts
+ */
+double cScenario::getInitialVoltage(int cell) const
+{
+	return InitialVoltage[cell];
+}
+
+/**
+ * @brief Returns the series resistance of a cell
+ *
+ * @param cell index of the cell
+ * @return double resistance in Ohms
+ */
+double cScenario::getSeriesResistance(int cell) const
+{
+	return SeriesResistance[cell];
+}
+
+/**
+ * @brief Returns the capacity of a cell
+ *
+ * @param cell index of the cell
+ * @return double capacity in mAH
+ */
+double cScenario::getCapacity(int cell) const
+{
+	return Capacity[cell];
+}
+
+/**
+ * @brief Returns the shift of the discharge curve of a cell
+ *
+ * @param cell index of the cell
+ * @return double shift in %
+ */
+double cScenario::getShift(int cell) const
+{
+	return Shift[cell];
+}
+
+/**
+ * @brief Returns the drop of the discharge curve of a cell
+ *
+ * @param cell index of the cell
+ * @return double drop in %
+ */
+double cScenario::getDrop(int cell) const
+{
+	return Drop[cell];
+}
+
+/**
+ * @brief Returns the load
+ *
+ * @param void
+ * @return double load in Ohms
+ */
+double cScenario::getLoad(void) const
+{
+	return Load;
+}
+
+/**
+ * @brief Returns the resolution
+ *
+ * @param void
+ * @return double interval of a step in milisecond
+ */
+double cScenario::getResolution(void) const
+{
+	return Resolution;
+}
+
+/**
+ * @brief Returns the cut off voltage
+ *
+ * @param void
+ * @return double voltage in Volts
+ */
+double cScenario::getCutOffVoltage(void) const
+{
+	return CutOffVoltage;
+}
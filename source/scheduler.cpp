@@ -0,0 +1,335 @@
+/**
+ * @file scheduler.cpp
+ * @brief Implementation of the cooperative scheduler
+ *
+ * A task is parked in the wheel slot of the tick its next step is
+ * due. Tasks that are due are queued for the workers. A task that
+ * is late runs upto MAXBATCH steps in one resume to catch up, so
+ * a step interval shorter than a wheel tick is still kept in pace.
+ *
+ * @author Subir Biswas
+ * @date 19/10/2026
+ * @see scheduler.hpp
+ */
+
+#include "../header/scheduler.hpp"
+#include <algorithm>	// std::find
+
+/**
+ * @brief Constructor of a battery task
+ *
+ * @param id		Identifier of the task
+ * @param battery	Battery to be simulated
+ * @param load		Load to be connected with in Ohms
+ * @param resolution	The interval between two successive calculation, in miliseconds.
+ * @param speed		Speed of the calculation. reduces the wait time between two calculations.
+ * @return void
+ */
+cPackTask::cPackTask(int id, cBattery* battery, double load, double resolution, double speed)
+{
+	Id = id;
+	Battery = battery;
+	Load = load;
+	Resolution = resolution;
+	Interval = resolution*1000/speed;
+	Due = 0;
+	DueTick = 0;
+	Cancelled = false;
+	Finished = false;
+	Resuming = false;
+	Started = false;
+	Next = (cPackTask*)0;
+}
+
+/**
+ * @brief Continues the run loop of the battery
+ *
+ * Attaches the battery on the first resume. Then runs every step
+ * that is due at the given time. Detaches the battery when it is
+ * exhausted or the task is cancelled.
+ *
+ * @param now Current time in micro seconds
+ * @return true the task has to be resumed again at Due
+ * @return false the run loop has ended
+ */
+bool cPackTask::resume(long long now)
+{
+	int steps = 0;
+	if(!Cancelled && !Started)
+	{
+		if(!Battery->attach())
+		{
+			Finished = true;
+			return false;
+		}
+		Started = true;
+		Due = now;
+	}
+	while(!Cancelled && Due <= now && steps < MAXBATCH)
+	{
+		if(!Battery->step(Load, Resolution))
+			Cancelled = true;
+		Due += Interval;
+		steps++;
+	}
+	if(Cancelled)
+	{
+		if(Started)
+			Battery->detach();
+		Started = false;
+		Finished = true;
+		return false;
+	}
+	return true;
+}
+
+/**
+ * @brief Constructor of the scheduler
+ *
+ * Starts the wheel thread and the worker threads.
+ * @param threads number of worker threads
+ * @return void
+ */
+cScheduler::cScheduler(int threads)
+{
+	for(int i=0; i<WHEELSLOTS; i++)
+		Slot[i] = (cPackTask*)0;
+	Tick = 0;
+	LastId = 0;
+	Quit = false;
+	Epoch = std::chrono::steady_clock::now();
+	if(threads < 1)
+		threads = 1;
+	Wheel = new std::thread(&cScheduler::runWheel, this);
+	for(int i=0; i<threads; i++)
+		Workers.push_back(new std::thread(&cScheduler::runWorker, this));
+}
+
+/**
+ * @brief Destructor of the scheduler
+ *
+ * Stops the threads and cancels the tasks that are still active.
+ * @param void
+ * @return void
+ */
+cScheduler::~cScheduler()
+{
+	mtx.lock();
+	Quit = true;
+	Wakeup.notify_all();
+	mtx.unlock();
+	Wheel->join();
+	delete Wheel;
+	for(unsigned int i=0; i<Workers.size(); i++)
+	{
+		Workers[i]->join();
+		delete Workers[i];
+	}
+	std::map<int, cPackTask*>::iterator it;
+	for(it = Tasks.begin(); it != Tasks.end(); it++)
+	{
+		it->second->Cancelled = true;
+		it->second->resume(now());
+		delete it->second;
+	}
+}
+
+/**
+ * @brief Returns the time since the scheduler started
+ *
+ * @param void
+ * @return long long time in micro seconds
+ */
+long long cScheduler::now(void)
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - Epoch).count();
+}
+
+/**
+ * @brief Parks a task till its next step is due
+ *
+ * Must be called with the scheduler locked. A task that is
+ * already due is queued for the workers.
+ *
+ * @param task The task to park
+ * @return void
+ */
+void cScheduler::park(cPackTask* task)
+{
+	task->DueTick = (long long)(task->Due / WHEELTICK);
+	if(task->DueTick <= Tick)
+	{
+		Ready.push_back(task);
+		Wakeup.notify_one();
+		return;
+	}
+	int slot = task->DueTick % WHEELSLOTS;
+	task->Next = Slot[slot];
+	Slot[slot] = task;
+}
+
+/**
+ * @brief Starts the simulation of a battery
+ *
+ * @param battery	Battery to be simulated
+ * @param load		Load to be connected with in Ohms
+ * @param resolution	The interval between two successive calculation, in miliseconds.
+ * @param speed		Speed of the calculation. reduces the wait time between two calculations.
+ * @return int identifier of the task, 0 if the inputs are invalid
+ */
+int cScheduler::spawn(cBattery* battery, double load, double resolution, double speed)
+{
+	if(battery == (cBattery*)0 || load == 0 || resolution == 0 || speed == 0)
+		return 0;
+	std::lock_guard<std::mutex> lock(mtx);
+	cPackTask* task = new cPackTask(++LastId, battery, load, resolution, speed);
+	Tasks[task->Id] = task;
+	task->Due = now();
+	park(task);
+	return task->Id;
+}
+
+/**
+ * @brief Stops the simulation of a battery
+ *
+ * Ends a parked or queued task right away. A task that is being
+ * resumed is signalled and waited for till it has detached its battery.
+ * @param task identifier of the task
+ * @return true successfully stopped the task
+ * @return false the task is not active
+ */
+bool cScheduler::cancel(int task)
+{
+	std::unique_lock<std::mutex> lock(mtx);
+	std::map<int, cPackTask*>::iterator it = Tasks.find(task);
+	if(it == Tasks.end())
+		return false;
+	cPackTask* pTask = it->second;
+	pTask->Cancelled = true;
+
+	//a task that is not being resumed is ended right here
+	if(!pTask->Resuming)
+	{
+		cPackTask** link = &Slot[pTask->DueTick % WHEELSLOTS];
+		while(*link != (cPackTask*)0 && *link != pTask)
+			link = &(*link)->Next;
+		if(*link == pTask)
+			*link = pTask->Next;
+		else
+		{
+			std::deque<cPackTask*>::iterator queued = std::find(Ready.begin(), Ready.end(), pTask);
+			if(queued != Ready.end())
+				Ready.erase(queued);
+		}
+		pTask->resume(now());
+		Tasks.erase(it);
+		delete pTask;
+		return true;
+	}
+	while(Tasks.count(task))
+		Done.wait(lock);
+	return true;
+}
+
+/**
+ * @brief Determines whether a task is still running
+ *
+ * @param task identifier of the task
+ * @return true the task is active
+ * @return false the task has ended or does not exist
+ */
+bool cScheduler::isActive(int task)
+{
+	std::lock_guard<std::mutex> lock(mtx);
+	return (Tasks.count(task) > 0);
+}
+
+/**
+ * @brief Returns the number of active tasks
+ *
+ * @param void
+ * @return int number of tasks
+ */
+int cScheduler::getActiveCount(void)
+{
+	std::lock_guard<std::mutex> lock(mtx);
+	return Tasks.size();
+}
+
+/**
+ * @brief The wheel thread function
+ *
+ * Advances the wheel one tick at a time and queues the tasks
+ * of the slot that are due. Catches up if it was delayed.
+ *
+ * @param void
+ * @return void
+ */
+void cScheduler::runWheel(void)
+{
+	cPackTask** link;
+	cPackTask* task;
+	while(true)
+	{
+		std::this_thread::sleep_until(Epoch + std::chrono::microseconds((Tick+1)*WHEELTICK));
+		std::lock_guard<std::mutex> lock(mtx);
+		if(Quit)
+			return;
+		while((Tick+1)*WHEELTICK <= now())
+		{
+			Tick++;
+			link = &Slot[Tick % WHEELSLOTS];
+			while(*link != (cPackTask*)0)
+			{
+				task = *link;
+				if(task->DueTick <= Tick)
+				{
+					*link = task->Next;
+					Ready.push_back(task);
+				}
+				else
+					link = &task->Next;
+			}
+		}
+		if(!Ready.empty())
+			Wakeup.notify_all();
+	}
+}
+
+/**
+ * @brief The worker thread function
+ *
+ * Resumes the tasks that are due and parks them again
+ * or frees them when their run loop has ended.
+ *
+ * @param void
+ * @return void
+ */
+void cScheduler::runWorker(void)
+{
+	cPackTask* task;
+	bool resumeAgain;
+	std::unique_lock<std::mutex> lock(mtx);
+	while(true)
+	{
+		while(Ready.empty() && !Quit)
+			Wakeup.wait(lock);
+		if(Quit)
+			return;
+		task = Ready.front();
+		Ready.pop_front();
+		task->Resuming = true;
+		lock.unlock();
+		resumeAgain = task->resume(now());
+		lock.lock();
+		task->Resuming = false;
+		if(resumeAgain)
+			park(task);
+		else
+		{
+			Tasks.erase(task->Id);
+			delete task;
+			Done.notify_all();
+		}
+	}
+}
@@ -0,0 +1,301 @@
+/**
+ * @file sensitivity.cpp
+ * @brief Implementation of the runtime sensitivity analysis
+ *
+ * @author Subir Biswas
+ * @date 19/10/2026
+ * @see sensitivity.hpp
+ */
+
+#include "../header/sensitivity.hpp"
+#include <math.h>	// fabs
+#include <chrono>	// std::chrono::steady_clock
+
+/**
+ * @brief Marks the derivatives a switch decision depends on
+ *
+ * The double model has none.
+ * @param model		the model
+ * @param affected	derivatives the decision depends on, unchanged
+ * @return void
+ */
+static void markDecision(cPackModel<double>& model, bool* affected)
+{
+	(void)model;
+	(void)affected;
+}
+
+/**
+ * @brief Marks the derivatives a switch decision depends on
+ *
+ * The policy decides on the voltages and charges of all the cells, a
+ * parameter that moves any of them moves the decision.
+ * @param model		the model, just switched
+ * @param affected	derivatives the decision depends on, set to true
+ * @return void
+ */
+template<int N>
+static void markDecision(cPackModel< cDual<N> >& model, bool* affected)
+{
+	for(int i=0; i<model.getCount(); i++)
+	{
+		cDual<N> voltage = model.getCurrentVoltage(i);
+		cDual<N> charge = model.getRemainingCapacityPercentage(i);
+		for(int k=0; k<N; k++)
+		{
+			if(voltage.getDerivative(k) != 0 || charge.getDerivative(k) != 0)
+				affected[k] = true;
+		}
+	}
+}
+
+/**
+ * @brief Discharges a model till the output crosses the cut off voltage
+ *
+ * The output voltage of a step is the voltage at its start, so the
+ * crossing lies between the start of the last step above the cut off
+ * and the start of the step below it. When the balancing policy
+ * switches, every change of the switches after the first step is a
+ * switch event.
+ * @param model		the model, charged
+ * @param mask		switches of the cells, 0 to let the balancing policy switch
+ * @param load		Load in Ohms
+ * @param resolution	The interval of a step in miliseconds
+ * @param toggles	switch events counted, null to not count them
+ * @param affected	derivatives the switch events depend on, set to true, null to not mark them
+ * @return T runtime till the crossing in mS
+ */
+template<typename T>
+static T crossing(cPackModel<T>& model, uint32_t mask, double load, double resolution,
+	long* toggles = (long*)0, bool* affected = (bool*)0)
+{
+	T above = T(0), below = T(0);
+	double start = 0, elapsed;
+	long steps = 0;
+	uint32_t last = 0, now;
+	while(steps < MAXSTEPS)
+	{
+		elapsed = model.getElapsedTime();
+		bool running = mask ? model.stepMask(mask, T(load), T(resolution)) : model.step(T(load), T(resolution));
+		below = model.getVout();
+		if(!mask && toggles != (long*)0)
+		{
+			now = 0;
+			for(int i=0; i<model.getCount(); i++)
+				now |= (uint32_t)model.getSwitchStatus(i) << i;
+			if(steps > 0 && now != last)
+			{
+				(*toggles)++;
+				if(affected != (bool*)0)
+					markDecision(model, affected);
+			}
+			last = now;
+		}
+		if(!running)
+			break;
+		above = below;
+		start = elapsed;
+		steps++;
+	}
+	if(steps == 0 || steps >= MAXSTEPS || !(below < above))
+		return T(model.getElapsedTime());
+	return T(start) + T(resolution) * (above - model.getCutOffVoltage()) / (above - below);
+}
+
+/**
+ * @brief Copies a scenario with one parameter of one cell changed
+ *
+ * @param scenario	the scenario to copy
+ * @param cell		index of the cell
+ * @param param		index of the parameter, SENSINITV to SENSDROP
+ * @param delta		change of the parameter
+ * @param changed	the copy
+ * @return true successfully copied
+ * @return false the changed parameter is invalid
+ */
+static bool perturb(const cScenario& scenario, int cell, int param, double delta, cScenario& changed)
+{
+	double value[SENSPARAMS];
+	changed = cScenario();
+	changed.setLoad(scenario.getLoad());
+	changed.setResolution(scenario.getResolution());
+	changed.setCutOffVoltage(scenario.getCutOffVoltage());
+	for(int i=0; i<scenario.getCount(); i++)
+	{
+		value[SENSINITV] = scenario.getInitialVoltage(i);
+		value[SENSSRES] = scenario.getSeriesResistance(i);
+		value[SENSCAP] = scenario.getCapacity(i);
+		value[SENSSHIFT] = scenario.getShift(i);
+		value[SENSDROP] = scenario.getDrop(i);
+		if(i == cell)
+			value[param] += delta;
+		if(!changed.addCell(value[SENSINITV], value[SENSSRES], value[SENSCAP], value[SENSSHIFT], value[SENSDROP]))
+			return false;
+	}
+	return true;
+}
+
+/**
+ * @brief Constructor of the sensitivity analysis
+ *
+ * Default finite difference step 1 % of the parameter, all cells connected.
+ * @param void
+ * @return void
+ */
+cSensitivity::cSensitivity()
+{
+	Step = 0.01;
+	Balanced = false;
+	Mask = 0;
+	Result.Cells = 0;
+	Result.Toggles = 0;
+	Result.RunTime = 0;
+	Result.DualTime = 0;
+	Result.PlainTime = 0;
+	Result.DifferenceTime = 0;
+}
+
+/**
+ * @brief Sets the step of the finite differences
+ *
+ * @param step relative step, fraction of the parameter, above 0 and below 1
+ * @return true successfully set
+ * @return false out of range
+ */
+bool cSensitivity::setStep(double step)
+{
+	if(step <= 0 || step >= 1)
+		return false;
+	Step = step;
+	return true;
+}
+
+/**
+ * @brief Chooses the balanced pack or all cells connected
+ *
+ * @param balanced true to let the balancing policy switch the cells
+ * @return void
+ */
+void cSensitivity::setBalanced(bool balanced)
+{
+	Balanced = balanced;
+}
+
+/**
+ * @brief Runs the discharge once in dual numbers
+ *
+ * Parameter p of cell i is derivative i*SENSPARAMS+p. The capacity is
+ * seeded in mAH, the unit of the scenario, before it is converted.
+ * A derivative is valid unless a switch event depends on its parameter.
+ * @param scenario the cells, the load, the resolution and the cut off voltage
+ * @return void
+ */
+template<int N>
+void cSensitivity::runDual(const cScenario& scenario)
+{
+	typedef cDual<N> tDual;
+	cPackModel<tDual> model;
+	bool affected[N] = {false};
+	int i, p;
+	for(i=0; i<Result.Cells; i++)
+	{
+		int base = i * SENSPARAMS;
+		model.addCell(tDual::variable(scenario.getInitialVoltage(i), base + SENSINITV),
+			tDual::variable(scenario.getSeriesResistance(i), base + SENSSRES),
+			tDual::variable(scenario.getCapacity(i), base + SENSCAP) * tDual(3600),
+			tDual::variable(scenario.getShift(i), base + SENSSHIFT),
+			tDual::variable(scenario.getDrop(i), base + SENSDROP));
+	}
+	model.setCutOffVoltage(tDual(scenario.getCutOffVoltage()));
+	Result.Toggles = 0;
+	tDual runtime = crossing(model, Mask, scenario.getLoad(), scenario.getResolution(), &Result.Toggles, affected);
+	Result.RunTime = runtime.getValue();
+	for(i=0; i<Result.Cells; i++)
+	{
+		for(p=0; p<SENSPARAMS; p++)
+		{
+			Result.Derivative[i][p] = runtime.getDerivative(i * SENSPARAMS + p);
+			Result.Valid[i][p] = !affected[i * SENSPARAMS + p];
+		}
+	}
+}
+
+/**
+ * @brief Computes the derivatives by central finite differences
+ *
+ * A parameter that is 0 is stepped by Step in its own unit.
+ * A derivative whose changed cell is invalid is left at 0.
+ * @param scenario the cells, the load, the resolution and the cut off voltage
+ * @return void
+ */
+void cSensitivity::runDifferences(const cScenario& scenario)
+{
+	cScenario up, down;
+	double h;
+	for(int i=0; i<Result.Cells; i++)
+	{
+		double value[SENSPARAMS] = {scenario.getInitialVoltage(i), scenario.getSeriesResistance(i),
+			scenario.getCapacity(i), scenario.getShift(i), scenario.getDrop(i)};
+		for(int p=0; p<SENSPARAMS; p++)
+		{
+			h = (value[p] != 0) ? fabs(value[p]) * Step : Step;
+			Result.Difference[i][p] = 0;
+			if(!perturb(scenario, i, p, h, up) || !perturb(scenario, i, p, -h, down))
+				continue;
+			cPackModel<double> upper, lower;
+			up.build(upper);
+			down.build(lower);
+			Result.Difference[i][p] = (crossing(upper, Mask, up.getLoad(), up.getResolution())
+				- crossing(lower, Mask, down.getLoad(), down.getResolution())) / (2 * h);
+		}
+	}
+}
+
+/**
+ * @brief Runs the analysis
+ *
+ * Times the dual number run, one double run and the finite differences.
+ * @param scenario the cells, the load, the resolution and the cut off voltage
+ * @return true successfully ran
+ * @return false the scenario has no cells
+ */
+bool cSensitivity::run(const cScenario& scenario)
+{
+	if(scenario.getCount() == 0)
+		return false;
+	Result.Cells = scenario.getCount();
+	Mask = Balanced ? 0 : (uint32_t)((1UL << Result.Cells) - 1);
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	if(Result.Cells <= 4)
+		runDual<4*SENSPARAMS>(scenario);
+	else if(Result.Cells <= 8)
+		runDual<8*SENSPARAMS>(scenario);
+	else
+		runDual<MAXCELLS*SENSPARAMS>(scenario);
+	std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+	Result.DualTime = std::chrono::duration<double>(end - start).count();
+
+	start = std::chrono::steady_clock::now();
+	cPackModel<double> plain;
+	scenario.build(plain);
+	crossing(plain, Mask, scenario.getLoad(), scenario.getResolution());
+	end = std::chrono::steady_clock::now();
+	Result.PlainTime = std::chrono::duration<double>(end - start).count();
+
+	start = std::chrono::steady_clock::now();
+	runDifferences(scenario);
+	end = std::chrono::steady_clock::now();
+	Result.DifferenceTime = std::chrono::duration<double>(end - start).count();
+	return true;
+}
+
+/**
+ * @brief Returns the result of the last run
+ *
+ * @param void
+ * @return const sSensitivityResult& the result
+ */
+const sSensitivityResult& cSensitivity::getResult(void)
+{
+	return Result;
+}
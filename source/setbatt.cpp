@@ -16,6 +16,7 @@
 #include <unistd.h>
 #include <iostream> 
 #include <thread>	// std::thread
+#include <math.h>	// isfinite
 
 /**
  * @brief Constructor of a Battery pack object
@@ -31,10 +32,22 @@ cBattery::cBattery()
 	Iout = 0;
 	ElapsedTime = 0;
 	CutOffVoltage = 8;	//cut-off at 8 volts
-	tollarance = 0.005; //50mV
+	tollarance = 0.005; //5 mV
+	Controller.setTolerance(tollarance);
+	Substeps = 1;
+	Ratio = 0;
+	Attached = false;
+	SinkCount = 0;
+	LiveLoad = 0;
+	Steps = 0;
+	Faults = (cFaultPlan*)0;
+	Sensed = 0;
 	SimState.unlock();
-	for(int i=0; i<3; i++)
-		Switch[i] = false;		
+	for(int i=0; i<MAXCELLS; i++)
+	{
+		Switch[i] = false;
+		SeriesRes[i] = 0;
+	}
 }
 
 /**
@@ -195,14 +208,16 @@ double cBattery::getCutOffVoltage(void)
  *
  * @param cCell* Adcell Pointer to a cell object
  * @return true successfully added the cell
- * @return false battery is running or the battery is full
+ * @return false battery is running, attached or the battery is full
  * @see cCell
  */
 bool cBattery::addCell(cSingleBatt* AdCell)
 {
 	if(IsRunning())
 		return false;
-	if(count>=3)
+	if(Attached)
+		return false;
+	if(count>=MAXCELLS)
 		return false;
 	Cell[count++] = AdCell;
 	return true;
@@ -246,121 +261,776 @@ bool cBattery::ContinueRunning(void)
 }
 
 /**
- * @brief The runner thread function that updates the battery parameters
+ * @brief Returns the number of cells added to the battery
  *
- * Runs untill a stop signal is received or battery voltage goes down cutoff voltage
- * in a specific speed and update the battery parameters and cells in a specific interval.
- * writes to a  log file for each run.
+ * @param void
+ * @return int number of cells
+ */
+int cBattery::getCellCount(void)
+{
+	return count;
+}
+
+/**
+ * @brief Attaches the added cells to the battery for stepping
  *
- * @param double load 		Load to be connected with
- * @param double resolution	The interval between two successive calculatein, in miliseconds.
- * @param double speed		Speed of the calculation. reduces the wait time between two calculations.
- * @return void
+ * Locks every cell to this battery, which also initialises the cells,
+ * and caches their series resistances. A battery must be attached
+ * before it can be balanced or discharged.
+ *
+ * @param void
+ * @return true successfully attached all the cells
+ * @return false already attached or one of the cells is owned by another battery
  */
-void cBattery::runBattery(double load, double resolution, double speed)
+bool cBattery::attach(void)
 {
-	if(resolution == 0 || speed == 0 || load == 0)
-		return;
-	bool status = false;
 	int i;
-	double seriesResistance[count];
-	for(i=0; i<3; i++)
+	if(Attached)
+		return false;
+	for(i=0; i<count; i++)
 	{
-		status = Cell[i]->lock(this);
-		if(!status)
-			return;
-		seriesResistance[i] = Cell[i]->getSeriesResistance();
+		if(!Cell[i]->lock(this))
+		{
+			while(--i >= 0)
+				Cell[i]->unlock(this);
+			return false;
+		}
+		SeriesRes[i] = Cell[i]->getSeriesResistance();
 	}
+	mtx.lock();
+	Ratio = 0;
+	for(i=0; i<count; i++)
+		Switch[i] = false;
+	Controller.reset();
+	mtx.unlock();
+	//changes posted between two runs are dropped
+	sLiveChange stale;
+	while(Changes.pop(stale));
+	LiveLoad = 0;
+	Steps = 0;
+	if(Faults)
+		Faults->rewind();
+	Attached = true;
+	return true;
+}
+
+/**
+ * @brief Detaches the cells from the battery
+ *
+ * @param void
+ * @return true successfully released the cells
+ * @return false the battery was not attached
+ */
+bool cBattery::detach(void)
+{
+	if(!Attached)
+		return false;
+	for(int i=0; i<count; i++)
+		Cell[i]->unlock(this);
+	Attached = false;
+	return true;
+}
 
-	int j, iTemp;
-	double dTemp;
-	double outVolt=0;
-	bool localSwitch[count];
-	int sortedCells[count];
-	double cellVoltages[count];
-	double tempVoltages[count];
-	double sourceCurrent[count];
+/**
+ * @brief Takes the balancing decision for the current cell voltages
+ *
+ * Measures the cell voltages and lets the controller connect the
+ * highest cell and every other cell that is within the tolerance band
+ * of it. The output voltage becomes the voltage of the lowest
+ * connected cell.
+ *
+ * @param void
+ * @return true successfully balanced
+ * @return false the battery is not attached or has no cells
+ */
+bool cBattery::balance(void)
+{
+	int n = count;
+	if(!Attached || n <= 0)
+		return false;
+	int i;
+	double outVolt;
 	double ratio;
+	uint32_t mask;
+	bool localSwitch[MAXCELLS];
+	double cellVoltages[MAXCELLS];
 
-	while(ContinueRunning())
+	for(i=0;i<n;i++)
+		cellVoltages[i] = Cell[i]->getCurrentVoltage();
+	if(Faults)
 	{
-		//std::cout << "Test case1";
-		for(i=0;i<count;i++)
-		{
-			localSwitch[i] = false;
-			sortedCells[i] = i;
-			cellVoltages[i] = Cell[i]->getCurrentVoltage();
-			tempVoltages[i] = cellVoltages[i];
-		}
+		//the controller decides on the readings, the switches that conduct carry the cells
+		Faults->sense(cellVoltages, n);
+		mtx.lock();
+		mask = Controller.decide(cellVoltages, n);
+		Sensed = Controller.getOutputVoltage();
+		mtx.unlock();
+		return balance(mask);
+	}
 
-		for(i=0;i<count;i++)		//rearrange as big to small
+	mtx.lock();
+	mask = Controller.decide(cellVoltages, n);
+	outVolt = Controller.getOutputVoltage();
+	for(i=0;i<n;i++)
+		localSwitch[i] = (mask >> i) & 1;
+	ratio = cellRatio<double>(n, cellVoltages, SeriesRes, localSwitch);
+	Vout = outVolt;
+	Sensed = outVolt;
+	Ratio = ratio;
+	for(i=0;i<n;i++)
+		Switch[i] = localSwitch[i];
+	mtx.unlock();
+	return true;
+}
+
+/**
+ * @brief Sets the switches decided by an external controller
+ *
+ * Used when the balancing decision is taken outside of the battery,
+ * e.g. by a controller process. The output voltage becomes the voltage
+ * of the lowest connected cell.
+ *
+ * @param uint32_t mask	switch states, bit i for cell i
+ * @return true successfully switched
+ * @return false the battery is not attached or the mask connects no cell
+ */
+bool cBattery::balance(uint32_t mask)
+{
+	int n = count;
+	if(Faults)
+		mask = Faults->actuate(mask);
+	if(!Attached || n <= 0 || (mask & (0xFFFFFFFF >> (32 - n))) == 0)
+		return false;
+	int i;
+	double outVolt = 0;
+	bool first = true;
+	bool localSwitch[MAXCELLS];
+	double cellVoltages[MAXCELLS];
+
+	for(i=0;i<n;i++)
+	{
+		cellVoltages[i] = Cell[i]->getCurrentVoltage();
+		localSwitch[i] = (mask >> i) & 1;
+		if(localSwitch[i] && (first || cellVoltages[i] < outVolt))
 		{
-			for(j=i+1;j<count;j++)
-			{
-				if(tempVoltages[i]<tempVoltages[j])
-				{
-					iTemp=sortedCells[i];
-					dTemp=tempVoltages[i];
-					sortedCells[i]=sortedCells[j];
-					tempVoltages[i]=tempVoltages[j];
-					sortedCells[j]=iTemp;
-					tempVoltages[j]=dTemp;
-				}
-			}
+			outVolt = cellVoltages[i];
+			first = false;
 		}
+	}
+	mtx.lock();
+	Vout = outVolt;
+	Ratio = cellRatio<double>(n, cellVoltages, SeriesRes, localSwitch);
+	for(i=0;i<n;i++)
+		Switch[i] = localSwitch[i];
+	mtx.unlock();
+	return true;
+}
 
-		localSwitch[sortedCells[0]] = true;
-		outVolt = cellVoltages[sortedCells[0]];
-		for(i=1;i<count;i++)
+/**
+ * @brief Sources a current from the connected cells
+ *
+ * Shares the output current between the connected cells in the ratio
+ * of their voltage over series resistance and updates the cells.
+ * The switch states of the last balance() are used.
+ *
+ * @param double current	Output current of the battery in Ampere
+ * @param double resolution	For how long the current is sourced, in miliseconds
+ * @return true successfully updated the cells
+ * @return false the battery is not attached or not balanced
+ */
+bool cBattery::discharge(double current, double resolution)
+{
+	if(!Attached || Ratio == 0)
+		return false;
+	double sourceCurrent;
+	mtx.lock();
+	Iout = current;
+	for(int i=0;i<count;i++)
+	{
+		if(Switch[i])
+			sourceCurrent = cellShare<double>(Iout, Cell[i]->getCurrentVoltage(), Ratio, SeriesRes[i]);
+		else
+			sourceCurrent = 0;
+		Cell[i]->update(this,Switch[i],sourceCurrent,resolution);
+	}
+	ElapsedTime += resolution;
+	mtx.unlock();
+	return true;
+}
+
+/**
+ * @brief Runs one simulation step of the battery with a load
+ *
+ * Headless step without any delay: applies the waiting live changes,
+ * balances the cells, connects the output to the load and discharges
+ * the cells for one interval. The interval is the controller step;
+ * with substeps the cell physics runs several times in it while the
+ * switches are held. @see setSubsteps
+ *
+ * @param double load 		Load to be connected with in Ohms
+ * @param double resolution	The interval of the step in miliseconds
+ * @return true the battery is still above the cut off voltage
+ * @return false the battery is exhausted or can not be stepped
+ */
+bool cBattery::step(double load, double resolution)
+{
+	if(!Changes.empty())
+		applyChanges();
+	if(Faults)
+		applyFaults();
+	if(LiveLoad > 0)
+		load = LiveLoad;
+	if(load == 0 || resolution == 0)
+		return false;
+	if(!balance())
+		return false;
+	double outVolt = getVout();
+	if(Substeps > 1)
+		outVolt = hold(load, resolution, Substeps);
+	else
+		discharge(outVolt / load, resolution);
+
+	sSnapshot snapshot;
+	tStepSink sinks[MAXSINKS];
+	void* contexts[MAXSINKS];
+	int i, n;
+	capture(load, snapshot);
+	Published.publish(snapshot);
+	mtx.lock();
+	n = SinkCount;
+	for(i=0;i<n;i++)
+	{
+		sinks[i] = Sink[i];
+		contexts[i] = SinkContext[i];
+	}
+	mtx.unlock();
+	for(i=0;i<n;i++)
+		sinks[i](contexts[i], snapshot);
+	Steps++;
+	//under faults the cut off is decided on what the controller sees
+	if(Faults)
+		return (Sensed >= CutOffVoltage);
+	return (outVolt >= CutOffVoltage);
+}
+
+/**
+ * @brief Discharges the cells in substeps with the switches held
+ *
+ * The physics between two controller decisions. Before every substep
+ * the output voltage follows the lowest connected cell and the current
+ * is shared again, but the switches stay as the last balance() set
+ * them. The loop does not allocate and visits only the connected cells.
+ *
+ * @param double load		Load in Ohms
+ * @param double resolution	The interval of the controller step in miliseconds
+ * @param int substeps		Number of substeps in the interval
+ * @return double the lowest output voltage during the interval in Volts
+ */
+double cBattery::hold(double load, double resolution, int substeps)
+{
+	int i, k, c, n = 0;
+	int connected[MAXCELLS];
+	double volts[MAXCELLS];
+	double interval = resolution / substeps;
+	double outVolt, ratio, current = 0;
+
+	mtx.lock();
+	for(i=0;i<count;i++)
+	{
+		if(Switch[i])
+			connected[n++] = i;
+		else
+			Cell[i]->update(this, false, 0, interval);
+		volts[i] = Cell[i]->getCurrentVoltage();
+	}
+	outVolt = Vout;
+	ratio = Ratio;
+	for(k=0;k<substeps;k++)
+	{
+		if(k > 0)
 		{
-			if((cellVoltages[sortedCells[0]] - cellVoltages[sortedCells[i]]) <= tollarance)
+			outVolt = volts[connected[0]];
+			ratio = 0;
+			for(c=0;c<n;c++)
 			{
-				localSwitch[sortedCells[i]] = true;
-				outVolt = cellVoltages[sortedCells[i]];
+				i = connected[c];
+				outVolt = (volts[i] < outVolt) ? volts[i] : outVolt;
+				ratio += volts[i]/SeriesRes[i];
 			}
 		}
-		ratio = 0;
-		for(i=0;i<count;i++)
+		current = outVolt / load;
+		for(c=0;c<n;c++)
 		{
-			if(localSwitch[i])
-				ratio += cellVoltages[i]/seriesResistance[i];
+			i = connected[c];
+			Cell[i]->update(this, true, cellShare<double>(current, volts[i], ratio, SeriesRes[i]), interval);
+			volts[i] = Cell[i]->getCurrentVoltage();
 		}
+		ElapsedTime += interval;
+	}
+	Vout = outVolt;
+	Iout = current;
+	Ratio = ratio;
+	mtx.unlock();
+	return outVolt;
+}
 
-		mtx.lock();
-		Vout = outVolt;
-		Iout = Vout / load;
+/**
+ * @brief Returns the equivalent resistance of the connected cells
+ *
+ * The connected cells are in parallel, so the equivalent
+ * resistance is the reciprocal of the sum of their conductances.
+ *
+ * @param void
+ * @return double resistance in Ohms, 0 if no cell is connected
+ */
+double cBattery::getResistance(void)
+{
+	double conductance = 0;
+	mtx.lock();
+	for(int i=0;i<count;i++)
+	{
+		if(Switch[i])
+			conductance += 1/SeriesRes[i];
+	}
+	mtx.unlock();
+	if(conductance == 0)
+		return 0;
+	return 1/conductance;
+}
 
-		for(i=0;i<count;i++)
-		{
-			if(localSwitch[i])
-				sourceCurrent[i] = (Iout*cellVoltages[i])/(ratio * seriesResistance[i]);
-			else
-				sourceCurrent[i] = 0;
-			Switch[i] = localSwitch[i];
-			Cell[i]->update(this,localSwitch[i],sourceCurrent[i],resolution);
-		}
-		mtx.unlock();
+/**
+ * @brief The runner thread function that updates the battery parameters
+ *
+ * Runs untill a stop signal is received or battery voltage goes down cutoff voltage
+ * in a specific speed and update the battery parameters and cells in a specific interval.
+ * writes to a  log file for each run.
+ *
+ * @param double load 		Load to be connected with
+ * @param double resolution	The interval between two successive calculatein, in miliseconds.
+ * @param double speed		Speed of the calculation. reduces the wait time between two calculations.
+ * @return void
+ */
+void cBattery::runBattery(double load, double resolution, double speed)
+{
+	if(resolution == 0 || speed == 0 || load == 0)
+		return;
+	if(!attach())
+		return;
+
+	while(ContinueRunning())
+	{
+		bool aboveCutOff = step(load, resolution);
 		//sleep for Inteval
 		usleep(resolution*1000/speed);
-		mtx.lock();
-		ElapsedTime += resolution;		
-		mtx.unlock();
 
 		//if total voltage < MIN, break;
-		if(outVolt < CutOffVoltage)
+		if(!aboveCutOff)
 		{
-			for(i = 0; i<count; i++)
-				localSwitch[i] = false;
 			SimState.unlock();
 			std::cout<<"\nBattery exhausted\nSimulation completed\n";
 			std::cout<<"MybatSim >> ";
 		}
 	}
 	
-	for(i =0;i<count;i++)
-		Cell[0]->unlock(this);
+	detach();
 	return;
 }
 
+/**
+ * @brief Sets the hysteresis bands of the balancing
+ *
+ * A disconnected cell is connected when it is within the on band of
+ * the highest cell, a connected cell is disconnected when it falls
+ * beyond the off band.
+ *
+ * @param on	on band in Volts
+ * @param off	off band in Volts, not narrower than the on band
+ * @return true successfully set
+ * @return false battery is running or the bands are invalid
+ */
+bool cBattery::setHysteresis(double on, double off)
+{
+	if(IsRunning() || on < 0)
+		return false;
+	mtx.lock();
+	bool result = Controller.setHysteresis(on, off);
+	mtx.unlock();
+	return result;
+}
 
+/**
+ * @brief Sets the number of physics substeps per controller step
+ *
+ * The balancing decision is taken once per step, like the firmware
+ * sampling at 10 to 100 Hz, and the cell physics runs substeps times
+ * in the step with the switches held. 1 runs the physics once per
+ * decision.
+ *
+ * @param int substeps number of substeps, 1 to MAXSUBSTEPS
+ * @return true successfully set
+ * @return false the battery is running or the number is out of range
+ */
+bool cBattery::setSubsteps(int substeps)
+{
+	if(IsRunning() || substeps < 1 || substeps > MAXSUBSTEPS)
+		return false;
+	mtx.lock();
+	Substeps = substeps;
+	mtx.unlock();
+	return true;
+}
 
+/**
+ * @brief Returns the number of physics substeps per controller step
+ *
+ * @param void
+ * @return int substeps
+ */
+int cBattery::getSubsteps(void)
+{
+	return Substeps;
+}
+
+/**
+ * @brief Sets the minimum dwell times of the switches
+ *
+ * @param on	steps a switch stays on once turned on
+ * @param off	steps a switch stays off once turned off
+ * @return true successfully set
+ * @return false battery is running or a dwell is negative
+ */
+bool cBattery::setDwell(int on, int off)
+{
+	if(IsRunning() || on < 0 || off < 0)
+		return false;
+	mtx.lock();
+	Controller.setDwell(on, off);
+	mtx.unlock();
+	return true;
+}
+
+/**
+ * @brief Returns how often a switch changed state in the current run
+ *
+ * @param cell The cell number
+ * @return unsigned int number of toggles
+ */
+unsigned int cBattery::getToggleCount(int cell)
+{
+	unsigned int result;
+	mtx.lock();
+	result = Controller.getToggles(cell);
+	mtx.unlock();
+	return result;
+}
+
+/**
+ * @brief Returns a bin of the toggle rate histogram of a switch
+ *
+ * The histogram counts windows of 100 steps by the number
+ * of toggles in them. @see cBalanceController
+ *
+ * @param cell	The cell number
+ * @param bin	index of the bin, 0 to CTRLHISTBINS-1
+ * @return unsigned int number of windows in the bin
+ */
+unsigned int cBattery::getToggleHistogram(int cell, int bin)
+{
+	unsigned int result;
+	mtx.lock();
+	result = Controller.getHistogram(cell, bin);
+	mtx.unlock();
+	return result;
+}
+
+/**
+ * @brief Returns the number of balancing decisions in the current run
+ *
+ * @param void
+ * @return unsigned int number of decisions
+ */
+unsigned int cBattery::getDecisionCount(void)
+{
+	unsigned int result;
+	mtx.lock();
+	result = Controller.getDecisions();
+	mtx.unlock();
+	return result;
+}
+
+/**
+ * @brief Publishes a snapshot of the battery and its cells
+ *
+ * Called after every step and after a parameter is changed. Readers
+ * take the snapshot with getSnapshot() without locking the battery.
+ *
+ * @param double load Load connected to the battery in Ohms
+ * @return true successfully published
+ */
+bool cBattery::publish(double load)
+{
+	sSnapshot snapshot;
+	capture(load, snapshot);
+	Published.publish(snapshot);
+	return true;
+}
+
+/**
+ * @brief Takes a snapshot of the battery and its cells
+ *
+ * @param double load		Load connected to the battery in Ohms
+ * @param sSnapshot& snapshot	the state is written here
+ * @return void
+ */
+void cBattery::capture(double load, sSnapshot& snapshot)
+{
+	snapshot = sSnapshot();
+	int i, bin;
+	int n = count;
+	for(i=0;i<n;i++)
+	{
+		snapshot.InitialVoltage[i] = Cell[i]->getInitialVoltage();
+		snapshot.SeriesResistance[i] = Cell[i]->getSeriesResistance();
+		snapshot.Capacity[i] = Cell[i]->getCapacity();
+		snapshot.CurrentVoltage[i] = Cell[i]->getCurrentVoltage();
+		snapshot.SourceCurrent[i] = Cell[i]->getSourceCurrent();
+		snapshot.RemainingCapacity[i] = Cell[i]->getRemainingCapacityPercentage();
+	}
+	mtx.lock();
+	snapshot.Steps = Steps;
+	snapshot.ElapsedTime = ElapsedTime;
+	snapshot.Vout = Vout;
+	snapshot.Iout = Iout;
+	snapshot.CutOffVoltage = CutOffVoltage;
+	snapshot.Decisions = Controller.getDecisions();
+	snapshot.Substeps = Substeps;
+	for(i=0;i<n;i++)
+	{
+		snapshot.Switch[i] = Switch[i];
+		snapshot.Toggles[i] = Controller.getToggles(i);
+		for(bin=0;bin<CTRLHISTBINS;bin++)
+			snapshot.Histogram[i][bin] = Controller.getHistogram(i,bin);
+	}
+	mtx.unlock();
+	snapshot.Load = load;
+	snapshot.Count = n;
+}
+
+/**
+ * @brief Returns the latest published snapshot
+ *
+ * Does not lock the battery or the cells.
+ * @param void
+ * @return sSnapshot the snapshot, Version 0 if none was published
+ */
+sSnapshot cBattery::getSnapshot(void)
+{
+	return Published.read();
+}
+
+/**
+ * @brief Adds a step sink
+ *
+ * The sink is called with the state of the battery after every step.
+ * @param tStepSink sink	the sink function
+ * @param void* context	passed to the sink
+ * @return true successfully added
+ * @return false MAXSINKS sinks are already added
+ */
+bool cBattery::addSink(tStepSink sink, void* context)
+{
+	bool result = false;
+	mtx.lock();
+	if(SinkCount < MAXSINKS)
+	{
+		Sink[SinkCount] = sink;
+		SinkContext[SinkCount] = context;
+		SinkCount++;
+		result = true;
+	}
+	mtx.unlock();
+	return result;
+}
+
+/**
+ * @brief Removes a step sink
+ *
+ * A step already running may still call the sink once.
+ * Stop the battery before destroying the context.
+ * @param tStepSink sink	the sink function
+ * @param void* context	the context it was added with
+ * @return true successfully removed
+ * @return false the sink was not added
+ */
+bool cBattery::removeSink(tStepSink sink, void* context)
+{
+	bool result = false;
+	mtx.lock();
+	for(int i=0;i<SinkCount;i++)
+	{
+		if(Sink[i] == sink && SinkContext[i] == context)
+		{
+			SinkCount--;
+			Sink[i] = Sink[SinkCount];
+			SinkContext[i] = SinkContext[SinkCount];
+			result = true;
+			break;
+		}
+	}
+	mtx.unlock();
+	return result;
+}
+
+/**
+ * @brief Queues a change of the running battery
+ *
+ * The change is applied as a whole at the start of the next step by
+ * the thread stepping the battery, so the step loop takes no lock for
+ * it. Only one thread may post at a time, the thread stepping the
+ * battery uses apply instead.
+ *
+ * @param sLiveChange change the change
+ * @return true successfully queued
+ * @return false the type is unknown, a value is invalid or the queue is full
+ */
+bool cBattery::post(const sLiveChange& change)
+{
+	if(!validChange(change))
+		return false;
+	return Changes.push(change);
+}
+
+/**
+ * @brief Applies a change from the thread stepping the battery
+ *
+ * For step sinks, which run on the thread stepping the battery: the
+ * change is applied at once and holds from the next step on, like a
+ * change posted during the step. It does not pass the queue, so the
+ * thread that posts stays its only producer.
+ *
+ * @param sLiveChange change the change
+ * @return true successfully applied
+ * @return false the type is unknown, a value is invalid or the battery is not attached
+ */
+bool cBattery::apply(const sLiveChange& change)
+{
+	if(!Attached || !validChange(change))
+		return false;
+	sLiveChange applied = change;
+	applyChange(applied);
+	return true;
+}
+
+/**
+ * @brief Takes the oldest applied live change
+ *
+ * Only one thread may take at a time. Changes applied while
+ * LIVEQUEUE changes are not taken are not recorded.
+ *
+ * @param sLiveChange& change the change, with the step it was applied at
+ * @return true a change was taken
+ * @return false no change was applied since the last call
+ */
+bool cBattery::getApplied(sLiveChange& change)
+{
+	return Applied.pop(change);
+}
+
+/**
+ * @brief Checks a live change
+ *
+ * @param sLiveChange change the change
+ * @return true the change is valid
+ * @return false the type is unknown or a value is invalid
+ */
+bool cBattery::validChange(const sLiveChange& change)
+{
+	if(change.Count < 1 || change.Count > MAXCELLS)
+		return false;
+	if(change.Type == LIVELOAD && change.Value[0] <= 0)
+		return false;
+	if(change.Type != LIVELOAD && change.Type != LIVESRES)
+		return false;
+	for(int i=0;i<change.Count;i++)
+	{
+		if(!isfinite(change.Value[i]) || change.Value[i] < 0)
+			return false;
+	}
+	return true;
+}
+
+/**
+ * @brief Applies a live change and records it as applied
+ *
+ * Called by the thread stepping the battery.
+ * @param sLiveChange& change the change, its step is set
+ * @return void
+ */
+void cBattery::applyChange(sLiveChange& change)
+{
+	if(change.Type == LIVELOAD)
+		LiveLoad = change.Value[0];
+	else
+	{
+		for(int i=0;i<change.Count && i<count;i++)
+		{
+			if(change.Value[i] > 0 && Cell[i]->setSeriesResistance(this, change.Value[i]))
+				SeriesRes[i] = change.Value[i];
+		}
+	}
+	change.Step = Steps;
+	Applied.push(change);
+}
+
+/**
+ * @brief Applies the waiting live changes
+ *
+ * Called by the thread stepping the battery at the start of a step.
+ * @param void
+ * @return void
+ */
+void cBattery::applyChanges(void)
+{
+	sLiveChange change;
+	while(Changes.pop(change))
+		applyChange(change);
+}
+
+/**
+ * @brief Sets the faults of the next runs
+ *
+ * The plan is rewound whenever the battery is attached and applied by
+ * step. The battery does not copy the plan, it has to live till the
+ * runs are over.
+ * @param plan the faults, null for none
+ * @return true successfully set
+ * @return false the battery is running
+ */
+bool cBattery::setFaults(cFaultPlan* plan)
+{
+	if(IsRunning() || Attached)
+		return false;
+	Faults = plan;
+	return true;
+}
+
+/**
+ * @brief Activates the faults that are due
+ *
+ * Called by step before the balancing decision. A resistance step is
+ * applied to the cell here, the other faults act through the plan.
+ * @param void
+ * @return void
+ */
+void cBattery::applyFaults(void)
+{
+	sFault fault;
+	while(Faults->next(ElapsedTime, fault))
+	{
+		if(fault.Type != FAULTSRES || fault.Cell >= count)
+			continue;
+		double sres = SeriesRes[fault.Cell] * fault.Value;
+		if(sres > 0 && Cell[fault.Cell]->setSeriesResistance(this, sres))
+			SeriesRes[fault.Cell] = sres;
+	}
+}
@@ -14,40 +14,112 @@
 #include "../header/singlebatt.hpp"
 #include "../header/setbatt.hpp"
 #include "../header/simulation.hpp"
+#include "../header/packtopology.hpp"
+#include "../header/scheduler.hpp"
+#include "../header/numericcheck.hpp"
+#include "../header/tournament.hpp"
+#include "../header/mpcctrl.hpp"
+#include "../header/cycler.hpp"
+#include "../header/socestimator.hpp"
+#include "../header/sensitivity.hpp"
+#include "../header/faultcampaign.hpp"
+#include "../header/ctrlserver.hpp"
+#include "../header/telemwriter.hpp"
+#include "../header/watcher.hpp"
+#include "../header/history.hpp"
+#include "../header/tracepreview.hpp"
+#include "../header/fleet.hpp"
 #include <stdio.h>
 #include <iostream>
 #include <iomanip>
+#include <sstream>
+#include <fstream>
+#include <mutex>
+#include <vector>
+#include <chrono>
 #include <string.h>
 #include <unistd.h>
 
 
-const char* validCommands[] = {"get","set","sim","help","exit",(char*)0};
-const char* validKeys[] = {"initvoltage","seriesres","loadres","cvoltage","cutoff","sourcecurr","remaincap","capacity","start","stop","switch",(char*)0}; 
+const char* validCommands[] = {"get","set","sim","help","exit","watch","unwatch",(char*)0};
+const char* validKeys[] = {"initvoltage","seriesres","loadres","cvoltage","cutoff","sourcecurr","remaincap","capacity","start","stop","switch","validate","hysteresis","dwell","toggles","tournament","mpc","changes","substeps","cycles","soc","sensitivity","faults","history","preview","fleet","pack","scheduler",(char*)0}; 
+
+cBattery battstatus;		///<The battery pack
+cSingleBatt battpack[3];	///<The cells of the battery pack
+cSimulation Simulator;		///<Runs the battery pack
+std::mutex CommandLock;		///<Runs the commands of the terminal and the control server one at a time
+cWatcher* Watcher = (cWatcher*)0;	///<Watches of the terminal, created by main
+cHistoryStore* History = (cHistoryStore*)0;	///<History of the runs, created by main
+cTracePreview* Preview = (cTracePreview*)0;	///<Plotting preview of the runs, created by main
+cResultCache Cache;			///<Cache of headless run results, open with -c
+cFleet Fleet;				///<Packs of the scenario file, loaded with -f
+double FleetTime = 0;			///<Time the scenario file took to load in mS
+cProfilePlayer Player;			///<Plays the load profile of the pack of the scenario file
+std::vector<sLiveChange> Changes;	///<Live changes applied by the running battery, oldest first
 
 /**
  * @brief Shows the help text.
  *
- * @param void
+ * @param out stream to print to
  * @return void
  */
-void showHelp(void)
+void showHelp(std::ostream& out)
 {
-	std::cout<<"\nMYBATSIM \n";
-	std::cout<<"\nNAME\n\tMybatsim - Assignment for Battery Simulation\n";
-	std::cout<<"\nSYNOPSIS\n\tMybatsim\n";
-	std::cout<<"\nDESCRIPTION\n\tMybatsim simulates a baterry pack with three parallel connected cells connected through switches.\
+	out<<"\nMYBATSIM \n";
+	out<<"\nNAME\n\tMybatsim - Assignment for Battery Simulation\n";
+	out<<"\nSYNOPSIS\n\tMybatsim [-s <socket path>] [-m <shared memory name>] [-H <history file>] [-p] [-t <trace file>] [-c <cache dir>] [-f <scenario file>] [-S <threads>]\n";
+	out<<"\nDESCRIPTION\n\tMybatsim simulates a baterry pack with three parallel connected cells connected through switches.\
 			\n\tThe simulator will start a command line interface and accepts command to view and set various parameters.\
-			\n\tGeneric command format is: MybatSim>> <command> <key> <value1> <value2> <value3>\n";
-	std::cout<<"\nCOMMANDS AND KEYWORDS\n\
+			\n\tGeneric command format is: MybatSim>> <command> <key> <value1> <value2> <value3>\
+			\n\tWith -s the same commands are also accepted over a local Unix domain socket, one per line.\
+			\n\tEvery reply ends with a line holding a single '.', 'exit' closes the connection.\
+			\n\tWith -m every step is written to a shared memory ring, see telemetry.hpp and the telemtail tool.\
+			\n\tWith -H every second of simulated time is kept in a compressed history, older blocks spill to the file.\
+			\n\tWith -p the plotting preview of the run is kept, with -t as well and every step is written to the trace file,\
+			\n\tby a thread of its own, and the preview to the file with .preview.csv added.\
+			\n\tThe trace holds the last run only, it is emptied when a run starts.\
+			\n\tWith -c the results of headless runs are cached in the directory and reused by later runs.\
+			\n\tWith -f the first pack of the scenario file, text or compiled by fleetc, sets the load, the resolution, the speed,\
+			\n\tits load profile and, if it has three cells, the cells.\
+			\n\tWith -S the simulator runs on the cooperative scheduler with the number of worker threads instead of a thread of its own.\n";
+	out<<"\nCOMMANDS AND KEYWORDS\n\
 			\n\tset   \tSets a value. Format: MybatSim>> <set> <key> <value1> <value2> <value3>\
 			\n\t      \tUnnecessary options/arguments are ignored. If required value is not provided, by default it takes 0.\
 			\n\t      \tValid keys are: initvoltage, seriesres, and loadres (only loadres have one argument)\
+			\n\t      \thysteresis <on V> <off V> and dwell <on steps> <off steps> configure the switch chatter suppression\
+			\n\t      \tsubsteps <n> runs the cell physics n times per controller step with the switches held\
+			\n\t      \tWhile the simulator runs, seriesres and loadres are queued and applied at the start of the next step\
 			\n\tget   \tReturns a parameter. Format: MybatSim>> <get> <key>\
-			\n\t      \tValid keys are: initvoltage, seriesres, loadres, cvoltage, cutoff, sourcecurr, remaincap, and switch\
+			\n\t      \tValid keys are: initvoltage, seriesres, loadres, cvoltage, cutoff, sourcecurr, remaincap, switch, toggles, substeps and changes\
+			\n\t      \tchanges lists the live changes with the step they were applied at\
+			\n\t      \tWith -H, cvoltage, sourcecurr and remaincap take <time s> for the values at that simulated time,\
+			\n\t      \tor <from s> <to s> for the min, mean and max of each cell over the range. history shows its size\
+			\n\t      \tpreview <lttb> writes the plotting preview of the run, the lowest and highest value of every bucket,\
+			\n\t      \tor one point per bucket if lttb is 1, to the preview file with -t or else to the screen, needs -p or -t\
+			\n\t      \tfleet shows the packs of the scenario file given with -f and how long it took to load\
 			\n\tsim   \tStarts or stops the simulator. Format: MybatSim>> <sim> <start> / <stop>\
+			\n\t      \t<sim> <validate> runs a full discharge with double, float and fixed point kernels and reports their divergence\
+			\n\t      \t<sim> <tournament> <scenarios> ranks the balancing policies by runtime and imbalance over varied cell sets\
+			\n\t      \t<sim> <mpc> <budget us> runs a discharge with the predictive controller at 10 Hz and reports its decision time\
+			\n\t      \t<sim> <cycles> <cycles> <packs> <fine> cycles packs through discharge, rest, charge and rest with aging\
+			\n\t      \tbetween cycles, fast forward unless fine is 1, and reports the runtime fade and the end of life\
+			\n\t      \t<sim> <soc> <cells> <voltage noise mV> <current noise mA> evaluates the state of charge estimator\
+			\n\t      \tstarting at the true charge and starting 10 % off\
+			\n\t      \t<sim> <sensitivity> <step %> <balanced> reports the derivative of the runtime to every cell parameter\
+			\n\t      \tfrom one dual number run, checked against central finite differences with the step, all cells\
+			\n\t      \tconnected unless balanced is 1\
+			\n\t      \t<sim> <faults> <runs> <seed> <resolution ms> runs the configured cells with random open cells, resistance\
+			\n\t      \tsteps, stuck switches and sensor faults and summarises how the balancing reacted\
+			\n\t      \t<sim> <pack> <series> <parallel> <threads> steps a series parallel pack of the configured cells with\
+			\n\t      \t1 upto threads worker threads and reports the time of each\
+			\n\t      \t<sim> <scheduler> <packs> <seconds> <threads> runs packs of the configured cells in real time pace,\
+			\n\t      \ta step of 1 s every 10 ms each, as tasks of the cooperative scheduler and reports the steps done\
+			\n\twatch \tPrints the value of a get key at an interval till unwatched. Format: MybatSim>> <watch> <key> <interval ms>\
+			\n\t      \tThe watches print from a separate thread, the prompt stays usable. Only on the terminal.\
+			\n\tunwatch\tStops the watch of a key, or every watch without a key. Format: MybatSim>> <unwatch> [key]\
 			\n\thelp  \tPrints this help text.\
 			\n\texit  \tExits the simulator. If the simulator is still running, tries to stop it first.\n";
-	std::cout<<"\nDEFAULT VALUES\n\
+	out<<"\nDEFAULT VALUES\n\
 			\n\tInitial voltages  : 12.5 V, 14.1 V, 12.9 V\
 			\n\tSeries resistances: 20 Ohm,  30 Ohm,  40 Ohm\
 			\n\tLoad              : 150 Ohm\
@@ -59,21 +131,1029 @@ void showHelp(void)
 }
 
 /**
- * @brief handle the main operation
+ * @brief Prints the value of a get key from a snapshot
+ *
+ * Used by the get command and by the watches.
+ *
+ * @param key		function number of the get command
+ * @param snapshot	the published state of the battery
+ * @param out		stream to print to
+ * @return bool false if key is not a get key
+ */
+bool printValue(int key, const sSnapshot& snapshot, std::ostream& out)
+{
+	int i = 0;
+	switch(key)
+	{
+		case GETINITV:	
+			out <<"Initiate Battery Voltage in Volts:\n";
+			for(i =0; i<3 ; i++)
+				out <<"Batery " <<i <<": " <<std::fixed <<std::setprecision(3) 
+				<<snapshot.InitialVoltage[i] <<" V.\n";
+		break;
+
+		case GETSERISR:
+			out <<"Series Resistance:\n";
+			for(i =0; i<3 ; i++)
+				out <<"Res " <<i <<": " <<std::fixed <<std::setprecision(3) 
+				<<snapshot.SeriesResistance[i] <<" Ohm.\n";
+		break;
+		case GETLOADR:
+			out <<"Load Resistance in Ohms:\n";
+			out <<snapshot.Load <<" Ohm."<<std::endl;
+		break;
+
+		case GETSUBST:
+			out <<"Physics substeps per controller step:\n";
+			out <<snapshot.Substeps <<"."<<std::endl;
+		break;
+
+		case GETVOLT:
+			out <<"Battery Voltage:\n";
+			for(i =0; i<3 ; i++)
+				out <<"Batery " <<i <<": " <<std::fixed <<std::setprecision(3) 
+				<<snapshot.CurrentVoltage[i] <<" V.\n";
+		break;
+
+		case GETCUTOFF:
+			out <<"Battery Voltage cut off in Volts:\n";
+			out <<snapshot.CutOffVoltage <<" V."<<std::endl;
+		break;
+
+		case GETCAP:
+			out <<"Battery Capacity in mAh:\n";
+			for(i =0; i<3 ; i++)
+				out <<"Capacity " <<i <<": " <<std::fixed <<std::setprecision(3) 
+				<<snapshot.Capacity[i] <<" mAh.\n";
+		break;
+
+		case GETSCURR:
+			out <<"Presently source current through the Battery:\n";
+			for(i =0; i<3 ; i++)
+				out <<"Battery " <<i <<": " <<std::fixed <<std::setprecision(3) 
+				<<snapshot.SourceCurrent[i] <<" A.\n";
+		break;
+
+		case GETRCAP:
+			out <<"Capacity remaining of the battery:\n";
+			for(i =0; i<3 ; i++)
+				out <<"Capacity " <<i <<": " <<std::fixed <<std::setprecision(3) 
+				<<snapshot.RemainingCapacity[i] <<" %\n";
+		break;
+
+		case GETSWTCH:
+			out <<"Switch status:\n";
+			for(i =0; i<3 ; i++)
+			{
+				out <<"Switch " <<i <<": ";
+				if(snapshot.Switch[i])
+					out <<"ON\n";
+				else
+					out <<"OFF\n";
+			}
+		break;
+
+		case GETTOGGL:
+			out <<"Switch toggles in " <<snapshot.Decisions <<" steps, windows of 100 steps by toggles:\n";
+			out <<"           toggles      0      1    2-3    4-7   8-15  16-31  32-63    64+\n";
+			for(i =0; i<3 ; i++)
+			{
+				out <<"Switch " <<i <<": " <<std::setw(10) <<snapshot.Toggles[i];
+				for(int bin =0; bin<CTRLHISTBINS ; bin++)
+					out <<std::setw(7) <<snapshot.Histogram[i][bin];
+				out <<"\n";
+			}
+		break;
+
+		default:
+			return false;
+	}
+	return true;
+}
+
+/**
+ * @brief Runs a watch or unwatch command
+ *
+ * @param inputdata	the validated command
+ * @param out		stream the reply is printed to
+ * @return char false, the commands never exit
+ */
+char watchCommand(cprocessIP& inputdata, std::ostream& out)
+{
+	int Function = inputdata.getFunctionNumber();
+	if(Watcher == (cWatcher*)0)
+	{
+		out <<"Watches are only available on the terminal." <<std::endl;
+		return false;
+	}
+	if(Function >= UNWATCH)
+	{
+		if(inputdata.getLastKey()[0] == '\0')
+			out <<Watcher->unwatchAll() <<" watches stopped." <<std::endl;
+		else if(Watcher->unwatch(Function - UNWATCH))
+			out <<inputdata.getLastKey() <<" is not watched any more." <<std::endl;
+		else
+			out <<inputdata.getLastKey() <<" is not watched." <<std::endl;
+		return false;
+	}
+	if(inputdata.getLastKey()[0] == '\0')
+	{
+		out <<"Insufficient arguments. Please Specify a key and an interval in ms." <<std::endl;
+		return false;
+	}
+	double interval = (inputdata.getParamCount() > 0) ? inputdata.getIPParam(0) : 1000;
+	if(Watcher->watch(Function - WATCH, interval))
+		out <<"Watching " <<inputdata.getLastKey() <<" every " <<interval <<" ms." <<std::endl;
+	else
+		out <<"Can not watch " <<inputdata.getLastKey() <<" every " <<interval <<" ms, valid keys are those of get, the interval is at least "
+		<<WATCHMININTERVAL <<" ms." <<std::endl;
+	if(inputdata.getParamCount() > 1)
+		out <<"Extra values omitted." <<std::endl;
+	return false;
+}
+
+/**
+ * @brief Returns a scenario of the configured cells and load
  *
  * @param void
+ * @return cScenario the scenario
+ */
+cScenario configuredScenario(void)
+{
+	cScenario scenario;
+	scenario.setLoad(Simulator.getLoad());
+	scenario.setResolution(Simulator.getResolution());
+	for(int i =0; i<3 ; i++)
+		scenario.addCell(&battpack[i]);
+	return scenario;
+}
+
+/**
+ * @brief Returns a variant of a scenario with spread cells
+ *
+ * The initial voltages are moved by upto 0.5 V and the series
+ * resistances scaled by 0.5 to 1.5, from a linear congruential
+ * generator so the variants are the same on every run.
+ *
+ * @param scenario	the scenario
+ * @param seed		state of the generator, updated
+ * @return cScenario the variant
+ */
+cScenario spreadScenario(const cScenario& scenario, unsigned int& seed)
+{
+	cScenario variant = scenario;
+	for(int i =0; i<scenario.getCount() ; i++)
+	{
+		seed = seed*1103515245 + 12345;
+		double dv = ((seed >> 16) % 1001) / 1000.0 - 0.5;
+		seed = seed*1103515245 + 12345;
+		double kr = 0.5 + ((seed >> 16) % 1001) / 1000.0;
+		variant.setCell(i, scenario.getInitialVoltage(i) + dv, scenario.getSeriesResistance(i) * kr);
+	}
+	return variant;
+}
+
+/**
+ * @brief Queues a live change of the running battery
+ *
+ * @param change	the change
+ * @param out		stream the reply is printed to
+ * @return bool true if queued
+ */
+bool postChange(const sLiveChange& change, std::ostream& out)
+{
+	if(battstatus.post(change))
+	{
+		out <<"Queued for the next step." <<std::endl;
+		return true;
+	}
+	out <<"Failed, the values must be positive and at most " <<LIVEQUEUE <<" changes can wait." <<std::endl;
+	return false;
+}
+
+/**
+ * @brief Prints the live changes applied so far
+ *
+ * Takes the changes the battery applied since the last call
+ * into the history first.
+ *
+ * @param out stream to print to
+ * @return void
+ */
+void printChanges(std::ostream& out)
+{
+	sLiveChange change;
+	while(battstatus.getApplied(change))
+		Changes.push_back(change);
+	if(Changes.empty())
+	{
+		out <<"No live changes applied." <<std::endl;
+		return;
+	}
+	for(size_t c=0; c<Changes.size(); c++)
+	{
+		out <<"Step " <<std::setw(10) <<Changes[c].Step <<": ";
+		if(Changes[c].Type == LIVELOAD)
+			out <<"loadres " <<Changes[c].Value[0];
+		else
+		{
+			out <<"seriesres";
+			for(int i=0; i<Changes[c].Count; i++)
+				out <<" " <<Changes[c].Value[i];
+		}
+		out <<"\n";
+	}
+}
+
+/**
+ * @brief Prints a column of the history at a time or over a range
+ *
+ * @param kind		HISTVOLTAGE, HISTCURRENT or HISTREMAIN
+ * @param inputdata	the command, <time s> or <from s> <to s>
+ * @param out		stream the reply is printed to
+ * @return void
+ */
+void printHistory(int kind, cprocessIP& inputdata, std::ostream& out)
+{
+	static const char* units[HISTKINDS] = {" V", " A", " %"};
+	double values[MAXCELLS];
+	bool switches[MAXCELLS];
+	int i = 0;
+	if(History == (cHistoryStore*)0)
+	{
+		out <<"No history, start the simulator with -H <history file>." <<std::endl;
+		return;
+	}
+	out <<std::fixed <<std::setprecision(kind == HISTCURRENT ? 6 : 4);
+	if(inputdata.getParamCount() == 1)
+	{
+		double time = inputdata.getIPParam(0);
+		if(!History->at(kind, time * 1000, values, switches))
+		{
+			out <<"No sample at " <<std::setprecision(3) <<time <<" s." <<std::endl;
+			return;
+		}
+		out <<"At " <<std::setprecision(3) <<time <<" s:\n" <<std::setprecision(kind == HISTCURRENT ? 6 : 4);
+		for(i =0; i<History->getCells() ; i++)
+			out <<"Battery " <<i <<": " <<values[i] <<units[kind] <<", switch " <<(switches[i] ? "ON" : "OFF") <<".\n";
+		return;
+	}
+	double from = inputdata.getIPParam(0), to = inputdata.getIPParam(1);
+	out <<"From " <<std::setprecision(3) <<from <<" s to " <<to <<" s, min / mean / max:\n" <<std::setprecision(kind == HISTCURRENT ? 6 : 4);
+	for(i =0; i<History->getCells() ; i++)
+	{
+		sHistoryRange summary;
+		if(!History->range(kind, i, from * 1000, to * 1000, summary))
+		{
+			out <<"No sample in the range." <<std::endl;
+			return;
+		}
+		out <<"Battery " <<i <<": " <<summary.Min <<" / " <<summary.Mean <<" / " <<summary.Max <<units[kind]
+		<<" over " <<summary.Samples <<" samples.\n";
+	}
+	if(inputdata.getParamCount() > 2)
+		out <<"Extra values omitted." <<std::endl;
+}
+
+/**
+ * @brief Runs a validated command
+ *
+ * The get commands only read the published snapshot of the battery.
+ * The other commands publish a new snapshot after they are run.
+ *
+ * @param inputdata	the validated command
+ * @param out		stream the reply is printed to
+ * @return char true if the command asks to exit
+ */
+char execute(cprocessIP& inputdata, std::ostream& out)
+{
+	char exit_loop = false;
+	int Function = inputdata.getFunctionNumber();
+	int i = 0;
+
+	if(Function >= WATCH && Function < INVALIDCMD)
+		return watchCommand(inputdata, out);
+
+	switch(Function)
+	{
+		case GETVOLT:
+		case GETSCURR:
+		case GETRCAP:
+			if(inputdata.getParamCount() > 0)
+			{
+				printHistory((Function == GETVOLT) ? HISTVOLTAGE : (Function == GETSCURR) ? HISTCURRENT : HISTREMAIN, inputdata, out);
+				break;
+			}
+			printValue(Function, battstatus.getSnapshot(), out);
+		break;
+
+		case GETINITV:
+		case GETSERISR:
+		case GETLOADR:
+		case GETCUTOFF:
+		case GETCAP:
+		case GETSWTCH:
+		case GETTOGGL:
+		case GETSUBST:
+			if(inputdata.getParamCount() > 0)
+				out<<"Extra values omitted."<<std::endl;
+			printValue(Function, battstatus.getSnapshot(), out);
+		break;
+
+		case GETHIST:
+			if(inputdata.getParamCount() > 0)
+				out<<"Extra values omitted."<<std::endl;
+			if(History == (cHistoryStore*)0)
+				out <<"No history, start the simulator with -H <history file>." <<std::endl;
+			else
+			{
+				sHistoryStats stats = History->getStats();
+				out <<std::fixed <<std::setprecision(3)
+				<<"History of " <<stats.Cells <<" cells: " <<stats.Samples <<" samples over " <<stats.Hours <<" h, "
+				<<stats.Blocks <<" sealed blocks, " <<stats.Spilled <<" spilled\n"
+				<<stats.Encoded <<" bytes encoded, " <<stats.Resident <<" in memory";
+				if(stats.Hours > 0 && stats.Cells > 0)
+					out <<std::setprecision(1) <<", " <<stats.Encoded / (stats.Hours * stats.Cells) / 1024 <<" kB per cell hour";
+				out <<"." <<std::endl;
+			}
+		break;
+
+		case GETPREV:
+		{
+			bool lttb = (inputdata.getParamCount() > 0) && (inputdata.getIPParam(0) == 1);
+			if(Preview == (cTracePreview*)0)
+			{
+				out <<"No preview, start the simulator with -p or -t <trace file>." <<std::endl;
+				break;
+			}
+			sPreviewStats stats = Preview->getStats();
+			if(stats.Samples == 0)
+			{
+				out <<"No run to preview." <<std::endl;
+				break;
+			}
+			out <<"Preview of " <<stats.Samples <<" steps: " <<stats.Buckets <<" buckets of " <<stats.Width
+			<<" steps per channel, " <<stats.Bytes <<" bytes." <<std::endl;
+			if(*Preview->getPath() == 0)
+				Preview->write(out, lttb);
+			else
+			{
+				std::string name = std::string(Preview->getPath()) + ".preview.csv";
+				std::ofstream file(name.c_str());
+				if(file && Preview->write(file, lttb))
+					out <<"Preview written to " <<name <<", the full trace is " <<Preview->getPath() <<"." <<std::endl;
+				else
+					out <<"Can not write the preview to " <<name <<"." <<std::endl;
+			}
+			if(inputdata.getParamCount() > 1)
+				out <<"Extra values omitted." <<std::endl;
+		}
+		break;
+
+		case GETFLEET:
+			if(inputdata.getParamCount() > 0)
+				out<<"Extra values omitted."<<std::endl;
+			if(Fleet.getPackCount() == 0)
+				out <<"No fleet, start the simulator with -f <scenario file>." <<std::endl;
+			else
+			{
+				const sFleetPack* pack = Fleet.getPack(0);
+				out <<std::fixed <<std::setprecision(2) <<Fleet.getPackCount() <<" packs with " <<Fleet.getCellCount() <<" distinct cells, "
+				<<(Fleet.isMapped() ? "mapped from the binary form" : "parsed from text") <<" in " <<FleetTime <<" ms.\n"
+				<<"The simulator runs pack " <<pack->Name <<": " <<pack->Cells <<" cells, " <<pack->Points <<" profile points." <<std::endl;
+				if(Player.getRejected() > 0)
+					out <<Player.getRejected() <<" profile loads were rejected by the battery." <<std::endl;
+			}
+		break;
+
+		case GETCHNG:
+			if(inputdata.getParamCount() > 0)
+				out<<"Extra values omitted."<<std::endl;
+			printChanges(out);
+		break;
+
+		case SETSRES:
+			if(inputdata.getParamCount() < 3)
+			{
+				out<<"Insufficient arguments. Please Specify series resistance."<<std::endl;
+				break;
+			}
+			if(Simulator.IsRunning())
+			{
+				sLiveChange change;
+				change.Type = LIVESRES;
+				change.Count = 3;
+				for( i=0;i<3;i++)
+					change.Value[i] = inputdata.getIPParam(i);
+				postChange(change, out);
+				if(inputdata.getParamCount() > 3)
+					out<<"Extra values omitted."<<std::endl;
+				break;
+			}
+			out <<"Initiate Series Resistance at:\n";
+			for( i=0;i<inputdata.getParamCount() && i<3;i++)
+			{
+				if(battpack[i].setSeriesResistance(inputdata.getIPParam(i)))
+					out <<i+1<<": Done." <<std::endl;
+				else
+					out <<i+1<<": Failed." <<std::endl;
+			}
+			if(inputdata.getParamCount() > 3)
+				out<<"Extra values omitted."<<std::endl;
+		break;
+
+		case SETLOAD:
+			if(inputdata.getParamCount() < 1)
+			{
+				out<<"Insufficient arguments. Please Specify load resistance."<<std::endl;
+				break;
+			}
+			if(Simulator.IsRunning())
+			{
+				sLiveChange change;
+				change.Type = LIVELOAD;
+				change.Count = 1;
+				change.Value[0] = inputdata.getIPParam(0);
+				//the next runs start with the new load too
+				if(postChange(change, out))
+					Simulator.setLoad(change.Value[0]);
+				if(inputdata.getParamCount() > 1)
+					out<<"Extra values omitted."<<std::endl;
+				break;
+			}
+			out <<"Initiate Load resistance at:\n";
+			if(Simulator.setLoad(inputdata.getIPParam(0)))
+				out <<1 <<": Done." <<std::endl;
+			else
+				out <<1 <<": Failed." <<std::endl;
+			if(inputdata.getParamCount() > 1)
+				out<<"Extra values omitted."<<std::endl;
+		break;
+
+		case SETHYST:
+			if(inputdata.getParamCount() < 2)
+			{
+				out<<"Insufficient arguments. Please Specify on and off band."<<std::endl;
+				break;
+			}
+			if(battstatus.setHysteresis(inputdata.getIPParam(0),inputdata.getIPParam(1)))
+				out <<"Hysteresis: Done." <<std::endl;
+			else
+				out <<"Hysteresis: Failed." <<std::endl;
+			if(inputdata.getParamCount() > 2)
+				out<<"Extra values omitted."<<std::endl;
+		break;
+
+		case SETDWELL:
+			if(inputdata.getParamCount() < 2)
+			{
+				out<<"Insufficient arguments. Please Specify on and off dwell."<<std::endl;
+				break;
+			}
+			if(battstatus.setDwell(inputdata.getIPParam(0),inputdata.getIPParam(1)))
+				out <<"Dwell: Done." <<std::endl;
+			else
+				out <<"Dwell: Failed." <<std::endl;
+			if(inputdata.getParamCount() > 2)
+				out<<"Extra values omitted."<<std::endl;
+		break;
+
+		case SETSUBST:
+			if(inputdata.getParamCount() < 1)
+			{
+				out<<"Insufficient arguments. Please Specify the number of substeps."<<std::endl;
+				break;
+			}
+			if(battstatus.setSubsteps((int)inputdata.getIPParam(0)))
+				out <<"Substeps: Done." <<std::endl;
+			else
+				out <<"Substeps: Failed." <<std::endl;
+			if(inputdata.getParamCount() > 1)
+				out<<"Extra values omitted."<<std::endl;
+		break;
+
+		case SETINTV:
+			if(inputdata.getParamCount() < 3)
+			{
+				out<<"Insufficient arguments. Please Specify battery voltage."<<std::endl;
+				break;
+			}
+			out <<"Initiate Battery Voltage at:\n";
+			for( i=0;i<inputdata.getParamCount() && i<3;i++)
+			{
+				if(battpack[i].setInitialVoltage(inputdata.getIPParam(i)))
+					out <<i+1 <<": Done." <<std::endl;
+				else
+					out <<i+1 <<": Failed." <<std::endl;
+			}
+			if(inputdata.getParamCount() > 3)
+				out<<"Extra values omitted."<<std::endl;
+		break;
+
+		case SIMSTART:
+			if(inputdata.getParamCount() > 0)
+				out <<"Extra parameters omitted." <<std::endl;
+			if(Simulator.start())
+				out <<"Simulation started." <<std::endl;
+			else
+				out <<"Simulation already running." <<std::endl;
+		break;
+
+		case SIMSTOP:
+			if(inputdata.getParamCount() > 0)
+				out <<"Extra parameters omitted." <<std::endl;
+			if(Simulator.stop())
+				out <<"Simulation stopped." <<std::endl;
+			else
+				out <<"Simulation is not running currently." <<std::endl;
+		break;
+
+		case SIMVALID:
+		{
+			if(inputdata.getParamCount() > 0)
+				out <<"Extra parameters omitted." <<std::endl;
+			cNumericCheck check;
+			for(i =0; i<3 ; i++)
+				check.addCell(&battpack[i]);
+			if(!check.run(Simulator.getLoad(),Simulator.getResolution()))
+			{
+				out <<"Validation failed." <<std::endl;
+				break;
+			}
+			out <<"Backend   Runtime(s)  Max dV(V)     Max dCap(%)   Switch mismatches\n";
+			for(i =0; i<check.getBackendCount() ; i++)
+			{
+				sBackendResult result = check.getResult(i);
+				out <<std::left <<std::setw(10) <<result.Name <<std::right
+				<<std::fixed <<std::setprecision(2) <<std::setw(10) <<result.RunTime/1000 <<"  "
+				<<std::scientific <<std::setprecision(3) <<std::setw(12) <<result.MaxVoltageError <<"  "
+				<<std::setw(12) <<result.MaxCapacityError <<"  "
+				<<result.SwitchMismatches <<"\n";
+			}
+			out <<std::fixed;
+		}
+		break;
+
+		case SIMTOURN:
+		{
+			int scenarios = (inputdata.getParamCount() > 0) ? (int)inputdata.getIPParam(0) : 16;
+			if(scenarios < 1 || scenarios > 100000)
+			{
+				out <<"Invalid number of scenarios." <<std::endl;
+				break;
+			}
+			if(inputdata.getParamCount() > 1)
+				out <<"Extra parameters omitted." <<std::endl;
+			//the configured cells and variants with spread voltages and resistances
+			cTournament tournament;
+			cScenario scenario = configuredScenario();
+			unsigned int seed = 1;
+			tournament.addScenario(scenario);
+			for(int s =1; s<scenarios ; s++)
+				tournament.addScenario(spreadScenario(scenario, seed));
+			unsigned int threads = std::thread::hardware_concurrency();
+			if(Cache.isOpen())
+				tournament.setCache(&Cache);
+			Cache.resetCounts();
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			if(!tournament.run(threads ? threads : 1))
+			{
+				out <<"Tournament failed." <<std::endl;
+				break;
+			}
+			double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			out <<"Rank  Policy      Runtime(s)  Imbalance(%)  Worst(%)  Wins\n";
+			for(i =0; i<tournament.getPolicyCount() ; i++)
+			{
+				sPolicyResult result = tournament.getResult(i);
+				out <<std::left <<std::setw(6) <<i+1 <<std::setw(10) <<result.Name <<std::right
+				<<std::fixed <<std::setprecision(2) <<std::setw(12) <<result.MeanRunTime/1000
+				<<std::setw(14) <<result.MeanImbalance <<std::setw(10) <<result.WorstImbalance
+				<<std::setw(6) <<result.Wins <<"\n";
+			}
+			out <<scenarios*tournament.getPolicyCount() <<" runs in " <<std::setprecision(2) <<wall <<" s";
+			if(Cache.isOpen())
+				out <<", " <<Cache.getHits() <<" from the cache in " <<Cache.getDir();
+			out <<std::endl;
+		}
+		break;
+
+		case SIMMPC:
+		{
+			unsigned int threads = std::thread::hardware_concurrency();
+			cMpcController mpc(threads ? threads : 1);
+			if(inputdata.getParamCount() > 0 && !mpc.setBudget(inputdata.getIPParam(0)))
+			{
+				out <<"Invalid budget." <<std::endl;
+				break;
+			}
+			if(inputdata.getParamCount() > 1)
+				out <<"Extra values omitted." <<std::endl;
+			cScenario scenario;
+			scenario.setLoad(Simulator.getLoad());
+			scenario.setResolution(Simulator.getResolution());
+			for(i =0; i<3 ; i++)
+				scenario.addCell(&battpack[i]);
+			cPackModel<double> greedy;
+			scenario.build(greedy);
+			while(greedy.step(scenario.getLoad(), scenario.getResolution()));
+			double runtime = mpc.simulate(scenario, MPCPERIOD);
+			sMpcStats stats = mpc.getStats();
+			out <<std::fixed <<std::setprecision(2)
+			<<"Runtime to cut off: mpc " <<runtime/1000 <<" s, tolerance band " <<greedy.getElapsedTime()/1000 <<" s\n"
+			<<"Decisions: " <<stats.Decisions <<", time mean " <<stats.MeanTime <<" us, p99 " <<stats.P99Time
+			<<" us, max " <<stats.MaxTime <<" us\n"
+			<<"Over the budget of " <<mpc.getBudget() <<" us: " <<stats.Overruns <<" decisions, " <<stats.Skipped <<" candidates skipped\n"
+			<<"Deployable at 10 Hz: " <<((stats.MaxTime <= mpc.getBudget() && stats.Overruns == 0) ? "yes" : "no") <<std::endl;
+		}
+		break;
+
+		case SIMCYCL:
+		{
+			int cycles = (inputdata.getParamCount() > 0) ? (int)inputdata.getIPParam(0) : 3000;
+			int packs = (inputdata.getParamCount() > 1) ? (int)inputdata.getIPParam(1) : 64;
+			cCycler cycler;
+			cycler.setFastForward(!(inputdata.getParamCount() > 2 && inputdata.getIPParam(2) != 0));
+			if(cycles < 1 || cycles > MAXCYCLES || packs < 1 || packs > 100000)
+			{
+				out <<"Invalid number of cycles or packs." <<std::endl;
+				break;
+			}
+			//the configured cells and variants with spread voltages and resistances
+			cScenario scenario = configuredScenario();
+			unsigned int seed = 1;
+			cycler.addPack(scenario);
+			for(int p =1; p<packs ; p++)
+				cycler.addPack(spreadScenario(scenario, seed));
+			unsigned int threads = std::thread::hardware_concurrency();
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			if(!cycler.run(cycles, threads ? threads : 1))
+			{
+				out <<"Cycling failed." <<std::endl;
+				break;
+			}
+			double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			const sCycleResult& first = cycler.getResult(0);
+			out <<"Configured pack, runtime to cut off by cycle:\n";
+			for(int c =0; c<cycles ; c++)
+			{
+				if(c == 0 || (c+1) % 500 == 0 || c == cycles-1)
+					out <<"Cycle " <<std::setw(6) <<c+1 <<": " <<std::fixed <<std::setprecision(2) <<std::setw(10) <<first.RunTime[c]/1000 <<" s\n";
+			}
+			int reached = 0;
+			double life = 0, capacity = 0, resistance = 0, worst = 0;
+			for(int p =0; p<packs ; p++)
+			{
+				const sCycleResult& result = cycler.getResult(p);
+				capacity += result.Capacity / packs;
+				resistance += result.Resistance / packs;
+				if(result.EndOfLife > 0)
+				{
+					reached++;
+					life += result.EndOfLife;
+					worst = (worst == 0 || result.EndOfLife < worst) ? result.EndOfLife : worst;
+				}
+			}
+			out <<packs <<" packs, " <<cycles <<" cycles each, " <<(first.SimulatedTime/3600000) <<" h simulated per pack in " <<wall <<" s\n"
+			<<"Capacity left " <<capacity <<" %, series resistance " <<resistance <<" % of new\n"
+			<<"End of life (runtime below " <<ENDOFLIFE <<" % of the first cycle): " <<reached <<" packs";
+			if(reached > 0)
+				out <<", mean cycle " <<life/reached <<", earliest cycle " <<worst;
+			out <<std::endl;
+			if(inputdata.getParamCount() > 3)
+				out <<"Extra values omitted." <<std::endl;
+		}
+		break;
+
+		case SIMSOC:
+		{
+			int cells = (inputdata.getParamCount() > 0) ? (int)inputdata.getIPParam(0) : 4096;
+			sSensorNoise noise;
+			sSocAccuracy accuracy, exact;
+			noise.Voltage = ((inputdata.getParamCount() > 1) ? inputdata.getIPParam(1) : 10) / 1000;
+			noise.Current = ((inputdata.getParamCount() > 2) ? inputdata.getIPParam(2) : 10) / 1000;
+			//the current sensor is biased by half its noise
+			noise.Bias = noise.Current / 2;
+			//once from the true charge for the sensors alone, once off by SOCOFFSET for a BMS that starts unsure
+			if(cells < 1 || cells > 1000000 || !evaluateSoc(configuredScenario(), cells, noise, 0, exact)
+				|| !evaluateSoc(configuredScenario(), cells, noise, SOCOFFSET, accuracy))
+			{
+				out <<"Invalid number of cells or noise." <<std::endl;
+				break;
+			}
+			out <<std::fixed <<std::setprecision(3)
+			<<accuracy.Cells <<" cells, " <<accuracy.Updates <<" updates at 1 Hz, voltage noise " <<noise.Voltage*1000
+			<<" mV, current noise " <<noise.Current*1000 <<" mA, bias " <<noise.Bias*1000 <<" mA\n"
+			<<"Estimator        Start off(%)  RMS error(%)  Max error(%)\n"
+			<<"Kalman filter   " <<std::setw(14) <<exact.Offset*100 <<std::setw(14) <<exact.FilterRms <<std::setw(14) <<exact.FilterMax <<"  (max after settling)\n"
+			<<"Coulomb counting" <<std::setw(14) <<exact.Offset*100 <<std::setw(14) <<exact.CountRms <<std::setw(14) <<exact.CountMax <<"\n"
+			<<"Kalman filter   " <<std::setw(14) <<accuracy.Offset*100 <<std::setw(14) <<accuracy.FilterRms <<std::setw(14) <<accuracy.FilterMax <<"  (max after settling)\n"
+			<<"Coulomb counting" <<std::setw(14) <<accuracy.Offset*100 <<std::setw(14) <<accuracy.CountRms <<std::setw(14) <<accuracy.CountMax <<"\n"
+			<<"Update cost per cell:";
+			const char* kernels[] = {"portable", "avx2", "avx512"};
+			for(i =KERNEL_PORTABLE; i<=KERNEL_AVX512 ; i++)
+			{
+				if(accuracy.Cost[i] > 0)
+					out <<" " <<kernels[i] <<" " <<std::setprecision(2) <<accuracy.Cost[i] <<" ns";
+			}
+			out <<std::endl;
+			if(inputdata.getParamCount() > 3)
+				out <<"Extra values omitted." <<std::endl;
+		}
+		break;
+
+		case SIMSENS:
+		{
+			double step = ((inputdata.getParamCount() > 0) ? inputdata.getIPParam(0) : 1) / 100;
+			cSensitivity sensitivity;
+			sensitivity.setBalanced(inputdata.getParamCount() > 1 && inputdata.getIPParam(1) != 0);
+			if(!sensitivity.setStep(step) || !sensitivity.run(configuredScenario()))
+			{
+				out <<"Invalid finite difference step." <<std::endl;
+				break;
+			}
+			const sSensitivityResult& result = sensitivity.getResult();
+			const char* names[SENSPARAMS] = {"initvoltage(V)", "seriesres(Ohm)", "capacity(mAH)", "shift(%)", "drop(%)"};
+			out <<std::fixed <<std::setprecision(2)
+			<<"Runtime till cut off " <<result.RunTime/1000 <<" s, derivatives in s per unit\n"
+			<<"Cell  Parameter            Dual number   Finite diff\n";
+			for(i =0; i<result.Cells ; i++)
+			{
+				for(int p =0; p<SENSPARAMS ; p++)
+				{
+					out <<std::setw(4) <<i+1 <<"  " <<std::left <<std::setw(16) <<names[p] <<std::right <<std::setprecision(4);
+					if(result.Valid[i][p])
+						out <<std::setw(16) <<result.Derivative[i][p]/1000;
+					else
+						out <<std::setw(16) <<"invalid";
+					out <<std::setw(14) <<result.Difference[i][p]/1000 <<"\n";
+				}
+			}
+			out <<"Shift and drop cancel in the gradient of the linear discharge curve, their derivatives are 0.\n";
+			if(result.Toggles > 0)
+				out <<result.Toggles <<" switch events in the dual number run, a derivative is invalid if a switch decision"
+				<<" depends on its parameter, use the finite difference.\n";
+			out <<std::setprecision(3) <<"Dual number run " <<result.DualTime <<" s, one double run " <<result.PlainTime
+			<<" s, " <<2*SENSPARAMS*result.Cells <<" finite difference runs " <<result.DifferenceTime <<" s\n"
+			<<"The dual number run costs " <<std::setprecision(1)
+			<<((result.PlainTime > 0) ? result.DualTime/result.PlainTime : 0) <<" double runs." <<std::endl;
+			if(inputdata.getParamCount() > 2)
+				out <<"Extra values omitted." <<std::endl;
+		}
+		break;
+
+		case SIMFAULT:
+		{
+			int runs = (inputdata.getParamCount() > 0) ? (int)inputdata.getIPParam(0) : 200;
+			unsigned int seed = (inputdata.getParamCount() > 1) ? (unsigned int)inputdata.getIPParam(1) : 1;
+			double resolution = (inputdata.getParamCount() > 2) ? inputdata.getIPParam(2) : 100;
+			cScenario scenario = configuredScenario();
+			cFaultCampaign campaign;
+			unsigned int threads = std::thread::hardware_concurrency();
+			if(runs < 1 || runs > 100000 || !scenario.setResolution(resolution) || !campaign.setScenario(scenario))
+			{
+				out <<"Invalid number of runs or resolution." <<std::endl;
+				break;
+			}
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			if(!campaign.run(runs, seed, threads ? threads : 1))
+			{
+				out <<"Fault campaign failed." <<std::endl;
+				break;
+			}
+			double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			const sFaultOutcome& reference = campaign.getReference();
+			out <<std::fixed <<std::setprecision(2)
+			<<"Fault free: runtime " <<reference.RunTime/1000 <<" s, over current above";
+			for(i =0; i<scenario.getCount() ; i++)
+				out <<" " <<campaign.getCurrentLimit(i)*1000 <<" mA";
+			out <<" (" <<OVERCURRENT <<" times the highest current of each cell)\n"
+			<<"Fault          Runs  Missed cut off  Over current  Never stopped  Runtime(%)  Worst below(s)\n";
+			for(i =FAULTOPEN; i<=FAULTTYPES ; i++)
+			{
+				sFaultSummary summary = campaign.getSummary(i);
+				out <<std::left <<std::setw(13) <<faultName(i) <<std::right <<std::setw(6) <<summary.Runs
+				<<std::setw(16) <<summary.MissedCutOff <<std::setw(14) <<summary.OverCurrent <<std::setw(15) <<summary.Exhausted
+				<<std::setw(12) <<summary.RunTimeChange <<std::setw(16) <<summary.WorstBelow/1000 <<"\n";
+			}
+			out <<runs <<" runs in " <<wall <<" s, fault free step " <<std::setprecision(0) <<campaign.getStepCost(false)
+			<<" ns without a plan, " <<campaign.getStepCost(true) <<" ns with an empty plan" <<std::endl;
+			if(inputdata.getParamCount() > 3)
+				out <<"Extra values omitted." <<std::endl;
+		}
+		break;
+
+		case SIMPACK:
+		{
+			int series = (inputdata.getParamCount() > 0) ? (int)inputdata.getIPParam(0) : 14;
+			int parallel = (inputdata.getParamCount() > 1) ? (int)inputdata.getIPParam(1) : 4;
+			int threads = (inputdata.getParamCount() > 2) ? (int)inputdata.getIPParam(2) : (int)std::thread::hardware_concurrency();
+			if(series < 1 || series > 1000 || parallel < 1 || parallel > MAXCELLS || threads < 1 || threads > 256)
+			{
+				out <<"Invalid topology or number of threads." <<std::endl;
+				break;
+			}
+			//the configured cells in turn, the load draws the configured current per cell
+			cScenario scenario = configuredScenario();
+			double load = scenario.getLoad() * series * scenario.getCount() / parallel;
+			out <<series <<"S" <<parallel <<"P of the configured cells at " <<std::fixed <<std::setprecision(0) <<load
+			<<" Ohm, " <<PACKSTEPS <<" steps of 1 s on " <<std::thread::hardware_concurrency() <<" cores\n"
+			<<"Threads   Time(s)  Step(us)  Speedup\n";
+			double single = 0;
+			for(int t=1; t<=threads; t=(t < threads && 2*t > threads) ? threads : 2*t)
+			{
+				cPack pack;
+				pack.build(series, parallel, 1);
+				for(int m=0; m<series; m++)
+				{
+					for(int c=0; c<parallel; c++)
+					{
+						cSingleBatt* cell = pack.getCell(0, m, c);
+						cell->setInitialVoltage(scenario.getInitialVoltage(c % scenario.getCount()));
+						cell->setSeriesResistance(scenario.getSeriesResistance(c % scenario.getCount()));
+						cell->setCapacity(scenario.getCapacity(c % scenario.getCount()));
+					}
+				}
+				pack.setThreads(t);
+				std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+				double simulated = pack.simulate(load, 1000, PACKSTEPS);
+				double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+				single = (t == 1) ? wall : single;
+				out <<std::setw(7) <<t <<std::setprecision(3) <<std::setw(10) <<wall <<std::setprecision(1)
+				<<std::setw(10) <<wall * 1e6 / (simulated / 1000 + 1) <<std::setprecision(2) <<std::setw(9) <<single / wall <<"\n";
+			}
+			out <<std::flush;
+		}
+		break;
+
+		case SIMSCHED:
+		{
+			int packs = (inputdata.getParamCount() > 0) ? (int)inputdata.getIPParam(0) : 1000;
+			double seconds = (inputdata.getParamCount() > 1) ? inputdata.getIPParam(1) : 5;
+			int threads = (inputdata.getParamCount() > 2) ? (int)inputdata.getIPParam(2) : (int)std::thread::hardware_concurrency();
+			if(packs < 1 || packs > 100000 || seconds <= 0 || seconds > 600 || threads < 1 || threads > 256)
+			{
+				out <<"Invalid number of packs, seconds or threads." <<std::endl;
+				break;
+			}
+			//every pack a battery of the configured cells, stepped in real time pace as its own task
+			cScenario scenario = configuredScenario();
+			std::vector<cSingleBatt> cells(packs * scenario.getCount());
+			std::vector<cBattery> batteries(packs);
+			std::vector<int> tasks(packs);
+			for(int p=0; p<packs; p++)
+			{
+				for(int c=0; c<scenario.getCount(); c++)
+				{
+					cSingleBatt& cell = cells[p*scenario.getCount() + c];
+					cell.setInitialVoltage(scenario.getInitialVoltage(c));
+					cell.setSeriesResistance(scenario.getSeriesResistance(c));
+					cell.setCapacity(scenario.getCapacity(c));
+					batteries[p].addCell(&cell);
+				}
+			}
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			double wall;
+			{
+				cScheduler scheduler(threads);
+				for(int p=0; p<packs; p++)
+					tasks[p] = scheduler.spawn(&batteries[p], scenario.getLoad(), 1000, SCHEDSPEED);
+				std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+				for(int p=0; p<packs; p++)
+					scheduler.cancel(tasks[p]);
+				wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			}
+			double steps = 0;
+			for(int p=0; p<packs; p++)
+				steps += batteries[p].getElapsedTime() / 1000;
+			double due = packs * wall * SCHEDSPEED;
+			out <<std::fixed <<std::setprecision(0) <<packs <<" packs on " <<threads <<" worker threads and the wheel thread for "
+			<<std::setprecision(2) <<wall <<" s: " <<std::setprecision(0) <<steps <<" of " <<due <<" due steps ("
+			<<std::setprecision(1) <<100 * steps / due <<" %), " <<steps / wall <<" steps per second" <<std::endl;
+		}
+		break;
+
+		case HELP:
+			showHelp(out);
+		break;
+
+		case EXIT:
+			Simulator.stop();
+			out <<"Simualtion Process is aborted" <<std::endl;
+			exit_loop = true;
+		break;
+
+		default:
+			if(Function >= INVALIDCMD)
+				out <<inputdata.getLastCommand() <<" is not a valid Command" <<std::endl;
+			else
+				out <<inputdata.getLastKey() <<" is not a valid key for " 							<<inputdata.getLastCommand() <<" command" <<std::endl;
+		break;
+	}
+	if(Function >= SETINTV)
+		battstatus.publish(Simulator.getLoad());
+	return exit_loop;
+}
+
+/**
+ * @brief Runs a request of the control server
+ *
+ * @param line	the request
+ * @param reply	the reply text is appended to it
+ * @param query	true to answer get commands only
+ * @return bool true if the request was answered
+ * @see tCommandHandler
+ */
+bool serveCommand(const char* line, std::string& reply, bool query)
+{
+	cprocessIP request;
+	std::ostringstream out;
+	bool valid = request.parseInput(line) && request.ValidateInput(validCommands,validKeys);
+	if(query)
+	{
+		//get commands only read the snapshot, they need no lock. get changes takes
+		//the applied changes into the history and get preview writes the preview
+		//file, they run under the lock
+		if(!valid || request.getFunctionNumber() >= SETINTV || request.getFunctionNumber() == GETCHNG
+			|| request.getFunctionNumber() == GETPREV)
+			return false;
+		execute(request, out);
+		reply += out.str();
+		return true;
+	}
+	if(!valid)
+		out <<"Input correctly not recorded." <<std::endl;
+	else if(request.getFunctionNumber() == EXIT)
+		out <<"exit closes the connection, the simulator keeps running." <<std::endl;
+	else if(request.getFunctionNumber() >= WATCH && request.getFunctionNumber() < INVALIDCMD)
+		out <<"Watches are only available on the terminal." <<std::endl;
+	else
+	{
+		std::lock_guard<std::mutex> lock(CommandLock);
+		execute(request, out);
+	}
+	reply += out.str();
+	return true;
+}
+
+/**
+ * @brief handle the main operation
+ *
+ * @param argc number of arguments
+ * @param argv -s <path> also serves the commands on a Unix domain socket,
+ *		-m <name> writes every step into a shared memory telemetry ring,
+ *		-H <file> keeps a compressed history that spills to the file,
+ *		-t <file> writes every step of the last run to the file,
+ *		-c <dir> caches the results of headless runs in the directory,
+ *		-f <file> configures the simulator with the first pack of the scenario file,
+ *		-S <threads> runs the simulator on a cooperative scheduler with the worker threads
  * @return int
  */
-int main (void)
+int main (int argc, char* argv[])
 {
 	cprocessIP inputdata;
-	cBattery battstatus;
-	cSingleBatt battpack[3];
-	cSimulation Simulator;
+	cControlServer Server(serveCommand);
+	cTelemetryWriter Telemetry;
+	cWatcher Watches(&battstatus, printValue, std::cout);
+	cHistoryStore Histories;
+	cTracePreview Previews;
+	const char* socketPath = (const char*)0;
+	const char* telemetryName = (const char*)0;
+	const char* historyName = (const char*)0;
+	const char* traceName = (const char*)0;
+	const char* cacheName = (const char*)0;
+	const char* fleetName = (const char*)0;
+	cScheduler* Tasks = (cScheduler*)0;
+	int taskThreads = 0;
+	bool keepPreview = false;
+	int option;
 
 	char exit_loop = false;
-	int Function = 0;
-	int i = 0;
+
+	while((option = getopt(argc, argv, "s:m:H:pt:c:f:S:")) != -1)
+	{
+		if(option == 's')
+			socketPath = optarg;
+		else if(option == 'm')
+			telemetryName = optarg;
+		else if(option == 'H')
+			historyName = optarg;
+		else if(option == 'p')
+			keepPreview = true;
+		else if(option == 't')
+			traceName = optarg;
+		else if(option == 'c')
+			cacheName = optarg;
+		else if(option == 'f')
+			fleetName = optarg;
+		else if(option == 'S' && atoi(optarg) > 0)
+			taskThreads = atoi(optarg);
+		else
+		{
+			std::cout <<"Usage: " <<argv[0] <<" [-s <socket path>] [-m <shared memory name>] [-H <history file>] [-p] [-t <trace file>] [-c <cache dir>] [-f <scenario file>] [-S <threads>]" <<std::endl;
+			return true;
+		}
+	}
 
 	//battpack[0].setCapacity(2000);		//for 2000 mAh
 	//battpack[1].setCapacity(2600);		//for 2600 mAh
@@ -86,6 +1166,29 @@ int main (void)
 	battpack[0].setSeriesResistance(20);
 	battpack[1].setSeriesResistance(30);
 	battpack[2].setSeriesResistance(40);
+
+	if(fleetName != (const char*)0)
+	{
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		bool loaded = Fleet.load(fleetName) && Fleet.getPackCount() > 0;
+		FleetTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		if(!loaded)
+		{
+			std::cout <<fleetName;
+			if(Fleet.getLine() > 0)
+				std::cout <<":" <<Fleet.getLine();
+			std::cout <<": " <<(*Fleet.getError() == 0 ? "no pack" : Fleet.getError()) <<std::endl;
+			return true;
+		}
+		//the pack of the simulator has three cells, other modules keep the default cells
+		const sFleetCell* cells = Fleet.getCells(0);
+		for(int i=0; i<3 && Fleet.getPack(0)->Cells == 3; i++)
+		{
+			battpack[i].setInitialVoltage(cells[i].InitialVoltage);
+			battpack[i].setSeriesResistance(cells[i].SeriesResistance);
+			battpack[i].setCapacity(cells[i].Capacity);
+		}
+	}
 	
 	battstatus.addCell(&battpack[0]);
 	battstatus.addCell(&battpack[1]);
@@ -95,10 +1198,75 @@ int main (void)
 	Simulator.connect(10); // set load at 150 ohm
 	Simulator.setSpeed(100000);
 	Simulator.setResolution(10);
+	if(Fleet.getPackCount() > 0)
+	{
+		const sFleetPack* pack = Fleet.getPack(0);
+		Simulator.connect(pack->Load);
+		Simulator.setSpeed((int)pack->Speed);
+		Simulator.setResolution(pack->Resolution);
+		Player.setProfile(&battstatus, Fleet.getProfile(0), pack->Points);
+	}
+
+	if(taskThreads > 0)
+	{
+		Tasks = new cScheduler(taskThreads);
+		Simulator.useScheduler(Tasks);
+	}
+	battstatus.publish(Simulator.getLoad());
+	Watcher = &Watches;
 
 	std::system("clear");
 	std::cout <<"Assignment for Battery Simulation\n";
-	
+	if(socketPath != (const char*)0)
+	{
+		if(Server.start(socketPath))
+			std::cout <<"Serving commands on " <<socketPath <<"\n";
+		else
+			std::cout <<"Can not serve commands on " <<socketPath <<"\n";
+	}
+	if(telemetryName != (const char*)0)
+	{
+		if(Telemetry.open(telemetryName, TELESLOTS) && battstatus.addSink(cTelemetryWriter::sink, &Telemetry))
+			std::cout <<"Publishing telemetry to " <<telemetryName <<"\n";
+		else
+			std::cout <<"Can not publish telemetry to " <<telemetryName <<"\n";
+	}
+	if(historyName != (const char*)0)
+	{
+		if(Histories.open(historyName, HISTINTERVAL) && battstatus.addSink(cHistoryStore::sink, &Histories))
+		{
+			History = &Histories;
+			std::cout <<"Keeping the history in " <<historyName <<"\n";
+		}
+		else
+			std::cout <<"Can not keep the history in " <<historyName <<"\n";
+	}
+	if(traceName != (const char*)0)
+	{
+		if(Previews.open(traceName))
+		{
+			keepPreview = true;
+			std::cout <<"Writing the trace to " <<traceName <<"\n";
+		}
+		else
+			std::cout <<"Can not write the trace to " <<traceName <<"\n";
+	}
+	if(cacheName != (const char*)0)
+	{
+		if(Cache.open(cacheName))
+			std::cout <<"Caching run results in " <<cacheName <<"\n";
+		else
+			std::cout <<"Can not cache run results in " <<cacheName <<"\n";
+	}
+	//the preview takes a lock every step, so it is only kept when asked for
+	if(keepPreview && battstatus.addSink(cTracePreview::sink, &Previews))
+		Preview = &Previews;
+	if(fleetName != (const char*)0)
+	{
+		if(Fleet.getPack(0)->Points > 0)
+			battstatus.addSink(cProfilePlayer::sink, &Player);
+		std::cout <<"Running pack " <<Fleet.getPack(0)->Name <<" of " <<Fleet.getPackCount() <<" packs in " <<fleetName <<"\n";
+	}
 
 	while(!exit_loop)
 	{
@@ -106,185 +1274,35 @@ int main (void)
 		{
 			if(inputdata.ValidateInput(validCommands,validKeys))
 			{
-				Function = inputdata.getFunctionNumber();
-
-				switch(Function)
-				{
-					case GETINITV:	
-						if(inputdata.getParamCount() > 0)
-							std::cout<<"Extra values omitted."<<std::endl;
-						std::cout <<"Initiate Battery Voltage in Volts:\n";
-						for(i =0; i<3 ; i++)
-							std::cout <<"Batery " <<i <<": " <<std::fixed <<std::setprecision(3) 
-							<<battpack[i].getInitialVoltage() <<" V.\n";
-					break;
-
-					case GETSERISR:
-						if(inputdata.getParamCount() > 0)
-							std::cout<<"Extra values omitted."<<std::endl;
-						std::cout <<"Series Resistance:\n";
-						for(i =0; i<3 ; i++)
-							std::cout <<"Res " <<i <<": " <<std::fixed <<std::setprecision(3) 
-							<<battpack[i].getSeriesResistance() <<" Ohm.\n";
-					break;
-					case GETLOADR:
-						if(inputdata.getParamCount() > 0)
-							std::cout<<"Extra values omitted."<<std::endl;
-						std::cout <<"Load Resistance in Ohms:\n";
-						std::cout <<Simulator.getLoad() <<" Ohm."<<std::endl;
-					break;
-
-					case GETVOLT:
-						if(inputdata.getParamCount() > 0)
-							std::cout<<"Extra values omitted."<<std::endl;
-						std::cout <<"Battery Voltage:\n";
-						for(i =0; i<3 ; i++)
-							std::cout <<"Batery " <<i <<": " <<std::fixed <<std::setprecision(3) 
-							<<battpack[i].getCurrentVoltage() <<" V.\n";
-					break;
-
-					case GETCUTOFF:
-						if(inputdata.getParamCount() > 0)
-							std::cout<<"Extra values omitted."<<std::endl;
-						std::cout <<"Battery Voltage cut off in Volts:\n";
-						std::cout <<battstatus.getCutOffVoltage() <<" V."<<std::endl;
-					break;
-
-					case GETCAP:
-						if(inputdata.getParamCount() > 0)
-							std::cout<<"Extra values omitted."<<std::endl;
-						std::cout <<"Battery Capacity in mAh:\n";
-						for(i =0; i<3 ; i++)
-							std::cout <<"Capacity " <<i <<": " <<std::fixed <<std::setprecision(3) 
-							<<battpack[i].getCapacity() <<" mAh.\n";
-					break;
-
-					case GETSCURR:
-						if(inputdata.getParamCount() > 0)
-							std::cout<<"Extra values omitted."<<std::endl;
-						std::cout <<"Presently source current through the Battery:\n";
-						for(i =0; i<3 ; i++)
-							std::cout <<"Battery " <<i <<": " <<std::fixed <<std::setprecision(3) 
-							<<battpack[i].getSourceCurrent() <<" A.\n";
-					break;
-
-					case GETRCAP:
-						if(inputdata.getParamCount() > 0)
-							std::cout<<"Extra values omitted."<<std::endl;
-						std::cout <<"Capacity remaining of the battery:\n";
-						for(i =0; i<3 ; i++)
-							std::cout <<"Capacity " <<i <<": " <<std::fixed <<std::setprecision(3) 
-							<<battpack[i].getRemainingCapacityPercentage() <<" %\n";
-					break;
-
-					case GETSWTCH:
-						if(inputdata.getParamCount() > 0)
-							std::cout<<"Extra values omitted."<<std::endl;
-						std::cout <<"Switch status:\n";
-						for(i =0; i<3 ; i++)
-						{
-							std::cout <<"Switch " <<i <<": ";
-							if(battstatus.getSwitchStatus(i))
-								std::cout <<"ON\n";
-							else
-								std::cout <<"OFF\n";
-						}
-					break;
-
-					case SETSRES:
-						if(inputdata.getParamCount() < 3)
-						{
-							std::cout<<"Insufficient arguments. Please Specify series resistance."<<std::endl;
-							break;
-						}
-						std::cout <<"Initiate Series Resistance at:\n";
-						for( i=0;i<inputdata.getParamCount() && i<3;i++)
-						{
-							if(battpack[i].setSeriesResistance(inputdata.getIPParam(i)))
-								std::cout <<i+1<<": Done." <<std::endl;
-							else
-								std::cout <<i+1<<": Failed." <<std::endl;
-						}
-						if(inputdata.getParamCount() > 3)
-							std::cout<<"Extra values omitted."<<std::endl;
-					break;
-
-					case SETLOAD:
-						if(inputdata.getParamCount() < 1)
-						{
-							std::cout<<"Insufficient arguments. Please Specify load resistance."<<std::endl;
-							break;
-						}
-						std::cout <<"Initiate Load resistance at:\n";
-						if(Simulator.setLoad(inputdata.getIPParam(0)))
-							std::cout <<1 <<": Done." <<std::endl;
-						else
-							std::cout <<1 <<": Failed." <<std::endl;
-						if(inputdata.getParamCount() > 1)
-							std::cout<<"Extra values omitted."<<std::endl;
-					break;
-
-					case SETINTV:
-						if(inputdata.getParamCount() < 3)
-						{
-							std::cout<<"Insufficient arguments. Please Specify battery voltage."<<std::endl;
-							break;
-						}
-						std::cout <<"Initiate Battery Voltage at:\n";
-						for( i=0;i<inputdata.getParamCount() && i<3;i++)
-						{
-							if(battpack[i].setInitialVoltage(inputdata.getIPParam(i)))
-								std::cout <<i+1 <<": Done." <<std::endl;
-							else
-								std::cout <<i+1 <<": Failed." <<std::endl;
-						}
-						if(inputdata.getParamCount() > 3)
-							std::cout<<"Extra values omitted."<<std::endl;
-					break;
-
-					case SIMSTART:
-						if(inputdata.getParamCount() > 0)
-							std::cout <<"Extra parameters omitted." <<std::endl;
-						if(Simulator.start())
-							std::cout <<"Simulation started." <<std::endl;
-						else
-							std::cout <<"Simulation already running." <<std::endl;
-					break;
-
-					case SIMSTOP:
-						if(inputdata.getParamCount() > 0)
-							std::cout <<"Extra parameters omitted." <<std::endl;
-						if(Simulator.stop())
-							std::cout <<"Simulation stopped." <<std::endl;
-						else
-							std::cout <<"Simulation is not running currently." <<std::endl;
-					break;
-
-					case HELP:
-						showHelp();
-					break;
-
-					case EXIT:
-						Simulator.stop();
-						std::cout <<"Simualtion Process is aborted" <<std::endl;
-						exit_loop = true;
-					break;
-
-					default:
-						if(Function >=500)
-							std::cout <<inputdata.getLastCommand() <<" is not a valid Command" <<std::endl;
-						else
-							std::cout <<inputdata.getLastKey() <<" is not a valid key for " 							<<inputdata.getLastCommand() <<" command" <<std::endl;
-					break;
-				}
+				std::lock_guard<std::mutex> lock(CommandLock);
+				exit_loop = execute(inputdata, std::cout);
 			}
 			else
 				std::cout <<std::endl <<"Input correctly not recorded." <<std::endl;
 		}
+		else if(feof(stdin))
+		{
+			//without a terminal the server keeps the simulator alive
+			while(Server.IsRunning())
+				sleep(1);
+			Simulator.stop();
+			exit_loop = true;
+		}
 	}
+	Server.stop();
+	Watcher = (cWatcher*)0;
+	Simulator.stop();
+	Simulator.useScheduler((cScheduler*)0);
+	delete Tasks;
+	battstatus.removeSink(cTelemetryWriter::sink, &Telemetry);
+	Telemetry.close();
+	battstatus.removeSink(cProfilePlayer::sink, &Player);
+	Preview = (cTracePreview*)0;
+	battstatus.removeSink(cTracePreview::sink, &Previews);
+	Previews.close();
+	History = (cHistoryStore*)0;
+	battstatus.removeSink(cHistoryStore::sink, &Histories);
+	Histories.close();
 
 	return false;
 }
-
-
-
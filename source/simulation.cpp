@@ -24,6 +24,8 @@ cSimulation::cSimulation(void)
 	Resolution = 100;
 	Speed = 1;
 	BatteryConnected = false;
+	Scheduler = (cScheduler*)0;
+	TaskId = 0;
 }
 
 /**
@@ -46,6 +48,8 @@ cSimulation::cSimulation(int multiplier, double res)
 	else
 		Speed = multiplier;
 	BatteryConnected = false;
+	Scheduler = (cScheduler*)0;
+	TaskId = 0;
 }
 
 /**
@@ -60,9 +64,14 @@ bool cSimulation::start(void)
 {
 	if(!BatteryConnected)
 		return false;
-	if(BatPack->IsRunning())
+	if(IsRunning())
 		return false;
 	std::cout<<"calling battery run"<<std::endl;
+	if(Scheduler != (cScheduler*)0)
+	{
+		TaskId = Scheduler->spawn(BatPack,Load,Resolution,Speed);
+		return (TaskId != 0);
+	}
 	return (BatPack->run(Load,Resolution,Speed));
 }
 
@@ -79,9 +88,17 @@ bool cSimulation::stop(void)
 {
 	if(!BatteryConnected)
 		return false;
-	if(!BatPack->IsRunning())
+	if(!IsRunning())
 		return false;
 	std::cout<<"calling battery stop"<<std::endl;
+	if(Scheduler != (cScheduler*)0)
+	{
+		if(!Scheduler->cancel(TaskId))
+			return false;
+		TaskId = 0;
+		std::cout<<"battery stopped"<<std::endl;
+		return (BatPack->reset());
+	}
 	if(BatPack->stop())
 	{
 		std::cout<<"battery stopped"<<std::endl;
@@ -104,7 +121,7 @@ bool cSimulation::setSpeed(int multiplier)
 {
 	if(BatteryConnected)
 	{
-		if(BatPack->IsRunning())
+		if(IsRunning())
 			return false;
 	}
 	if(0 >= multiplier)
@@ -125,7 +142,7 @@ bool cSimulation::setResolution(double milisec)
 {
 	if(BatteryConnected)
 	{
-		if(BatPack->IsRunning())
+		if(IsRunning())
 			return false;
 	}
 	if(0 >= milisec)
@@ -146,7 +163,7 @@ bool cSimulation::connect(cBattery* battery)
 {
 	if(BatteryConnected)
 	{
-		if(BatPack->IsRunning())
+		if(IsRunning())
 			return false;
 	}
 	BatPack = battery;
@@ -167,7 +184,7 @@ bool cSimulation::connect(double load)
 {
 	if(BatteryConnected)
 	{
-		if(BatPack->IsRunning())
+		if(IsRunning())
 			return false;
 	}
 	Load = load;
@@ -196,3 +213,50 @@ double cSimulation::getLoad(void)
 {
 	return Load;
 }
+
+/**
+ * @brief Returns the resolution of the simulation
+ *
+ * @param void
+ * @return double interval between two steps in milisecond
+ */
+double cSimulation::getResolution(void)
+{
+	return Resolution;
+}
+
+/**
+ * @brief Runs the battery on a scheduler
+ *
+ * Instead of a runner thread per battery, start spawns a task on the
+ * scheduler and stop cancels it. NULL switches back to a runner thread.
+ * @param cScheduler* pointer to the scheduler
+ * @return bool true if successful
+ * false if simulation is running
+ */
+bool cSimulation::useScheduler(cScheduler* scheduler)
+{
+	if(BatteryConnected)
+	{
+		if(IsRunning())
+			return false;
+	}
+	Scheduler = scheduler;
+	return true;
+}
+
+/**
+ * @brief Determines whether the battery is running
+ *
+ * @param void
+ * @return bool true if the runner thread or the scheduler task is active
+ * false if no battery is connected or it is not running
+ */
+bool cSimulation::IsRunning(void)
+{
+	if(!BatteryConnected)
+		return false;
+	if(Scheduler != (cScheduler*)0 && TaskId != 0)
+		return Scheduler->isActive(TaskId);
+	return BatPack->IsRunning();
+}
@@ -13,6 +13,7 @@
  * @see singlebatt.hpp
  */
 #include "../header/singlebatt.hpp"
+#include "../header/cellkernel.hpp"
 
 /**
  * @brief Constructor of a cell object
@@ -69,6 +70,27 @@ bool cSingleBatt::setSeriesResistance(double sres)
 	return true;
 }
 
+/**
+ * @brief Changes the series resistance of a locked cell
+ *
+ * Lets the battery the cell is attached to apply a change
+ * during a run, e.g. a live change at a step boundary.
+ *
+ * @param owner Owner of the cell
+ * @param double series resistance to be set in Ohms
+ * @return bool true if successfully set the series resistance
+ * false if the cell is not owned by the battery or sres is not positive.
+ */
+bool cSingleBatt::setSeriesResistance(cBattery* owner, double sres)
+{
+	if(AttachedTo != owner || sres <= 0)
+		return false;
+	mtx.lock();
+	SeriesResistance = sres;
+	mtx.unlock();
+	return true;
+}
+
 /**
  * @brief Sets the capacity of the cell
  *
@@ -206,7 +228,7 @@ double cSingleBatt::getRemainingCapacityPercentage(void)
 void cSingleBatt::initialise(void)
 {
 	mtx.lock();
-	m1 = ((InitialVoltage * Shift) - (InitialVoltage * Drop)) / ((Capacity * Shift) - (Capacity * Drop)); //based on y=mx+c 
+	m1 = cellGradient<double>(InitialVoltage, Capacity, Shift, Drop); //based on y=mx+c 
 	CurrentVoltage = InitialVoltage;
 	DischargedCapacity = 0;
 	RemainigCapacity = 100;
@@ -243,9 +265,7 @@ bool cSingleBatt::update(cBattery* owner,bool connected, double scurrent, double
 	}
 	mtx.lock();
 	SourceCurrent = scurrent;
-	DischargedCapacity += (SourceCurrent * runtime);
-	RemainigCapacity = ((Capacity - DischargedCapacity) / Capacity) * 100;
-	CurrentVoltage = CurrentVoltage - Gradient*SourceCurrent*runtime + ConstantK;
+	cellUpdate<double>(DischargedCapacity, RemainigCapacity, CurrentVoltage, Capacity, Gradient, ConstantK, SourceCurrent, runtime);
 	mtx.unlock();
 	return true;
 }
@@ -292,3 +312,25 @@ double cSingleBatt::getCurrentVoltage(void)
 	return result;
 }
 
+
+/**
+ * @brief Returns the first gradient change point of the discharge curve
+ *
+ * @param void
+ * @return double shift as percentage of discharged capacity
+ */
+double cSingleBatt::getShift(void)
+{
+	return Shift;
+}
+
+/**
+ * @brief Returns the voltage drop at the shift point
+ *
+ * @param void
+ * @return double drop as percentage
+ */
+double cSingleBatt::getDrop(void)
+{
+	return Drop;
+}
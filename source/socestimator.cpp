@@ -0,0 +1,499 @@
+/**
+ * @file socestimator.cpp
+ * @brief Implementation of the state of charge estimator
+ *
+ * Every kernel does the same operations in the same order for each
+ * cell. The open circuit voltage curve of the model is a line, so the
+ * Jacobian of the measurement is the slope of the cell and the filter
+ * does not linearise around the estimate; the update is written for
+ * the slope at the estimate so a curved table can replace the line.
+ *
+ * @author Subir Biswas
+ * @date 19/10/2026
+ * @see socestimator.hpp
+ */
+
+#include "../header/socestimator.hpp"
+#include "../header/cellkernel.hpp"
+#include <stdlib.h>	// posix_memalign
+#include <math.h>	// sqrt, log, cos
+#include <chrono>	// std::chrono
+#include <vector>	// std::vector
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SOCX86
+#endif
+
+#define SOCSETTLE	10	///<The largest filter error is taken after this % of the updates
+#define SOCTIMING	200	///<Updates timed per kernel
+
+/**
+ * @brief Arrays and constants of one update
+ */
+struct sSocLanes
+{
+	const double* Full;	///<Open circuit voltage of each full cell in Volts
+	const double* Slope;	///<Voltage of each cell over its state of charge in Volts
+	const double* Capacity;	///<Capacity of each cell in AmS
+	const double* Voltage;	///<Measured voltage of each cell in Volts
+	const double* Current;	///<Measured current of each cell in Ampere
+	double* Soc;		///<State of charge estimated by the filter
+	double* Variance;	///<Variance of the filter estimate
+	double* Counted;	///<State of charge by Coulomb counting
+	double Runtime;		///<Time since the last update in mS
+	double Process;		///<Process noise times the squared capacity
+	double Measure;		///<Variance of the voltage measurement
+};
+
+/**
+ * @brief Signature of an estimator kernel
+ */
+typedef void (*tSocKernel)(int n, const sSocLanes& l);
+
+/**
+ * @brief Portable kernel, the scalar reference
+ *
+ * @param n	number of cells
+ * @param l	arrays and constants
+ * @return void
+ */
+static void estimatePortable(int n, const sSocLanes& l)
+{
+	double dq, p, y, s, k;
+	for(int i=0; i<n; i++)
+	{
+		dq = l.Current[i] * l.Runtime / l.Capacity[i];
+		l.Counted[i] = l.Counted[i] - dq;
+		l.Soc[i] = l.Soc[i] - dq;
+		p = l.Variance[i] + l.Process / (l.Capacity[i] * l.Capacity[i]);
+		y = l.Voltage[i] - (l.Full[i] - l.Slope[i] * (1 - l.Soc[i]));
+		s = l.Slope[i] * p * l.Slope[i] + l.Measure;
+		k = p * l.Slope[i] / s;
+		l.Soc[i] = l.Soc[i] + k * y;
+		l.Variance[i] = (1 - k * l.Slope[i]) * p;
+	}
+}
+
+#ifdef SOCX86
+/**
+ * @brief AVX2 kernel, 4 cells at a time
+ *
+ * @see estimatePortable
+ */
+__attribute__((target("avx2")))
+static void estimateAvx2(int n, const sSocLanes& l)
+{
+	const __m256d one = _mm256_set1_pd(1);
+	const __m256d t = _mm256_set1_pd(l.Runtime);
+	const __m256d q = _mm256_set1_pd(l.Process);
+	const __m256d r = _mm256_set1_pd(l.Measure);
+	__m256d cap, slope, dq, soc, p, y, s, k;
+	for(int c=0; c<n; c+=4)
+	{
+		cap = _mm256_load_pd(l.Capacity+c);
+		slope = _mm256_load_pd(l.Slope+c);
+		dq = _mm256_div_pd(_mm256_mul_pd(_mm256_load_pd(l.Current+c), t), cap);
+		_mm256_store_pd(l.Counted+c, _mm256_sub_pd(_mm256_load_pd(l.Counted+c), dq));
+		soc = _mm256_sub_pd(_mm256_load_pd(l.Soc+c), dq);
+		p = _mm256_add_pd(_mm256_load_pd(l.Variance+c), _mm256_div_pd(q, _mm256_mul_pd(cap, cap)));
+		y = _mm256_sub_pd(_mm256_load_pd(l.Voltage+c), _mm256_sub_pd(_mm256_load_pd(l.Full+c), _mm256_mul_pd(slope, _mm256_sub_pd(one, soc))));
+		s = _mm256_add_pd(_mm256_mul_pd(_mm256_mul_pd(slope, p), slope), r);
+		k = _mm256_div_pd(_mm256_mul_pd(p, slope), s);
+		_mm256_store_pd(l.Soc+c, _mm256_add_pd(soc, _mm256_mul_pd(k, y)));
+		_mm256_store_pd(l.Variance+c, _mm256_mul_pd(_mm256_sub_pd(one, _mm256_mul_pd(k, slope)), p));
+	}
+}
+
+/**
+ * @brief AVX-512 update of 8 cells
+ *
+ * @see estimatePortable
+ */
+__attribute__((target("avx512f")))
+static inline void estimateAvx512Lanes(int c, const sSocLanes& l, __m512d t, __m512d q, __m512d r)
+{
+	const __m512d one = _mm512_set1_pd(1);
+	__m512d cap = _mm512_load_pd(l.Capacity+c);
+	__m512d slope = _mm512_load_pd(l.Slope+c);
+	__m512d dq = _mm512_div_pd(_mm512_mul_pd(_mm512_load_pd(l.Current+c), t), cap);
+	_mm512_store_pd(l.Counted+c, _mm512_sub_pd(_mm512_load_pd(l.Counted+c), dq));
+	__m512d soc = _mm512_sub_pd(_mm512_load_pd(l.Soc+c), dq);
+	__m512d p = _mm512_add_pd(_mm512_load_pd(l.Variance+c), _mm512_div_pd(q, _mm512_mul_pd(cap, cap)));
+	__m512d y = _mm512_sub_pd(_mm512_load_pd(l.Voltage+c), _mm512_sub_pd(_mm512_load_pd(l.Full+c), _mm512_mul_pd(slope, _mm512_sub_pd(one, soc))));
+	__m512d s = _mm512_add_pd(_mm512_mul_pd(_mm512_mul_pd(slope, p), slope), r);
+	__m512d k = _mm512_div_pd(_mm512_mul_pd(p, slope), s);
+	_mm512_store_pd(l.Soc+c, _mm512_add_pd(soc, _mm512_mul_pd(k, y)));
+	_mm512_store_pd(l.Variance+c, _mm512_mul_pd(_mm512_sub_pd(one, _mm512_mul_pd(k, slope)), p));
+}
+
+/**
+ * @brief AVX-512 kernel, 16 cells at a time
+ *
+ * Two 8 lane vectors per iteration.
+ * @see estimatePortable
+ */
+__attribute__((target("avx512f")))
+static void estimateAvx512(int n, const sSocLanes& l)
+{
+	const __m512d t = _mm512_set1_pd(l.Runtime);
+	const __m512d q = _mm512_set1_pd(l.Process);
+	const __m512d r = _mm512_set1_pd(l.Measure);
+	for(int c=0; c<n; c+=16)
+	{
+		estimateAvx512Lanes(c, l, t, q, r);
+		estimateAvx512Lanes(c+8, l, t, q, r);
+	}
+}
+#endif
+
+static const tSocKernel Kernels[] = {estimatePortable,
+#ifdef SOCX86
+	estimateAvx2, estimateAvx512
+#endif
+};
+static const int DetectedKernel = cCellBatch::detectKernel();	///<Kernel chosen at startup
+
+/**
+ * @brief Allocates a cache line aligned array of doubles
+ *
+ * @param n	number of elements
+ * @param value	initial value of the elements
+ * @return double* the array
+ */
+static double* allocArray(int n, double value)
+{
+	void* p = (void*)0;
+	if(posix_memalign(&p, 64, n*sizeof(double)) != 0)
+		return (double*)0;
+	for(int i=0; i<n; i++)
+		((double*)p)[i] = value;
+	return (double*)p;
+}
+
+/**
+ * @brief Constructor of an estimator
+ *
+ * Creates the filters of the cells, full and certain. The padding
+ * cells have unit parameters so they never divide by zero.
+ * @param cells number of cells
+ * @return void
+ */
+cSocEstimator::cSocEstimator(int cells)
+{
+	if(cells < 0)
+		cells = 0;
+	Count = cells;
+	Padded = ((cells + BATCHALIGN - 1) / BATCHALIGN) * BATCHALIGN;
+	Kernel = DetectedKernel;
+	ProcessNoise = 0;
+	MeasureNoise = 1e-4;
+	Full = allocArray(Padded, 1);
+	Slope = allocArray(Padded, 1);
+	Capacity = allocArray(Padded, 1);
+	Soc = allocArray(Padded, 1);
+	Variance = allocArray(Padded, 0);
+	Counted = allocArray(Padded, 1);
+	Voltage = allocArray(Padded, 1);
+	Current = allocArray(Padded, 0);
+}
+
+/**
+ * @brief Destructor of the estimator
+ *
+ * @param void
+ * @return void
+ */
+cSocEstimator::~cSocEstimator()
+{
+	free(Full);
+	free(Slope);
+	free(Capacity);
+	free(Soc);
+	free(Variance);
+	free(Counted);
+	free(Voltage);
+	free(Current);
+}
+
+/**
+ * @brief Sets the model of a cell and the initial guess
+ *
+ * The initial variance is that of a guess anywhere in 0 to 1.
+ *
+ * @param index		position of the cell
+ * @param full		open circuit voltage of the full cell in Volts
+ * @param slope		voltage over state of charge in Volts
+ * @param capacity	capacity in AmS
+ * @param soc		initial guess of the state of charge, 0 to 1
+ * @return true successfully set
+ * @return false index is out of range or the model is invalid
+ */
+bool cSocEstimator::setCell(int index, double full, double slope, double capacity, double soc)
+{
+	if(index < 0 || index >= Count || slope <= 0 || capacity <= 0)
+		return false;
+	Full[index] = full;
+	Slope[index] = slope;
+	Capacity[index] = capacity;
+	Soc[index] = soc;
+	Counted[index] = soc;
+	Variance[index] = 1.0 / 12;
+	return true;
+}
+
+/**
+ * @brief Sets the noise the filters expect
+ *
+ * The bias of the current is not known to the filters.
+ *
+ * @param noise		noise of the sensors
+ * @param interval	time between two updates in mS
+ * @return true successfully set
+ * @return false the voltage noise is not positive
+ */
+bool cSocEstimator::setNoise(const sSensorNoise& noise, double interval)
+{
+	if(noise.Voltage <= 0 || noise.Current < 0 || interval <= 0)
+		return false;
+	ProcessNoise = noise.Current * interval * noise.Current * interval;
+	MeasureNoise = noise.Voltage * noise.Voltage;
+	return true;
+}
+
+/**
+ * @brief Sets the measurements of a cell for the next update
+ *
+ * @param index		position of the cell
+ * @param voltage	measured voltage in Volts
+ * @param current	measured current in Ampere, positive when discharging
+ * @return true successfully set
+ * @return false index is out of range
+ */
+bool cSocEstimator::setMeasurement(int index, double voltage, double current)
+{
+	if(index < 0 || index >= Count)
+		return false;
+	Voltage[index] = voltage;
+	Current[index] = current;
+	return true;
+}
+
+/**
+ * @brief Updates every filter and counter with the selected kernel
+ *
+ * @param runtime time since the last update in mS
+ * @return void
+ */
+void cSocEstimator::update(double runtime)
+{
+	sSocLanes lanes;
+	lanes.Full = Full;
+	lanes.Slope = Slope;
+	lanes.Capacity = Capacity;
+	lanes.Voltage = Voltage;
+	lanes.Current = Current;
+	lanes.Soc = Soc;
+	lanes.Variance = Variance;
+	lanes.Counted = Counted;
+	lanes.Runtime = runtime;
+	lanes.Process = ProcessNoise;
+	lanes.Measure = MeasureNoise;
+	Kernels[Kernel](Padded, lanes);
+}
+
+/**
+ * @brief Returns the number of cells
+ *
+ * @param void
+ * @return int number of cells
+ */
+int cSocEstimator::getCount(void)
+{
+	return Count;
+}
+
+/**
+ * @brief Returns the state of charge estimated by the filter
+ *
+ * @param index position of the cell
+ * @return double state of charge, 0 if index is out of range
+ */
+double cSocEstimator::getFilterSoc(int index)
+{
+	if(index < 0 || index >= Count)
+		return 0;
+	return Soc[index];
+}
+
+/**
+ * @brief Returns the state of charge by Coulomb counting
+ *
+ * @param index position of the cell
+ * @return double state of charge, 0 if index is out of range
+ */
+double cSocEstimator::getCountedSoc(int index)
+{
+	if(index < 0 || index >= Count)
+		return 0;
+	return Counted[index];
+}
+
+/**
+ * @brief Returns the variance of the filter estimate
+ *
+ * @param index position of the cell
+ * @return double variance, 0 if index is out of range
+ */
+double cSocEstimator::getVariance(int index)
+{
+	if(index < 0 || index >= Count)
+		return 0;
+	return Variance[index];
+}
+
+/**
+ * @brief Selects the kernel of update
+ *
+ * @param kernel one of KERNEL_PORTABLE, KERNEL_AVX2, KERNEL_AVX512
+ * @return true successfully selected
+ * @return false the CPU does not support the kernel
+ */
+bool cSocEstimator::setKernel(int kernel)
+{
+	if(kernel < KERNEL_PORTABLE || kernel > DetectedKernel)
+		return false;
+	Kernel = kernel;
+	return true;
+}
+
+/**
+ * @brief Returns the selected kernel
+ *
+ * @param void
+ * @return int one of KERNEL_PORTABLE, KERNEL_AVX2, KERNEL_AVX512
+ */
+int cSocEstimator::getKernel(void)
+{
+	return Kernel;
+}
+
+/**
+ * @brief Returns a normally distributed number
+ *
+ * Box-Muller transform of a 64 bit xorshift generator, so an
+ * evaluation gives the same result on every run.
+ * @param state state of the generator, updated
+ * @return double number with mean 0 and standard deviation 1
+ */
+static double gaussian(uint64_t& state)
+{
+	double u[2];
+	for(int a=0; a<2; a++)
+	{
+		state ^= state << 13;
+		state ^= state >> 7;
+		state ^= state << 17;
+		u[a] = ((state >> 11) + 0.5) / 9007199254740992.0;
+	}
+	return sqrt(-2 * log(u[0])) * cos(6.283185307179586 * u[1]);
+}
+
+/**
+ * @brief Evaluates the estimator on simulated cells
+ *
+ * The cells of the scenario are repeated upto the number of cells,
+ * with initial voltages spread by upto 0.5 V. Each cell is discharged
+ * at 0.5 to 1.2 times half its capacity per hour and is disconnected
+ * in a quarter of the updates, like the balancing does. The batch
+ * gives the true state, the sensors add noise and bias, the estimator
+ * starts offset below the truth and is updated once a second till the
+ * fastest cell is 80 % discharged. Coulomb counting never corrects its
+ * initial error, with an offset its error is mostly the offset.
+ *
+ * @param scenario	the cells
+ * @param cells		number of cells to estimate
+ * @param noise		noise of the sensors
+ * @param offset	initial error of the estimates, 0 to start at the true charge
+ * @param accuracy	errors and cost of the estimator
+ * @return true successfully evaluated
+ * @return false the scenario has no cells, cells is below 1, the offset is out of 0 to 1 or the noise is invalid
+ */
+bool evaluateSoc(const cScenario& scenario, int cells, const sSensorNoise& noise, double offset, sSocAccuracy& accuracy)
+{
+	const double interval = 1000;
+	if(scenario.getCount() == 0 || cells < 1 || offset < 0 || offset >= 1)
+		return false;
+	cCellBatch batch(cells);
+	cSocEstimator estimator(cells);
+	cSingleBatt model;
+	std::vector<double> current(cells);
+	uint32_t seed = 1;
+	uint64_t state = 88172645463325252ULL;
+	int i, c;
+	long step, steps;
+	double cap, dv, factor, fastest = 0;
+
+	if(!estimator.setNoise(noise, interval))
+		return false;
+	for(i=0; i<cells; i++)
+	{
+		c = i % scenario.getCount();
+		seed = seed*1103515245 + 12345;
+		dv = ((seed >> 16) % 1001) / 1000.0 - 0.5;
+		seed = seed*1103515245 + 12345;
+		factor = 0.5 + ((seed >> 16) % 1001) / 1000.0 * 0.7;
+		model.setInitialVoltage(scenario.getInitialVoltage(c) + dv);
+		model.setCapacity(scenario.getCapacity(c));
+		batch.setCell(i, &model);
+		cap = scenario.getCapacity(c) * 3600;
+		current[i] = factor * cap / 2 / 3600000;
+		fastest = (factor > fastest) ? factor : fastest;
+		double slope = cellGradient<double>(model.getInitialVoltage(), cap, model.getShift(), model.getDrop()) * cap;
+		estimator.setCell(i, model.getInitialVoltage(), slope, cap, 1 - offset);
+	}
+	steps = (long)(0.8 * 2 * 3600 / fastest);
+
+	double filterSum = 0, countSum = 0, error;
+	accuracy.Cells = cells;
+	accuracy.Offset = offset;
+	accuracy.Updates = steps;
+	accuracy.FilterMax = 0;
+	accuracy.CountMax = 0;
+	for(step=0; step<steps; step++)
+	{
+		for(i=0; i<cells; i++)
+		{
+			seed = seed*1103515245 + 12345;
+			batch.setCurrent(i, ((seed >> 16) & 3) != 0, current[i]);
+		}
+		batch.update(interval);
+		for(i=0; i<cells; i++)
+			estimator.setMeasurement(i, batch.getCurrentVoltage(i) + noise.Voltage * gaussian(state),
+				batch.getSourceCurrent(i) + noise.Bias + noise.Current * gaussian(state));
+		estimator.update(interval);
+		for(i=0; i<cells; i++)
+		{
+			error = fabs(estimator.getFilterSoc(i) * 100 - batch.getRemainingCapacityPercentage(i));
+			filterSum += error * error;
+			if(step * 100 >= steps * SOCSETTLE && error > accuracy.FilterMax)
+				accuracy.FilterMax = error;
+			error = fabs(estimator.getCountedSoc(i) * 100 - batch.getRemainingCapacityPercentage(i));
+			countSum += error * error;
+			accuracy.CountMax = (error > accuracy.CountMax) ? error : accuracy.CountMax;
+		}
+	}
+	accuracy.FilterRms = sqrt(filterSum / ((double)steps * cells));
+	accuracy.CountRms = sqrt(countSum / ((double)steps * cells));
+
+	for(int k=KERNEL_PORTABLE; k<=KERNEL_AVX512; k++)
+	{
+		accuracy.Cost[k] = 0;
+		if(!estimator.setKernel(k))
+			continue;
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for(step=0; step<SOCTIMING; step++)
+			estimator.update(interval);
+		accuracy.Cost[k] = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / SOCTIMING / cells;
+	}
+	return true;
+}
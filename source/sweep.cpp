@@ -0,0 +1,540 @@
+/**
+ * @file sweep.cpp
+ * @brief Implementation of the sharded sweep of a fleet
+ *
+ * The workers are forked from the coordinator, so they share the
+ * fleet it loaded, mapped or parsed, without loading it again.
+ *
+ * @author Subir Biswas
+ * @date 19/10/2026
+ * @see sweep.hpp
+ */
+
+#include "../header/sweep.hpp"
+#include <stdio.h>	// FILE, snprintf, rename
+#include <string.h>	// memset
+#include <stddef.h>	// offsetof
+#include <fcntl.h>	// open
+#include <unistd.h>	// fork, write, fdatasync
+#include <sys/stat.h>	// mkdir
+#include <sys/wait.h>	// waitpid
+#include <errno.h>	// errno
+#include <map>		// std::map
+#include <algorithm>	// std::min
+
+/**
+ * @brief Constructor of a closed sweep
+ *
+ * @param void
+ * @return void
+ */
+cSweep::cSweep()
+{
+	Fleet = (cFleet*)0;
+	Cache = (cResultCache*)0;
+	Journal = -1;
+	ShardPacks = SWEEPSHARD;
+	Shards = 0;
+	Stamp = 0;
+	Resumed = 0;
+	Torn = 0;
+	Error = "";
+	for(int p=0; p<POLICIES; p++)
+		Result[p] = sPolicyResult();
+}
+
+/**
+ * @brief Destructor of the sweep, closes the journal
+ *
+ * @param void
+ * @return void
+ */
+cSweep::~cSweep()
+{
+	if(Journal >= 0)
+		close(Journal);
+}
+
+/**
+ * @brief Records an error
+ *
+ * @param error the error
+ * @return bool false
+ */
+bool cSweep::fail(const char* error)
+{
+	Error = error;
+	return false;
+}
+
+/**
+ * @brief Opens the sweep of a fleet in a directory
+ *
+ * A new directory starts the sweep, a directory with the journal of the
+ * same fleet and shard size resumes it.
+ * @param dir	the directory, it is created if missing
+ * @param fleet	the fleet, it must outlive the sweep
+ * @param packs	packs of a shard
+ * @return true successfully opened
+ * @return false the fleet is empty, the directory can not be used or it holds another sweep
+ */
+bool cSweep::open(const char* dir, cFleet* fleet, int packs)
+{
+	if(Journal >= 0)
+		return fail("the sweep is already open");
+	if(fleet == (cFleet*)0 || fleet->getPackCount() == 0 || packs < 1)
+		return fail("no pack to sweep");
+	if(mkdir(dir, 0755) != 0 && errno != EEXIST)
+		return fail("can not create the directory");
+	Dir = dir;
+	Fleet = fleet;
+	ShardPacks = packs;
+	Shards = (fleet->getPackCount() + packs - 1) / packs;
+	Stamp = identity(fleet);
+	Done.assign(Shards, false);
+	Journal = ::open((Dir + "/journal").c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+	if(Journal < 0)
+		return fail("can not open the journal");
+	if(!replay())
+	{
+		close(Journal);
+		Journal = -1;
+		return false;
+	}
+	return true;
+}
+
+/**
+ * @brief Reads the journal back
+ *
+ * A record that is not whole or fails its checksum ends the journal,
+ * it and what follows are cut off. A shard is done if its record says
+ * so and its file is valid.
+ * @param void
+ * @return bool false if the journal belongs to another sweep or can not be read
+ */
+bool cSweep::replay(void)
+{
+	struct stat info;
+	if(fstat(Journal, &info) != 0)
+		return fail("can not read the journal");
+	std::vector<sJournalRecord> records(info.st_size / sizeof(sJournalRecord));
+	size_t bytes = records.size() * sizeof(sJournalRecord);
+	if(bytes > 0 && pread(Journal, &records[0], bytes, 0) != (ssize_t)bytes)
+		return fail("can not read the journal");
+	size_t whole = 0;
+	while(whole < records.size() && records[whole].Magic == SWEEPMAGIC && records[whole].Check == check(records[whole]))
+		whole++;
+	Torn = info.st_size - whole * sizeof(sJournalRecord);
+	if(Torn > 0 && ftruncate(Journal, whole * sizeof(sJournalRecord)) != 0)
+		return fail("can not repair the journal");
+	if(whole == 0)
+		return append(SWEEPBEGIN, Shards, Fleet->getPackCount(), true) || fail("can not write the journal");
+	const sJournalRecord& begin = records[0];
+	if(begin.Type != SWEEPBEGIN || begin.Shard != (uint32_t)Shards || begin.Value != (uint32_t)Fleet->getPackCount()
+		|| begin.Extra != (uint32_t)ShardPacks || begin.Stamp != Stamp)
+		return fail("the directory holds the journal of another sweep");
+	std::vector<double> values;
+	for(size_t r=1; r<whole; r++)
+	{
+		if(records[r].Type == SWEEPDONE && records[r].Shard < (uint32_t)Shards)
+			Done[records[r].Shard] = true;
+	}
+	Resumed = 0;
+	for(int shard=0; shard<Shards; shard++)
+	{
+		Done[shard] = Done[shard] && loadShard(shard, values);
+		Resumed += Done[shard] ? 1 : 0;
+	}
+	return true;
+}
+
+/**
+ * @brief Appends a record to the journal
+ *
+ * The record is one write to a file opened for appending, a crash
+ * leaves it whole or torn, never interleaved.
+ * @param type	type of the record
+ * @param shard	the shard, the number of shards for SWEEPBEGIN
+ * @param value	depends on the type
+ * @param sync	true to wait till the record is on the disk
+ * @return bool false if the record can not be written
+ */
+bool cSweep::append(uint32_t type, uint32_t shard, uint32_t value, bool sync)
+{
+	sJournalRecord record;
+	memset(&record, 0, sizeof(record));
+	record.Magic = SWEEPMAGIC;
+	record.Type = type;
+	record.Shard = shard;
+	record.Value = value;
+	if(type == SWEEPBEGIN)
+	{
+		record.Stamp = Stamp;
+		record.Extra = ShardPacks;
+	}
+	record.Check = check(record);
+	if(write(Journal, &record, sizeof(record)) != (ssize_t)sizeof(record))
+		return false;
+	return !sync || fdatasync(Journal) == 0;
+}
+
+/**
+ * @brief Returns the checksum of a journal record
+ *
+ * @param record the record
+ * @return uint32_t 32 bit FNV-1a hash of the bytes before Check
+ */
+uint32_t cSweep::check(const sJournalRecord& record)
+{
+	const uint8_t* bytes = (const uint8_t*)&record;
+	uint32_t value = 2166136261U;
+	for(size_t c=0; c<offsetof(sJournalRecord, Check); c++)
+	{
+		value ^= bytes[c];
+		value *= 16777619U;
+	}
+	return value;
+}
+
+/**
+ * @brief Returns the identity of a fleet
+ *
+ * @param fleet the fleet
+ * @return uint64_t 64 bit FNV-1a hash of every pack, its cells and its profile
+ */
+uint64_t cSweep::identity(cFleet* fleet)
+{
+	uint64_t value = 14695981039346656037ULL;
+	for(int k=0; k<fleet->getPackCount(); k++)
+	{
+		const sFleetPack* pack = fleet->getPack(k);
+		const uint8_t* part[3] = {(const uint8_t*)pack, (const uint8_t*)fleet->getCells(k), (const uint8_t*)fleet->getProfile(k)};
+		size_t size[3] = {sizeof(sFleetPack), pack->Cells * sizeof(sFleetCell), pack->Points * sizeof(sFleetPoint)};
+		for(int p=0; p<3; p++)
+		{
+			for(size_t c=0; c<size[p]; c++)
+			{
+				value ^= part[p][c];
+				value *= 1099511628211ULL;
+			}
+		}
+	}
+	return value;
+}
+
+/**
+ * @brief Returns the path of the file of a shard
+ *
+ * @param shard the shard
+ * @return std::string <dir>/shard<shard>.res
+ */
+std::string cSweep::shardPath(int shard)
+{
+	char name[32];
+	snprintf(name, sizeof(name), "/shard%06d.res", shard);
+	return Dir + name;
+}
+
+/**
+ * @brief Runs a shard and writes its file, in a worker
+ *
+ * @param shard the shard
+ * @return bool false if a pack can not be run or the file can not be written
+ */
+bool cSweep::runShard(int shard)
+{
+	cTournament tournament;
+	sShardHeader head;
+	memset(&head, 0, sizeof(head));
+	head.Magic = SWEEPMAGIC;
+	head.Version = SWEEPVERSION;
+	head.Shard = shard;
+	head.FirstPack = shard * ShardPacks;
+	head.Packs = std::min(ShardPacks, Fleet->getPackCount() - (int)head.FirstPack);
+	head.Policies = POLICIES;
+	head.Stamp = Stamp;
+	for(uint32_t k=0; k<head.Packs; k++)
+	{
+		cScenario scenario;
+		if(!Fleet->getScenario(head.FirstPack + k, scenario) || !tournament.addScenario(scenario))
+			return false;
+	}
+	tournament.setCache(Cache);
+	if(!tournament.run(1))
+		return false;
+	std::vector<double> values(head.Packs * POLICIES * 2);
+	for(uint32_t k=0; k<head.Packs; k++)
+	{
+		for(int p=0; p<POLICIES; p++)
+			tournament.getRun(k, p, values[(k*POLICIES + p)*2], values[(k*POLICIES + p)*2 + 1]);
+	}
+	char host[64] = "", name[128];
+	gethostname(host, sizeof(host) - 1);
+	snprintf(name, sizeof(name), "/.tmp.%s.%d", host, (int)getpid());
+	std::string temporary = Dir + name;
+	FILE* file = fopen(temporary.c_str(), "wb");
+	if(file == (FILE*)0)
+		return false;
+	bool written = fwrite(&head, sizeof(head), 1, file) == 1 && fwrite(&values[0], sizeof(double), values.size(), file) == values.size()
+		&& fflush(file) == 0 && fsync(fileno(file)) == 0;
+	written = fclose(file) == 0 && written;
+	//the journal says done only for a file in place, so the file is on the disk before its rename
+	if(!written || rename(temporary.c_str(), shardPath(shard).c_str()) != 0)
+	{
+		remove(temporary.c_str());
+		return false;
+	}
+	return true;
+}
+
+/**
+ * @brief Loads the file of a shard
+ *
+ * @param shard		the shard
+ * @param values	runtime and imbalance of every policy of every pack of the shard
+ * @return bool false if the file is missing or does not belong to the shard of this sweep
+ */
+bool cSweep::loadShard(int shard, std::vector<double>& values)
+{
+	FILE* file = fopen(shardPath(shard).c_str(), "rb");
+	if(file == (FILE*)0)
+		return false;
+	sShardHeader head;
+	uint32_t first = shard * ShardPacks;
+	bool valid = fread(&head, sizeof(head), 1, file) == 1 && head.Magic == SWEEPMAGIC && head.Version == SWEEPVERSION
+		&& head.Shard == (uint32_t)shard && head.FirstPack == first && head.Policies == POLICIES && head.Stamp == Stamp
+		&& head.Packs == (uint32_t)std::min(ShardPacks, Fleet->getPackCount() - (int)first);
+	if(valid)
+	{
+		values.resize(head.Packs * POLICIES * 2);
+		valid = fread(&values[0], sizeof(double), values.size(), file) == values.size() && fgetc(file) == EOF;
+	}
+	fclose(file);
+	return valid;
+}
+
+/**
+ * @brief Sets the cache of the runs of the workers
+ *
+ * @param cache the cache, null to run every pack
+ * @return void
+ */
+void cSweep::setCache(cResultCache* cache)
+{
+	Cache = cache;
+}
+
+/**
+ * @brief Runs the shards that are not done
+ *
+ * Keeps up to workers worker processes running, a shard each. A shard
+ * whose worker fails or leaves no valid file is given to a new worker,
+ * upto SWEEPRETRIES times.
+ * @param workers	number of worker processes
+ * @param out		stream the progress is printed to
+ * @return true every shard is done
+ * @return false the sweep is not open, a worker can not be started, the journal can not be written or a shard failed every attempt
+ */
+bool cSweep::run(int workers, std::ostream& out)
+{
+	if(Journal < 0 || workers < 1)
+		return fail("the sweep is not open");
+	std::vector<int> queue;
+	std::vector<int> attempts(Shards, 0);
+	std::map<pid_t, int> running;
+	std::vector<double> values;
+	int done = getDoneCount(), failed = 0;
+	bool journaled = true;
+	for(int shard=0; shard<Shards; shard++)
+	{
+		if(!Done[shard])
+			queue.push_back(shard);
+	}
+	size_t next = 0;
+	while(next < queue.size() || !running.empty())
+	{
+		while((int)running.size() < workers && next < queue.size())
+		{
+			int shard = queue[next];
+			out.flush();
+			fflush(stdout);
+			pid_t pid = fork();
+			if(pid == 0)
+				_exit(runShard(shard) ? 0 : 1);
+			if(pid < 0)
+				break;
+			next++;
+			running[pid] = shard;
+			journaled = append(SWEEPSTART, shard, (uint32_t)pid, false) && journaled;
+		}
+		if(running.empty())
+			return fail("can not start a worker");
+		int status;
+		pid_t pid = waitpid(-1, &status, 0);
+		if(pid < 0 || running.find(pid) == running.end())
+			continue;
+		int shard = running[pid];
+		running.erase(pid);
+		if(WIFEXITED(status) && WEXITSTATUS(status) == 0 && loadShard(shard, values))
+		{
+			Done[shard] = true;
+			journaled = append(SWEEPDONE, shard, 0, true) && journaled;
+			out <<"Shard " <<shard <<" done, " <<++done <<" of " <<Shards <<std::endl;
+			continue;
+		}
+		journaled = append(SWEEPFAIL, shard, (uint32_t)status, true) && journaled;
+		out <<"Shard " <<shard <<" failed, status " <<status;
+		if(++attempts[shard] < SWEEPRETRIES)
+		{
+			queue.push_back(shard);
+			out <<", it runs again" <<std::endl;
+		}
+		else
+		{
+			failed++;
+			out <<", given up" <<std::endl;
+		}
+	}
+	if(!journaled)
+		return fail("can not write the journal");
+	return failed == 0 || fail("a shard failed every attempt");
+}
+
+/**
+ * @brief Merges the shard files into one CSV and ranks the policies
+ *
+ * The CSV is results.csv in the directory, a line per pack and policy:
+ * pack, policy, runtime in s and imbalance in %. The policies are
+ * ranked by cTournament::rank, the same ranking as the tournament.
+ * @param void
+ * @return true successfully merged
+ * @return false a shard is not done or the CSV can not be written
+ */
+bool cSweep::merge(void)
+{
+	if(Journal < 0 || getDoneCount() != Shards)
+		return fail("the sweep is not done");
+	cTournament names;
+	std::vector<double> values;
+	std::string temporary = Dir + "/.tmp.results.csv";
+	FILE* file = fopen(temporary.c_str(), "w");
+	if(file == (FILE*)0)
+		return fail("can not write the results");
+	int packs = Fleet->getPackCount();
+	std::vector<double> runtimes((size_t)packs * POLICIES), imbalances((size_t)packs * POLICIES);
+	bool written = fprintf(file, "pack,policy,runtime s,imbalance %%\n") > 0;
+	for(int shard=0; shard<Shards && written; shard++)
+	{
+		if(!loadShard(shard, values))
+		{
+			fclose(file);
+			remove(temporary.c_str());
+			Done[shard] = false;
+			return fail("the file of a done shard is gone");
+		}
+		for(size_t k=0; k<values.size() / (POLICIES * 2); k++)
+		{
+			size_t pack = (size_t)shard * ShardPacks + k;
+			const char* name = Fleet->getPack(pack)->Name;
+			for(int p=0; p<POLICIES; p++)
+			{
+				runtimes[pack*POLICIES + p] = values[(k*POLICIES + p)*2];
+				imbalances[pack*POLICIES + p] = values[(k*POLICIES + p)*2 + 1];
+				written = fprintf(file, "%s,%s,%.3f,%.4f\n", name, names.getPolicyName(p),
+					runtimes[pack*POLICIES + p] / 1000, imbalances[pack*POLICIES + p]) > 0 && written;
+			}
+		}
+	}
+	written = fclose(file) == 0 && written;
+	Results = Dir + "/results.csv";
+	if(!written || rename(temporary.c_str(), Results.c_str()) != 0)
+	{
+		remove(temporary.c_str());
+		return fail("can not write the results");
+	}
+	cTournament::rank(&runtimes[0], &imbalances[0], packs, Result);
+	return true;
+}
+
+/**
+ * @brief Returns the number of shards
+ *
+ * @param void
+ * @return int number of shards
+ */
+int cSweep::getShardCount(void)
+{
+	return Shards;
+}
+
+/**
+ * @brief Returns the number of shards done
+ *
+ * @param void
+ * @return int shards done
+ */
+int cSweep::getDoneCount(void)
+{
+	int done = 0;
+	for(int shard=0; shard<Shards; shard++)
+		done += Done[shard] ? 1 : 0;
+	return done;
+}
+
+/**
+ * @brief Returns the number of shards done before the sweep was opened
+ *
+ * @param void
+ * @return int shards resumed from the journal
+ */
+int cSweep::getResumedCount(void)
+{
+	return Resumed;
+}
+
+/**
+ * @brief Returns the bytes cut from a torn journal when it was opened
+ *
+ * @param void
+ * @return int bytes cut, 0 if the journal was whole
+ */
+int cSweep::getTornCount(void)
+{
+	return Torn;
+}
+
+/**
+ * @brief Returns the path of the merged CSV
+ *
+ * @param void
+ * @return const char* the path, empty before merge
+ */
+const char* cSweep::getResultPath(void)
+{
+	return Results.c_str();
+}
+
+/**
+ * @brief Returns the result of a policy by rank
+ *
+ * @param rank 0 is the best policy of the merged results
+ * @return sPolicyResult the result
+ */
+sPolicyResult cSweep::getResult(int rank)
+{
+	if(rank < 0 || rank >= POLICIES)
+		rank = 0;
+	return Result[rank];
+}
+
+/**
+ * @brief Returns the last error
+ *
+ * @param void
+ * @return const char* the error, empty if none
+ */
+const char* cSweep::getError(void)
+{
+	return Error;
+}
@@ -0,0 +1,177 @@
+/**
+ * @file telemwriter.cpp
+ * @brief Implementation of the writer of the shared memory telemetry ring
+ *
+ * Only open and close make system calls, a write is a copy into
+ * the mapped ring between two stores of the record sequence.
+ *
+ * @author Subir Biswas
+ * @date 19/10/2026
+ * @see telemwriter.hpp
+ */
+
+#include "../header/telemwriter.hpp"
+
+static_assert(TELEMAXCELLS >= MAXCELLS, "a telemetry record must hold every cell");
+
+/**
+ * @brief Constructor of the writer
+ *
+ * @param void
+ * @return void
+ */
+cTelemetryWriter::cTelemetryWriter()
+{
+	Name[0] = '\0';
+	Header = (sTelemetryHeader*)0;
+	Records = (sTelemetryRecord*)0;
+	Size = 0;
+	Head = 0;
+}
+
+/**
+ * @brief Destructor of the writer, closes the ring
+ *
+ * @param void
+ * @return void
+ */
+cTelemetryWriter::~cTelemetryWriter()
+{
+	close();
+}
+
+/**
+ * @brief Creates a ring
+ *
+ * An existing object of the same name is replaced.
+ * @param name	name of the shared memory object, starting with '/'
+ * @param slots	number of records, a power of two
+ * @return true successfully created
+ * @return false already open, invalid input or a system call failed
+ */
+bool cTelemetryWriter::open(const char* name, unsigned int slots)
+{
+	if(isOpen() || name[0] != '/' || strlen(name) >= sizeof(Name) || slots == 0 || (slots & (slots - 1)))
+		return false;
+	shm_unlink(name);
+	int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0644);
+	if(fd < 0)
+		return false;
+	Size = sizeof(sTelemetryHeader) + (size_t)slots * sizeof(sTelemetryRecord);
+	if(ftruncate(fd, Size) < 0)
+	{
+		::close(fd);
+		shm_unlink(name);
+		return false;
+	}
+	void* map = mmap((void*)0, Size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	::close(fd);
+	if(map == MAP_FAILED)
+	{
+		shm_unlink(name);
+		return false;
+	}
+	strcpy(Name, name);
+	Header = (sTelemetryHeader*)map;
+	Records = (sTelemetryRecord*)(Header + 1);
+	Head = 0;
+	Header->Version = TELEVERSION;
+	Header->Slots = slots;
+	Header->RecordSize = sizeof(sTelemetryRecord);
+	Header->MaxCells = TELEMAXCELLS;
+	Header->Closed = 0;
+	Header->Head = 0;
+	//readers check the magic last
+	__atomic_store_n(&Header->Magic, TELEMAGIC, __ATOMIC_RELEASE);
+	return true;
+}
+
+/**
+ * @brief Marks the ring finished and removes it
+ *
+ * Readers that have it mapped can still read the last records.
+ * @param void
+ * @return true successfully closed
+ * @return false the ring was not open
+ */
+bool cTelemetryWriter::close(void)
+{
+	if(!isOpen())
+		return false;
+	__atomic_store_n(&Header->Closed, 1, __ATOMIC_RELEASE);
+	munmap((void*)Header, Size);
+	shm_unlink(Name);
+	Header = (sTelemetryHeader*)0;
+	Records = (sTelemetryRecord*)0;
+	return true;
+}
+
+/**
+ * @brief Returns true if the ring is open
+ *
+ * @param void
+ * @return bool true if open
+ */
+bool cTelemetryWriter::isOpen(void)
+{
+	return (Header != (sTelemetryHeader*)0);
+}
+
+/**
+ * @brief Writes a step into the ring
+ *
+ * @param snapshot state of the battery after the step
+ * @return void
+ */
+void cTelemetryWriter::write(const sSnapshot& snapshot)
+{
+	if(!isOpen())
+		return;
+	sTelemetryRecord* record = &Records[Head & (Header->Slots - 1)];
+	int n = (snapshot.Count < TELEMAXCELLS) ? snapshot.Count : TELEMAXCELLS;
+	uint32_t switches = 0;
+	__atomic_store_n(&record->Sequence, 2*Head + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	record->Step = Head;
+	record->ElapsedTime = snapshot.ElapsedTime;
+	record->Vout = snapshot.Vout;
+	record->Iout = snapshot.Iout;
+	record->Load = snapshot.Load;
+	record->Count = n;
+	for(int i=0; i<TELEMAXCELLS; i++)
+	{
+		bool used = (i < n);
+		record->Voltage[i] = used ? snapshot.CurrentVoltage[i] : 0;
+		record->Current[i] = used ? snapshot.SourceCurrent[i] : 0;
+		record->Remaining[i] = used ? snapshot.RemainingCapacity[i] : 0;
+		switches |= (used && snapshot.Switch[i]) ? (1u << i) : 0;
+	}
+	record->Switches = switches;
+	record->Reserved = 0;
+	__atomic_store_n(&record->Sequence, 2*Head + 2, __ATOMIC_RELEASE);
+	Head++;
+	__atomic_store_n(&Header->Head, Head, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Returns the number of steps written
+ *
+ * @param void
+ * @return uint64_t steps written since open
+ */
+uint64_t cTelemetryWriter::getWritten(void)
+{
+	return Head;
+}
+
+/**
+ * @brief Step sink writing into a ring
+ *
+ * @param writer	the cTelemetryWriter
+ * @param snapshot	state of the battery after the step
+ * @return void
+ */
+void cTelemetryWriter::sink(void* writer, const sSnapshot& snapshot)
+{
+	((cTelemetryWriter*)writer)->write(snapshot);
+}
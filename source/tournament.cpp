@@ -0,0 +1,285 @@
+/**
+ * @file tournament.cpp
+ * @brief Implementation of the balancing policy tournament
+ *
+ * The policies are compile time template parameters of cPackModel,
+ * so each one is its own instantiation of runPolicy and the
+ * tournament picks them from a table of function pointers.
+ *
+ * @author Subir Biswas
+ * @date 19/10/2026
+ * @see tournament.hpp
+ */
+
+#include "../header/tournament.hpp"
+#include "../header/jobrunner.hpp"
+#include <algorithm>	// std::stable_sort
+
+/**
+ * @brief Runs a scenario till cut off with one policy
+ *
+ * @param scenario	the scenario
+ * @param runtime	simulated time till cut off in mS
+ * @param imbalance	spread of remaining capacity at cut off in %
+ * @return void
+ */
+template<typename Policy>
+static void runPolicy(const cScenario& scenario, double& runtime, double& imbalance)
+{
+	cPackModel<double, Policy> model;
+	scenario.build(model);
+	long steps = 0;
+	while(model.step(scenario.getLoad(), scenario.getResolution()) && ++steps < MAXSTEPS);
+	double lowest = model.getRemainingCapacityPercentage(0);
+	double highest = lowest;
+	for(int i=1; i<model.getCount(); i++)
+	{
+		double remaining = model.getRemainingCapacityPercentage(i);
+		lowest = (remaining < lowest) ? remaining : lowest;
+		highest = (remaining > highest) ? remaining : highest;
+	}
+	runtime = model.getElapsedTime();
+	imbalance = highest - lowest;
+}
+
+typedef void (*tPolicyRun)(const cScenario&, double&, double&);
+
+/**
+ * @brief The policies of the tournament
+ */
+static const tPolicyRun PolicyRun[POLICIES] = {
+	runPolicy< cVoltagePolicy<double> >,
+	runPolicy< cSocPolicy<double> >,
+	runPolicy< cResistancePolicy<double> >,
+	runPolicy< cPredictivePolicy<double> >
+};
+static const char* PolicyName[POLICIES] = {
+	cVoltagePolicy<double>::name(),
+	cSocPolicy<double>::name(),
+	cResistancePolicy<double>::name(),
+	cPredictivePolicy<double>::name()
+};
+
+/**
+ * @brief Constructor of the tournament
+ *
+ * @param void
+ * @return void
+ */
+cTournament::cTournament()
+{
+	Cache = (cResultCache*)0;
+	for(int p=0; p<POLICIES; p++)
+	{
+		Result[p].Name = PolicyName[p];
+		Result[p].MeanRunTime = 0;
+		Result[p].MeanImbalance = 0;
+		Result[p].WorstImbalance = 0;
+		Result[p].Wins = 0;
+	}
+}
+
+/**
+ * @brief Adds a scenario
+ *
+ * @param scenario the scenario, it is copied
+ * @return true successfully added
+ * @return false the scenario has no cells
+ */
+bool cTournament::addScenario(const cScenario& scenario)
+{
+	if(scenario.getCount() == 0)
+		return false;
+	Scenarios.push_back(scenario);
+	return true;
+}
+
+/**
+ * @brief Returns the number of scenarios
+ *
+ * @param void
+ * @return int number of scenarios
+ */
+int cTournament::getScenarioCount(void)
+{
+	return (int)Scenarios.size();
+}
+
+/**
+ * @brief Runs a job, policy job % POLICIES on scenario job / POLICIES
+ *
+ * Every job writes its own slot of the results, so jobs run on
+ * several threads need no lock. A job found in the cache is not run,
+ * a job that is run is saved.
+ * @param job the job
+ * @return void
+ */
+void cTournament::runJob(int job)
+{
+	const cScenario& scenario = Scenarios[job / POLICIES];
+	double values[2];
+	std::string key;
+	if(Cache != (cResultCache*)0)
+	{
+		key = cResultCache::key(scenario, PolicyName[job % POLICIES]);
+		if(Cache->load(key, values, 2, (std::vector<uint8_t>*)0))
+		{
+			RunTime[job] = values[0];
+			Imbalance[job] = values[1];
+			return;
+		}
+	}
+	PolicyRun[job % POLICIES](scenario, RunTime[job], Imbalance[job]);
+	if(Cache != (cResultCache*)0)
+	{
+		values[0] = RunTime[job];
+		values[1] = Imbalance[job];
+		Cache->save(key, values, 2, (std::vector<uint8_t>*)0);
+	}
+}
+
+/**
+ * @brief Runs every policy against every scenario
+ *
+ * @param threads number of threads to run the jobs on
+ * @return true successfully ran
+ * @return false no scenario is added or threads is less than 1
+ */
+bool cTournament::run(int threads)
+{
+	if(Scenarios.empty() || threads < 1)
+		return false;
+	int jobs = (int)Scenarios.size() * POLICIES;
+	RunTime.assign(jobs, 0);
+	Imbalance.assign(jobs, 0);
+	runJobs(jobs, threads, [this](int job) { runJob(job); });
+	rank();
+	return true;
+}
+
+/**
+ * @brief Sets the cache of the jobs
+ *
+ * @param cache the cache, null to run every job
+ * @return void
+ */
+void cTournament::setCache(cResultCache* cache)
+{
+	Cache = cache;
+}
+
+/**
+ * @brief Aggregates the jobs and ranks the policies
+ *
+ * @param void
+ * @return void
+ * @see rank(const double*, const double*, int, sPolicyResult*)
+ */
+void cTournament::rank(void)
+{
+	rank(&RunTime[0], &Imbalance[0], (int)Scenarios.size(), Result);
+}
+
+/**
+ * @brief Aggregates the runs of every policy on every scenario and ranks the policies
+ *
+ * The ranking of the tournament and of the sweep. Longer mean runtime
+ * ranks first, equal runtimes are ranked by the lower mean imbalance.
+ * A scenario is won by the policy with the longest runtime, the first
+ * one on a tie.
+ * @param runtimes	runtime of policy p on scenario s at s*POLICIES+p in mS
+ * @param imbalances	imbalance of policy p on scenario s at s*POLICIES+p in %
+ * @param scenarios	number of scenarios
+ * @param result	the POLICIES results, best first
+ * @return void
+ */
+void cTournament::rank(const double* runtimes, const double* imbalances, int scenarios, sPolicyResult* result)
+{
+	int p, s, best;
+	for(p=0; p<POLICIES; p++)
+	{
+		result[p].Name = PolicyName[p];
+		result[p].MeanRunTime = 0;
+		result[p].MeanImbalance = 0;
+		result[p].WorstImbalance = 0;
+		result[p].Wins = 0;
+	}
+	for(s=0; s<scenarios; s++)
+	{
+		best = 0;
+		for(p=0; p<POLICIES; p++)
+		{
+			double runtime = runtimes[s*POLICIES + p];
+			double imbalance = imbalances[s*POLICIES + p];
+			result[p].MeanRunTime += runtime / scenarios;
+			result[p].MeanImbalance += imbalance / scenarios;
+			if(imbalance > result[p].WorstImbalance)
+				result[p].WorstImbalance = imbalance;
+			if(runtime > runtimes[s*POLICIES + best])
+				best = p;
+		}
+		result[best].Wins++;
+	}
+	std::stable_sort(result, result + POLICIES, [](const sPolicyResult& a, const sPolicyResult& b) {
+		if(a.MeanRunTime != b.MeanRunTime)
+			return a.MeanRunTime > b.MeanRunTime;
+		return a.MeanImbalance < b.MeanImbalance;
+	});
+}
+
+/**
+ * @brief Returns the number of policies
+ *
+ * @param void
+ * @return int number of policies
+ */
+int cTournament::getPolicyCount(void)
+{
+	return POLICIES;
+}
+
+/**
+ * @brief Returns the result of a policy by rank
+ *
+ * @param rank 0 is the best policy of the last run
+ * @return sPolicyResult the result
+ */
+sPolicyResult cTournament::getResult(int rank)
+{
+	if(rank < 0 || rank >= POLICIES)
+		rank = 0;
+	return Result[rank];
+}
+
+/**
+ * @brief Returns the name of a policy
+ *
+ * @param policy index of the policy in the order it is run, not ranked
+ * @return const char* the name, empty if out of range
+ */
+const char* cTournament::getPolicyName(int policy)
+{
+	if(policy < 0 || policy >= POLICIES)
+		return "";
+	return PolicyName[policy];
+}
+
+/**
+ * @brief Returns the result of one policy on one scenario of the last run
+ *
+ * @param scenario	index of the scenario in the order it was added
+ * @param policy	index of the policy, see getPolicyName
+ * @param runtime	simulated time till cut off in mS
+ * @param imbalance	spread of remaining capacity at cut off in %
+ * @return true the job was run
+ * @return false out of range or not run
+ */
+bool cTournament::getRun(int scenario, int policy, double& runtime, double& imbalance)
+{
+	int job = scenario * POLICIES + policy;
+	if(scenario < 0 || policy < 0 || policy >= POLICIES || job >= (int)RunTime.size())
+		return false;
+	runtime = RunTime[job];
+	imbalance = Imbalance[job];
+	return true;
+}
@@ -0,0 +1,497 @@
+/**
+ * @file tracepreview.cpp
+ * @brief Implementation of the plotting preview of a run
+ *
+ * @author Subir Biswas
+ * @date 19/10/2026
+ * @see tracepreview.hpp
+ */
+
+#include "../header/tracepreview.hpp"
+#include <sstream>	// std::ostringstream
+#include <unistd.h>	// ftruncate
+#include <math.h>	// fabs
+#include <algorithm>	// std::swap
+#include <chrono>	// std::chrono::milliseconds
+
+/**
+ * @brief Returns the value of a channel in a snapshot
+ *
+ * @param snapshot	state of the battery after a step
+ * @param channel	0 for the output voltage, then the voltage and current of each cell
+ * @return double the value
+ */
+static double channelValue(const sSnapshot& snapshot, int channel)
+{
+	if(channel == 0)
+		return snapshot.Vout;
+	channel--;
+	return (channel % 2) ? snapshot.SourceCurrent[channel / 2] : snapshot.CurrentVoltage[channel / 2];
+}
+
+/**
+ * @brief Constructor of the preview, without a full trace
+ *
+ * @param void
+ * @return void
+ */
+cTracePreview::cTracePreview()
+{
+	Trace = (FILE*)0;
+	Lines = (cSpscQueue<sTraceLine, TRACELINES>*)0;
+	Writer = (std::thread*)0;
+	Stop = false;
+	Queued = 0;
+	Written = 0;
+	clear(0);
+}
+
+/**
+ * @brief Destructor of the preview, closes the full trace
+ *
+ * @param void
+ * @return void
+ */
+cTracePreview::~cTracePreview()
+{
+	close();
+}
+
+/**
+ * @brief Writes the full trace of the runs to a file as well
+ *
+ * A line per step: time in mS, output voltage, then voltage and current
+ * of each cell, then the switches as a number, bit i for cell i. The
+ * file holds the run of the preview, it is emptied when a run starts.
+ * Starts the thread that writes it.
+ * @param path the file, it is truncated
+ * @return true successfully opened
+ * @return false a trace is already written or the file can not be created
+ */
+bool cTracePreview::open(const char* path)
+{
+	std::lock_guard<std::mutex> guard(Lock);
+	if(Trace != (FILE*)0 || path == (const char*)0)
+		return false;
+	Trace = fopen(path, "w");
+	if(Trace == (FILE*)0)
+		return false;
+	Path = path;
+	clear(0);
+	Lines = new cSpscQueue<sTraceLine, TRACELINES>();
+	Stop = false;
+	Queued = 0;
+	Written = 0;
+	Writer = new std::thread(&cTracePreview::runWriter, this);
+	return true;
+}
+
+/**
+ * @brief Stops writing the full trace
+ *
+ * The steps queued so far are written before the file is closed.
+ * @param void
+ * @return true successfully closed
+ * @return false no trace is written
+ */
+bool cTracePreview::close(void)
+{
+	std::lock_guard<std::mutex> guard(Lock);
+	if(Trace == (FILE*)0)
+		return false;
+	Stop = true;
+	Writer->join();
+	delete Writer;
+	Writer = (std::thread*)0;
+	delete Lines;
+	Lines = (cSpscQueue<sTraceLine, TRACELINES>*)0;
+	fclose(Trace);
+	Trace = (FILE*)0;
+	Path.clear();
+	return true;
+}
+
+/**
+ * @brief Returns the path of the full trace
+ *
+ * @param void
+ * @return const char* the path, empty if no trace is written
+ */
+const char* cTracePreview::getPath(void)
+{
+	return Path.c_str();
+}
+
+/**
+ * @brief Starts an empty preview, called with the lock held
+ *
+ * Empties the trace as well, so it holds the same run as the preview.
+ * @param cells number of cells of the run
+ * @return void
+ */
+void cTracePreview::clear(int cells)
+{
+	Channels = (cells > 0) ? 1 + 2 * cells : 0;
+	Buckets.assign((size_t)Channels * PREVBUCKETS, sBucket());
+	Used = 0;
+	Width = 1;
+	Fill = 1;
+	Samples = 0;
+	Last = 0;
+	if(Writer != (std::thread*)0)
+	{
+		sTraceLine empty;
+		empty.Channels = 0;
+		queue(empty);
+	}
+}
+
+/**
+ * @brief Queues a line for the trace writer, called with the lock held
+ *
+ * Waits while the queue is full, the writer needs no lock to drain it.
+ * @param line the line
+ * @return void
+ */
+void cTracePreview::queue(const sTraceLine& line)
+{
+	while(!Lines->push(line))
+		std::this_thread::yield();
+	Queued++;
+}
+
+/**
+ * @brief Writes the queued lines to the trace till close
+ *
+ * Formats the lines into a buffer and writes it when it is full or
+ * the queue is empty, then flushes the file.
+ * @param void
+ * @return void
+ */
+void cTracePreview::runWriter(void)
+{
+	std::vector<char> text(TRACEBUFFER);
+	sTraceLine line;
+	while(true)
+	{
+		bool stop = Stop;
+		size_t used = 0;
+		unsigned long taken = 0;
+		while(Lines->pop(line))
+		{
+			taken++;
+			if(line.Channels == 0)
+			{
+				fwrite(&text[0], 1, used, Trace);
+				used = 0;
+				fflush(Trace);
+				if(ftruncate(fileno(Trace), 0) == 0)
+					rewind(Trace);
+				continue;
+			}
+			used += snprintf(&text[used], TRACEBUFFER - used, "%.0f", line.Time);
+			for(int c=0; c<line.Channels; c++)
+				used += snprintf(&text[used], TRACEBUFFER - used, ",%.6f", line.Value[c]);
+			used += snprintf(&text[used], TRACEBUFFER - used, ",%lu\n", line.Switches);
+			if(used > TRACEBUFFER - TRACELINE)
+			{
+				fwrite(&text[0], 1, used, Trace);
+				used = 0;
+			}
+		}
+		if(taken > 0)
+		{
+			fwrite(&text[0], 1, used, Trace);
+			fflush(Trace);
+			Written += taken;
+		}
+		else if(stop)
+			break;
+		else
+			std::this_thread::sleep_for(std::chrono::milliseconds(TRACEPOLL));
+	}
+}
+
+/**
+ * @brief Merges neighbouring buckets, called with the lock held
+ *
+ * @param void
+ * @return void
+ */
+void cTracePreview::merge(void)
+{
+	for(int c=0; c<Channels; c++)
+	{
+		sBucket* bucket = &Buckets[(size_t)c * PREVBUCKETS];
+		for(int b=0; b<Used/2; b++)
+		{
+			const sBucket& first = bucket[2*b];
+			const sBucket& second = bucket[2*b + 1];
+			sBucket merged = first;
+			if(second.Min < merged.Min)
+			{
+				merged.Min = second.Min;
+				merged.MinTime = second.MinTime;
+			}
+			if(second.Max > merged.Max)
+			{
+				merged.Max = second.Max;
+				merged.MaxTime = second.MaxTime;
+			}
+			bucket[b] = merged;
+		}
+	}
+	Used /= 2;
+	Width *= 2;
+}
+
+/**
+ * @brief Records a step
+ *
+ * @param snapshot state of the battery after the step
+ * @return void
+ */
+void cTracePreview::record(const sSnapshot& snapshot)
+{
+	std::lock_guard<std::mutex> guard(Lock);
+	int c;
+	if(Channels != 1 + 2 * snapshot.Count || snapshot.ElapsedTime < Last)
+		clear(snapshot.Count);
+	if(Fill == Width)
+	{
+		if(Used == PREVBUCKETS)
+			merge();
+		Used++;
+		Fill = 0;
+	}
+	for(c=0; c<Channels; c++)
+	{
+		sBucket& bucket = Buckets[(size_t)c * PREVBUCKETS + Used - 1];
+		double value = channelValue(snapshot, c);
+		if(Fill == 0 || value < bucket.Min)
+		{
+			bucket.Min = value;
+			bucket.MinTime = snapshot.ElapsedTime;
+		}
+		if(Fill == 0 || value > bucket.Max)
+		{
+			bucket.Max = value;
+			bucket.MaxTime = snapshot.ElapsedTime;
+		}
+	}
+	Fill++;
+	Samples++;
+	Last = snapshot.ElapsedTime;
+	if(Writer != (std::thread*)0)
+	{
+		sTraceLine line;
+		line.Time = snapshot.ElapsedTime;
+		line.Channels = Channels;
+		for(c=0; c<Channels; c++)
+			line.Value[c] = channelValue(snapshot, c);
+		line.Switches = 0;
+		for(c=0; c<snapshot.Count; c++)
+			line.Switches |= (unsigned long)snapshot.Switch[c] << c;
+		queue(line);
+	}
+}
+
+/**
+ * @brief Step sink recording into a preview
+ *
+ * @param preview	the cTracePreview
+ * @param snapshot	state of the battery after the step
+ * @return void
+ */
+void cTracePreview::sink(void* preview, const sSnapshot& snapshot)
+{
+	((cTracePreview*)preview)->record(snapshot);
+}
+
+/**
+ * @brief Returns the number of channels of the run
+ *
+ * @param void
+ * @return int number of channels, 0 before the first step
+ */
+int cTracePreview::getChannels(void)
+{
+	std::lock_guard<std::mutex> guard(Lock);
+	return Channels;
+}
+
+/**
+ * @brief Returns the name of a channel
+ *
+ * @param channel index of the channel
+ * @return std::string vout, then v<cell> and i<cell>
+ */
+std::string cTracePreview::getName(int channel)
+{
+	std::ostringstream name;
+	if(channel == 0)
+		name <<"vout";
+	else
+		name <<(((channel - 1) % 2) ? "i" : "v") <<(channel - 1) / 2;
+	return name.str();
+}
+
+/**
+ * @brief Lists the minima and maxima of a channel in time order, called with the lock held
+ *
+ * A bucket whose extremes fall on one step gives one point.
+ * @param channel	index of the channel
+ * @param points	the points
+ * @return void
+ */
+void cTracePreview::extremes(int channel, std::vector<sPreviewPoint>& points)
+{
+	const sBucket* bucket = &Buckets[(size_t)channel * PREVBUCKETS];
+	points.clear();
+	for(int b=0; b<Used; b++)
+	{
+		sPreviewPoint low = {bucket[b].MinTime, bucket[b].Min};
+		sPreviewPoint high = {bucket[b].MaxTime, bucket[b].Max};
+		if(high.Time < low.Time)
+			std::swap(low, high);
+		points.push_back(low);
+		if(high.Time != low.Time)
+			points.push_back(high);
+	}
+}
+
+/**
+ * @brief Reduces points with largest triangle three buckets
+ *
+ * Keeps the first and the last point. The points between are split
+ * into count-2 buckets, from each the point that makes the largest
+ * triangle with the point kept before it and the mean of the next
+ * bucket is kept.
+ * @param points	the points in time order
+ * @param count		number of points to keep, at least 3
+ * @param reduced	the kept points
+ * @return void
+ */
+void cTracePreview::reduce(const std::vector<sPreviewPoint>& points, int count, std::vector<sPreviewPoint>& reduced)
+{
+	int n = (int)points.size();
+	reduced.clear();
+	if(count < 3 || n <= count)
+	{
+		reduced = points;
+		return;
+	}
+	double every = (double)(n - 2) / (count - 2);
+	int kept = 0;
+	reduced.push_back(points[0]);
+	for(int b=0; b<count-2; b++)
+	{
+		int start = 1 + (int)(b * every);
+		int end = 1 + (int)((b + 1) * every);
+		int nextStart = end;
+		int nextEnd = (b + 2 < count - 1) ? 1 + (int)((b + 2) * every) : n;
+		double meanTime = 0, meanValue = 0;
+		for(int p=nextStart; p<nextEnd; p++)
+		{
+			meanTime += points[p].Time;
+			meanValue += points[p].Value;
+		}
+		meanTime /= (nextEnd - nextStart);
+		meanValue /= (nextEnd - nextStart);
+		double largest = -1;
+		int chosen = start;
+		for(int p=start; p<end; p++)
+		{
+			double area = fabs((points[kept].Time - meanTime) * (points[p].Value - points[kept].Value)
+				- (points[kept].Time - points[p].Time) * (meanValue - points[kept].Value));
+			if(area > largest)
+			{
+				largest = area;
+				chosen = p;
+			}
+		}
+		reduced.push_back(points[chosen]);
+		kept = chosen;
+	}
+	reduced.push_back(points[n-1]);
+}
+
+/**
+ * @brief Returns the preview of a channel
+ *
+ * @param channel	index of the channel
+ * @param lttb		true for one point per bucket by LTTB, false for the minima and maxima
+ * @param points	the points in time order
+ * @return true successfully returned
+ * @return false the channel is not recorded
+ */
+bool cTracePreview::getPoints(int channel, bool lttb, std::vector<sPreviewPoint>& points)
+{
+	std::lock_guard<std::mutex> guard(Lock);
+	if(channel < 0 || channel >= Channels)
+		return false;
+	if(!lttb)
+	{
+		extremes(channel, points);
+		return true;
+	}
+	std::vector<sPreviewPoint> candidates;
+	extremes(channel, candidates);
+	reduce(candidates, Used, points);
+	return true;
+}
+
+/**
+ * @brief Writes the preview of every channel
+ *
+ * A line per point: channel name, time in mS and value. Waits till
+ * the writer has flushed the full trace, so it is complete up to the
+ * preview.
+ * @param out	stream to write to
+ * @param lttb	true for one point per bucket by LTTB, false for the minima and maxima
+ * @return true successfully written
+ * @return false nothing is recorded
+ */
+bool cTracePreview::write(std::ostream& out, bool lttb)
+{
+	std::vector<sPreviewPoint> points;
+	int channels = getChannels();
+	if(channels == 0)
+		return false;
+	unsigned long queued;
+	{
+		std::lock_guard<std::mutex> guard(Lock);
+		queued = Queued;
+	}
+	while(Written < queued)
+		std::this_thread::sleep_for(std::chrono::milliseconds(TRACEPOLL));
+	out <<"channel,time_ms,value\n";
+	for(int c=0; c<channels; c++)
+	{
+		if(!getPoints(c, lttb, points))
+			return false;
+		std::string name = getName(c);
+		for(size_t p=0; p<points.size(); p++)
+			out <<name <<"," <<(long)points[p].Time <<"," <<points[p].Value <<"\n";
+	}
+	out.flush();
+	return true;
+}
+
+/**
+ * @brief Returns the size of the preview
+ *
+ * @param void
+ * @return sPreviewStats the size
+ */
+sPreviewStats cTracePreview::getStats(void)
+{
+	std::lock_guard<std::mutex> guard(Lock);
+	sPreviewStats stats;
+	stats.Samples = Samples;
+	stats.Buckets = Used;
+	stats.Width = Width;
+	stats.Channels = Channels;
+	stats.Bytes = Buckets.size() * sizeof(sBucket);
+	return stats;
+}
@@ -0,0 +1,196 @@
+/**
+ * @file watcher.cpp
+ * @brief Implementation of the watches of the command line
+ *
+ * @author Subir Biswas
+ * @date 19/10/2026
+ * @see watcher.hpp
+ */
+
+#include "../header/watcher.hpp"
+#include <sstream>	// std::ostringstream
+#include <iomanip>	// std::setprecision
+
+/**
+ * @brief Constructor of the watcher, starts the output thread
+ *
+ * @param battery	battery whose snapshots are printed
+ * @param format	prints the value of a key
+ * @param out		stream the watches print to
+ * @return void
+ */
+cWatcher::cWatcher(cBattery* battery, tWatchFormat format, std::ostream& out) : Out(out)
+{
+	Battery = battery;
+	Format = format;
+	Reads = 0;
+	Quit = false;
+	Output = new std::thread(&cWatcher::runOutput, this);
+}
+
+/**
+ * @brief Destructor of the watcher, ends the output thread
+ *
+ * @param void
+ * @return void
+ */
+cWatcher::~cWatcher()
+{
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		Quit = true;
+	}
+	Changed.notify_one();
+	Output->join();
+	delete Output;
+}
+
+/**
+ * @brief Starts or changes a watch
+ *
+ * A key already watched gets the new interval.
+ * @param key		the key, as accepted by the format function
+ * @param interval	interval in miliseconds, at least WATCHMININTERVAL
+ * @return true successfully started
+ * @return false the interval is too short or the key can not be printed
+ */
+bool cWatcher::watch(int key, double interval)
+{
+	if(interval < WATCHMININTERVAL)
+		return false;
+	std::ostringstream probe;
+	if(!Format(key, sSnapshot(), probe))
+		return false;
+	sWatch entry;
+	entry.Key = key;
+	entry.Interval = std::chrono::microseconds((long long)(interval * 1000));
+	entry.Due = std::chrono::steady_clock::now();
+	entry.Version = 0;
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		size_t w;
+		for(w=0; w<Watches.size() && Watches[w].Key != key; w++);
+		if(w == Watches.size())
+			Watches.push_back(entry);
+		else
+			Watches[w].Interval = entry.Interval;
+	}
+	Changed.notify_one();
+	return true;
+}
+
+/**
+ * @brief Stops a watch
+ *
+ * @param key the key
+ * @return true successfully stopped
+ * @return false the key was not watched
+ */
+bool cWatcher::unwatch(int key)
+{
+	std::lock_guard<std::mutex> lock(mtx);
+	for(size_t w=0; w<Watches.size(); w++)
+	{
+		if(Watches[w].Key == key)
+		{
+			Watches.erase(Watches.begin() + w);
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * @brief Stops every watch
+ *
+ * @param void
+ * @return int number of watches stopped
+ */
+int cWatcher::unwatchAll(void)
+{
+	std::lock_guard<std::mutex> lock(mtx);
+	int count = (int)Watches.size();
+	Watches.clear();
+	return count;
+}
+
+/**
+ * @brief Returns the number of active watches
+ *
+ * @param void
+ * @return int number of watches
+ */
+int cWatcher::getCount(void)
+{
+	std::lock_guard<std::mutex> lock(mtx);
+	return (int)Watches.size();
+}
+
+/**
+ * @brief Returns the number of snapshot reads of the output thread
+ *
+ * @param void
+ * @return unsigned long reads since start
+ */
+unsigned long cWatcher::getReadCount(void)
+{
+	std::lock_guard<std::mutex> lock(mtx);
+	return Reads;
+}
+
+/**
+ * @brief The output thread
+ *
+ * Sleeps till the earliest watch is due, reads one snapshot for all
+ * the watches due at that tick or within WATCHSLACK of it and prints
+ * them in one write. A watch that fell behind skips the missed ticks.
+ * @param void
+ * @return void
+ */
+void cWatcher::runOutput(void)
+{
+	std::unique_lock<std::mutex> lock(mtx);
+	while(!Quit)
+	{
+		if(Watches.empty())
+		{
+			Changed.wait(lock);
+			continue;
+		}
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		std::chrono::steady_clock::time_point due = Watches[0].Due;
+		for(size_t w=1; w<Watches.size(); w++)
+			due = (Watches[w].Due < due) ? Watches[w].Due : due;
+		if(now < due)
+		{
+			Changed.wait_until(lock, due);
+			continue;
+		}
+
+		sSnapshot snapshot = Battery->getSnapshot();
+		Reads++;
+		std::ostringstream text;
+		std::chrono::steady_clock::time_point tick = now + std::chrono::milliseconds(WATCHSLACK);
+		for(size_t w=0; w<Watches.size(); w++)
+		{
+			sWatch& entry = Watches[w];
+			if(tick < entry.Due)
+				continue;
+			if(entry.Version != snapshot.Version)
+			{
+				Format(entry.Key, snapshot, text);
+				entry.Version = snapshot.Version;
+			}
+			entry.Due += entry.Interval;
+			if(entry.Due < now)
+				entry.Due = now + entry.Interval;
+		}
+		if(text.tellp() <= 0)
+			continue;
+		lock.unlock();
+		std::ostringstream header;
+		header <<std::fixed <<std::setprecision(1) <<"\n[watch " <<snapshot.ElapsedTime/1000 <<" s]\n";
+		Out <<header.str() <<text.str() <<std::flush;
+		lock.lock();
+	}
+}
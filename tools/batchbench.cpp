@@ -0,0 +1,261 @@
+/**
+ * @file batchbench.cpp
+ * @brief Check and throughput benchmark of the cell batch kernels
+ *
+ * Runs every kernel of cCellBatch the CPU supports against the scalar
+ * reference with cCellBatch::verify, step by step over a discharge with
+ * random currents and switches, and fails if a kernel differs by more
+ * than BATCHTOLERANCE. Then times every kernel on a batch that fits in
+ * the cache and on one that does not, and reports cells and bytes per
+ * second beside the bandwidth of the memory. An update reads 8 and
+ * writes 4 doubles per cell, so the bandwidth is measured with a stream
+ * of the same arrays that moves the same doubles with additions only,
+ * vectorised where the CPU has AVX2. Once the batch is out of the cache
+ * a kernel can not be faster than that stream, a kernel near 100 % is
+ * bound by the memory.
+ *
+ * Usage: batchbench [-c]
+ *	-c only checks the kernels. The exit status is 0 if every
+ *	kernel is within the tolerance.
+ *
+ * @author Subir Biswas
+ * @date 19/10/2026
+ * @see cellbatch.hpp
+ */
+
+#include "../header/cellbatch.hpp"
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <stdlib.h>
+#include <string.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BENCHX86
+#endif
+
+#define CHECKCELLS	1003		///<Cells of the check, not a multiple of the padding
+#define CHECKSTEPS	2000		///<Steps of the check
+#define CACHECELLS	4096		///<Cells of the batch that fits in the cache
+#define MEMORYCELLS	(1 << 22)	///<Cells of the batch that does not, 300 MB
+#define CELLBYTES	96		///<Bytes an update reads and writes per cell
+#define BENCHTIME	0.3		///<Seconds a measurement runs at least
+
+/**
+ * @brief Draws the next number of a linear congruential generator
+ *
+ * @param seed state of the generator, updated
+ * @return double number from 0 to below 1
+ */
+double draw(unsigned int& seed)
+{
+	seed = seed * 1103515245U + 12345U;
+	return (double)((seed >> 8) & 0xFFFF) / 0x10000;
+}
+
+/**
+ * @brief Loads random cells and currents into a batch
+ *
+ * The generator is seeded, so every kernel gets the same batch.
+ * @param batch	the batch
+ * @param seed	state of the generator, updated
+ * @return void
+ */
+void fill(cCellBatch& batch, unsigned int& seed)
+{
+	cSingleBatt cell;
+	for(int i=0; i<batch.getCount(); i++)
+	{
+		cell.setInitialVoltage(11.5 + 3 * draw(seed));
+		cell.setCapacity(600 + 400 * draw(seed));
+		batch.setCell(i, &cell);
+		batch.setCurrent(i, draw(seed) < 0.75, 0.05 + 0.1 * draw(seed));
+	}
+}
+
+/**
+ * @brief Checks a kernel against the scalar reference
+ *
+ * Every step switches and loads the cells at random and compares the
+ * kernel with the reference run from the same state.
+ * @param kernel the kernel
+ * @return double largest relative difference of all the steps
+ */
+double check(int kernel)
+{
+	cCellBatch batch(CHECKCELLS);
+	unsigned int seed = 2026;
+	double worst = 0, diff;
+	batch.setKernel(kernel);
+	fill(batch, seed);
+	for(int step=0; step<CHECKSTEPS; step++)
+	{
+		for(int i=0; i<CHECKCELLS; i++)
+			batch.setCurrent(i, draw(seed) < 0.75, 0.05 + 0.1 * draw(seed));
+		diff = batch.verify(1000);
+		worst = (diff > worst) ? diff : worst;
+	}
+	return worst;
+}
+
+/**
+ * @brief Times the updates of a kernel
+ *
+ * @param kernel	the kernel
+ * @param cells		cells of the batch
+ * @return double cells updated per second
+ */
+double measure(int kernel, int cells)
+{
+	cCellBatch batch(cells);
+	unsigned int seed = 2026;
+	long updates = 0;
+	double elapsed = 0;
+	batch.setKernel(kernel);
+	fill(batch, seed);
+	batch.update(1);
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	while(elapsed < BENCHTIME)
+	{
+		for(int k=0; k<10; k++)
+			batch.update(1);
+		updates += 10;
+		elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+	return (double)cells * updates / elapsed;
+}
+
+/**
+ * @brief Moves the doubles of a cell update with additions only
+ *
+ * Reads and writes the arrays the way the kernels do: 8 reads and 4
+ * writes per cell, 3 of them in place.
+ * @param n number of cells, a multiple of 4
+ * @param a the 9 arrays
+ * @return void
+ */
+void streamPortable(int n, double** a)
+{
+	for(int i=0; i<n; i++)
+	{
+		a[3][i] += a[7][i];
+		a[4][i] += a[0][i];
+		a[5][i] += a[1][i] + a[2][i];
+		a[6][i] = a[8][i];
+	}
+}
+
+#ifdef BENCHX86
+/**
+ * @brief AVX2 stream, 4 cells at a time
+ *
+ * @see streamPortable
+ */
+__attribute__((target("avx2")))
+void streamAvx2(int n, double** a)
+{
+	for(int i=0; i<n; i+=4)
+	{
+		_mm256_store_pd(a[3]+i, _mm256_add_pd(_mm256_load_pd(a[3]+i), _mm256_load_pd(a[7]+i)));
+		_mm256_store_pd(a[4]+i, _mm256_add_pd(_mm256_load_pd(a[4]+i), _mm256_load_pd(a[0]+i)));
+		_mm256_store_pd(a[5]+i, _mm256_add_pd(_mm256_load_pd(a[5]+i),
+			_mm256_add_pd(_mm256_load_pd(a[1]+i), _mm256_load_pd(a[2]+i))));
+		_mm256_store_pd(a[6]+i, _mm256_load_pd(a[8]+i));
+	}
+}
+#endif
+
+/**
+ * @brief Measures the memory bandwidth of a cell update
+ *
+ * Streams arrays as large as those of the batch that does not fit in
+ * the cache.
+ * @param void
+ * @return double bytes per second
+ */
+double bandwidth(void)
+{
+	double* a[9];
+	long passes = 0;
+	double elapsed = 0;
+	void (*stream)(int, double**) = streamPortable;
+#ifdef BENCHX86
+	if(cCellBatch::detectKernel() >= KERNEL_AVX2)
+		stream = streamAvx2;
+#endif
+	for(int k=0; k<9; k++)
+	{
+		void* p = (void*)0;
+		if(posix_memalign(&p, 64, (size_t)MEMORYCELLS * sizeof(double)) != 0)
+		{
+			while(k > 0)
+				free(a[--k]);
+			return 0;
+		}
+		a[k] = (double*)p;
+		for(int i=0; i<MEMORYCELLS; i++)
+			a[k][i] = 1;
+	}
+	stream(MEMORYCELLS, a);
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	while(elapsed < BENCHTIME)
+	{
+		stream(MEMORYCELLS, a);
+		passes++;
+		elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+	for(int k=0; k<9; k++)
+		free(a[k]);
+	return (double)MEMORYCELLS * CELLBYTES * passes / elapsed;
+}
+
+int main(int argc, char** argv)
+{
+	bool checkOnly = false;
+	if(argc == 2 && !strcmp(argv[1], "-c"))
+		checkOnly = true;
+	else if(argc != 1)
+	{
+		std::cout <<"Usage: " <<argv[0] <<" [-c]" <<std::endl;
+		return 2;
+	}
+	cCellBatch names(1);
+	int kernels = cCellBatch::detectKernel();
+	int failed = 0;
+	std::cout <<"Kernel     Worst difference  Result\n";
+	for(int kernel=KERNEL_PORTABLE; kernel<=kernels; kernel++)
+	{
+		double worst = check(kernel);
+		names.setKernel(kernel);
+		std::cout <<std::left <<std::setw(11) <<names.getKernelName() <<std::right <<std::scientific <<std::setprecision(2)
+		<<std::setw(16) <<worst <<"  " <<((worst <= BATCHTOLERANCE) ? "passed" : "FAILED") <<"\n";
+		failed += (worst <= BATCHTOLERANCE) ? 0 : 1;
+	}
+	std::cout <<kernels + 1 - failed <<" of " <<kernels + 1 <<" kernels within " <<BATCHTOLERANCE
+	<<" of the scalar reference in " <<CHECKSTEPS <<" steps of " <<CHECKCELLS <<" cells" <<std::endl;
+	if(failed || checkOnly)
+		return failed ? 1 : 0;
+
+	double memory = bandwidth();
+	if(memory <= 0)
+	{
+		std::cout <<"Can not allocate the stream." <<std::endl;
+		return 2;
+	}
+	std::cout <<std::fixed <<"\nKernel         Cells  Mcells/s    GB/s  Of memory\n";
+	for(int kernel=KERNEL_PORTABLE; kernel<=kernels; kernel++)
+	{
+		names.setKernel(kernel);
+		const int sizes[2] = {CACHECELLS, MEMORYCELLS};
+		for(int s=0; s<2; s++)
+		{
+			double rate = measure(kernel, sizes[s]);
+			std::cout <<std::left <<std::setw(11) <<names.getKernelName() <<std::right <<std::setw(9) <<sizes[s]
+			<<std::setprecision(1) <<std::setw(10) <<rate / 1e6 <<std::setw(8) <<rate * CELLBYTES / 1e9
+			<<std::setw(10) <<100 * rate * CELLBYTES / memory <<"%\n";
+		}
+	}
+	std::cout <<"Memory bandwidth " <<std::setprecision(1) <<memory / 1e9 <<" GB/s streaming the arrays of "
+	<<MEMORYCELLS <<" cells, " <<CELLBYTES <<" bytes per cell update" <<std::endl;
+	return 0;
+}
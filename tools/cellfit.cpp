@@ -0,0 +1,149 @@
+/**
+ * @file cellfit.cpp
+ * @brief Fits the cell parameters of the simulator to recorded discharges
+ *
+ * Reads one discharge log per cell, fits the initial voltage, the
+ * series resistance and the capacity of every cell with cCellFit on
+ * all cores and prints the parameters with the remaining voltage error.
+ * With -g it writes logs of cells with known parameters instead, a
+ * pulsed load discharge with measurement noise, to try the fit on.
+ *
+ * Usage: cellfit [-s <starts>] [-t <threads>] [-i <interval ms>] <log>...
+ *	  cellfit -g <prefix> [-n <cells>]
+ *
+ * @author Subir Biswas
+ * @date 19/10/2026
+ * @see cellfit.hpp
+ */
+
+#include "../header/cellfit.hpp"
+#include "../header/cellkernel.hpp"
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <random>
+#include <chrono>
+#include <thread>
+#include <stdlib.h>
+#include <string.h>
+
+#define GENCUTOFF	8	///<Generated logs end at this terminal voltage in Volts
+#define GENPERIOD	60000	///<The generated load switches between its two values after this many mS
+
+/**
+ * @brief Writes logs of cells with known parameters
+ *
+ * The load switches between 150 and 75 Ohm every minute so the drop
+ * over the series resistance shows. Measured every second with 5 mV
+ * and 0.5 mA of noise.
+ * @param prefix	the logs are written to <prefix><cell>.csv
+ * @param cells		number of cells
+ * @return int exit status
+ */
+int generate(const char* prefix, int cells)
+{
+	std::mt19937 random(7);
+	std::uniform_real_distribution<double> spread(0, 1);
+	std::normal_distribution<double> voltageNoise(0, 0.005);
+	std::normal_distribution<double> currentNoise(0, 0.0005);
+	std::cout <<"Cell   File                    Init V(V)   Res(Ohm)   Cap(mAH)\n" <<std::fixed;
+	for(int c=0; c<cells; c++)
+	{
+		double initv = 12 + 1.5 * spread(random);
+		double sres = 10 + 30 * spread(random);
+		double cap = 600 + 400 * spread(random);
+		std::ostringstream name;
+		name <<prefix <<c+1 <<".csv";
+		std::ofstream out(name.str().c_str());
+		if(!out)
+		{
+			std::cout <<"Can not write " <<name.str() <<std::endl;
+			return 1;
+		}
+		double grad = cellGradient<double>(initv, cap*3600, 95, 10);
+		double dis = 0, rem = 100, volt = initv, current, terminal;
+		out <<"# time ms, current A, voltage V\n" <<std::setprecision(6);
+		for(long t=0; t<24L*3600000; t+=1000)
+		{
+			current = volt / ((((t / GENPERIOD) & 1) ? 75 : 150) + sres);
+			terminal = volt - current * sres;
+			if(terminal < GENCUTOFF)
+				break;
+			out <<t <<"," <<current + currentNoise(random) <<"," <<terminal + voltageNoise(random) <<"\n";
+			cellUpdate<double>(dis, rem, volt, cap*3600, grad, 0, current, 1000);
+		}
+		std::cout <<std::setw(4) <<c+1 <<"   " <<std::left <<std::setw(22) <<name.str() <<std::right
+		<<std::setprecision(3) <<std::setw(11) <<initv <<std::setw(11) <<sres <<std::setw(11) <<cap <<"\n";
+	}
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	int starts = 16, cells = 16;
+	unsigned int threads = std::thread::hardware_concurrency();
+	double interval = 1000;
+	const char* prefix = (const char*)0;
+	std::vector<const char*> paths;
+
+	for(int a=1; a<argc; a++)
+	{
+		if(!strcmp(argv[a], "-g") && a+1 < argc)
+			prefix = argv[++a];
+		else if(!strcmp(argv[a], "-n") && a+1 < argc)
+			cells = atoi(argv[++a]);
+		else if(!strcmp(argv[a], "-s") && a+1 < argc)
+			starts = atoi(argv[++a]);
+		else if(!strcmp(argv[a], "-t") && a+1 < argc)
+			threads = atoi(argv[++a]);
+		else if(!strcmp(argv[a], "-i") && a+1 < argc)
+			interval = atof(argv[++a]);
+		else
+			paths.push_back(argv[a]);
+	}
+	if(prefix != (const char*)0 && cells > 0)
+		return generate(prefix, cells);
+	if(paths.empty() || starts < 1 || interval <= 0)
+	{
+		std::cout <<"Usage: " <<argv[0] <<" [-s <starts>] [-t <threads>] [-i <interval ms>] <log>...\n"
+		<<"       " <<argv[0] <<" -g <prefix> [-n <cells>]" <<std::endl;
+		return 2;
+	}
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	std::vector<cDischargeLog> logs(paths.size());
+	cCellFit fit;
+	fit.setStarts(starts);
+	for(size_t p=0; p<paths.size(); p++)
+	{
+		if(!logs[p].load(paths[p], interval) || !fit.addLog(&logs[p]))
+		{
+			std::cout <<"Can not read " <<paths[p] <<std::endl;
+			return 1;
+		}
+	}
+	double read = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	if(!fit.run(threads ? threads : 1))
+	{
+		std::cout <<"Fit failed." <<std::endl;
+		return 1;
+	}
+	double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() - read;
+
+	long evaluations = 0;
+	std::cout <<"Cell   File                    Lines  Intervals   Init V(V)   Res(Ohm)   Cap(mAH)  RMS(mV)  Converged\n" <<std::fixed;
+	for(int c=0; c<fit.getCount(); c++)
+	{
+		const sFitResult& result = fit.getResult(c);
+		evaluations += result.Evaluations;
+		std::cout <<std::setw(4) <<c+1 <<"   " <<std::left <<std::setw(22) <<logs[c].getPath() <<std::right
+		<<std::setw(7) <<logs[c].getLines() <<std::setw(11) <<logs[c].getCount()
+		<<std::setprecision(3) <<std::setw(12) <<result.Parameter[FITINITV] <<std::setw(11) <<result.Parameter[FITSRES]
+		<<std::setw(11) <<result.Parameter[FITCAP] <<std::setw(9) <<result.Error*1000
+		<<std::setw(7) <<result.Converged <<"/" <<starts <<"\n";
+	}
+	std::cout <<fit.getCount() <<" cells, " <<starts <<" starts each, " <<evaluations <<" simulations on "
+	<<(threads ? threads : 1) <<" threads in " <<std::setprecision(2) <<wall <<" s, logs read in " <<read <<" s" <<std::endl;
+	return 0;
+}
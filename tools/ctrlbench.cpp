@@ -0,0 +1,193 @@
+/**
+ * @file ctrlbench.cpp
+ * @brief Cycle count benchmark of the balancing controller
+ *
+ * Measures the cycles of one balancing decision for a set of
+ * measurement patterns and cell counts, and fails if the worst case
+ * exceeds the cycle budget. Every decision is timed on its own, so the
+ * expensive ones are not averaged away: with a window of 100 decisions
+ * the hundredth closes the toggle window and bins the toggle counts.
+ * A repetition runs the decisions of one window, which do the same
+ * work in every repetition. The cycles of each decision of the window
+ * is its minimum over the repetitions, which filters out interrupts and
+ * cache misses of the host, and the cycles of a pattern is the most
+ * expensive decision of the window. The highest single sample, with
+ * the noise of the host, is printed beside. The toggling pattern flips
+ * every switch on every decision with a window of one decision, so
+ * every decision closes a window, the worst case of the toggle counting.
+ *
+ * Usage: ctrlbench [budget in cycles]
+ *
+ * @author Subir Biswas
+ * @date 19/10/2026
+ * @see balancectrl.hpp
+ */
+
+#include "../header/balancectrl.hpp"
+#include "../header/cellkernel.hpp"
+#include <iostream>
+#include <iomanip>
+#include <stdlib.h>
+#include <x86intrin.h>	// __rdtsc
+
+#define CTRLCYCLEBUDGET	400	///<Default budget of one decision in cycles
+#define REPETITIONS	2000	///<Repetitions of a measurement
+#define DECISIONS	100	///<Decisions of a repetition, one toggle window
+#define PATTERNS	6	///<Number of measurement patterns
+
+const char* patternNames[PATTERNS] = {"equal", "ascending", "descending", "band edge", "random", "toggling"};
+
+/**
+ * @brief Reads the time stamp counter in order
+ *
+ * @param void
+ * @return unsigned long long cycles
+ */
+static inline unsigned long long cycles(void)
+{
+	_mm_lfence();
+	unsigned long long c = __rdtsc();
+	_mm_lfence();
+	return c;
+}
+
+/**
+ * @brief Fills the measurements of a pattern
+ *
+ * The decisions alternate between the two sets of measurements.
+ * @param pattern	index of the pattern
+ * @param n		number of cells
+ * @param volts		first set of measurements, output
+ * @param other		second set of measurements, output
+ * @return void
+ */
+template<typename T>
+static void fillPattern(int pattern, int n, T* volts, T* other)
+{
+	for(int i=0; i<n; i++)
+	{
+		switch(pattern)
+		{
+			case 0:	volts[i] = T(12.0); break;
+			case 1:	volts[i] = T(12.0 + 0.01*i); break;
+			case 2:	volts[i] = T(12.0 - 0.01*i); break;
+			case 3:	volts[i] = T(12.0 - ((i & 1) ? 0.0049 : 0.0051)); break;
+			case 4: volts[i] = T(11.0 + (rand() % 2000) / 1000.0); break;
+			default: volts[i] = T(12.0 - ((i & 1) ? 0.1 : 0.0)); break;
+		}
+		other[i] = volts[i];
+		if(pattern == 5)
+			other[i] = T(12.0 - ((i & 1) ? 0.0 : 0.1));
+	}
+	//the first cell is always on, keep it highest in both sets
+	if(pattern == 5)
+	{
+		volts[0] = T(12.5);
+		other[0] = T(12.5);
+	}
+}
+
+/**
+ * @brief Measures the worst case of a controller instantiation
+ *
+ * @param name		name of the numeric type
+ * @param n		number of cells
+ * @param highest	highest single sample of any pattern, updated
+ * @return unsigned long long worst case cycles of one decision
+ */
+template<typename T>
+static unsigned long long measure(const char* name, int n, unsigned long long& highest)
+{
+	cBalanceController<T> controller;
+	T volts[CTRLMAXCELLS];
+	T other[CTRLMAXCELLS];
+	unsigned long long best[DECISIONS];
+	volatile uint32_t sink = 0;
+	unsigned long long overhead = ~0ULL, start, stop, worst = 0, most = 0;
+	int r, d, p;
+
+	for(r=0; r<REPETITIONS; r++)
+	{
+		start = cycles();
+		stop = cycles();
+		if(stop - start < overhead)
+			overhead = stop - start;
+	}
+
+	std::cout <<std::left <<std::setw(8) <<name <<std::right <<std::setw(6) <<n;
+	for(p=0; p<PATTERNS; p++)
+	{
+		fillPattern<T>(p, n, volts, other);
+		controller.reset();
+		controller.setWindow((p == 5) ? 1 : DECISIONS);
+		for(d=0; d<DECISIONS; d++)
+			best[d] = ~0ULL;
+		for(r=0; r<REPETITIONS; r++)
+		{
+			for(d=0; d<DECISIONS; d++)
+			{
+				start = cycles();
+				sink = controller.decide((d & 1) ? other : volts, n);
+				stop = cycles();
+				best[d] = (stop - start < best[d]) ? stop - start : best[d];
+				most = (stop - start > most) ? stop - start : most;
+			}
+		}
+		unsigned long long pattern = 0;
+		for(d=0; d<DECISIONS; d++)
+		{
+			best[d] = (best[d] > overhead) ? best[d] - overhead : 0;
+			pattern = (best[d] > pattern) ? best[d] : pattern;
+		}
+		worst = (pattern > worst) ? pattern : worst;
+		std::cout <<std::setw(12) <<pattern;
+	}
+	(void)sink;
+	most = (most > overhead) ? most - overhead : 0;
+	highest = (most > highest) ? most : highest;
+	std::cout <<std::setw(10) <<worst <<std::setw(10) <<most <<std::endl;
+	return worst;
+}
+
+/**
+ * @brief Runs the benchmark
+ *
+ * @param argc number of arguments
+ * @param argv optional cycle budget
+ * @return int 0 if the worst case is within the budget, 1 if not
+ */
+int main(int argc, char** argv)
+{
+	unsigned long long budget = CTRLCYCLEBUDGET;
+	unsigned long long worst = 0, highest = 0, w;
+	int sizes[] = {3, 16, CTRLMAXCELLS};
+	if(argc > 1)
+		budget = strtoull(argv[1], (char**)0, 10);
+
+	std::cout <<"Balancing controller cycles of the most expensive single decision of a window of " <<DECISIONS
+	<<" (minimum of " <<REPETITIONS <<" runs)\n";
+	std::cout <<std::left <<std::setw(8) <<"type" <<std::right <<std::setw(6) <<"cells";
+	for(int p=0; p<PATTERNS; p++)
+		std::cout <<std::setw(12) <<patternNames[p];
+	std::cout <<std::setw(10) <<"worst" <<std::setw(10) <<"sample" <<std::endl;
+
+	for(int s=0; s<3; s++)
+	{
+		w = measure<double>("double", sizes[s], highest);
+		worst = (w > worst) ? w : worst;
+		w = measure<float>("float", sizes[s], highest);
+		worst = (w > worst) ? w : worst;
+		w = measure< cFixed<32> >("Q31.32", sizes[s], highest);
+		worst = (w > worst) ? w : worst;
+	}
+
+	std::cout <<"Worst case " <<worst <<" cycles, highest sample with host noise " <<highest
+	<<" cycles, budget " <<budget <<" cycles: ";
+	if(worst > budget)
+	{
+		std::cout <<"FAILED" <<std::endl;
+		return 1;
+	}
+	std::cout <<"OK" <<std::endl;
+	return 0;
+}
@@ -0,0 +1,208 @@
+/**
+ * @file goldtrace.cpp
+ * @brief Regression check of the simulator against golden traces
+ *
+ * Runs a fixed corpus of discharge cases headless through cBattery and
+ * cSingleBatt on all cores. With -r it records the golden trace of
+ * every case, else it compares every case with its golden trace while
+ * it runs and reports the first divergent step and channel of each
+ * case that differs. Record the goldens from a trusted build before a
+ * change to the cell update or the balancing loop, check after it.
+ * With -q it runs the quick corpus instead, whose goldens are small
+ * enough to be kept in the repository and are checked by make check.
+ *
+ * Usage: goldtrace [-r] [-q] [-d <dir>] [-t <threads>] [-v <V>] [-c <A>] [-e <relative>] [-s <steps>] [case]...
+ *	-v, -c and -e are the absolute voltage, absolute current and
+ *	relative tolerances, -s the slack of a toggle in steps. The exit
+ *	status is 0 if every case passed.
+ *
+ * @author Subir Biswas
+ * @date 19/10/2026
+ * @see goldtrace.hpp
+ */
+
+#include "../header/goldtrace.hpp"
+#include "../header/jobrunner.hpp"
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#define GOLDCASES	24	///<Cases of the corpus
+#define GOLDQUICK	8	///<Cases of the quick corpus
+#define GOLDSCALE	0.01	///<Capacity of the cells of the quick corpus to those of the corpus
+
+/**
+ * @brief Draws the next number of a linear congruential generator
+ *
+ * @param seed state of the generator, updated
+ * @return double number from 0 to below 1
+ */
+double draw(unsigned int& seed)
+{
+	seed = seed * 1103515245U + 12345U;
+	return (double)((seed >> 8) & 0xFFFF) / 0x10000;
+}
+
+/**
+ * @brief Builds the corpus
+ *
+ * Case 0 is the default pack of the simulator. The others have 2 to 8
+ * random cells, loads of 50 to 150 Ohm and steps of 500 to 2000 mS,
+ * and every fourth case in turn a hysteresis band, a dwell or 4 physics
+ * substeps. The generator is seeded, so the corpus never changes.
+ *
+ * The quick corpus is the first GOLDQUICK cases with GOLDSCALE of the
+ * capacity, so each discharges in a hundredth of the steps and its
+ * golden files take about 300 kB.
+ * @param cases the corpus
+ * @param quick true for the quick corpus
+ * @return void
+ */
+void corpus(std::vector<sGoldCase>& cases, bool quick)
+{
+	static const double loads[3] = {50, 100, 150};
+	static const double resolutions[3] = {500, 1000, 2000};
+	unsigned int seed = 2026;
+	int count = quick ? GOLDQUICK : GOLDCASES;
+	double scale = quick ? GOLDSCALE : 1;
+	cases.assign(count, sGoldCase());
+	for(int k=0; k<count; k++)
+	{
+		sGoldCase& run = cases[k];
+		snprintf(run.Name, sizeof(run.Name), quick ? "quick%02d" : "case%02d", k);
+		run.HysteresisOn = 0.05;
+		run.HysteresisOff = (k % 4 == 1) ? 0.15 : 0.05;
+		run.DwellOn = (k % 4 == 2) ? 5 : 0;
+		run.DwellOff = run.DwellOn;
+		run.Substeps = (k % 4 == 3) ? 4 : 1;
+		if(k == 0)
+		{
+			run.Scenario.addCell(12.5, 20, 800 * scale, 95, 10);
+			run.Scenario.addCell(14.1, 30, 800 * scale, 95, 10);
+			run.Scenario.addCell(12.9, 40, 800 * scale, 95, 10);
+			run.Scenario.setLoad(150);
+			run.Scenario.setResolution(500);
+			continue;
+		}
+		int cells = 2 + (int)(draw(seed) * 7);
+		for(int i=0; i<cells; i++)
+			run.Scenario.addCell(11.5 + 3 * draw(seed), 10 + 40 * draw(seed), (600 + 400 * draw(seed)) * scale, 95, 10);
+		run.Scenario.setLoad(loads[(int)(draw(seed) * 3)]);
+		run.Scenario.setResolution(resolutions[(int)(draw(seed) * 3)]);
+	}
+}
+
+/**
+ * @brief Runs a case
+ *
+ * @param gold		the case
+ * @param result	result of the case
+ * @param dir		directory of the golden files
+ * @param record	true to record, false to compare
+ * @param tolerance	tolerances of the comparison
+ * @return void
+ */
+void runCase(const sGoldCase& gold, sGoldResult& result, const char* dir, bool record, sGoldTolerance tolerance)
+{
+	cGoldenTrace trace;
+	std::string path = std::string(dir) + "/" + gold.Name + ".gold";
+	if(record)
+		trace.record(gold, path.c_str(), result);
+	else
+		trace.compare(gold, path.c_str(), tolerance, result);
+}
+
+int main(int argc, char** argv)
+{
+	unsigned int threads = std::thread::hardware_concurrency();
+	const char* dir = "golden";
+	bool record = false;
+	bool quick = false;
+	sGoldTolerance tolerance;
+	std::vector<sGoldCase> all, cases;
+	std::vector<const char*> names;
+	tolerance.Voltage = 1e-6;
+	tolerance.Current = 1e-9;
+	tolerance.Relative = 1e-9;
+	tolerance.Slack = 0;
+
+	for(int a=1; a<argc; a++)
+	{
+		if(!strcmp(argv[a], "-r"))
+			record = true;
+		else if(!strcmp(argv[a], "-q"))
+			quick = true;
+		else if(!strcmp(argv[a], "-d") && a+1 < argc)
+			dir = argv[++a];
+		else if(!strcmp(argv[a], "-t") && a+1 < argc)
+			threads = atoi(argv[++a]);
+		else if(!strcmp(argv[a], "-v") && a+1 < argc)
+			tolerance.Voltage = atof(argv[++a]);
+		else if(!strcmp(argv[a], "-c") && a+1 < argc)
+			tolerance.Current = atof(argv[++a]);
+		else if(!strcmp(argv[a], "-e") && a+1 < argc)
+			tolerance.Relative = atof(argv[++a]);
+		else if(!strcmp(argv[a], "-s") && a+1 < argc)
+			tolerance.Slack = atoi(argv[++a]);
+		else if(argv[a][0] != '-')
+			names.push_back(argv[a]);
+		else
+		{
+			std::cout <<"Usage: " <<argv[0] <<" [-r] [-q] [-d <dir>] [-t <threads>] [-v <V>] [-c <A>] [-e <relative>] [-s <steps>] [case]..." <<std::endl;
+			return 2;
+		}
+	}
+	corpus(all, quick);
+	for(size_t k=0; k<all.size(); k++)
+	{
+		bool chosen = names.empty();
+		for(size_t n=0; n<names.size(); n++)
+			chosen = chosen || !strcmp(names[n], all[k].Name);
+		if(chosen)
+			cases.push_back(all[k]);
+	}
+	if(cases.empty() || tolerance.Slack < 0)
+	{
+		std::cout <<"No case to run." <<std::endl;
+		return 2;
+	}
+	if(record)
+		mkdir(dir, 0755);
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	std::vector<sGoldResult> results(cases.size());
+	if(threads < 1)
+		threads = 1;
+	runJobs((int)cases.size(), (int)threads, [&](int job) { runCase(cases[job], results[job], dir, record, tolerance); });
+	double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	int failed = 0;
+	unsigned long steps = 0;
+	std::cout <<"Case    Cells  Load(Ohm)  Step(ms)    Steps  Result\n" <<std::fixed;
+	for(size_t k=0; k<cases.size(); k++)
+	{
+		const sGoldResult& result = results[k];
+		const cScenario& scenario = cases[k].Scenario;
+		steps += result.Steps;
+		std::cout <<std::left <<std::setw(8) <<cases[k].Name <<std::right <<std::setw(5) <<scenario.getCount()
+		<<std::setprecision(0) <<std::setw(11) <<scenario.getLoad() <<std::setw(10) <<scenario.getResolution()
+		<<std::setw(9) <<result.Steps <<"  ";
+		if(result.Error[0] != 0)
+			std::cout <<"ERROR " <<result.Error <<"\n";
+		else if(result.Passed)
+			std::cout <<(record ? "recorded" : "passed") <<"\n";
+		else
+			std::cout <<"FAILED at step " <<result.Step <<" (" <<std::setprecision(3) <<result.Time/1000 <<" s) "
+			<<result.Channel <<": golden " <<std::setprecision(9) <<result.Golden <<", run " <<result.Actual <<"\n";
+		failed += (result.Error[0] != 0 || !result.Passed) ? 1 : 0;
+	}
+	std::cout <<cases.size() - failed <<" of " <<cases.size() <<" cases " <<(record ? "recorded" : "passed") <<", "
+	<<steps <<" steps on " <<threads <<" threads in " <<std::setprecision(2) <<wall <<" s" <<std::endl;
+	return failed ? 1 : 0;
+}
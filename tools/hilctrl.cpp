@@ -0,0 +1,106 @@
+/**
+ * @file hilctrl.cpp
+ * @brief Balancing controller of the hardware-in-the-loop stand-in
+ *
+ * Answers every measurement of the cell emulator with the switch mask
+ * of cBalanceController, the header only controller the BMS firmware
+ * runs. Uses only hillink.hpp and balancectrl.hpp, the way the firmware
+ * would. Ends when the emulator has finished.
+ *
+ * Usage: hilctrl [-n <name>] [-b <band V>]
+ *
+ * @author Subir Biswas
+ * @date 19/10/2026
+ * @see hillink.hpp
+ * @see hilemu.cpp
+ */
+
+#include "../header/hillink.hpp"
+#include "../header/balancectrl.hpp"
+#include <iostream>
+#include <stdlib.h>
+#include <signal.h>
+#include <sched.h>
+
+#define OPENWAIT	10000	///<Wait in micro seconds between two attempts to open the link
+#define OPENTRIES	1000	///<Attempts to open the link
+
+volatile sig_atomic_t Stop = 0;	///<Set by SIGINT
+
+/**
+ * @brief SIGINT handler, ends the controller
+ *
+ * @param signal the signal number
+ * @return void
+ */
+void onSignal(int signal)
+{
+	(void)signal;
+	Stop = 1;
+}
+
+int main(int argc, char** argv)
+{
+	const char* name = "/battbalancehil";
+	double band = 0;
+	int option;
+
+	while((option = getopt(argc, argv, "n:b:")) != -1)
+	{
+		if(option == 'n')
+			name = optarg;
+		else if(option == 'b')
+			band = atof(optarg);
+		else
+		{
+			std::cout <<"Usage: " <<argv[0] <<" [-n <name>] [-b <band V>]" <<std::endl;
+			return 2;
+		}
+	}
+
+	cHilLink link;
+	cBalanceController<double> controller;
+	cLatencyHistogram decision;
+	sHilMeasure measure;
+	sHilCommand command;
+	uint64_t start;
+
+	if(band > 0)
+		controller.setTolerance(band);
+	for(int tries=0; !link.open(name); tries++)
+	{
+		if(tries >= OPENTRIES)
+		{
+			std::cout <<"Can not open the link " <<name <<std::endl;
+			return 1;
+		}
+		usleep(OPENWAIT);
+	}
+	signal(SIGINT, onSignal);
+	std::cout <<"Controlling " <<name <<std::endl;
+
+	memset(&command, 0, sizeof(command));
+	while(!Stop)
+	{
+		if(!link.receiveMeasure(measure))
+		{
+			if(link.isClosed())
+				break;
+			sched_yield();
+			continue;
+		}
+		start = hilNow();
+		command.Mask = controller.decide(measure.Voltage, (measure.Count < HILMAXCELLS) ? measure.Count : HILMAXCELLS);
+		command.DecideTime = hilNow() - start;
+		command.Sequence = measure.Sequence;
+		command.SentTime = measure.SentTime;
+		decision.add(command.DecideTime);
+		while(!link.sendCommand(command) && !link.isClosed())
+			sched_yield();
+	}
+	link.close();
+
+	std::cout <<"\nAnswered " <<decision.getCount() <<" measurements, " <<controller.getDecisions() <<" decisions\n";
+	decision.print("Decision", std::cout);
+	return 0;
+}
@@ -0,0 +1,203 @@
+/**
+ * @file hilemu.cpp
+ * @brief Cell emulator of the hardware-in-the-loop stand-in
+ *
+ * Runs the cells of the simulator (cSingleBatt and the current
+ * sharing of cBattery) at a fixed rate in real time. Every tick it
+ * applies the latest switch mask received from the controller process,
+ * discharges the cells for one step and sends the cell voltages to the
+ * controller. At the end it prints the histograms of the round trip
+ * latency, of the tick jitter and of the decision time reported by
+ * the controller.
+ *
+ * Usage: hilemu [-n <name>] [-r <rate Hz>] [-c <ticks>] [-l <load Ohm>] [-t <resolution ms>]
+ *	Start hilctrl with the same name in another terminal.
+ *
+ * @author Subir Biswas
+ * @date 19/10/2026
+ * @see hillink.hpp
+ * @see hilctrl.cpp
+ */
+
+#include "../header/hillink.hpp"
+#include "../header/singlebatt.hpp"
+#include "../header/setbatt.hpp"
+#include <iostream>
+#include <stdlib.h>
+#include <signal.h>
+#include <sched.h>
+
+#define HILCONNECT	10	///<Seconds to wait for the controller to answer the first measurement
+
+volatile sig_atomic_t Stop = 0;	///<Set by SIGINT
+
+/**
+ * @brief SIGINT handler, ends the emulation
+ *
+ * @param signal the signal number
+ * @return void
+ */
+void onSignal(int signal)
+{
+	(void)signal;
+	Stop = 1;
+}
+
+/**
+ * @brief Sends the measurement of the cells
+ *
+ * @param link		the link to the controller
+ * @param tick		index of the tick
+ * @param battery	the battery
+ * @param cells		the cells of the battery
+ * @return bool false if the measurement ring is full
+ */
+bool sendMeasure(cHilLink& link, uint64_t tick, cBattery& battery, cSingleBatt* cells)
+{
+	sHilMeasure frame;
+	memset(&frame, 0, sizeof(frame));
+	frame.Sequence = tick;
+	frame.ElapsedTime = battery.getElapsedTime();
+	frame.Vout = battery.getVout();
+	frame.Iout = battery.getIout();
+	frame.Count = battery.getCellCount();
+	for(uint32_t i=0; i<frame.Count; i++)
+		frame.Voltage[i] = cells[i].getCurrentVoltage();
+	frame.SentTime = hilNow();
+	return link.sendMeasure(frame);
+}
+
+int main(int argc, char** argv)
+{
+	const char* name = "/battbalancehil";
+	double rate = 1000;
+	double load = 150;
+	double resolution = 10;
+	unsigned long long ticks = 0;
+	int option;
+
+	while((option = getopt(argc, argv, "n:r:c:l:t:")) != -1)
+	{
+		if(option == 'n')
+			name = optarg;
+		else if(option == 'r')
+			rate = atof(optarg);
+		else if(option == 'c')
+			ticks = strtoull(optarg, (char**)0, 10);
+		else if(option == 'l')
+			load = atof(optarg);
+		else if(option == 't')
+			resolution = atof(optarg);
+		else
+			rate = 0;
+	}
+	if(rate <= 0 || load <= 0 || resolution <= 0)
+	{
+		std::cout <<"Usage: " <<argv[0] <<" [-n <name>] [-r <rate Hz>] [-c <ticks>] [-l <load Ohm>] [-t <resolution ms>]" <<std::endl;
+		return 2;
+	}
+
+	cSingleBatt cells[3];
+	cBattery battery;
+	cells[0].setInitialVoltage(12.5);
+	cells[1].setInitialVoltage(14.1);
+	cells[2].setInitialVoltage(12.9);
+	cells[0].setSeriesResistance(20);
+	cells[1].setSeriesResistance(30);
+	cells[2].setSeriesResistance(40);
+	for(int i=0; i<3; i++)
+		battery.addCell(&cells[i]);
+
+	cHilLink link;
+	if(!link.create(name))
+	{
+		std::cout <<"Can not create the link " <<name <<std::endl;
+		return 1;
+	}
+	if(!battery.attach())
+	{
+		std::cout <<"Can not attach the cells" <<std::endl;
+		return 1;
+	}
+	signal(SIGINT, onSignal);
+
+	cLatencyHistogram roundTrip, jitter, decision;
+	sHilCommand command;
+	uint32_t mask = 0;
+	uint64_t period = (uint64_t)(1e9 / rate);
+	uint64_t tick = 0, missed = 0, dropped = 0, overruns = 0;
+	bool answered = false;
+
+	//the clock starts once the controller answered the first measurement
+	std::cout <<"Waiting for the controller on " <<name <<std::endl;
+	sendMeasure(link, tick, battery, cells);
+	uint64_t now, next = hilNow() + (uint64_t)HILCONNECT * 1000000000ULL;
+	while(!Stop && !answered)
+	{
+		if(link.receiveCommand(command))
+		{
+			mask = command.Mask;
+			answered = true;
+		}
+		else if(hilNow() > next)
+			break;
+		else
+			sched_yield();
+	}
+	if(!answered)
+	{
+		std::cout <<"No controller answered" <<std::endl;
+		return 1;
+	}
+	std::cout <<"Controller connected, running at " <<rate <<" Hz" <<std::endl;
+	tick = 1;
+	next = hilNow() + period;
+	while(!Stop)
+	{
+		while(link.receiveCommand(command))
+		{
+			now = hilNow();
+			roundTrip.add(now - command.SentTime);
+			decision.add(command.DecideTime);
+			//answers to earlier ticks are late, only the newest mask counts
+			if(command.Sequence == tick - 1)
+				answered = true;
+			mask = command.Mask;
+		}
+		now = hilNow();
+		if(now < next)
+		{
+			sched_yield();
+			continue;
+		}
+		jitter.add(now - next);
+		if(!answered)
+			missed++;
+		if(!battery.balance(mask))
+			break;
+		battery.discharge(battery.getVout() / load, resolution);
+		if(battery.getVout() < battery.getCutOffVoltage() || (ticks > 0 && tick >= ticks))
+			break;
+		if(!sendMeasure(link, tick, battery, cells))
+			dropped++;
+		answered = false;
+		tick++;
+		next += period;
+		//a tick later than a whole period is not caught up
+		if(now > next)
+		{
+			overruns++;
+			next = now + period;
+		}
+	}
+	link.close();
+	battery.detach();
+
+	std::cout <<"\nTicks " <<tick <<", simulated " <<battery.getElapsedTime()/1000 <<" s, cut off "
+		<<((battery.getVout() < battery.getCutOffVoltage()) ? "reached" : "not reached") <<"\n";
+	std::cout <<"Missed answers " <<missed <<", dropped measurements " <<dropped <<", overruns " <<overruns <<"\n\n";
+	roundTrip.print("Round trip", std::cout);
+	jitter.print("Tick jitter", std::cout);
+	decision.print("Controller decision", std::cout);
+	return 0;
+}
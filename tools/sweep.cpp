@@ -0,0 +1,113 @@
+/**
+ * @file sweep.cpp
+ * @brief Runs every balancing policy on every pack of a fleet in worker processes
+ *
+ * Cuts the packs of a scenario file into shards and runs them in
+ * worker processes, each pack at its start load with the cells of one
+ * module. An interrupted or crashed sweep resumes where it stopped when
+ * it is started again with the same directory. When every shard is done
+ * the results are merged into results.csv in the directory and the
+ * policies are ranked.
+ *
+ * Usage: sweep -f <scenario file> [-d <dir>] [-w <workers>] [-n <packs per shard>] [-c <cache dir>]
+ *	The exit status is 0 if the sweep is done.
+ *
+ * @author Subir Biswas
+ * @date 19/10/2026
+ * @see sweep.hpp
+ */
+
+#include "../header/sweep.hpp"
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <chrono>
+#include <stdlib.h>
+#include <string.h>
+
+int main(int argc, char** argv)
+{
+	const char* fleetName = (const char*)0;
+	const char* dir = "sweep";
+	const char* cacheName = (const char*)0;
+	int workers = (int)std::thread::hardware_concurrency();
+	int packs = SWEEPSHARD;
+	cFleet fleet;
+	cResultCache cache;
+	cSweep sweep;
+
+	for(int a=1; a<argc; a++)
+	{
+		if(!strcmp(argv[a], "-f") && a+1 < argc)
+			fleetName = argv[++a];
+		else if(!strcmp(argv[a], "-d") && a+1 < argc)
+			dir = argv[++a];
+		else if(!strcmp(argv[a], "-w") && a+1 < argc)
+			workers = atoi(argv[++a]);
+		else if(!strcmp(argv[a], "-n") && a+1 < argc)
+			packs = atoi(argv[++a]);
+		else if(!strcmp(argv[a], "-c") && a+1 < argc)
+			cacheName = argv[++a];
+		else
+		{
+			fleetName = (const char*)0;
+			break;
+		}
+	}
+	if(fleetName == (const char*)0)
+	{
+		std::cout <<"Usage: " <<argv[0] <<" -f <scenario file> [-d <dir>] [-w <workers>] [-n <packs per shard>] [-c <cache dir>]" <<std::endl;
+		return 2;
+	}
+	if(workers < 1)
+		workers = 1;
+	if(!fleet.load(fleetName))
+	{
+		std::cout <<fleetName;
+		if(fleet.getLine() > 0)
+			std::cout <<":" <<fleet.getLine();
+		std::cout <<": " <<fleet.getError() <<std::endl;
+		return 2;
+	}
+	if(cacheName != (const char*)0)
+	{
+		if(!cache.open(cacheName))
+		{
+			std::cout <<"Can not cache run results in " <<cacheName <<std::endl;
+			return 2;
+		}
+		sweep.setCache(&cache);
+	}
+	if(!sweep.open(dir, &fleet, packs))
+	{
+		std::cout <<dir <<": " <<sweep.getError() <<std::endl;
+		return 2;
+	}
+	std::cout <<"Sweep of " <<fleet.getPackCount() <<" packs in " <<sweep.getShardCount() <<" shards on " <<workers <<" workers";
+	if(sweep.getResumedCount() > 0)
+		std::cout <<", resuming with " <<sweep.getResumedCount() <<" shards done";
+	if(sweep.getTornCount() > 0)
+		std::cout <<", " <<sweep.getTornCount() <<" torn bytes cut from the journal";
+	std::cout <<std::endl;
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	if(!sweep.run(workers, std::cout) || !sweep.merge())
+	{
+		std::cout <<"Sweep stopped: " <<sweep.getError() <<", " <<sweep.getDoneCount() <<" of " <<sweep.getShardCount()
+		<<" shards done. Start it again to resume." <<std::endl;
+		return 1;
+	}
+	double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::cout <<"Rank  Policy      Runtime(s)  Imbalance(%)  Worst(%)  Wins\n";
+	for(int i=0; i<POLICIES; i++)
+	{
+		sPolicyResult result = sweep.getResult(i);
+		std::cout <<std::left <<std::setw(6) <<i+1 <<std::setw(10) <<result.Name <<std::right
+		<<std::fixed <<std::setprecision(2) <<std::setw(12) <<result.MeanRunTime/1000
+		<<std::setw(14) <<result.MeanImbalance <<std::setw(10) <<result.WorstImbalance
+		<<std::setw(6) <<result.Wins <<"\n";
+	}
+	std::cout <<(long)fleet.getPackCount() * POLICIES <<" runs, " <<sweep.getShardCount() - sweep.getResumedCount()
+	<<" shards in " <<std::setprecision(2) <<wall <<" s, results in " <<sweep.getResultPath() <<std::endl;
+	return 0;
+}
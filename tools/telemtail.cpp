@@ -0,0 +1,89 @@
+/**
+ * @file telemtail.cpp
+ * @brief Follows the shared memory telemetry ring of a simulator
+ *
+ * Prints every n-th step written by a simulator started with
+ * -m <name>, and at the end the number of steps read and lost.
+ * Uses only telemetry.hpp, the way an external monitor would.
+ *
+ * Usage: telemtail <name> [every n-th step] [-o]
+ *	-o starts at the oldest step still in the ring
+ *
+ * @author Subir Biswas
+ * @date 19/10/2026
+ * @see telemetry.hpp
+ */
+
+#include "../header/telemetry.hpp"
+#include <iostream>
+#include <iomanip>
+#include <stdlib.h>
+#include <signal.h>
+
+#define IDLEWAIT	1000	///<Wait in micro seconds when no step is new
+
+volatile sig_atomic_t Stop = 0;	///<Set by SIGINT
+
+/**
+ * @brief SIGINT handler, ends the tail
+ *
+ * @param signal the signal number
+ * @return void
+ */
+void onSignal(int signal)
+{
+	(void)signal;
+	Stop = 1;
+}
+
+int main(int argc, char** argv)
+{
+	cTelemetryReader reader;
+	sTelemetryRecord record;
+	unsigned long every = 1;
+	unsigned long long read = 0;
+	bool oldest = false;
+	const char* name = (const char*)0;
+
+	for(int a=1; a<argc; a++)
+	{
+		if(!strcmp(argv[a], "-o"))
+			oldest = true;
+		else if(name == (const char*)0)
+			name = argv[a];
+		else
+			every = strtoul(argv[a], (char**)0, 10);
+	}
+	if(name == (const char*)0 || every == 0)
+	{
+		std::cout <<"Usage: " <<argv[0] <<" <name> [every n-th step] [-o]" <<std::endl;
+		return 2;
+	}
+	if(!reader.open(name, oldest))
+	{
+		std::cout <<"Can not open telemetry ring " <<name <<std::endl;
+		return 1;
+	}
+	signal(SIGINT, onSignal);
+
+	std::cout <<std::fixed;
+	while(!Stop && !reader.isClosed())
+	{
+		if(!reader.next(record))
+		{
+			usleep(IDLEWAIT);
+			continue;
+		}
+		read++;
+		if(record.Step % every)
+			continue;
+		std::cout <<std::setw(10) <<record.Step <<std::setprecision(1) <<std::setw(12) <<record.ElapsedTime/1000 <<" s"
+		<<std::setprecision(3) <<std::setw(9) <<record.Vout <<" V" <<std::setw(10) <<record.Iout*1000 <<" mA ";
+		for(uint32_t i=0; i<record.Count; i++)
+			std::cout <<" " <<((record.Switches >> i) & 1 ? '*' : ' ') <<record.Voltage[i] <<"V/" <<std::setprecision(1)
+			<<record.Remaining[i] <<"%" <<std::setprecision(3);
+		std::cout <<"\n";
+	}
+	std::cout <<"Read " <<read <<" steps, lost " <<reader.getLost() <<std::endl;
+	return 0;
+}